@@ -0,0 +1,110 @@
+QT       -= core gui
+
+
+TARGET = ImplicitSkinningBatch
+
+DESTDIR = ../bin
+
+TEMPLATE = app
+
+CONFIG += console c++11
+CONFIG -= qt
+
+QMAKE_CXXFLAGS += -std=c++11 -O2 -g
+
+
+# Everything needed to load, fit and deform a model, without the GUI, Model or MachingCube
+SOURCES +=  main.cpp                                    \
+            ../src/ScalarField/*.cpp                    \
+            ../src/MeshSampler/*.cpp                    \
+            ../src/Threading/*.cpp                      \
+            ../src/Texture/*.cpp                        \
+            ../src/Model/modelloader.cpp                \
+            ../src/Model/rig.cpp                        \
+            ../src/Model/ImplicitSkinDeformer.cpp       \
+            ../src/Model/ImplicitSkinCpuKernels.cpp     \
+            ../src/Model/DeformerBackendRegistry.cpp    \
+            ../src/Model/CpuDeformerBackend.cpp
+
+HEADERS  += ../include/ScalarField/*.h                  \
+            ../include/ScalarField/Hrbf/*.h             \
+            ../include/MeshSampler/*.h                  \
+            ../include/Threading/*.h                    \
+            ../include/Model/mesh.h                     \
+            ../include/Model/rig.h                      \
+            ../include/Model/bone.h                     \
+            ../include/Model/boneAnim.h                 \
+            ../include/Model/modelloader.h              \
+            ../include/Model/implicitskindeformer.h     \
+            ../include/Model/implicitskincpukernels.h   \
+            ../include/Model/deformerbackend.h          \
+            ../include/Model/deformerbackendregistry.h  \
+            ../include/Model/cpudeformerbackend.h       \
+            ../include/Texture/BinaryBlob.h             \
+            ../include/Texture/SparseTexture3DCpu.h     \
+            ../include/Texture/Texture3DCpu.h           \
+            ../include/Texture/TextureBatch.h           \
+            ../include/Texture/TextureLanes.h           \
+            ../include/Texture/TextureStorage.h
+
+
+INCLUDEPATH +=  $$PWD/../include                    \
+                /usr/local/include                  \
+                /usr/include                        \
+                /usr/local/include/eigen3/          \
+                /home/idris/dev/include             \
+                /home/idris/dev/eigen/include/eigen3
+
+LIBS += -L/usr/local/lib -L/usr/lib -lpthread \
+        -L${HOME}/dev/lib -L/usr/local/lib -lassimp
+
+
+OBJECTS_DIR = ./obj
+
+
+
+#--------------------------------------------------------------------------
+# CUDA stuff
+#--------------------------------------------------------------------------
+
+# "qmake CONFIG+=cpu_only" builds without CUDA, OpenGL or an NVIDIA toolkit, with only the cpu backends
+cpu_only {
+    DEFINES += NO_CUDA
+} else {
+    SOURCES += ../src/Model/CudaDeformerBackend.cpp
+
+    HEADERS += ../include/Model/cudadeformerbackend.h   \
+               ../include/Texture/Texture3DCuda.h
+
+    HEADERS += $$PWD/../cuda_inc/*.*h
+
+    INCLUDEPATH +=  $$PWD/../cuda_inc \
+                    $$PWD/../include
+    CUDA_SOURCES += $$PWD/../cuda_src/ImplicitSkinGpuWrapper.cu \
+                    $$PWD/../cuda_src/ImplicitSkinKernels.cu
+    CUDA_PATH = /usr
+    NVCC = $$CUDA_PATH/bin/nvcc
+
+    SYSTEM_NAME = unix
+    SYSTEM_TYPE = 64
+    GENCODE_FLAGS += -arch=sm_50
+    NVCC_OPTIONS = -std=c++11 -ccbin g++ --compiler-options -fno-strict-aliasing --ptxas-options=-v
+
+    # include paths
+    INCLUDEPATH += $(CUDA_PATH)/include $(CUDA_PATH)/include/cuda
+
+    # library directories
+    QMAKE_LIBDIR += $$CUDA_PATH/lib/x86_64-linux-gnu $(CUDA_PATH)/include/cuda
+
+    CUDA_OBJECTS_DIR = $$PWD/cuda_obj
+
+    # The following makes sure all path names (which often include spaces) are put between quotation marks
+    CUDA_INC = $$join(INCLUDEPATH,' -I','-I','')
+    LIBS += -lcudart -lcurand
+
+    cuda.input = CUDA_SOURCES
+    cuda.output = $$CUDA_OBJECTS_DIR/${QMAKE_FILE_BASE}_cuda.o
+    cuda.commands = $$NVCC -m$$SYSTEM_TYPE $$GENCODE_FLAGS -c -o ${QMAKE_FILE_OUT} ${QMAKE_FILE_NAME} $$NVCC_OPTIONS $$CUDA_INC
+    cuda.dependency_type = TYPE_C
+    QMAKE_EXTRA_COMPILERS += cuda
+}
@@ -0,0 +1,381 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstdlib>
+
+#include "Model/modelloader.h"
+#include "Model/mesh.h"
+#include "Model/rig.h"
+#include "Model/implicitskindeformer.h"
+#include "Model/deformerbackendregistry.h"
+#include "Threading/threadpool.h"
+#include "Threading/framepipeline.h"
+
+
+//-------------------------------------------------------------------------------
+/// @brief Headless batch deformation, loads a model, builds the global field and
+/// deforms a range of animation frames without Qt or an OpenGL context.
+//-------------------------------------------------------------------------------
+
+
+typedef std::chrono::high_resolution_clock Clock;
+
+
+/// @struct BatchSettings
+/// @brief Command line settings for the batch deformer
+struct BatchSettings
+{
+    std::string modelFile;
+    std::string outputDir = ".";
+    int startFrame = 0;
+    int endFrame = -1;
+    float fps = 30.0f;
+    int numHrbfCentres = 50;
+    int iterations = 1;
+    std::string backend;
+    int numThreads = 0;
+    bool implicitSkin = true;
+    bool writeFrames = true;
+    bool lazyPrecompute = false;
+};
+
+
+/// @struct StageTimer
+/// @brief Accumulates the time spent in a pipeline stage
+struct StageTimer
+{
+    StageTimer(const std::string &_name) : name(_name), totalMs(0.0), count(0) {}
+
+    std::string name;
+    double totalMs;
+    int count;
+
+    void Add(const Clock::time_point &_start, const Clock::time_point &_end)
+    {
+        totalMs += std::chrono::duration<double, std::milli>(_end - _start).count();
+        count++;
+    }
+};
+
+//-------------------------------------------------------------------------------
+
+std::string BackendList()
+{
+    std::string list;
+    for(auto &name : DeformerBackendRegistry::Instance().GetAvailableBackends())
+    {
+        list += (list.empty() ? "" : ", ") + name;
+    }
+    return list;
+}
+
+//-------------------------------------------------------------------------------
+
+void PrintUsage(const char *_exe)
+{
+    std::cout<<"Usage: "<<_exe<<" <model file> [options]\n"
+             <<"  -o <dir>        output directory for deformed frames (default .)\n"
+             <<"  -s <frame>      first frame (default 0)\n"
+             <<"  -e <frame>      last frame (default end of animation)\n"
+             <<"  -f <fps>        frames per second used to sample the animation (default 30)\n"
+             <<"  -c <num>        number of HRBF centres per mesh part (default 50)\n"
+             <<"  -i <num>        number of projection and relaxation iterations (default 1)\n"
+             <<"  -t <num>        number of threads including the main thread (default all hardware threads)\n"
+             <<"  -b <name>       deformer backend, one of "<<BackendList()<<" or all (default fastest available)\n"
+             <<"  --lbw           only perform linear blend weight skinning\n"
+             <<"  --no-write      do not write deformed frames, only measure throughput\n"
+             <<"  --lazy          only precompute the fields where the frames reach them, the rest is filled\n"
+             <<"                  and the fields are cached after the last frame, CPU backends only\n";
+}
+
+//-------------------------------------------------------------------------------
+
+bool ParseArgs(int argc, char **argv, BatchSettings &_settings)
+{
+    for(int i=1; i<argc; i++)
+    {
+        std::string arg(argv[i]);
+        bool hasValue = (i+1 < argc);
+
+        if(arg == "-o" && hasValue)         { _settings.outputDir = argv[++i]; }
+        else if(arg == "-s" && hasValue)    { _settings.startFrame = atoi(argv[++i]); }
+        else if(arg == "-e" && hasValue)    { _settings.endFrame = atoi(argv[++i]); }
+        else if(arg == "-f" && hasValue)    { _settings.fps = atof(argv[++i]); }
+        else if(arg == "-c" && hasValue)    { _settings.numHrbfCentres = atoi(argv[++i]); }
+        else if(arg == "-i" && hasValue)    { _settings.iterations = atoi(argv[++i]); }
+        else if(arg == "-t" && hasValue)    { _settings.numThreads = atoi(argv[++i]); }
+        else if(arg == "-b" && hasValue)    { _settings.backend = argv[++i]; }
+        else if(arg == "--lbw")             { _settings.implicitSkin = false; }
+        else if(arg == "--no-write")        { _settings.writeFrames = false; }
+        else if(arg == "--lazy")            { _settings.lazyPrecompute = true; }
+        else if(arg[0] != '-' && _settings.modelFile.empty()) { _settings.modelFile = arg; }
+        else
+        {
+            std::cout<<"Unknown argument "<<arg<<"\n";
+            return false;
+        }
+    }
+
+    return !_settings.modelFile.empty() && _settings.fps > 0.0f;
+}
+
+//-------------------------------------------------------------------------------
+
+bool WriteObj(const std::string &_file,
+              const std::vector<glm::vec3> &_verts,
+              const std::vector<glm::vec3> &_norms,
+              const std::vector<glm::ivec3> &_tris)
+{
+    std::ofstream out(_file);
+    if(!out.is_open())
+    {
+        std::cout<<"Error opening "<<_file<<" for writing\n";
+        return false;
+    }
+
+    for(auto &v : _verts)
+    {
+        out<<"v "<<v.x<<" "<<v.y<<" "<<v.z<<"\n";
+    }
+    for(auto &n : _norms)
+    {
+        out<<"vn "<<n.x<<" "<<n.y<<" "<<n.z<<"\n";
+    }
+    for(auto &t : _tris)
+    {
+        out<<"f "<<t.x+1<<"//"<<t.x+1<<" "<<t.y+1<<"//"<<t.y+1<<" "<<t.z+1<<"//"<<t.z+1<<"\n";
+    }
+
+    return true;
+}
+
+/// @struct BatchFrame
+/// @brief A frame moving through the batch pipeline: posed, then deformed, then written
+struct BatchFrame
+{
+    BatchFrame(const int _frame = 0) : frame(_frame) {}
+
+    int frame;
+    std::vector<glm::mat4> boneTransforms;
+    std::vector<glm::vec3> verts;
+    std::vector<glm::vec3> norms;
+};
+
+//-------------------------------------------------------------------------------
+
+void DeformFrames(const BatchSettings &_settings,
+                  const std::string &_filePrefix,
+                  ImplicitSkinDeformer &_deformer,
+                  Rig &_rig,
+                  const Mesh &_mesh,
+                  const std::vector<StageTimer*> &_setupTimers)
+{
+    StageTimer animTimer("animate");
+    StageTimer lbwTimer("lbw skinning");
+    StageTimer implicitTimer("implicit skinning");
+    StageTimer writeTimer("write");
+
+    std::cout<<"\nDeforming "<<_mesh.m_meshVerts.size()<<" vertices with the "<<_deformer.GetBackendName()<<" backend, frames "<<_settings.startFrame<<" to "<<_settings.endFrame<<"\n";
+
+    // Pose frame N+1 and write frame N-1 while frame N is deformed, each timer is only touched by its own stage
+    auto poseFrame = [&](BatchFrame &_frame){
+        auto t0 = Clock::now();
+        _rig.EvaluatePose(_frame.frame / _settings.fps, _frame.boneTransforms);
+        animTimer.Add(t0, Clock::now());
+    };
+
+    auto deformFrame = [&](BatchFrame &_frame){
+        auto t1 = Clock::now();
+        _deformer.SetRigidTransforms(_frame.boneTransforms);
+        _deformer.PerformLBWSkinning();
+        auto t2 = Clock::now();
+        lbwTimer.Add(t1, t2);
+
+        if(_settings.implicitSkin)
+        {
+            _deformer.PerformImplicitSkinning();
+            implicitTimer.Add(t2, Clock::now());
+        }
+
+        if(_settings.writeFrames)
+        {
+            _frame.verts = _deformer.GetDeformedMeshVerts();
+            _frame.norms = _deformer.GetDeformedMeshNorms();
+        }
+    };
+
+    auto writeFrame = [&](BatchFrame &_frame){
+        if(!_settings.writeFrames)
+        {
+            return;
+        }
+
+        auto t0 = Clock::now();
+        std::stringstream file;
+        file << _settings.outputDir << "/" << _filePrefix << "frame_" << std::setw(4) << std::setfill('0') << _frame.frame << ".obj";
+        WriteObj(file.str(), _frame.verts, _frame.norms, _mesh.m_meshTris);
+        writeTimer.Add(t0, Clock::now());
+    };
+
+    FramePipeline<BatchFrame> pipeline(poseFrame, deformFrame, writeFrame);
+
+    auto framesStart = Clock::now();
+    BatchFrame finished;
+    for(int frame=_settings.startFrame; frame<=_settings.endFrame; frame++)
+    {
+        // Hand the last written frame back in so its buffers are reused
+        finished.frame = frame;
+        pipeline.Advance(std::move(finished), finished);
+    }
+    while(pipeline.Flush(finished))
+    {
+    }
+    double framesMs = std::chrono::duration<double, std::milli>(Clock::now() - framesStart).count();
+
+
+    //-------------------------------------------------------------------
+    // Report
+    int numFrames = _settings.endFrame - _settings.startFrame + 1;
+    numFrames = numFrames > 0 ? numFrames : 0;
+    double deformMs = animTimer.totalMs + lbwTimer.totalMs + implicitTimer.totalMs;
+
+    std::vector<StageTimer*> timers(_setupTimers);
+    timers.insert(timers.end(), {&animTimer, &lbwTimer, &implicitTimer, &writeTimer});
+
+    std::cout<<std::fixed<<std::setprecision(3);
+    std::cout<<"Stage timings (ms)\n";
+    for(auto *timer : timers)
+    {
+        if(timer->count == 0) { continue; }
+        std::cout<<"  "<<std::left<<std::setw(20)<<timer->name<<std::right
+                 <<" total "<<std::setw(12)<<timer->totalMs
+                 <<"  avg "<<std::setw(10)<<timer->totalMs / timer->count<<"\n";
+    }
+
+    if(numFrames > 0)
+    {
+        std::cout<<"\nFrames:          "<<numFrames<<"\n";
+        std::cout<<"Deform fps:      "<<(deformMs > 0.0 ? 1000.0 * numFrames / deformMs : 0.0)<<"\n";
+        std::cout<<"Overall fps:     "<<(framesMs > 0.0 ? 1000.0 * numFrames / framesMs : 0.0)<<"\n";
+    }
+}
+
+//-------------------------------------------------------------------------------
+
+int main(int argc, char **argv)
+{
+    BatchSettings settings;
+    if(!ParseArgs(argc, argv, settings))
+    {
+        PrintUsage(argv[0]);
+        return 1;
+    }
+
+    if(settings.numThreads > 0)
+    {
+        ThreadPool::Instance().SetNumWorkers(settings.numThreads - 1);
+    }
+
+    StageTimer loadTimer("load");
+    StageTimer fieldTimer("global field");
+
+
+    //-------------------------------------------------------------------
+    // Load model
+    Mesh mesh;
+    Mesh rigMesh;
+    Rig rig;
+
+    auto t0 = Clock::now();
+    if(!ModelLoader::LoadModel(settings.modelFile, mesh, rigMesh, rig))
+    {
+        return 1;
+    }
+    loadTimer.Add(t0, Clock::now());
+
+
+    //-------------------------------------------------------------------
+    // Select backends
+    ImplicitSkinDeformer deformer;
+    std::vector<std::string> backends;
+    if(settings.backend == "all")
+    {
+        backends = DeformerBackendRegistry::Instance().GetAvailableBackends();
+    }
+    else if(!settings.backend.empty())
+    {
+        if(!deformer.SetBackend(settings.backend))
+        {
+            return 1;
+        }
+        backends.push_back(settings.backend);
+    }
+    else
+    {
+        backends.push_back(deformer.GetBackendName());
+    }
+
+
+    //-------------------------------------------------------------------
+    // Build the global field
+    t0 = Clock::now();
+    deformer.AttachMesh(mesh, rig.m_boneTransforms);
+    deformer.SetIterations(settings.iterations);
+    deformer.SetLazyPrecompute(settings.lazyPrecompute);
+
+    std::vector<Mesh> meshParts;
+    mesh.GenerateMeshParts(meshParts, rig.m_boneNameIdMapping.size());
+
+    std::vector<std::pair<glm::vec3, glm::vec3>> boneEnds;
+    for(unsigned int i=0; i<meshParts.size(); i++)
+    {
+        boneEnds.push_back(std::make_pair(rigMesh.m_meshVerts[i*2], rigMesh.m_meshVerts[(i*2) + 1]));
+    }
+    deformer.GenerateGlobalFieldFunction(meshParts, boneEnds, settings.numHrbfCentres);
+    fieldTimer.Add(t0, Clock::now());
+
+
+    //-------------------------------------------------------------------
+    // Deform frames with each backend
+    if(settings.endFrame < 0)
+    {
+        float duration = (rig.m_animExists && rig.m_ticksPerSecond > 0.0f) ? rig.m_animationDuration / rig.m_ticksPerSecond : 0.0f;
+        settings.endFrame = (int)(duration * settings.fps);
+    }
+
+    bool reportSetup = true;
+    for(auto &backend : backends)
+    {
+        if(!deformer.SetBackend(backend))
+        {
+            continue;
+        }
+
+        // Only report the shared setup once, and keep frames from different backends apart
+        std::vector<StageTimer*> setupTimers;
+        if(reportSetup)
+        {
+            setupTimers = {&loadTimer, &fieldTimer};
+            reportSetup = false;
+        }
+        std::string filePrefix = backends.size() > 1 ? backend + "_" : "";
+
+        DeformFrames(settings, filePrefix, deformer, rig, mesh, setupTimers);
+    }
+
+
+    //-------------------------------------------------------------------
+    // Fill what the frames did not reach, so the next run loads every field from the cache
+    if(settings.lazyPrecompute)
+    {
+        t0 = Clock::now();
+        deformer.FinishLazyPrecompute();
+        std::cout<<"\nFinished lazy fields in "<<std::chrono::duration<double, std::milli>(Clock::now() - t0).count()<<" ms\n";
+    }
+
+    return 0;
+}
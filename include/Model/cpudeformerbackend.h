@@ -0,0 +1,83 @@
+#ifndef CPUDEFORMERBACKEND_H
+#define CPUDEFORMERBACKEND_H
+
+//--------------------------------------------------------------------------------
+
+#include <functional>
+
+#include "Model/deformerbackend.h"
+
+
+//--------------------------------------------------------------------------------
+/// @author Idris Miles
+/// @version 1.0
+/// @data 18/04/2017
+//--------------------------------------------------------------------------------
+
+
+/// @class CpuDeformerBackend
+/// @brief Deformer backend running the isck CPU kernels.
+/// Single threaded this is the reference backend ("cpu"),
+/// otherwise vertices are split across the shared ThreadPool ("cpu-mt").
+/// Both evaluate the field a chunk of vertices at a time, with the texture lookups vectorised where the CPU supports it, see TextureKernels.
+class CpuDeformerBackend : public DeformerBackend
+{
+public:
+    /// @brief Constructor.
+    /// @param _multithreaded : whether to deform on the shared ThreadPool or only the calling thread
+    CpuDeformerBackend(const bool _multithreaded = false);
+
+    /// @brief Destructor.
+    virtual ~CpuDeformerBackend();
+
+    virtual std::string GetName() const override;
+    virtual void AttachMesh(const DeformerMeshData &_meshData, const BufferId _meshVBO, const BufferId _meshNBO) override;
+    virtual void AttachGlobalField(GlobalFieldFunction &_globalField) override;
+    virtual void SetRigidTransforms(const std::vector<glm::mat4> &_transforms) override;
+    virtual void PerformLBWSkinning() override;
+    virtual void PerformImplicitSkinning(const float _sigma, const float _contactAngle, const int _iterations) override;
+    virtual void EvalGlobalField(std::vector<float> &_output, const std::vector<glm::vec3> &_samplePoints) override;
+    virtual const std::vector<glm::vec3> &GetDeformedMeshVerts() override;
+    virtual const std::vector<glm::vec3> &GetDeformedMeshNorms() override;
+
+
+private:
+    /// @brief Method to run _threadFunc over [0:_dataSize), on the shared ThreadPool when multithreaded
+    /// @param _threadFunc : function taking the start and end of a chunk
+    /// @param _dataSize : the number of elements to process
+    void ParallelFor(const std::function<void(int, int)> &_threadFunc, const int _dataSize);
+
+    /// @brief Whether to deform on the shared ThreadPool.
+    bool m_multithreaded;
+
+    /// @brief The attached mesh data.
+    const DeformerMeshData *m_meshData;
+
+    /// @brief The attached global field.
+    GlobalFieldFunction *m_globalField;
+
+    /// @brief Deformed mesh vertices.
+    std::vector<glm::vec3> m_deformedMeshVerts;
+
+    /// @brief Deformed mesh normals.
+    std::vector<glm::vec3> m_deformedMeshNorms;
+
+    /// @brief Scratch buffer tangential relaxation writes into before being swapped with m_deformedMeshVerts.
+    std::vector<glm::vec3> m_relaxedMeshVerts;
+
+    /// @brief Iso value of each vertex in the rest pose.
+    std::vector<float> m_origVertIso;
+
+    /// @brief Gradient of the global field at each vertex from the previous step.
+    std::vector<glm::vec3> m_vertIsoGrad;
+
+    /// @brief Bone transforms.
+    std::vector<glm::mat4> m_transforms;
+
+    /// @brief a bool to check if the iso values have been initialised.
+    bool m_initIsoValues;
+};
+
+//--------------------------------------------------------------------------------
+
+#endif // CPUDEFORMERBACKEND_H
@@ -0,0 +1,195 @@
+#ifndef CUDADEFORMERBACKEND_H
+#define CUDADEFORMERBACKEND_H
+
+//--------------------------------------------------------------------------------
+
+#include <cuda_runtime.h>
+#include <cuda.h>
+#include <cuda_gl_interop.h>
+
+#include "Model/deformerbackend.h"
+
+
+//--------------------------------------------------------------------------------
+/// @author Idris Miles
+/// @version 1.0
+/// @data 18/04/2017
+//--------------------------------------------------------------------------------
+
+
+/// @class CudaDeformerBackend
+/// @brief Deformer backend running the isgw CUDA kernels.
+/// When the mesh is attached with OpenGL buffers the kernels deform the VBO and NBO directly,
+/// otherwise the deformed mesh lives in device memory and is downloaded on request.
+class CudaDeformerBackend : public DeformerBackend
+{
+public:
+    /// @brief Constructor.
+    CudaDeformerBackend();
+
+    /// @brief Destructor.
+    virtual ~CudaDeformerBackend();
+
+    /// @brief Method to check if a CUDA device is available.
+    static bool IsAvailable();
+
+    virtual std::string GetName() const override;
+    virtual void AttachMesh(const DeformerMeshData &_meshData, const BufferId _meshVBO, const BufferId _meshNBO) override;
+    virtual void AttachGlobalField(GlobalFieldFunction &_globalField) override;
+    virtual void SetRigidTransforms(const std::vector<glm::mat4> &_transforms) override;
+    virtual void PerformLBWSkinning() override;
+    virtual void PerformImplicitSkinning(const float _sigma, const float _contactAngle, const int _iterations) override;
+    virtual void EvalGlobalField(std::vector<float> &_output, const std::vector<glm::vec3> &_samplePoints) override;
+    virtual const std::vector<glm::vec3> &GetDeformedMeshVerts() override;
+    virtual const std::vector<glm::vec3> &GetDeformedMeshNorms() override;
+    virtual bool DeformsMeshBuffers() const override;
+    virtual bool SamplesGpuTextures() const override;
+
+
+private:
+    //--------------------------------------------------------------------
+    // Methods for initlaising the backend
+
+    /// @brief Method to initialise CUDA memory that will hold the mesh to be deformed
+    /// @param _meshData : The mesh we which to upload to the GPU
+    /// @param _memshVBO : The meshes vertex buffer object which we need to map resources inorder to drectly deform the meshes vertices on the GPU
+    /// @param _memshNBO : The meshes norrmal buffer object which we need to map resources inorder to drectly deform the meshes normals on the GPU
+    void InitMeshCudaMem(const DeformerMeshData &_meshData, const BufferId _meshVBO, const BufferId _meshNBO);
+
+    /// @brief Method to initialise CUDA memory that will hold the global field
+    void InitFieldCudaMem(GlobalFieldFunction &_globalField);
+
+    /// @brief Method to initialise the Iso values of each mesh vertex in the global field
+    void InitialiseIsoValues();
+
+    /// @brief Method to clean up CUDA memory allocated for storing the mesh
+    void DestroyMeshCudaMem();
+
+    /// @brief Method to clean up CUDA memory allocated for storing the global field
+    void DestroyFieldCudaMem();
+
+
+    //--------------------------------------------------------------------
+    // Methods for accessing GPU resources within the backend
+
+    /// @brief Method to get the device side pointer to deformed mesh vertices for use in CUDA kernels.
+    /// @brief We must map resources before directly accessing it.
+    glm::vec3 *GetDeformedMeshVertsDevicePtr();
+
+    /// @brief Method to release the device side pointer so OpenGL can use the VBO holding the deformed mesh vertices.
+    /// @brief We must unmap resources once we are finished using it.
+    void ReleaseDeformedMeshVertsDevicePtr();
+
+    /// @brief Method to get the device side pointer to deformed mesh normals for use in CUDA kernels
+    /// @brief We must map resources before directly accessing it.
+    glm::vec3 *GetDeformedMeshNormsDevicePtr();
+
+    /// @brief Method to release the device side pointer so OpenGL can use the NBO holding the deformed mesh normals.
+    /// @brief We must unmap resources once we are finished using it.
+    void ReleaseDeformedMeshNormsDevicePtr();
+
+
+    //---------------------------------------------------------------------
+    // CPU Attributes
+
+    /// @brief The CUDA graphics resource to map the mesh vertex buffer object to a pointer that can be used within a CUDA kernel
+    cudaGraphicsResource *m_meshVBO_CUDA;
+
+    /// @brief The CUDA graphics resource to map the mesh normal buffer object to a pointer that can be used within a CUDA kernel
+    cudaGraphicsResource *m_meshNBO_CUDA;
+
+    /// @brief A boolean to check whether the deformed mesh lives in OpenGL buffers rather than plain device memory.
+    bool m_useMeshBuffers;
+
+    /// @brief A boolean to check whether the m_meshVBO_CUDA object has been mapped.
+    bool m_deformedMeshVertsMapped;
+
+    /// @brief A boolean to check whether the m_meshNBO_CUDA object has been mapped.
+    bool m_deformedMeshNormsMapped;
+
+    /// @brief a bool to check if we have uploaded mesh data to cuda
+    bool m_initMeshCudaMem;
+
+    /// @brief a bool to check if we have uploaded field data to cuda
+    bool m_initFieldCudaMem;
+
+    /// @brief The number of vertices in the mesh that has been attached for deformation.
+    int m_numVerts;
+
+    /// @brief The number of primitive fields that our global field is composed of.
+    uint m_numFields;
+
+    /// @brief The number of composition operators
+    uint m_numCompOps;
+
+    /// @brief The number of composed fields that our global field is composed of.
+    uint m_numCompFields;
+
+    /// @brief The number of bone transforms
+    int m_numTransforms;
+
+    /// @brief Host copy of the deformed mesh vertices, filled by GetDeformedMeshVerts
+    std::vector<glm::vec3> m_deformedMeshVerts;
+
+    /// @brief Host copy of the deformed mesh normals, filled by GetDeformedMeshNorms
+    std::vector<glm::vec3> m_deformedMeshNorms;
+
+
+    //---------------------------------------------------------------------
+    // GPU data
+
+    /// @brief
+    glm::vec3 *d_deformedMeshVertsPtr;
+
+    /// @brief
+    glm::vec3 *d_origMeshVertsPtr;
+
+    /// @brief
+    glm::vec3 *d_deformedMeshNormsPtr;
+
+    /// @brief
+    glm::vec3 *d_origMeshNormsPtr;
+
+    /// @brief
+    int *d_oneRingIdPtr;
+
+    /// @brief
+    int *d_oneRingScatterAddrPtr;
+
+    /// @brief
+    float *d_centroidWeightsPtr;
+
+    /// @brief
+    float *d_origVertIsoPtr;
+
+    /// @brief
+    glm::vec3 *d_vertIsoGradPtr;
+
+    /// @brief
+    glm::mat4 *d_transformPtr;
+
+    /// @brief
+    glm::mat4 *d_textureSpacePtr;
+
+    /// @brief
+    cudaTextureObject_t *d_fieldsPtr;
+
+    /// @brief
+    cudaTextureObject_t *d_compOpPtr;
+
+    /// @brief
+    cudaTextureObject_t *d_thetaPtr;
+
+    /// @brief
+    ComposedFieldCuda *d_compFieldPtr;
+
+    /// @brief
+    unsigned int *d_boneIdPtr;
+
+    /// @brief
+    float *d_weightPtr;
+};
+
+//--------------------------------------------------------------------------------
+
+#endif // CUDADEFORMERBACKEND_H
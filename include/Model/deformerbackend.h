@@ -0,0 +1,119 @@
+#ifndef DEFORMERBACKEND_H
+#define DEFORMERBACKEND_H
+
+//--------------------------------------------------------------------------------
+
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "ScalarField/globalfieldfunction.h"
+
+
+//--------------------------------------------------------------------------------
+/// @author Idris Miles
+/// @version 1.0
+/// @data 18/04/2017
+//--------------------------------------------------------------------------------
+
+
+/// @typedef BufferId
+/// @brief Name of an OpenGL buffer object, the same type as GLuint, so backends that never touch OpenGL do not need its headers.
+typedef unsigned int BufferId;
+
+
+/// @struct DeformerMeshData
+/// @brief Host side mesh data shared by all deformer backends, built once when a mesh is attached to the deformer.
+struct DeformerMeshData
+{
+    /// @brief The number of vertices in the mesh.
+    int numVerts;
+
+    /// @brief Original mesh vertices.
+    std::vector<glm::vec3> origVerts;
+
+    /// @brief Original mesh normals.
+    std::vector<glm::vec3> origNorms;
+
+    /// @brief Bone ids, 4 per vertex.
+    std::vector<unsigned int> boneIds;
+
+    /// @brief Normalised bone weights, 4 per vertex.
+    std::vector<float> weights;
+
+    /// @brief Flat array of one ring neighbour ids.
+    std::vector<int> oneRingIds;
+
+    /// @brief Start index into oneRingIds for each vertex, has numVerts+1 entries.
+    std::vector<int> oneRingScatterAddr;
+
+    /// @brief One ring centroid weights calculated using MVC, one per entry in oneRingIds.
+    std::vector<float> centroidWeights;
+
+    /// @brief The rest bone transforms.
+    std::vector<glm::mat4> restTransforms;
+};
+
+
+//--------------------------------------------------------------------------------
+
+/// @class DeformerBackend
+/// @brief Abstract interface for where and how the implicit skinning steps are computed.
+/// The ImplicitSkinDeformer owns the mesh data and the global field, a backend owns
+/// whatever per vertex state and device resources it needs to deform the mesh.
+class DeformerBackend
+{
+public:
+    /// @brief Destructor.
+    virtual ~DeformerBackend() {}
+
+    /// @brief Method to get the name this backend is registered under.
+    virtual std::string GetName() const = 0;
+
+    /// @brief Method to attach the mesh to deform.
+    /// @param _meshData : host side mesh data, must outlive the backend
+    /// @param _meshVBO : The meshes vertex buffer object, 0 if there is no OpenGL context
+    /// @param _meshNBO : The meshes normal buffer object, 0 if there is no OpenGL context
+    virtual void AttachMesh(const DeformerMeshData &_meshData, const BufferId _meshVBO, const BufferId _meshNBO) = 0;
+
+    /// @brief Method to attach the generated global field, this initialises the iso values of the mesh vertices.
+    /// @param _globalField : the global field, must outlive the backend
+    virtual void AttachGlobalField(GlobalFieldFunction &_globalField) = 0;
+
+    /// @brief Method to update the bone transforms used for linear blend weight skinning.
+    /// @param _transforms : Updated bone transforms
+    virtual void SetRigidTransforms(const std::vector<glm::mat4> &_transforms) = 0;
+
+    /// @brief Method to perform linear blend weight skinning.
+    virtual void PerformLBWSkinning() = 0;
+
+    /// @brief Method to perform the vertex projection and tangential relaxation iterations of implicit skinning.
+    /// @param _sigma : scaling value for vertex projection step
+    /// @param _contactAngle : threshold for running vertex projection step
+    /// @param _iterations : number of projection and relaxation iterations
+    virtual void PerformImplicitSkinning(const float _sigma, const float _contactAngle, const int _iterations) = 0;
+
+    /// @brief Method to evaluate the global field at a set of sample points.
+    /// @param _output : The output values of the evaulated field at the sample points, already sized.
+    /// @param _samplePoints : positions in 3D space to sample the global field.
+    virtual void EvalGlobalField(std::vector<float> &_output, const std::vector<glm::vec3> &_samplePoints) = 0;
+
+    /// @brief Method to get the deformed mesh vertices on the host.
+    virtual const std::vector<glm::vec3> &GetDeformedMeshVerts() = 0;
+
+    /// @brief Method to get the deformed mesh normals on the host.
+    virtual const std::vector<glm::vec3> &GetDeformedMeshNorms() = 0;
+
+    /// @brief Method to check if this backend writes the deformed mesh straight into the attached OpenGL buffers,
+    /// otherwise the caller needs to upload GetDeformedMeshVerts and GetDeformedMeshNorms itself.
+    virtual bool DeformsMeshBuffers() const { return false; }
+
+    /// @brief Method to check if this backend samples the CUDA textures of the global field,
+    /// which lazily precomputed fields only get once they are finished, see ImplicitSkinDeformer::SetLazyPrecompute.
+    virtual bool SamplesGpuTextures() const { return false; }
+};
+
+//--------------------------------------------------------------------------------
+
+#endif // DEFORMERBACKEND_H
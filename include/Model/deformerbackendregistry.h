@@ -0,0 +1,78 @@
+#ifndef DEFORMERBACKENDREGISTRY_H
+#define DEFORMERBACKENDREGISTRY_H
+
+//--------------------------------------------------------------------------------
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <functional>
+
+#include "Model/deformerbackend.h"
+
+
+//--------------------------------------------------------------------------------
+/// @author Idris Miles
+/// @version 1.0
+/// @data 18/04/2017
+//--------------------------------------------------------------------------------
+
+
+/// @class DeformerBackendRegistry
+/// @brief Registry of deformer backends, each registered with a priority and an availability check
+/// so the fastest backend available on this machine can be picked at runtime.
+/// The built in backends are "cuda", "cpu-mt" and "cpu", there is no "cuda" when built with NO_CUDA.
+class DeformerBackendRegistry
+{
+public:
+    /// @typedef Factory, creates a new instance of a backend.
+    typedef std::function<std::unique_ptr<DeformerBackend>()> Factory;
+
+    /// @typedef AvailabilityCheck, returns whether a backend can run on this machine.
+    typedef std::function<bool()> AvailabilityCheck;
+
+    /// @brief Method to get the registry.
+    static DeformerBackendRegistry &Instance();
+
+    /// @brief Method to register a backend, replaces any backend already registered under the same name.
+    /// @param _name : name used to select the backend
+    /// @param _priority : higher priority backends are preferred by CreateFastestAvailable
+    /// @param _factory : function creating the backend
+    /// @param _isAvailable : function checking the backend can run on this machine
+    void Register(const std::string &_name, const int _priority, Factory _factory, AvailabilityCheck _isAvailable);
+
+    /// @brief Method to create a backend by name.
+    /// @return the backend, or nullptr if it is not registered or not available.
+    std::unique_ptr<DeformerBackend> Create(const std::string &_name) const;
+
+    /// @brief Method to create the highest priority available backend.
+    std::unique_ptr<DeformerBackend> CreateFastestAvailable() const;
+
+    /// @brief Method to check if a backend is registered and available.
+    bool IsAvailable(const std::string &_name) const;
+
+    /// @brief Method to get the names of the available backends, highest priority first.
+    std::vector<std::string> GetAvailableBackends() const;
+
+
+private:
+    /// @brief Constructor, registers the built in backends.
+    DeformerBackendRegistry();
+
+    /// @struct Entry
+    /// @brief A registered backend.
+    struct Entry
+    {
+        std::string name;
+        int priority;
+        Factory factory;
+        AvailabilityCheck isAvailable;
+    };
+
+    /// @brief Registered backends sorted by priority, highest first.
+    std::vector<Entry> m_entries;
+};
+
+//--------------------------------------------------------------------------------
+
+#endif // DEFORMERBACKENDREGISTRY_H
@@ -0,0 +1,149 @@
+#ifndef IMPLICITSKINCPUKERNELS_H
+#define IMPLICITSKINCPUKERNELS_H
+
+//--------------------------------------------------------------------------------------------------------------
+
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "ScalarField/globalfieldfunction.h"
+
+
+//--------------------------------------------------------------------------------------------------------------
+/// @author Idris Miles
+/// @version 1.0
+/// @data 18/04/2017
+//--------------------------------------------------------------------------------------------------------------
+
+/// @namespace isck, Implicit Skin CPU Kernels (isck), CPU counterparts of the Implicit Skinning CUDA kernels.
+/// Each function processes the vertex range [_startVert, _endVert) so callers can split the mesh across threads,
+/// the same way isgw splits it across CUDA blocks.
+namespace isck {
+
+
+/// @brief Function to project a point onto a plane
+/// @param _point : The point to project
+/// @param _planeOrigin : A point on the plane
+/// @param _planeNormal : The normal of the plane
+glm::vec3 ProjectPointOnToPlane(const glm::vec3 &_point, const glm::vec3 &_planeOrigin, const glm::vec3 &_planeNormal);
+
+
+/// @brief Function to evaluate the global field and its gradient at a sample point,
+/// uses the same forward difference step as the CUDA implementation.
+/// @param _outputF : The value of the global field at the sample point
+/// @param _outputG : The gradient of the global field at the sample point
+/// @param _samplePoint : The position in 3D space to sample the global field
+/// @param _globalField : The global field to evaluate
+void EvalGradGlobalField(float &_outputF,
+                         glm::vec3 &_outputG,
+                         const glm::vec3 &_samplePoint,
+                         GlobalFieldFunction &_globalField);
+
+
+/// @brief Function to evaluate the global field and its gradient at many sample points, the values EvalGradGlobalField gives.
+/// The 4 points of each sample point's forward differences are gathered so a chunk of sample points
+/// is evaluated with one GlobalFieldFunction::EvalBatch.
+/// @param _outputF : Pointer to the value of the global field at each sample point
+/// @param _outputG : Pointer to the gradient of the global field at each sample point
+/// @param _samplePoints : Const pointer to the positions in 3D space to sample the global field
+/// @param _numPoints : The number of sample points
+/// @param _globalField : The global field to evaluate
+/// @param _fieldTransforms : One transform per field function, see GlobalFieldFunction::GetFieldTransforms,
+/// or nullptr to use the field functions' own transforms
+void EvalGradGlobalField(float *_outputF,
+                         glm::vec3 *_outputG,
+                         const glm::vec3 *_samplePoints,
+                         const int _numPoints,
+                         GlobalFieldFunction &_globalField,
+                         const std::vector<glm::mat4> *_fieldTransforms = nullptr);
+
+
+/// @brief Function to perform linear blend weight skinning
+/// @param _deformedVert : Pointer to the deformed vertices
+/// @param _origVert : Const pointer to the original mesh vertices
+/// @param _deformedNorms : Pointer to the deformed normals
+/// @param _origNorms : Const pointer to the original mesh normals
+/// @param _transforms : Const pointer to the bone transforms
+/// @param _boneId : Const pointer to the vertex bone IDs, 4 per vertex
+/// @param _weights : Const pointer to the vertex bone weights, 4 per vertex
+/// @param _startVert : First vertex to skin
+/// @param _endVert : One past the last vertex to skin
+void LinearBlendWeightSkin(glm::vec3 *_deformedVert,
+                           const glm::vec3 *_origVert,
+                           glm::vec3 *_deformedNorms,
+                           const glm::vec3 *_origNorms,
+                           const glm::mat4 *_transform,
+                           const unsigned int *_boneId,
+                           const float *_weight,
+                           const int _startVert,
+                           const int _endVert);
+
+
+/// @brief Function to perform the vertex projection step of implicit skinning,
+/// vertices are moved along the gradient of the global field towards their original iso value.
+/// The field is evaluated a chunk of vertices at a time, see EvalGradGlobalField.
+/// @param _deformedVert : Pointer to the deformed vertices, updated in place
+/// @param _origIsoValue : Const pointer to the iso values of each vertex in their original rest position
+/// @param _prevIsoGrad : Pointer to the gradient of the field for each vertex from the previous step
+/// @param _globalField : The global field to project onto
+/// @param _sigma : scaling value for vertex projection step
+/// @param _contactAngle : threshold for running vertex projection step
+/// @param _startVert : First vertex to project
+/// @param _endVert : One past the last vertex to project
+void VertexProjection(glm::vec3 *_deformedVert,
+                      const float *_origIsoValue,
+                      glm::vec3 *_prevIsoGrad,
+                      GlobalFieldFunction &_globalField,
+                      const float _sigma,
+                      const float _contactAngle,
+                      const int _startVert,
+                      const int _endVert);
+
+
+/// @brief Function to perform the tangential relaxation step of implicit skinning.
+/// The field is evaluated a chunk of vertices at a time, see EvalGradGlobalField.
+/// Neighbours are read from _deformedVert and results written to _relaxedVert,
+/// so the two buffers must not alias, this keeps the result independent of thread scheduling.
+/// @param _relaxedVert : Pointer to the output relaxed vertices
+/// @param _deformedVert : Const pointer to the deformed vertices
+/// @param _origIsoValue : Const pointer to the iso values of each vertex in their original rest position
+/// @param _prevIsoGrad : Pointer to the gradient of the field for each vertex from the previous step
+/// @param _globalField : The global field
+/// @param _oneRingVerts : Const pointer to flat array of vertex ids of each vertices one ring neighbour
+/// @param _centroidWeights : Const pointer to one ring centroid weights calculated using MVC
+/// @param _oneRingScatterAddr : Const pointer holding start index into _oneRingVerts for each vertex
+/// @param _startVert : First vertex to relax
+/// @param _endVert : One past the last vertex to relax
+void TangentialRelaxation(glm::vec3 *_relaxedVert,
+                          const glm::vec3 *_deformedVert,
+                          const float *_origIsoValue,
+                          glm::vec3 *_prevIsoGrad,
+                          GlobalFieldFunction &_globalField,
+                          const int *_oneRingVerts,
+                          const float *_centroidWeights,
+                          const int *_oneRingScatterAddr,
+                          const int _startVert,
+                          const int _endVert);
+
+
+/// @brief Function to generate the one ring centroid weights for each mesh vertex using Mean Value Coordinates method
+/// @param _verts : Const pointer to vertices
+/// @param _normals : Const pointer to normals
+/// @param _centroidWeights : Pointer to one ring centroid weights
+/// @param _oneRingVerts : Const pointer to flat array of vertex ids of each vertices one ring neighbour
+/// @param _oneRingScatterAddr : Const pointer holding start index into _oneRingVerts for each vertex
+/// @param _startVert : First vertex to process
+/// @param _endVert : One past the last vertex to process
+void GenerateOneRingCentroidWeights(const glm::vec3 *_verts,
+                                    const glm::vec3 *_normals,
+                                    float *_centroidWeights,
+                                    const int *_oneRingVerts,
+                                    const int *_oneRingScatterAddr,
+                                    const int _startVert,
+                                    const int _endVert);
+
+}
+
+//--------------------------------------------------------------------------------------------------------------
+
+#endif // IMPLICITSKINCPUKERNELS_H
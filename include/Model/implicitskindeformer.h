@@ -1,13 +1,13 @@
 #ifndef IMPLICITSKINDEFORMER_H
 #define IMPLICITSKINDEFORMER_H
 
-#include <thread>
-
-#include <cuda_runtime.h>
-#include <cuda.h>
-#include <cuda_gl_interop.h>
+#include <memory>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
 #include "Model/mesh.h"
+#include "Model/deformerbackend.h"
 #include "ScalarField/globalfieldfunction.h"
 
 
@@ -21,10 +21,12 @@
 
 /// @class ImplicitSkinDeformer
 /// @brief This class deforms a mesh using the implicit skinning technique.
+/// The deformation itself is computed by a DeformerBackend picked from the DeformerBackendRegistry.
 class ImplicitSkinDeformer
 {
 public:
     /// @brief Constructor.
+    /// Selects the fastest backend available on this machine, this can be changed with SetBackend.
     ImplicitSkinDeformer();
 
     /// @brief Destructor.
@@ -32,23 +34,52 @@ public:
 
     //--------------------------------------------------------------------
 
-    /// @brief Method to attach a mesh to the deformer, and upload data to the GPU
+    /// @brief Method to attach a mesh to the deformer, and upload data to the backend
     /// @param _origMesh : Mesh holding vertices, normals, bone weight and ids
     /// @param _meshVBO : The meshes vertex buffer object, need this to map resources so we can directly deform mesh vertices in CUDA
     /// @param _meshNBO : The meshes normal buffer object, need this to map resources so we can directly deform mesh normals in CUDA
     /// @param _transform : The rest bone transforms.
     void AttachMesh(const Mesh _origMesh,
-                    const GLuint _meshVBO,
-                    const GLuint _meshNBO,
+                    const BufferId _meshVBO,
+                    const BufferId _meshNBO,
+                    const std::vector<glm::mat4> &_transform);
+
+    /// @brief Method to attach a mesh to the deformer without any OpenGL buffers.
+    /// The deformed mesh can be retrieved with GetDeformedMeshVerts and GetDeformedMeshNorms.
+    /// @param _origMesh : Mesh holding vertices, normals, bone weight and ids
+    /// @param _transform : The rest bone transforms.
+    void AttachMesh(const Mesh _origMesh,
                     const std::vector<glm::mat4> &_transform);
 
     /// @brief Method to generate the global function from the various mesh parts
     /// @param _meshParts : A vector of meshes containing individual mesh parts, for example: left lower leg, left upper leg etc..
     /// @param _boneStarts : A vector of the positions in 3D space of the start and end of the bones corresponding to the mesh parts.
-    /// @param _numHrbfCentres : The numbere of Hermite Radial Basis Function (HRBF) centres used to generate the field function.
+    /// @param _numHrbfCentres : The numbere of Hermite Radial Basis Function (HRBF) centres used to generate the field function,
+    /// with a tolerance the most centres used per mesh part.
+    /// @param _hrbfTolerance : When above zero, each mesh part gets only as many centres as it needs for its vertices to be
+    /// within this distance of the field surface, relative to the size of the part. See GlobalFieldFunction::GenerateAdaptiveFieldFuncs.
     void GenerateGlobalFieldFunction(const std::vector<Mesh> &_meshParts,
                                      const std::vector<std::pair<glm::vec3, glm::vec3>> &_boneEnds,
-                                     const int _numHrbfCentres = 50);
+                                     const int _numHrbfCentres = 50,
+                                     const float _hrbfTolerance = 0.0f);
+
+    /// @brief Method to set the directory GenerateGlobalFieldFunction caches fields in, FieldCache::DefaultDirectory unless set.
+    /// Fields generated with the same mesh part, bone and settings are loaded from there instead of fit and precomputed again.
+    /// @param _directory : directory to keep the fields in, an empty string disables the cache
+    void SetFieldCacheDirectory(const std::string &_directory);
+
+    /// @brief Method to make GenerateGlobalFieldFunction precompute fields lazily, only the bricks near the surface the
+    /// first frames reach are filled, see FieldFunction::SetLazyPrecompute. Set before GenerateGlobalFieldFunction.
+    /// The CUDA textures need every voxel, so this only applies while the backend in use runs on the CPU,
+    /// other backends sampling the CUDA textures are then released and finish the fields when they are created again.
+    /// Lazy fields are saved to the field cache by FinishLazyPrecompute, once they are whole.
+    /// @param _lazy : whether to precompute lazily
+    void SetLazyPrecompute(const bool _lazy);
+
+    /// @brief Method to fill every brick lazily precomputed fields have left, create their CUDA textures
+    /// and save them to the field cache, so the next run loads them whole.
+    /// Call it between frames, the global field must not be evaluated at the same time.
+    void FinishLazyPrecompute();
 
     //--------------------------------------------------------------------
 
@@ -56,7 +87,6 @@ public:
     void Deform();
 
     /// @brief Method to perform LBW skinning
-    /// @param _transform : a vector of joint transform matrices.
     void PerformLBWSkinning();
 
     /// @brief Method to perform Implicit skinning
@@ -80,11 +110,47 @@ public:
 
     //--------------------------------------------------------------------
 
+    /// @brief Method to set the backend used by subsequent calls, the current backend is kept if _name is unavailable.
+    /// @param _name : name of a backend in the DeformerBackendRegistry, for example "cuda", "cpu-mt" or "cpu"
+    /// @return true if the backend is now in use.
+    bool SetBackend(const std::string &_name);
+
+    /// @brief Method to get the name of the backend in use.
+    std::string GetBackendName() const;
+
+    /// @brief Method to get a backend by name for a single call, for example to compare backends on the same scene.
+    /// The backend is created on first use and has the mesh, global field and current transforms attached.
+    /// @param _name : name of a backend in the DeformerBackendRegistry
+    /// @return the backend, or nullptr if it is unavailable.
+    DeformerBackend *GetBackend(const std::string &_name);
+
+    /// @brief Method to check if the backend in use writes the deformed mesh straight into the attached OpenGL buffers.
+    bool DeformsMeshBuffers() const;
+
+    //--------------------------------------------------------------------
+
+    /// @brief Method to get the deformed mesh vertices from the backend in use.
+    const std::vector<glm::vec3> &GetDeformedMeshVerts();
+
+    /// @brief Method to get the deformed mesh normals from the backend in use.
+    const std::vector<glm::vec3> &GetDeformedMeshNorms();
+
+    //--------------------------------------------------------------------
+
     /// @brief Method to evaluate the global field function at a set of given sasmple points.
     /// @param _output : The output values of the evaulated field at the sampel points.
     /// @param _samplePoints : A vector of positions in 3D space to sample the global field function.
     void EvalGlobalField(std::vector<float> &_output, const std::vector<glm::vec3> &_samplePoints);
 
+    /// @brief Method to evaluate the global field function at a set of sample points for a given pose, on the CPU.
+    /// Leaves the transforms of the deformer untouched so it is safe to call while another frame is being deformed.
+    /// @param _output : The output values of the evaulated field at the sampel points.
+    /// @param _samplePoints : A vector of positions in 3D space to sample the global field function.
+    /// @param _transforms : The bone transforms of the pose to evaluate.
+    /// @param _error : Largest voxel size the fields may be sampled at, 0 for full detail. Characters far from the camera
+    /// can pass about the size of a pixel at their distance and sample coarser levels of the fields, see FieldFunction::GetLevel.
+    void EvalGlobalField(std::vector<float> &_output, const std::vector<glm::vec3> &_samplePoints, const std::vector<glm::mat4> &_transforms, const float _error = 0.0f);
+
     /// @brief Method to evaluate the global field function at regular uniform intervals within a cube
     /// @param _output : The output values of the evaulated field at the sampel points.
     /// @param res : The resolution of the cube volume to sample, number of sample points = res*res*res
@@ -110,109 +176,55 @@ private:
     void AddCompositionOp(std::shared_ptr<CompositionOp> _compOp);
 
 
-    //--------------------------------------------------------------------
-    // methods for evaluating the global field
-
-    /// @brief Private method to evaulate the global field on the CPU
-    /// @param _output : The output values of the evaulated field at the sampel points.
-    /// @param _samplePoints : A vector of positions in 3D space to sample the global field function.
-    void EvalGlobalFieldCPU(std::vector<float> &_output, const std::vector<glm::vec3> &_samplePoints);
-
-    /// @brief Private method to evaluate the global field on the GPU
-    /// @param _output : The output values of the evaulated field at the sampel points.
-    /// @param _samplePoints : A vector of positions in 3D space to sample the global field function.
-    void EvalGlobalFieldGPU(std::vector<float> &_output, const std::vector<glm::vec3> &_samplePoints);
-
-
-    /// @brief Private method to evaluate the global field at regular uniform intervals within a cube on the CPU
-    /// @param _output : The output values of the evaulated field at the sampel points.
-    /// @param res : The resolution of the cube volume to sample, number of sample points = res*res*res
-    /// @param dim : The dimension of the cube volume to sample.
-    void EvalFieldInCubeCPU(std::vector<float> &_output, const int res, const float dim);
-
-    /// @brief Private method to evaluate the global field at regular uniform intervals within a cube on the GPU
-    /// @param _output : The output values of the evaulated field at the sampel points.
-    /// @param res : The resolution of the cube volume to sample, number of sample points = res*res*res
-    /// @param dim : The dimension of the cube volume to sample.
-    void EvalFieldInCubeGPU(std::vector<float> &_output, const int res, const float dim);
-
-
     //--------------------------------------------------------------------
     // Methods for initlaising the deformer
 
-    /// @brief Method to initialise the Iso values of each mesh vertex in the global field
-    void InitialiseIsoValues();
-
-    /// @brief Method to initialise CUDA memory that will hold the mesh to be deformed
-    /// @param _origMesh : The mesh we which to upload to the GPU
-    /// @param _memshVBO : The meshes vertex buffer object which we need to map resources inorder to drectly deform the meshes vertices on the GPU
-    /// @param _memshNBO : The meshes norrmal buffer object which we need to map resources inorder to drectly deform the meshes normals on the GPU
+    /// @brief Method to build the host side mesh data shared by all backends
+    /// @param _origMesh : The mesh to deform
     /// param _transforms : The default bone transforms.
-    void InitMeshCudaMem(const Mesh _origMesh, const GLuint _meshVBO, const GLuint _meshNBO, const std::vector<glm::mat4> &_transform);
+    void InitMeshData(const Mesh &_origMesh, const std::vector<glm::mat4> &_transform);
 
-    /// @brief Method to initialise CUDA memory that will hold the global field
-    void InitFieldCudaMem();
-
-    /// @brief Method to clean up CUDA memory allocated for storing the mesh
-    void DestroyMeshCudaMem();
-
-    /// @brief Method to clean up CUDA memory allocated for storing the global field
-    void DestroyFieldCudaMem();
-
-
-    //--------------------------------------------------------------------
-    // Methods for accessing GPU resources within the deformer
-
-    /// @brief Method to get the device side pointer to deformed mesh vertices for use in CUDA kernels.
-    /// @brief We must map resources before directly accessing it.
-    glm::vec3 *GetDeformedMeshVertsDevicePtr();
-
-    /// @brief Method to release the device side pointer so OpenGL can use the VBO holding the deformed mesh vertices.
-    /// @brief We must unmap resources once we are finished using it.
-    void ReleaseDeformedMeshVertsDevicePtr();
-
-    /// @brief Method to get the device side pointer to deformed mesh normals for use in CUDA kernels
-    /// @brief We must map resources before directly accessing it.
-    glm::vec3 *GetDeformedMeshNormsDevicePtr();
-
-    /// @brief Method to release the device side pointer so OpenGL can use the NBO holding the deformed mesh normals.
-    /// @brief We must unmap resources once we are finished using it.
-    void ReleaseDeformedMeshNormsDevicePtr();
+    /// @brief Method to attach the mesh, global field and current transforms to a newly created backend
+    /// @param _backend : the backend to initialise
+    void InitBackend(DeformerBackend &_backend);
 
 
 
     //---------------------------------------------------------------------
-    // CPU Attributes
+    // Attributes
+
+    /// @brief The backends created so far, keyed by name
+    std::unordered_map<std::string, std::unique_ptr<DeformerBackend>> m_backends;
 
-    /// @brief The CUDA graphics resource to map the mesh vertex buffer object to a pointer that can be used within a CUDA kernel
-    cudaGraphicsResource *m_meshVBO_CUDA;
+    /// @brief The backend in use
+    DeformerBackend *m_backend;
 
-    /// @brief The CUDA graphics resource to map the mesh normal buffer object to a pointer that can be used within a CUDA kernel
-    cudaGraphicsResource *m_meshNBO_CUDA;
+    /// @brief a bool to check if CUDA textures are generated for the global field
+    bool m_gpuTextures;
 
-    /// @brief A sort of thread pool to start up some threads quickly for some data processing
-    std::vector<std::thread> m_threads;
+    /// @brief Fitted and precomputed fields from earlier runs
+    FieldCache m_fieldCache;
 
-    /// @brief A boolean to check whether the m_meshVBO_CUDA object has been mapped.
-    bool m_deformedMeshVertsMapped;
+    /// @brief a bool to check if GenerateGlobalFieldFunction precomputes fields lazily, see SetLazyPrecompute
+    bool m_lazyPrecompute;
 
-    /// @brief A boolean to check whether the m_meshNBO_CUDA object has been mapped.
-    bool m_deformedMeshNormsMapped;
+    /// @brief Id and cache key of each lazily precomputed field, saved by FinishLazyPrecompute
+    std::vector<std::pair<int, FieldCache::Key>> m_lazyFields;
 
-    /// @brief The number of vertices in the mesh that has been attached for deformation.
-    int m_numVerts;
+    /// @brief a bool to check if we have initialised the host side mesh data
+    bool m_initMeshData;
 
-    /// @brief The number of primitive fields that our global field is composed of.
-    uint m_numFields;
+    /// @brief The host side mesh data shared by all backends
+    DeformerMeshData m_meshData;
 
-    /// @brief The number of composition operators
-    uint m_numCompOps;
+    /// @brief The meshes vertex buffer object, 0 if the mesh was attached without OpenGL buffers
+    BufferId m_meshVBO;
 
-    /// @brief The number of composed fields that our global field is composed of.
-    uint m_numCompFields;
+    /// @brief The meshes normal buffer object, 0 if the mesh was attached without OpenGL buffers
+    BufferId m_meshNBO;
 
-    /// @brief The number of bone transforms
-    int m_numTransforms;
+    /// @brief Current bone transforms
+    std::vector<glm::mat4> m_transforms;
 
     /// @brief minimum of the axis aligned bounding box
     glm::vec3 m_minBBox;
@@ -223,12 +235,6 @@ private:
     /// @brief The global field whose 0.5 iso-surface represents our mesh
     GlobalFieldFunction m_globalFieldFunction;
 
-    /// @brief a bool to check if we have uploaded mesh data to cuda
-    bool m_initMeshCudaMem;
-
-    /// @brief a bool to check if we have uploaded field data to cuda
-    bool m_initFieldCudaMem;
-
     /// @brief scales vertex projection step in implicit skinning
     float m_sigma;
 
@@ -238,72 +244,6 @@ private:
     /// @brief number of projection and relaxations iterations to perform
     int m_numIterations;
 
-
-
-    //---------------------------------------------------------------------
-    // GPU data
-
-    /// @todo move below properties into a single data structure
-    /// @brief
-    glm::vec3 *d_deformedMeshVertsPtr;
-
-    /// @brief
-    glm::vec3 *d_origMeshVertsPtr;
-
-    /// @brief
-    glm::vec3 *d_deformedMeshNormsPtr;
-
-    /// @brief
-    glm::vec3 *d_origMeshNormsPtr;
-
-    /// @brief
-    int *d_oneRingIdPtr;
-
-    /// @brief
-    int *d_numNeighsPerVertPtr;
-
-    /// @brief
-    int *d_oneRingScatterAddrPtr;
-
-    float *d_centroidWeightsPtr;
-
-    /// @brief
-    glm::vec3 *d_oneRingVertPtr;
-
-    /// @brief
-    float *d_origVertIsoPtr;
-
-    /// @brief
-    float *d_newVertIsoPtr;
-
-    /// @brief
-    glm::vec3 *d_vertIsoGradPtr;
-
-    /// @brief
-    glm::mat4 *d_transformPtr;
-
-    /// @brief
-    glm::mat4 *d_textureSpacePtr;
-
-    /// @brief
-    cudaTextureObject_t *d_fieldsPtr;
-
-    /// @brief
-    cudaTextureObject_t *d_compOpPtr;
-
-    /// @brief
-    cudaTextureObject_t *d_thetaPtr;
-
-    /// @brief
-    ComposedFieldCuda *d_compFieldPtr;
-
-    /// @brief
-    unsigned int *d_boneIdPtr;
-
-    /// @brief
-    float *d_weightPtr;
-
-
 };
 
 #endif // IMPLICITSKINDEFORMER_H
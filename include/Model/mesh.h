@@ -153,6 +153,75 @@ public :
 
     //------------------------------------------------------------------------------------
 
+    /// @brief Method to split this mesh into parts, one per bone, by the dominant bone weights of each triangle.
+    /// Each part shares this meshes vertices and normals but only holds the triangles influenced by its bone.
+    /// @param _meshParts : vector to store the resulting mesh parts
+    /// @param _numParts : the number of parts to generate, typically the number of bones
+    void GenerateMeshParts(std::vector<Mesh> &_meshParts, const unsigned int _numParts) const
+    {
+        _meshParts.resize(_numParts);
+
+
+        for(unsigned int t=0; t<m_meshTris.size(); t++)
+        {
+            int v1 = m_meshTris[t].x;
+            int v2 = m_meshTris[t].y;
+            int v3 = m_meshTris[t].z;
+
+            float weight[3] = {0.0f, 0.0f, 0.0f};
+            int boneId[3] = {-1, -1, -1};
+            for(int bw = 0; bw<4; bw++)
+            {
+                if(m_meshBoneWeights[v1].boneWeight[bw] > weight[0])
+                {
+                    weight[0] = m_meshBoneWeights[v1].boneWeight[bw];
+                    boneId[0] = m_meshBoneWeights[v1].boneID[bw];
+                }
+
+                if(m_meshBoneWeights[v2].boneWeight[bw] > weight[1])
+                {
+                    weight[1] = m_meshBoneWeights[v2].boneWeight[bw];
+                    boneId[1] = m_meshBoneWeights[v2].boneID[bw];
+                }
+
+                if(m_meshBoneWeights[v3].boneWeight[bw] > weight[2])
+                {
+                    weight[2] = m_meshBoneWeights[v3].boneWeight[bw];
+                    boneId[2] = m_meshBoneWeights[v3].boneID[bw];
+                }
+            }
+
+            for(unsigned int v=0; v<3; v++)
+            {
+                if(boneId[v] < 0 || boneId[v] >= (int)_numParts)
+                {
+                    continue;
+                }
+                if(v==1 && boneId[1] == boneId[0])
+                {
+                    continue;
+                }
+                if((v==2) && (boneId[2] == boneId[1] || boneId[2] == boneId[0]))
+                {
+                    continue;
+                }
+
+                if(weight[v] >0.2f)
+                    _meshParts[boneId[v]].m_meshTris.push_back(glm::ivec3(v1, v2, v3));
+            }
+
+        }
+
+
+        for(unsigned int i=0 ;i<_meshParts.size(); i++)
+        {
+            _meshParts[i].m_meshVerts = m_meshVerts;
+            _meshParts[i].m_meshNorms = m_meshNorms;
+        }
+    }
+
+    //------------------------------------------------------------------------------------
+
 
     /// @brief m_meshVerts, a vector containing all vertices of the mesh.
     std::vector<glm::vec3> m_meshVerts;
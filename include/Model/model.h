@@ -25,6 +25,9 @@
 
 #include "implicitskindeformer.h"
 
+#include "Threading/framepipeline.h"
+#include "Threading/triplebuffer.h"
+
 //-------------------------------------------------------------------------------
 /// @author Idris Miles
 /// @version 1.0
@@ -58,7 +61,7 @@ public:
     /// @brief Method to draw the animated rig
     void DrawRig();
 
-    /// @brief Method to animate the model
+    /// @brief Method to animate the model, publishes the pose for the next draw without waiting on it
     /// @param _animationTime : the time the animation should be a
     void Animate(const float _animationTime);
 
@@ -74,6 +77,9 @@ public:
     /// @brief Method to toggle rendering the iso surface of the global field from the implicit deformer
     void ToggleIsoSurface();
 
+    /// @brief Method to cycle through the deformer backends available on this machine
+    void CycleDeformerBackend();
+
 
 
 
@@ -122,6 +128,24 @@ public:
 
 private:
 
+    /// @struct AnimFrame
+    /// @brief A frame moving through the frame pipeline: posed, then skinned, then polygonised.
+    struct AnimFrame
+    {
+        AnimFrame(const bool _isoSurface = false) :
+            isoSurface(_isoSurface) {}
+
+        /// @brief whether to polygonise the iso surface for this frame
+        bool isoSurface;
+
+        /// @brief bone transforms of this frames pose
+        std::vector<glm::mat4> boneTransforms;
+
+        /// @brief the polygonised iso surface of this frame
+        std::vector<glm::vec3> isoVerts;
+        std::vector<glm::vec3> isoNorms;
+    };
+
     /// @brief Method to create shaders
     void CreateShaders();
 
@@ -144,8 +168,15 @@ private:
     /// @brief Method to upload bone transforms to shader
     void UploadBonesToShader(RenderType _rt);
 
-    /// @brief Method to update the iso surface for rendering
-    void UpdateIsoSurface(int xRes = 32,
+    /// @brief Method to update the iso surface for rendering.
+    /// Only reads the implicit skinner and mesh, so it can run alongside the skinning of another frame.
+    /// @param _transforms : bone transforms of the pose to polygonise
+    /// @param _verts : output iso surface vertices
+    /// @param _norms : output iso surface normals
+    void UpdateIsoSurface(const std::vector<glm::mat4> &_transforms,
+                          std::vector<glm::vec3> &_verts,
+                          std::vector<glm::vec3> &_norms,
+                          int xRes = 32,
                           int yRes = 32,
                           int zRes = 32,
                           float dim = 800.0f,
@@ -165,6 +196,14 @@ private:
     /// @brief Method to deform the skin using the implicit skin deformer
     void DeformSkin();
 
+    /// @brief Method to create the frame pipeline which evaluates the next pose and polygonises
+    /// the previous iso surface while the current frame is skinned
+    void InitFramePipeline();
+
+    /// @brief Method to upload the skinned frames bone transforms to the shaders and deform the skin, runs on the GL thread
+    /// @param _frame : the posed frame
+    void SkinFrame(AnimFrame &_frame);
+
 
     //-------------------------------------------------------------------
     // Attributes
@@ -172,8 +211,14 @@ private:
     /// @brief Implicit skinner used to deform the mesh of our model
     ImplicitSkinDeformer *m_implicitSkinner;
 
-    /// @brief a mini thread pool used to speed up data processing
-    std::vector<std::thread> m_threads;
+    /// @brief Pipelines posing, skinning and iso surface extraction across consecutive frames
+    std::unique_ptr<FramePipeline<AnimFrame>> m_framePipeline;
+
+    /// @brief Hands the newest pose from the animation timer to the frame pipeline
+    TripleBuffer<std::vector<glm::mat4>> m_poseBuffer;
+
+    /// @brief The last frame out of the pipeline, passed back in so its buffers are reused
+    AnimFrame m_spareFrame;
 
     /// @brief This models rig
     Rig m_rig;
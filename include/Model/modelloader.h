@@ -6,7 +6,12 @@
 #include <assimp/scene.h>
 #include <assimp/matrix4x4.h>
 
-#include "Model/model.h"
+#include <string>
+#include <unordered_map>
+#include <memory>
+
+#include "Model/mesh.h"
+#include "Model/rig.h"
 
 
 //-------------------------------------------------------------------------------
@@ -24,23 +29,27 @@ public:
     /// @brief constructor
     ModelLoader();
 
-    /// @brief Method to load a new model from file
+    /// @brief Method to load a new model from file, does not require an OpenGL context.
     /// @param _file : file we wish to load
-    static Model *LoadModel(const std::string &_file);
+    /// @param _mesh : mesh to store the skinned mesh in
+    /// @param _rigMesh : mesh to store the rig joints in, pairs of verts per bone
+    /// @param _rig : rig to store the bone hierarchy and animation in
+    /// @return bool : true if the file was loaded
+    static bool LoadModel(const std::string &_file, Mesh &_mesh, Mesh &_rigMesh, Rig &_rig);
 
 private:
 
     /// @brief Method to initialise mesh
-    static void InitModelMesh(Model *_model, const aiScene *_scene);
+    static void InitModelMesh(Mesh &_mesh, Rig &_rig, const aiScene *_scene);
 
     /// @brief Method to initialise rig mesh
-    static void InitRigMesh(Model* _model, const aiScene *_scene);
+    static void InitRigMesh(Mesh &_rigMesh, Rig &_rig, const aiScene *_scene);
 
     /// @brief Method to initialise the rig
-    static void InitRig(Model* _model, const aiScene *_scene);
+    static void InitRig(Rig &_rig, const aiScene *_scene);
 
-    static void SetRigVerts(Model* _model, aiNode *_pParentNode, aiNode *_pNode, const glm::mat4 &_parentTransform, const glm::mat4 &_thisTransform);
-    static void SetJointVert(Model* _model, const std::string _nodeName, const glm::mat4 &_transform, VertexBoneData &_vb);
+    static void SetRigVerts(Mesh &_rigMesh, Rig &_rig, aiNode *_pParentNode, aiNode *_pNode, const glm::mat4 &_parentTransform, const glm::mat4 &_thisTransform);
+    static void SetJointVert(Mesh &_rigMesh, Rig &_rig, const std::string _nodeName, const glm::mat4 &_transform, VertexBoneData &_vb);
 
     static glm::mat4 ConvertToGlmMat(const aiMatrix4x4 &m);
     static void CopyRigStructure(const std::unordered_map<std::string, unsigned int> &_boneMapping, const aiScene *_aiScene, aiNode *_aiNode, Rig &_rig, std::shared_ptr<Bone> _parentBone, const glm::mat4 &_parentTransform);
@@ -33,28 +33,34 @@ public:
     /// @param _animationTime : current time to evaluate the rigs animation
     void Animate(const float _animationTime);
 
+    /// @brief Method to evaluate the bone transforms at the specified time without changing the rig,
+    /// so the next pose can be evaluated while the current one is still in use
+    /// @param _animationTime : time to evaluate the rigs animation
+    /// @param _boneTransforms : output, one transform per bone
+    void EvaluatePose(const float _animationTime, std::vector<glm::mat4> &_boneTransforms) const;
+
 private:
 
     /// @brief Method to update the bone hierarchy transforms
-    void UpdateBoneHierarchy(const float _animationTime, std::shared_ptr<Bone> _pBone, const glm::mat4& _parentTransform);
+    void UpdateBoneHierarchy(const float _animationTime, std::shared_ptr<Bone> _pBone, const glm::mat4& _parentTransform, std::vector<glm::mat4> &_boneTransforms) const;
 
     /// @brief Method to interpolate the rotation animation at the request animation time
-    void CalcInterpolatedRotation(glm::quat& _out, const float _animationTime, const BoneAnim &_boneAnin);
+    void CalcInterpolatedRotation(glm::quat& _out, const float _animationTime, const BoneAnim &_boneAnin) const;
 
     /// @brief Method to interpolate the position animation at the request animation time
-    void CalcInterpolatedPosition(glm::vec3& _out, const float _animationTime, const BoneAnim &_boneAnim);
+    void CalcInterpolatedPosition(glm::vec3& _out, const float _animationTime, const BoneAnim &_boneAnim) const;
 
     /// @brief Method to interpolate the scaling animation at the request animation time
-    void CalcInterpolatedScaling(glm::vec3& _out, const float _animationTime, const BoneAnim &_boneAnim);
+    void CalcInterpolatedScaling(glm::vec3& _out, const float _animationTime, const BoneAnim &_boneAnim) const;
 
     /// @brief Method to find the keyframe closest to the request animation time in the rotation animation keyframes
-    uint FindRotationKeyFrame(const float _animationTime, const BoneAnim &_pBoneAnim);
+    uint FindRotationKeyFrame(const float _animationTime, const BoneAnim &_pBoneAnim) const;
 
     /// @brief Method to find the keyframe closest to the request animation time in the position animation keyframes
-    uint FindPositionKeyFrame(const float _animationTime, const BoneAnim &_pBoneAnim);
+    uint FindPositionKeyFrame(const float _animationTime, const BoneAnim &_pBoneAnim) const;
 
     /// @brief Method to find the keyframe closest to the request animation time in the scaling animation keyframes
-    uint FindScalingKeyFrame(const float _animationTime, const BoneAnim &_pBoneAnim);
+    uint FindScalingKeyFrame(const float _animationTime, const BoneAnim &_pBoneAnim) const;
 
 
 public:
@@ -0,0 +1,213 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public License,
+ * v. 2.0. If a copy of the MPL was not distributed with this file,
+ * You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+/// @file hrbf_batch.h
+/// Idris Miles - Batched evaluation of the HRBF potential and gradient
+
+#ifndef HRBF_BATCH_HPP__
+#define HRBF_BATCH_HPP__
+
+#include <vector>
+#include <cmath>
+
+#include "hrbf_phi_funcs.h"
+
+/// @brief Evaluates the potential and gradient of a fitted HRBF for many
+/// points in one pass. Node centres and weights are stored as a structure of
+/// arrays, and each block of points is evaluated lane by lane against every
+/// node, so the inner loop has no branches and no reductions. For float r^3
+/// fields there are AVX2 and AVX-512 kernels, built for their instruction set
+/// whatever the rest of the build targets, the best one the CPU supports is
+/// picked the first time one is needed.
+namespace hrbf_batch {
+
+/// Structure of arrays copy of the HRBF nodes, padded with zero weight nodes
+template<typename Scalar, int Dim>
+struct Nodes
+{
+    enum { Padding = 16 };
+
+    Nodes() : nb_nodes(0) {}
+
+    /// Copy the nodes from the column major storage of HRBF_fit
+    template<typename MatrixDX, typename VectorX>
+    void set(const MatrixDX& node_centers, const VectorX& alphas, const MatrixDX& betas)
+    {
+        int nb = node_centers.cols();
+        nb_nodes = ((nb + Padding - 1) / Padding) * Padding;
+
+        for(int d = 0; d < Dim; ++d)
+        {
+            centers[d].assign(nb_nodes, Scalar(0));
+            betas_[d].assign(nb_nodes, Scalar(0));
+        }
+        alphas_.assign(nb_nodes, Scalar(0));
+
+        for(int i = 0; i < nb; ++i)
+        {
+            for(int d = 0; d < Dim; ++d)
+            {
+                centers[d][i] = node_centers(d, i);
+                betas_[d][i]  = betas(d, i);
+            }
+            alphas_[i] = alphas(i);
+        }
+    }
+
+    /// number of nodes including padding
+    int nb_nodes;
+    std::vector<Scalar> centers[Dim];
+    std::vector<Scalar> alphas_;
+    std::vector<Scalar> betas_[Dim];
+};
+
+// =============================================================================
+
+/// Portable kernel, a block of points at a time, the compiler is free to
+/// vectorise the lane loops
+template<typename Scalar, int Dim, typename Rbf>
+struct PortableKernel
+{
+    enum { Lanes = 8 };
+
+    template<typename Vector>
+    static void eval_grad(const Nodes<Scalar, Dim>& nodes,
+                          const Vector* points, int nb_points,
+                          Scalar* values, Vector* grads)
+    {
+        const Scalar ddf0 = Rbf::ddf(Scalar(0));
+
+        for(int start = 0; start < nb_points; start += Lanes)
+        {
+            int lanes = nb_points - start < Lanes ? nb_points - start : Lanes;
+
+            Scalar p[Dim][Lanes];
+            Scalar val[Lanes];
+            Scalar g[Dim][Lanes];
+            for(int k = 0; k < Lanes; ++k)
+            {
+                const Vector& x = points[start + (k < lanes ? k : 0)];
+                for(int d = 0; d < Dim; ++d)
+                {
+                    p[d][k] = x(d);
+                    g[d][k] = 0;
+                }
+                val[k] = 0;
+            }
+
+            for(int i = 0; i < nodes.nb_nodes; ++i)
+            {
+                Scalar alpha = nodes.alphas_[i];
+                Scalar c[Dim], beta[Dim];
+                for(int d = 0; d < Dim; ++d)
+                {
+                    c[d]    = nodes.centers[d][i];
+                    beta[d] = nodes.betas_[d][i];
+                }
+
+                for(int k = 0; k < Lanes; ++k)
+                {
+                    Scalar diff[Dim];
+                    Scalar l2 = 0, bd = 0;
+                    for(int d = 0; d < Dim; ++d)
+                    {
+                        diff[d] = p[d][k] - c[d];
+                        l2 += diff[d] * diff[d];
+                        bd += beta[d] * diff[d];
+                    }
+
+                    Scalar l     = std::sqrt(l2);
+                    Scalar inv_l = l2 > 0 ? Scalar(1) / l : Scalar(0);
+                    Scalar df    = Rbf::df(l);
+                    Scalar df_l  = df * inv_l;
+                    // limit of the beta term at the centre, zero for r^3
+                    Scalar beta_scale = l2 > 0 ? df_l : ddf0;
+
+                    val[k] += alpha * Rbf::f(l) + bd * df_l;
+
+                    Scalar diff_scale = alpha * df_l + bd * inv_l * (Rbf::ddf(l) * inv_l - df_l * inv_l);
+                    for(int d = 0; d < Dim; ++d)
+                        g[d][k] += diff_scale * diff[d] + beta_scale * beta[d];
+                }
+            }
+
+            for(int k = 0; k < lanes; ++k)
+            {
+                values[start + k] = val[k];
+                for(int d = 0; d < Dim; ++d)
+                    grads[start + k](d) = g[d][k];
+            }
+        }
+    }
+};
+
+// =============================================================================
+
+/// Kernel used by HRBF_fit::eval_grad, the portable one unless specialised
+template<typename Scalar, int Dim, typename Rbf>
+struct Kernel : PortableKernel<Scalar, Dim, Rbf> {};
+
+// =============================================================================
+
+/// Instruction set the r^3 kernel of 3D float fields is built for
+enum class Isa { Portable, Avx2, Avx512 };
+
+/// r^3 kernel of 3D float fields, points and gradients are 3 packed floats each
+typedef void (*Pow3Kernel)(const Nodes<float, 3>& nodes, const float* points, int nb_points, float* values, float* grads);
+
+/// The r^3 kernel in use, the best the CPU supports unless select was called,
+/// null for Isa::Portable. In src/ScalarField/hrbf_batch.cpp
+Pow3Kernel pow3_kernel();
+
+/// Instruction set of the r^3 kernel in use
+Isa selected();
+
+/// Check if the CPU and the build support an instruction set
+bool is_supported(Isa isa);
+
+/// Use the r^3 kernel of another instruction set, to compare them in tests and
+/// benchmarks. Must not be called while anything is evaluating a field.
+/// Returns false if the instruction set is not supported, nothing changes
+bool select(Isa isa);
+
+/// Name of an instruction set
+const char* get_name(Isa isa);
+
+/// Kernels built for AVX2 and FMA, in src/ScalarField/hrbf_batch_avx2.cpp,
+/// only call them through pow3_kernel
+namespace avx2 {
+void eval_grad_pow3(const Nodes<float, 3>& nodes, const float* points, int nb_points, float* values, float* grads);
+}
+
+/// Kernels built for AVX-512, in src/ScalarField/hrbf_batch_avx512.cpp,
+/// only call them through pow3_kernel
+namespace avx512 {
+void eval_grad_pow3(const Nodes<float, 3>& nodes, const float* points, int nb_points, float* values, float* grads);
+}
+
+/// r^3 kernel for 3D float fields, with the SIMD kernel the CPU supports
+template<>
+struct Kernel<float, 3, Rbf_pow3<float> >
+{
+    template<typename Vector>
+    static void eval_grad(const Nodes<float, 3>& nodes,
+                          const Vector* points, int nb_points,
+                          float* values, Vector* grads)
+    {
+        static_assert(sizeof(Vector) == 3 * sizeof(float), "points and gradients are read as 3 packed floats");
+
+        Pow3Kernel kernel = pow3_kernel();
+        if(kernel == nullptr || nb_points <= 0)
+        {
+            PortableKernel<float, 3, Rbf_pow3<float> >::eval_grad(nodes, points, nb_points, values, grads);
+            return;
+        }
+
+        kernel(nodes, &points[0](0), nb_points, values, &grads[0](0));
+    }
+};
+
+} // END namespace hrbf_batch ==================================================
+
+#endif // HRBF_BATCH_HPP__
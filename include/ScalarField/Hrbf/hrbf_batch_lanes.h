@@ -0,0 +1,101 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public License,
+ * v. 2.0. If a copy of the MPL was not distributed with this file,
+ * You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+/// @file hrbf_batch_lanes.h
+/// Idris Miles - The r^3 kernel of hrbf_batch written over SIMD registers
+
+#ifndef HRBF_BATCH_LANES_HPP__
+#define HRBF_BATCH_LANES_HPP__
+
+namespace hrbf_batch {
+
+/// r^3 kernel for 3D float fields, phi = l^3, phi' = 3 l^2, phi'' = 6 l, so
+/// the value is alpha l^3 + 3 l (beta.diff) and the gradient
+/// 3 (alpha l + (beta.diff) / l) diff + 3 l beta, which vanishes at the centre.
+/// Written once over the registers and operations of an instruction set, L,
+/// see src/ScalarField/hrbf_batch_avx2.cpp. Only included by the kernel
+/// sources after they switch on their instruction set, so it includes nothing
+/// itself, a header first included here would be built for that instruction
+/// set too.
+template<typename L>
+struct Pow3Lanes
+{
+    typedef typename L::Reg Reg;
+
+    static void eval_grad(const Nodes<float, 3>& nodes,
+                          const float* points, int nb_points,
+                          float* values, float* grads)
+    {
+        const float* cx = nodes.centers[0].data();
+        const float* cy = nodes.centers[1].data();
+        const float* cz = nodes.centers[2].data();
+        const float* bx_ = nodes.betas_[0].data();
+        const float* by_ = nodes.betas_[1].data();
+        const float* bz_ = nodes.betas_[2].data();
+        const float* alphas = nodes.alphas_.data();
+        const Reg three = L::set1(3.0f);
+
+        for(int start = 0; start < nb_points; start += L::Lanes)
+        {
+            int lanes = nb_points - start < L::Lanes ? nb_points - start : L::Lanes;
+
+            float p[3][L::Lanes];
+            for(int k = 0; k < L::Lanes; ++k)
+            {
+                const float* x = points + 3 * (start + (k < lanes ? k : 0));
+                p[0][k] = x[0];
+                p[1][k] = x[1];
+                p[2][k] = x[2];
+            }
+
+            Reg px = L::load(p[0]), py = L::load(p[1]), pz = L::load(p[2]);
+            Reg val = L::set1(0.0f), gx = L::set1(0.0f), gy = L::set1(0.0f), gz = L::set1(0.0f);
+
+            for(int i = 0; i < nodes.nb_nodes; ++i)
+            {
+                Reg bx = L::set1(bx_[i]);
+                Reg by = L::set1(by_[i]);
+                Reg bz = L::set1(bz_[i]);
+                Reg alpha = L::set1(alphas[i]);
+
+                Reg dx = L::sub(px, L::set1(cx[i]));
+                Reg dy = L::sub(py, L::set1(cy[i]));
+                Reg dz = L::sub(pz, L::set1(cz[i]));
+
+                Reg l2 = L::fmadd(dz, dz, L::fmadd(dy, dy, L::mul(dx, dx)));
+                Reg bd = L::fmadd(bz, dz, L::fmadd(by, dy, L::mul(bx, dx)));
+                Reg l  = L::sqrt(l2);
+                Reg inv_l = L::safe_inv(l);
+
+                // alpha l^3 + 3 l bd
+                Reg l3 = L::mul(l2, l);
+                Reg l_3 = L::mul(three, l);
+                val = L::fmadd(alpha, l3, L::fmadd(l_3, bd, val));
+
+                // 3 (alpha l + bd / l) diff + 3 l beta
+                Reg s = L::mul(three, L::fmadd(alpha, l, L::mul(bd, inv_l)));
+                gx = L::fmadd(s, dx, L::fmadd(l_3, bx, gx));
+                gy = L::fmadd(s, dy, L::fmadd(l_3, by, gy));
+                gz = L::fmadd(s, dz, L::fmadd(l_3, bz, gz));
+            }
+
+            float v[L::Lanes], g[3][L::Lanes];
+            L::store(v, val);
+            L::store(g[0], gx);
+            L::store(g[1], gy);
+            L::store(g[2], gz);
+            for(int k = 0; k < lanes; ++k)
+            {
+                values[start + k] = v[k];
+                grads[3 * (start + k)]     = g[0][k];
+                grads[3 * (start + k) + 1] = g[1][k];
+                grads[3 * (start + k) + 2] = g[2][k];
+            }
+        }
+    }
+};
+
+} // END namespace hrbf_batch ==================================================
+
+#endif // HRBF_BATCH_LANES_HPP__
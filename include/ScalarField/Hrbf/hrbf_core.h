@@ -12,16 +12,27 @@
 
 #include <Eigen/LU>
 #include <Eigen/Cholesky>
+#include <Eigen/SparseCore>
+#include <Eigen/SparseCholesky>
+#include <Eigen/SparseLU>
 #include <vector>
+#include <limits>
+#include <algorithm>
+#include <functional>
 #include <iostream>
 
+#include "hrbf_phi_funcs.h"
+#include "hrbf_batch.h"
+#include "hrbf_grid.h"
+
 /// @brief fitting surface on a cloud point and evaluating the implicit surface
 /// @tparam _Scalar : a base type float, double etc.
 /// @tparam _Dim    : integer of the dimension of the ambient space 
 /// (for a implicit surface == 3)
 /// @tparam Rbf     : the class of a the radial basis
 /// must implement float Rbf::f(float) float Rbf::df(float) float Rbf::ddf(float)
-/// (see hrbf_phi_funcs.h for an example)
+/// (see hrbf_phi_funcs.h for an example). Kernels marked compact by
+/// Rbf_support are scaled to the support radius and get a sparse system.
 /// @note Please go see http://eigen.tuxfamily.org to use matrix and vectors 
 /// types of this lib. The documentation is pretty good.
 template<typename _Scalar, int _Dim, typename Rbf>
@@ -30,22 +41,160 @@ class HRBF_fit
 public:
     typedef _Scalar Scalar;
     enum { Dim = _Dim };
+    enum { Compact = Rbf_support<Rbf>::compact };
 
     typedef Eigen::Matrix<Scalar,Dim,Dim>                       MatrixDD;
     typedef Eigen::Matrix<Scalar,Dim,1>                         Vector;
     typedef Eigen::Matrix<Scalar,Dim,Eigen::Dynamic>            MatrixDX;
     typedef Eigen::Matrix<Scalar,Eigen::Dynamic,Eigen::Dynamic> MatrixXX;
     typedef Eigen::Matrix<Scalar,Eigen::Dynamic,1>              VectorX;
+    typedef Eigen::Matrix<Scalar,Dim+1,Dim+1>                   MatrixBlock;
+    typedef Eigen::SparseMatrix<Scalar>                         SparseMatrix;
+
+    /// Linear solvers hermite_fit can use, from fastest to most robust.
+    /// The system is solved in a symmetric form, see hermite_fit.
+    /// Compact kernels use the sparse counterparts, SimplicialLDLT and
+    /// SparseLU, and fall back to a dense FULL_PIV_LU.
+    /// ITERATIVE is not part of the escalation, it never stores the system.
+    enum Solver
+    {
+        LDLT = 0,       ///< symmetric LDLT, needs a non zero diagonal (positive definite kernels)
+        PARTIAL_PIV_LU, ///< LU with partial pivoting
+        FULL_PIV_LU,    ///< LU with full pivoting, slowest but most robust
+        ITERATIVE       ///< matrix free restarted GMRES, O(n) memory, see set_iterative_tolerance
+    };
+
+    /// Runs 'func(begin, end)' over chunks of [0, size), possibly in parallel,
+    /// and returns once every chunk is done
+    typedef std::function<void(const std::function<void(int, int)>& func, int size)> Parallel_for;
+
+    /// Scratch memory for the dense hermite_fit. Passing the same workspace to
+    /// successive fits reuses the design matrix and its factorisation instead
+    /// of allocating them again, the buffers only ever grow.
+    /// A workspace must only be used by one fit at a time.
+    class Workspace
+    {
+    public:
+        /// Free the buffers
+        void release()
+        {
+            std::vector<Scalar>().swap(_design);
+            std::vector<Scalar>().swap(_factor);
+        }
+
+    private:
+        friend class HRBF_fit;
 
-    HRBF_fit() {}
+        /// Design matrix storage
+        std::vector<Scalar> _design;
+        /// Copy of the design matrix the solvers factorise in place
+        std::vector<Scalar> _factor;
+    };
+
+    HRBF_fit() :
+        _solver(LDLT),
+        _residual_tolerance(Scalar(1e-4)),
+        _used_solver(LDLT),
+        _residual(0),
+        _support_radius(1),
+        _iterative_tolerance(Scalar(1e-4)),
+        _max_iterations(1000),
+        _restart(50),
+        _warm_start(true),
+        _iterations(0),
+        _keep_factorisation(false),
+        _has_factorisation(false),
+        _max_pending_updates(32),
+        _nb_removed(0)
+    {}
+
+    // --------------------------------------------------------------------------
+
+    /// Set the first solver hermite_fit tries. When the relative residual
+    /// |Ax - b| / |b| of a solution is above the residual tolerance the next,
+    /// more robust, solver is tried until FULL_PIV_LU.
+    void set_solver(Solver solver) { _solver = solver; }
+
+    /// First solver hermite_fit tries
+    Solver solver() const { return _solver; }
+
+    /// Set the relative residual above which hermite_fit escalates to the next solver
+    void set_residual_tolerance(Scalar tolerance) { _residual_tolerance = tolerance; }
+
+    /// Relative residual above which hermite_fit escalates to the next solver
+    Scalar residual_tolerance() const { return _residual_tolerance; }
+
+    /// Solver that produced the last fit
+    Solver used_solver() const { return _used_solver; }
+
+    /// Relative residual of the last fit
+    Scalar residual() const { return _residual; }
+
+    /// Set how hermite_fit spreads the assembly of the design matrix over
+    /// threads, by default it runs on the calling thread
+    void set_parallel_for(const Parallel_for& parallel_for) { _parallel_for = parallel_for; }
+
+    /// Set the distance beyond which a compact kernel vanishes, in the units
+    /// of the points. Each centre needs a few neighbours inside it, a few
+    /// times the sample spacing works well. Ignored by global kernels.
+    void set_support_radius(Scalar radius) { assert( radius > 0 ); _support_radius = radius; }
+
+    /// Distance beyond which a compact kernel vanishes
+    Scalar support_radius() const { return _support_radius; }
+
+    /// Set the relative residual the ITERATIVE solver stops at
+    void set_iterative_tolerance(Scalar tolerance) { _iterative_tolerance = tolerance; }
+
+    /// Relative residual the ITERATIVE solver stops at
+    Scalar iterative_tolerance() const { return _iterative_tolerance; }
+
+    /// Set the most products with the system the ITERATIVE solver may do, and
+    /// how many it does before restarting. Each step of a restart cycle keeps
+    /// one more vector of (Dim+1)*n scalars.
+    void set_max_iterations(int max_iterations, int restart = 50)
+    {
+        assert( restart > 0 );
+        _max_iterations = max_iterations;
+        _restart = restart;
+    }
+
+    /// Most products with the system the ITERATIVE solver may do
+    int max_iterations() const { return _max_iterations; }
+
+    /// Set whether the ITERATIVE solver starts from the previous weights when
+    /// refitting the same number of points, on by default. Small edits to
+    /// the centres then converge in a few iterations.
+    void set_warm_start(bool warm_start) { _warm_start = warm_start; }
+
+    /// Products with the system the last ITERATIVE fit did
+    int iterations() const { return _iterations; }
+
+    /// Keep the LU factorisation of dense fits, so centres can then be added
+    /// and removed with add_nodes() and remove_nodes() without refitting.
+    /// The factorisation takes as much memory as the dense system.
+    void set_keep_factorisation(bool keep) { _keep_factorisation = keep; }
+
+    /// Whether add_nodes() and remove_nodes() can update the last fit
+    bool has_factorisation() const { return _has_factorisation; }
+
+    /// Set how many centres may be added or removed since the last full fit
+    /// before an update refits from scratch. Each pending centre adds
+    /// Dim+1 columns to the update, which costs O(n^2) per column.
+    void set_max_pending_updates(int max_pending) { _max_pending_updates = max_pending; }
+
+    /// Centres added or removed since the last full fit
+    int nb_pending_updates() const { return int(_added_points.size()) + _nb_removed; }
 
     // --------------------------------------------------------------------------
 
     /// Compute surface interpolation given a set of points and normals.
     /// This solve the linear system of equation to find alpha scalars and beta
     /// beta vectors stored in '_alphas' and '_betas' attributes.
+    /// @param workspace : scratch memory to reuse across fits, when null
+    /// the fit allocates its own
     void hermite_fit(const std::vector<Vector>& points,
-                     const std::vector<Vector>& normals)
+                     const std::vector<Vector>& normals,
+                     Workspace* workspace = 0)
     {
         assert( points.size() == normals.size() );
 
@@ -54,64 +203,169 @@ public:
         int nb_constraints      = nb_hrbf_constraints;
         int nb_coeffs           = (Dim+1)*nb_points;
 
+        // the previous weights in y = S*x form, as the iterative solver's guess
+        VectorX   x(nb_coeffs);
+        bool warm = _solver == ITERATIVE && _warm_start && _alphas.size() == nb_points;
+        for(int i = 0; warm && i < nb_points; ++i)
+        {
+            x((Dim+1) * i) = _alphas(i);
+            x.template segment<Dim>((Dim+1) * i + 1) = -_betas.col(i);
+        }
+
         _node_centers.resize(Dim, nb_points);
         _betas.       resize(Dim, nb_points);
         _alphas.      resize(nb_points);
 
-        // Assemble the "design" and "value" matrix and vector
-        MatrixXX  D(nb_constraints, nb_coeffs);
+        // Assemble the "design" and "value" matrix and vector.
+        // The gradient terms are odd in diff, so the design matrix D is not
+        // symmetric, but D*S is, with S negating the beta unknowns. We assemble
+        // D*S directly, solve for y = S*x and flip the betas back afterwards.
         VectorX   f(nb_constraints);
-        VectorX   x(nb_coeffs);
 
         // copy the node centers
-        for(int i = 0; i < nb_points; ++i)
-            _node_centers.col(i) = points[i];
-
         for(int i = 0; i < nb_points; ++i)
         {
-            Vector p = points[i];
-            Vector n = normals[i];
+            _node_centers.col(i) = points[i];
 
             int io = (Dim+1) * i;
             f(io) = 0;
-            f.template segment<Dim>(io + 1) = n;
-
-            for(int j = 0; j < nb_points; ++j)
-            {
-                int jo = (Dim + 1) * j;
-                Vector diff = p - _node_centers.col(j);
-                Scalar l = diff.norm();
-                if( l == 0 ) {
-                    D.template block<Dim+1,Dim+1>(io,jo).setZero();
-                } else {
-                    Scalar w    = Rbf::f(l);
-                    Scalar dw_l = Rbf::df(l)/l;
-                    Scalar ddw  = Rbf::ddf(l);
-                    Vector g    = diff * dw_l;
-                    D(io,jo) = w;
-                    D.row(io).template segment<Dim>(jo+1) = g.transpose();
-                    D.col(jo).template segment<Dim>(io+1) = g;
-                    D.template block<Dim,Dim>(io+1,jo+1)  = (ddw - dw_l)/(l*l) * (diff * diff.transpose());
-                    D.template block<Dim,Dim>(io+1,jo+1).diagonal().array() += dw_l;
-                }
-            }
+            f.template segment<Dim>(io + 1) = normals[i];
         }
 
-        x = D.fullPivLu().solve(f);
+        _has_factorisation = false;
+        if(_solver == ITERATIVE)
+            fit_iterative(f, x, warm);
+        else if(Compact)
+            fit_sparse(f, x);
+        else
+            fit_dense(f, x, workspace);
 
-//        if((D*x).isApprox(f))
-//        {
-//            printf("there was a solution\n");
-//        }
-//        else
-//        {
-//            printf("there was NO solution\n");
-//        }
+        // everything add_nodes() and remove_nodes() need to start from this fit
+        _base_points.clear();
+        _base_normals.clear();
+        _added_points.clear();
+        _added_normals.clear();
+        _base_removed.clear();
+        _nb_removed = 0;
+        if(_has_factorisation)
+        {
+            _base_points  = points;
+            _base_normals = normals;
+            _base_removed.assign(nb_points, false);
+            _base_f = f;
+            _base_y = x;
+        }
+        else
+        {
+            _base_lu = Eigen::PartialPivLU<MatrixXX>();
+        }
+
+        // x = S*y
+        for(int i = 0; i < nb_points; ++i)
+            x.template segment<Dim>((Dim+1) * i + 1) *= Scalar(-1);
 
         Eigen::Map< Eigen::Matrix<Scalar,Dim+1,Eigen::Dynamic> > mx( x.data(), Dim + 1, nb_points);
 
         _alphas = mx.row(0);
         _betas  = mx.template bottomRows<Dim>();
+
+        update_batch_nodes();
+    }
+
+    // -------------------------------------------------------------------------
+
+    /// Add centres to the last fit through its kept factorisation, the new
+    /// centres go after the existing ones
+    /// @return false, leaving the fit untouched, when there is no
+    /// factorisation to update, see set_keep_factorisation
+    bool add_nodes(const std::vector<Vector>& points, const std::vector<Vector>& normals)
+    {
+        assert( points.size() == normals.size() );
+        if(!_has_factorisation)
+            return false;
+
+        _added_points.insert(_added_points.end(), points.begin(), points.end());
+        _added_normals.insert(_added_normals.end(), normals.begin(), normals.end());
+        update_from_factorisation();
+        return true;
+    }
+
+    // -------------------------------------------------------------------------
+
+    /// Remove centres from the last fit through its kept factorisation, the
+    /// remaining centres keep their order
+    /// @param indices : columns of '_node_centers' to remove
+    /// @return false, leaving the fit untouched, when there is no
+    /// factorisation to update, see set_keep_factorisation
+    bool remove_nodes(const std::vector<int>& indices)
+    {
+        if(!_has_factorisation)
+            return false;
+
+        // the current nodes are the remaining base nodes followed by the added ones
+        std::vector<int> base_index;
+        for(int i = 0; i < int(_base_points.size()); ++i)
+            if(!_base_removed[i])
+                base_index.push_back(i);
+
+        std::vector<int> added_to_erase;
+        for(unsigned k = 0; k < indices.size(); ++k)
+        {
+            int index = indices[k];
+            assert( index >= 0 && index < _node_centers.cols() );
+            if(index < int(base_index.size()))
+            {
+                if(!_base_removed[base_index[index]])
+                    ++_nb_removed;
+                _base_removed[base_index[index]] = true;
+            }
+            else
+            {
+                added_to_erase.push_back(index - int(base_index.size()));
+            }
+        }
+
+        std::sort(added_to_erase.begin(), added_to_erase.end());
+        added_to_erase.erase(std::unique(added_to_erase.begin(), added_to_erase.end()), added_to_erase.end());
+        for(int k = int(added_to_erase.size()) - 1; k >= 0; --k)
+        {
+            _added_points.erase(_added_points.begin() + added_to_erase[k]);
+            _added_normals.erase(_added_normals.begin() + added_to_erase[k]);
+        }
+
+        update_from_factorisation();
+        return true;
+    }
+
+    // -------------------------------------------------------------------------
+
+    /// Take the nodes and weights of a fit made in another precision, for
+    /// example fit in double, where the system is far better conditioned,
+    /// and evaluate in float to keep the SIMD width of eval_grad
+    template<typename Other_scalar, typename Other_rbf>
+    void assign_from(const HRBF_fit<Other_scalar, Dim, Other_rbf>& fit)
+    {
+        _node_centers   = fit._node_centers.template cast<Scalar>();
+        _alphas         = fit._alphas.template cast<Scalar>();
+        _betas          = fit._betas.template cast<Scalar>();
+        _support_radius = Scalar(fit.support_radius());
+        _used_solver    = Solver(fit.used_solver());
+        _residual       = Scalar(fit.residual());
+        _iterations     = fit.iterations();
+
+        update_batch_nodes();
+    }
+    // -------------------------------------------------------------------------
+
+    /// Copy the nodes into the layouts eval(), grad() and eval_grad() use,
+    /// the grid of compact kernels or the batches of global ones. hermite_fit
+    /// does it, call it again after editing '_node_centers', '_alphas' or '_betas'
+    void update_batch_nodes()
+    {
+        if(Compact)
+            _grid.build(_node_centers, _support_radius);
+        else
+            _batch_nodes.set(_node_centers, _alphas, _betas);
     }
 
     // -------------------------------------------------------------------------
@@ -120,19 +374,16 @@ public:
     Scalar eval(const Vector& x) const
     {
         Scalar ret = 0;
-        int nb_nodes = _node_centers.cols();
 
-        for(int i = 0; i < nb_nodes; ++i)
+        for_each_node(x, [&](int i)
         {
             Vector diff = x - _node_centers.col(i);
             Scalar l    = diff.norm();
 
+            ret += _alphas(i) * phi(l);
             if( l > 0 )
-            {
-                ret += _alphas(i) * Rbf::f(l);
-                ret += _betas.col(i).dot( diff ) * Rbf::df(l) / l;
-            }
-        }
+                ret += _betas.col(i).dot( diff ) * dphi(l) / l;
+        });
         return ret;
     }
 
@@ -142,35 +393,61 @@ public:
     Vector grad(const Vector& x) const
     {
         Vector grad = Vector::Zero();
-        int nb_nodes = _node_centers.cols();
-        for(int i = 0; i < nb_nodes; i++)
+        for_each_node(x, [&](int i)
         {
             Vector node  = _node_centers.col(i);
             Vector beta  = _betas.col(i);
-            float  alpha = _alphas(i);
+            Scalar alpha = _alphas(i);
             Vector diff  = x - node;
 
             Vector diffNormalized = diff;
-            float l =  diff.norm();
+            Scalar l =  diff.norm();
 
-            if( l > 0.00001f)
+            if( l > Scalar(0.00001))
             {
                 diffNormalized.normalize();
-                float dphi  = Rbf::df(l);
-                float ddphi = Rbf::ddf(l);
+                Scalar dphi_l  = dphi(l);
+                Scalar ddphi_l = ddphi(l);
 
-                float alpha_dphi = alpha * dphi;
+                Scalar alpha_dphi = alpha * dphi_l;
 
-                float bDotd_l = beta.dot(diff)/l;
-                float squared_l = diff.squaredNorm();
+                Scalar bDotd_l = beta.dot(diff)/l;
+                Scalar squared_l = diff.squaredNorm();
 
                 grad += alpha_dphi * diffNormalized;
-                grad += bDotd_l * (ddphi * diffNormalized - diff * dphi / squared_l) + beta * dphi / l ;
+                grad += bDotd_l * (ddphi_l * diffNormalized - diff * dphi_l / squared_l) + beta * dphi_l / l ;
             }
-        }
+            else
+            {
+                // limit at the centre, zero for r^3
+                grad += beta * ddphi(Scalar(0));
+            }
+        });
         return grad;
     }
 
+    // -------------------------------------------------------------------------
+
+    /// Evaluate potential and gradient at 'nb_points' positions in one pass,
+    /// much faster than calling eval() and grad() per point
+    /// @param values : output, 'nb_points' potentials
+    /// @param grads  : output, 'nb_points' gradients
+    void eval_grad(const Vector* points, int nb_points, Scalar* values, Vector* grads) const
+    {
+        if(Compact)
+        {
+            // only a handful of nodes reach each point, the grid does the work
+            for(int i = 0; i < nb_points; ++i)
+            {
+                values[i] = eval(points[i]);
+                grads[i]  = grad(points[i]);
+            }
+            return;
+        }
+
+        hrbf_batch::Kernel<Scalar, Dim, Rbf>::eval_grad(_batch_nodes, points, nb_points, values, grads);
+    }
+
     // --------------------------------------------------------------------------
 
     /// Each column represents p_i:  VectorX pi = _node_centers.col(i);
@@ -180,6 +457,579 @@ public:
     /// Each column represents beta_i:  VectorX bi = _betas.col(i);
     MatrixDX  _betas;
 
+private:
+    /// Kernel at distance 'l', scaled to the support radius for compact kernels
+    Scalar phi(Scalar l) const
+    {
+        return Compact ? Rbf::f(l / _support_radius) : Rbf::f(l);
+    }
+
+    /// First derivative of phi()
+    Scalar dphi(Scalar l) const
+    {
+        return Compact ? Rbf::df(l / _support_radius) / _support_radius : Rbf::df(l);
+    }
+
+    /// Second derivative of phi()
+    Scalar ddphi(Scalar l) const
+    {
+        return Compact ? Rbf::ddf(l / _support_radius) / (_support_radius * _support_radius) : Rbf::ddf(l);
+    }
+
+    // -------------------------------------------------------------------------
+
+    /// Call 'func(node_index)' for the nodes that can reach 'x', every node
+    /// for global kernels
+    template<typename Func>
+    void for_each_node(const Vector& x, Func func) const
+    {
+        if(Compact)
+        {
+            _grid.for_each_near(x, func);
+            return;
+        }
+
+        int nb_nodes = _node_centers.cols();
+        for(int i = 0; i < nb_nodes; ++i)
+            func(i);
+    }
+
+    // -------------------------------------------------------------------------
+
+    /// The (Dim+1)x(Dim+1) block of D*S coupling a constraint to a node,
+    /// 'diff' being the constraint point minus the node
+    void assemble_block(const Vector& diff, MatrixBlock& block) const
+    {
+        Scalar l = diff.norm();
+        block.setZero();
+        if( l == 0 ) {
+            // limits at the centre, all zero for r^3 but not for positive definite kernels
+            block(0,0) = phi(Scalar(0));
+            block.template bottomRightCorner<Dim,Dim>().diagonal().setConstant(-ddphi(Scalar(0)));
+        } else {
+            Scalar w    = phi(l);
+            Scalar dw_l = dphi(l)/l;
+            Scalar ddw  = ddphi(l);
+            Vector g    = diff * dw_l;
+            block(0,0) = w;
+            block.row(0).template segment<Dim>(1) = -g.transpose();
+            block.col(0).template segment<Dim>(1) = g;
+            block.template bottomRightCorner<Dim,Dim>() = -(ddw - dw_l)/(l*l) * (diff * diff.transpose());
+            block.template bottomRightCorner<Dim,Dim>().diagonal().array() -= dw_l;
+        }
+    }
+
+    // -------------------------------------------------------------------------
+
+    /// Solve the dense system of a global kernel, y is D*S's solution
+    void fit_dense(const VectorX& f, VectorX& y, Workspace* workspace)
+    {
+        int nb_points = _node_centers.cols();
+        int nb_coeffs = f.size();
+
+        Workspace local_workspace;
+        Workspace& ws = workspace ? *workspace : local_workspace;
+        size_t matrix_size = size_t(nb_coeffs) * nb_coeffs;
+        if(ws._design.size() < matrix_size)
+        {
+            ws._design.resize(matrix_size);
+            ws._factor.resize(matrix_size);
+        }
+
+        Eigen::Map<MatrixXX> D(ws._design.data(), nb_coeffs, nb_coeffs);
+
+        // Each block pair is computed once by the row of its upper block and
+        // mirrored, so rows share no writes and can be assembled in parallel
+        std::function<void(int, int)> assemble_rows = [&](int begin, int end)
+        {
+            MatrixBlock block;
+            for(int i = begin; i < end; ++i)
+            {
+                int io = (Dim+1) * i;
+                for(int j = i; j < nb_points; ++j)
+                {
+                    int jo = (Dim + 1) * j;
+                    assemble_block(_node_centers.col(i) - _node_centers.col(j), block);
+                    D.template block<Dim+1,Dim+1>(io,jo) = block;
+                    if(j != i)
+                        D.template block<Dim+1,Dim+1>(jo,io) = block.transpose();
+                }
+            }
+        };
+
+        if(_parallel_for)
+            _parallel_for(assemble_rows, nb_points);
+        else
+            assemble_rows(0, nb_points);
+
+        // LDLT only pivots on the diagonal, which is all zero for kernels
+        // such as r^3, so go straight to LU for those. Updates need an LU.
+        Solver solver = _solver;
+        if(solver == LDLT && (_keep_factorisation || D.diagonal().cwiseAbs().maxCoeff() == Scalar(0)))
+            solver = PARTIAL_PIV_LU;
+
+        // The solvers factorise a copy in place, D is kept for the residual
+        Eigen::Map<MatrixXX> F(ws._factor.data(), nb_coeffs, nb_coeffs);
+        Eigen::Ref<MatrixXX> F_ref(F);
+
+        Scalar f_norm = f.norm();
+        for(;;)
+        {
+            F = D;
+            switch(solver)
+            {
+            case LDLT:           y = Eigen::LDLT<Eigen::Ref<MatrixXX> >(F_ref).solve(f);         break;
+            case PARTIAL_PIV_LU:
+                if(_keep_factorisation)
+                {
+                    _base_lu.compute(D);
+                    y = _base_lu.solve(f);
+                }
+                else
+                {
+                    y = Eigen::PartialPivLU<Eigen::Ref<MatrixXX> >(F_ref).solve(f);
+                }
+                break;
+            default:             y = Eigen::FullPivLU<Eigen::Ref<MatrixXX> >(F_ref).solve(f);    break;
+            }
+
+            _residual = (D*y - f).norm();
+            if(f_norm > 0)
+                _residual /= f_norm;
+
+            // written so a NaN residual also escalates
+            if(solver == FULL_PIV_LU || _residual <= _residual_tolerance)
+                break;
+
+            solver = Solver(solver + 1);
+        }
+        _used_solver = solver;
+        _has_factorisation = _keep_factorisation && solver == PARTIAL_PIV_LU;
+    }
+
+    // -------------------------------------------------------------------------
+
+    /// Solve the sparse system of a compact kernel, y is D*S's solution.
+    /// Only pairs of nodes closer than the support radius couple.
+    void fit_sparse(const VectorX& f, VectorX& y)
+    {
+        typedef Eigen::Triplet<Scalar> Triplet;
+
+        int nb_points = _node_centers.cols();
+        int nb_coeffs = f.size();
+        Scalar support2 = _support_radius * _support_radius;
+
+        _grid.build(_node_centers, _support_radius);
+
+        // Rows fill their own lists, so they can be assembled in parallel
+        std::vector< std::vector<Triplet> > row_triplets(nb_points);
+        std::function<void(int, int)> assemble_rows = [&](int begin, int end)
+        {
+            MatrixBlock block;
+            for(int i = begin; i < end; ++i)
+            {
+                int io = (Dim+1) * i;
+                Vector p = _node_centers.col(i);
+                std::vector<Triplet>& triplets = row_triplets[i];
+
+                _grid.for_each_near(p, [&](int j)
+                {
+                    Vector diff = p - _node_centers.col(j);
+                    if(j < i || diff.squaredNorm() >= support2)
+                        return;
+
+                    int jo = (Dim + 1) * j;
+                    assemble_block(diff, block);
+                    for(int a = 0; a < Dim+1; ++a)
+                    {
+                        for(int b = 0; b < Dim+1; ++b)
+                        {
+                            if(block(a,b) == Scalar(0))
+                                continue;
+                            triplets.push_back(Triplet(io + a, jo + b, block(a,b)));
+                            if(j != i)
+                                triplets.push_back(Triplet(jo + b, io + a, block(a,b)));
+                        }
+                    }
+                });
+            }
+        };
+
+        if(_parallel_for)
+            _parallel_for(assemble_rows, nb_points);
+        else
+            assemble_rows(0, nb_points);
+
+        size_t nb_triplets = 0;
+        for(int i = 0; i < nb_points; ++i)
+            nb_triplets += row_triplets[i].size();
+
+        std::vector<Triplet> triplets;
+        triplets.reserve(nb_triplets);
+        for(int i = 0; i < nb_points; ++i)
+        {
+            triplets.insert(triplets.end(), row_triplets[i].begin(), row_triplets[i].end());
+            std::vector<Triplet>().swap(row_triplets[i]);
+        }
+
+        SparseMatrix D(nb_coeffs, nb_coeffs);
+        D.setFromTriplets(triplets.begin(), triplets.end());
+        std::vector<Triplet>().swap(triplets);
+
+        Solver solver = _solver;
+        Scalar f_norm = f.norm();
+        for(;;)
+        {
+            bool solved = true;
+            switch(solver)
+            {
+            case LDLT:
+            {
+                Eigen::SimplicialLDLT<SparseMatrix> ldlt(D);
+                solved = ldlt.info() == Eigen::Success;
+                if(solved)
+                    y = ldlt.solve(f);
+                break;
+            }
+            case PARTIAL_PIV_LU:
+            {
+                Eigen::SparseLU<SparseMatrix> lu;
+                lu.analyzePattern(D);
+                lu.factorize(D);
+                solved = lu.info() == Eigen::Success;
+                if(solved)
+                    y = lu.solve(f);
+                break;
+            }
+            default:
+                // last resort, dense
+                y = MatrixXX(D).fullPivLu().solve(f);
+                break;
+            }
+
+            _residual = solved ? (D*y - f).norm() : std::numeric_limits<Scalar>::infinity();
+            if(solved && f_norm > 0)
+                _residual /= f_norm;
+
+            // written so a NaN residual also escalates
+            if(solver == FULL_PIV_LU || _residual <= _residual_tolerance)
+                break;
+
+            solver = Solver(solver + 1);
+        }
+        _used_solver = solver;
+    }
+
+    // -------------------------------------------------------------------------
+
+    /// y = (D*S) x without storing D*S, blocks are recomputed on the fly.
+    /// Rows are independent so they spread over the Parallel_for hook.
+    void apply_system(const VectorX& x, VectorX& y) const
+    {
+        int nb_points = _node_centers.cols();
+
+        std::function<void(int, int)> apply_rows = [&](int begin, int end)
+        {
+            MatrixBlock block;
+            for(int i = begin; i < end; ++i)
+            {
+                Vector p = _node_centers.col(i);
+                Eigen::Matrix<Scalar,Dim+1,1> sum = Eigen::Matrix<Scalar,Dim+1,1>::Zero();
+                for_each_node(p, [&](int j)
+                {
+                    assemble_block(p - _node_centers.col(j), block);
+                    sum += block * x.template segment<Dim+1>((Dim+1) * j);
+                });
+                y.template segment<Dim+1>((Dim+1) * i) = sum;
+            }
+        };
+
+        if(_parallel_for)
+            _parallel_for(apply_rows, nb_points);
+        else
+            apply_rows(0, nb_points);
+    }
+
+    // -------------------------------------------------------------------------
+
+    /// Solve D*S y = f with right preconditioned restarted GMRES, applying the
+    /// system on the fly so memory stays O(n). The preconditioner inverts the
+    /// diagonal blocks, identity where they are singular as with r^3.
+    /// @param warm : start from the given y rather than zero
+    void fit_iterative(const VectorX& f, VectorX& y, bool warm)
+    {
+        typedef Eigen::Matrix<Scalar,Dim+1,1> VectorBlock;
+
+        int nb_points = _node_centers.cols();
+        int n = f.size();
+        int m = _restart;
+
+        if(Compact)
+            _grid.build(_node_centers, _support_radius);
+
+        // block Jacobi preconditioner, every diagonal block is the same
+        MatrixBlock precond;
+        {
+            MatrixBlock diagonal;
+            assemble_block(Vector::Zero(), diagonal);
+            Eigen::FullPivLU<MatrixBlock> lu(diagonal);
+            precond = lu.isInvertible() ? MatrixBlock(lu.inverse()) : MatrixBlock(MatrixBlock::Identity());
+        }
+        auto apply_precond = [&](const VectorX& v, VectorX& z)
+        {
+            for(int i = 0; i < nb_points; ++i)
+                z.template segment<Dim+1>((Dim+1) * i) = precond * VectorBlock(v.template segment<Dim+1>((Dim+1) * i));
+        };
+
+        if(!warm)
+            y.setZero(n);
+
+        MatrixXX V(n, m + 1);
+        MatrixXX H = MatrixXX::Zero(m + 1, m);
+        VectorX  cs(m), sn(m), g(m + 1);
+        VectorX  r(n), w(n), z(n);
+
+        Scalar f_norm = f.norm();
+        if(f_norm == Scalar(0))
+            f_norm = Scalar(1);
+
+        _iterations = 0;
+        for(;;)
+        {
+            apply_system(y, r);
+            r = f - r;
+            Scalar beta = r.norm();
+            _residual = beta / f_norm;
+            if(!(_residual > _iterative_tolerance) || _iterations >= _max_iterations)
+                break;
+
+            V.col(0) = r / beta;
+            g.setZero();
+            g(0) = beta;
+
+            int k = 0;
+            for(; k < m && _iterations < _max_iterations; ++k)
+            {
+                apply_precond(V.col(k), z);
+                apply_system(z, w);
+                ++_iterations;
+
+                // modified Gram-Schmidt
+                for(int j = 0; j <= k; ++j)
+                {
+                    H(j, k) = V.col(j).dot(w);
+                    w -= H(j, k) * V.col(j);
+                }
+                H(k + 1, k) = w.norm();
+                if(H(k + 1, k) > Scalar(0))
+                    V.col(k + 1) = w / H(k + 1, k);
+
+                // Givens rotations keep H upper triangular
+                for(int j = 0; j < k; ++j)
+                {
+                    Scalar t    = cs(j) * H(j, k) + sn(j) * H(j + 1, k);
+                    H(j + 1, k) = -sn(j) * H(j, k) + cs(j) * H(j + 1, k);
+                    H(j, k)     = t;
+                }
+                Scalar rho = std::sqrt(H(k, k) * H(k, k) + H(k + 1, k) * H(k + 1, k));
+                cs(k) = rho > Scalar(0) ? H(k, k) / rho : Scalar(1);
+                sn(k) = rho > Scalar(0) ? H(k + 1, k) / rho : Scalar(0);
+                H(k, k)     = rho;
+                H(k + 1, k) = 0;
+                g(k + 1) = -sn(k) * g(k);
+                g(k)     =  cs(k) * g(k);
+
+                if(!(std::abs(g(k + 1)) / f_norm > _iterative_tolerance) || H(k, k) == Scalar(0))
+                {
+                    ++k;
+                    break;
+                }
+            }
+
+            // y += M^-1 V h, with H h = g
+            VectorX h = H.topLeftCorner(k, k).template triangularView<Eigen::Upper>().solve(g.head(k));
+            w = V.leftCols(k) * h;
+            apply_precond(w, z);
+            y += z;
+        }
+
+        _used_solver = ITERATIVE;
+    }
+
+    // -------------------------------------------------------------------------
+
+    /// Re-solve for the base fit with centres added and removed, through the
+    /// kept factorisation of the base system A. The new system borders A:
+    ///   | A    W | |y  |   |f_base |
+    ///   | W^T  Z | |y_w| = |f_added|
+    /// where the columns of W couple the base constraints to the added
+    /// nodes, and, for removed nodes, select their weights so the matching
+    /// multipliers absorb their equations and pin the weights to zero.
+    /// Eliminating y leaves the small Schur complement Z - W^T A^-1 W.
+    void update_from_factorisation()
+    {
+        int nb_base    = _base_points.size();
+        int nb_added   = _added_points.size();
+        int nb_removed = _nb_removed;
+
+        if(nb_added + nb_removed > _max_pending_updates)
+        {
+            std::vector<Vector> points, normals;
+            current_nodes(points, normals);
+            hermite_fit(points, normals);
+            return;
+        }
+
+        const int B = Dim + 1;
+        int n = B * nb_base;
+        int m = B * (nb_added + nb_removed);
+
+        MatrixXX W = MatrixXX::Zero(n, m);
+        MatrixXX Z = MatrixXX::Zero(m, m);
+        VectorX  f_w = VectorX::Zero(m);
+        MatrixBlock block;
+
+        for(int k = 0; k < nb_added; ++k)
+        {
+            for(int i = 0; i < nb_base; ++i)
+            {
+                assemble_block(_base_points[i] - _added_points[k], block);
+                W.template block<Dim+1,Dim+1>(B * i, B * k) = block;
+            }
+            for(int l = 0; l < nb_added; ++l)
+            {
+                assemble_block(_added_points[k] - _added_points[l], block);
+                Z.template block<Dim+1,Dim+1>(B * k, B * l) = block;
+            }
+            f_w.template segment<Dim>(B * k + 1) = _added_normals[k];
+        }
+
+        int column = B * nb_added;
+        for(int i = 0; i < nb_base; ++i)
+        {
+            if(!_base_removed[i])
+                continue;
+            W.template block<Dim+1,Dim+1>(B * i, column).setIdentity();
+            column += B;
+        }
+
+        MatrixXX A_inv_W = _base_lu.solve(W);
+        MatrixXX schur   = Z - W.transpose() * A_inv_W;
+        VectorX  y_w     = schur.fullPivLu().solve(f_w - W.transpose() * _base_y);
+        VectorX  y       = _base_y - A_inv_W * y_w;
+
+        // gather the weights of the current nodes, x = S*y
+        int nb_nodes = nb_base - nb_removed + nb_added;
+        _node_centers.resize(Dim, nb_nodes);
+        _alphas.resize(nb_nodes);
+        _betas.resize(Dim, nb_nodes);
+
+        int node = 0;
+        for(int i = 0; i < nb_base; ++i, ++node)
+        {
+            if(_base_removed[i])
+            {
+                --node;
+                continue;
+            }
+            _node_centers.col(node) = _base_points[i];
+            _alphas(node)           = y(B * i);
+            _betas.col(node)        = -y.template segment<Dim>(B * i + 1);
+        }
+        for(int k = 0; k < nb_added; ++k, ++node)
+        {
+            _node_centers.col(node) = _added_points[k];
+            _alphas(node)           = y_w(B * k);
+            _betas.col(node)        = -y_w.template segment<Dim>(B * k + 1);
+        }
+
+        // residual of the updated system, against the constraints it holds
+        VectorX weights(B * nb_nodes), f(B * nb_nodes), product(B * nb_nodes);
+        for(int i = 0; i < nb_nodes; ++i)
+        {
+            weights(B * i) = _alphas(i);
+            weights.template segment<Dim>(B * i + 1) = -_betas.col(i);
+        }
+        node = 0;
+        for(int i = 0; i < nb_base; ++i)
+            if(!_base_removed[i])
+                f.template segment<Dim+1>(B * node++) = _base_f.template segment<Dim+1>(B * i);
+        for(int k = 0; k < nb_added; ++k)
+            f.template segment<Dim+1>(B * node++) = f_w.template segment<Dim+1>(B * k);
+
+        apply_system(weights, product);
+        _residual = (product - f).norm();
+        if(f.norm() > 0)
+            _residual /= f.norm();
+
+        update_batch_nodes();
+    }
+
+    // -------------------------------------------------------------------------
+
+    /// The current nodes and their normals, remaining base nodes then added ones
+    void current_nodes(std::vector<Vector>& points, std::vector<Vector>& normals) const
+    {
+        for(unsigned i = 0; i < _base_points.size(); ++i)
+        {
+            if(_base_removed[i])
+                continue;
+            points.push_back(_base_points[i]);
+            normals.push_back(_base_normals[i]);
+        }
+        points.insert(points.end(), _added_points.begin(), _added_points.end());
+        normals.insert(normals.end(), _added_normals.begin(), _added_normals.end());
+    }
+
+    // -------------------------------------------------------------------------
+
+    /// Spreads the assembly over threads, serial when empty
+    Parallel_for _parallel_for;
+    /// First solver hermite_fit tries
+    Solver _solver;
+    /// Relative residual above which hermite_fit escalates to the next solver
+    Scalar _residual_tolerance;
+    /// Solver that produced the last fit
+    Solver _used_solver;
+    /// Relative residual of the last fit
+    Scalar _residual;
+    /// Distance beyond which a compact kernel vanishes
+    Scalar _support_radius;
+    /// Copy of the nodes for eval_grad, global kernels
+    hrbf_batch::Nodes<Scalar, Dim> _batch_nodes;
+    /// Nodes bucketed by position, compact kernels
+    hrbf_grid::Node_grid<Scalar, Dim> _grid;
+    /// Relative residual the ITERATIVE solver stops at
+    Scalar _iterative_tolerance;
+    /// Most products with the system the ITERATIVE solver may do
+    int _max_iterations;
+    /// Products with the system between restarts of the ITERATIVE solver
+    int _restart;
+    /// Whether the ITERATIVE solver starts from the previous weights
+    bool _warm_start;
+    /// Products with the system the last ITERATIVE fit did
+    int _iterations;
+    /// Whether dense fits keep their factorisation
+    bool _keep_factorisation;
+    /// Whether '_base_lu' factorises the system of the base nodes
+    bool _has_factorisation;
+    /// Centres added or removed before an update refits from scratch
+    int _max_pending_updates;
+    /// LU of the system of the last full fit
+    Eigen::PartialPivLU<MatrixXX> _base_lu;
+    /// Nodes of the last full fit
+    std::vector<Vector> _base_points;
+    std::vector<Vector> _base_normals;
+    /// Right hand side and solution of the last full fit, in y = S*x form
+    VectorX _base_f;
+    VectorX _base_y;
+    /// Base nodes removed since the last full fit
+    std::vector<bool> _base_removed;
+    int _nb_removed;
+    /// Nodes added since the last full fit
+    std::vector<Vector> _added_points;
+    std::vector<Vector> _added_normals;
+
 }; // END HermiteRbfReconstruction Class =======================================
 
 #endif // HRBF_CORE_HPP__
@@ -0,0 +1,160 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public License,
+ * v. 2.0. If a copy of the MPL was not distributed with this file,
+ * You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+/// @file hrbf_grid.h
+/// Idris Miles - Uniform grid of HRBF nodes for compactly supported kernels
+
+#ifndef HRBF_GRID_HPP__
+#define HRBF_GRID_HPP__
+
+#include <vector>
+#include <cmath>
+
+/// @brief Buckets node centres into a uniform grid whose cells are at least
+/// as wide as the kernel support, so every node that can influence a point
+/// lies in the 3^Dim cells around it. Cells are stored compressed: the nodes
+/// of cell c are cell_nodes[cell_start[c] .. cell_start[c+1]).
+namespace hrbf_grid {
+
+template<typename Scalar, int Dim>
+class Node_grid
+{
+public:
+    /// Cells allowed per node before the cells are made wider, keeps sparse
+    /// sets of centres from allocating huge empty grids
+    enum { Max_cells_per_node = 8 };
+
+    Node_grid() : _cell_size(1), _nb_cells(0) {}
+
+    /// Bucket the columns of 'centers'
+    /// @param cell_size : smallest cell width, the kernel support radius
+    template<typename MatrixDX>
+    void build(const MatrixDX& centers, Scalar cell_size)
+    {
+        int nb_nodes = centers.cols();
+        _cell_size = cell_size;
+
+        Scalar max_corner[Dim];
+        for(int d = 0; d < Dim; ++d)
+        {
+            _origin[d]    = nb_nodes > 0 ? centers.row(d).minCoeff() : Scalar(0);
+            max_corner[d] = nb_nodes > 0 ? centers.row(d).maxCoeff() : Scalar(0);
+        }
+
+        // widen the cells until the grid is small enough
+        double max_cells = double(Max_cells_per_node) * (nb_nodes + 1);
+        for(;;)
+        {
+            double total = 1;
+            for(int d = 0; d < Dim; ++d)
+            {
+                _dims[d] = int(std::floor((max_corner[d] - _origin[d]) / _cell_size)) + 1;
+                total *= _dims[d];
+            }
+            if(total <= max_cells)
+                break;
+            _cell_size *= Scalar(2);
+        }
+
+        _nb_cells = 1;
+        for(int d = 0; d < Dim; ++d)
+            _nb_cells *= _dims[d];
+
+        // counting sort of the nodes by cell
+        std::vector<int> node_cell(nb_nodes);
+        _cell_start.assign(_nb_cells + 1, 0);
+        for(int i = 0; i < nb_nodes; ++i)
+        {
+            int cell[Dim];
+            for(int d = 0; d < Dim; ++d)
+                cell[d] = clamp(cell_coord(centers(d, i), d), 0, _dims[d] - 1);
+            node_cell[i] = linear_index(cell);
+            _cell_start[node_cell[i] + 1]++;
+        }
+
+        for(int c = 0; c < _nb_cells; ++c)
+            _cell_start[c + 1] += _cell_start[c];
+
+        std::vector<int> fill(_cell_start.begin(), _cell_start.end() - 1);
+        _cell_nodes.resize(nb_nodes);
+        for(int i = 0; i < nb_nodes; ++i)
+            _cell_nodes[fill[node_cell[i]]++] = i;
+    }
+
+    /// Call 'func(node_index)' for every node in the cells around 'x'. This
+    /// includes every node closer than the cell size, and a few further away
+    template<typename Vector, typename Func>
+    void for_each_near(const Vector& x, Func func) const
+    {
+        if(_nb_cells == 0)
+            return;
+
+        int lo[Dim], hi[Dim], cell[Dim];
+        for(int d = 0; d < Dim; ++d)
+        {
+            int c = cell_coord(x(d), d);
+            lo[d] = clamp(c - 1, 0, _dims[d]);
+            hi[d] = clamp(c + 1, -1, _dims[d] - 1);
+            if(lo[d] > hi[d])
+                return;
+            cell[d] = lo[d];
+        }
+
+        // odometer over the neighbouring cells
+        for(;;)
+        {
+            int c = linear_index(cell);
+            for(int k = _cell_start[c]; k < _cell_start[c + 1]; ++k)
+                func(_cell_nodes[k]);
+
+            int d = 0;
+            while(d < Dim && cell[d] == hi[d])
+            {
+                cell[d] = lo[d];
+                ++d;
+            }
+            if(d == Dim)
+                break;
+            ++cell[d];
+        }
+    }
+
+    /// Width of the cells, at least the size given to build()
+    Scalar cell_size() const { return _cell_size; }
+
+private:
+    /// Cell coordinate of 'x' along axis 'd', kept well inside int range
+    int cell_coord(Scalar x, int d) const
+    {
+        double c = std::floor(double(x - _origin[d]) / _cell_size);
+        if(!(c > -2.0))
+            return -2;
+        if(c > double(_dims[d]) + 1.0)
+            return _dims[d] + 1;
+        return int(c);
+    }
+
+    static int clamp(int v, int lo, int hi) { return v < lo ? lo : (v > hi ? hi : v); }
+
+    int linear_index(const int* cell) const
+    {
+        int index = 0;
+        for(int d = Dim - 1; d >= 0; --d)
+            index = index * _dims[d] + cell[d];
+        return index;
+    }
+
+    Scalar _origin[Dim];
+    Scalar _cell_size;
+    int    _dims[Dim];
+    int    _nb_cells;
+    /// Offset of each cell in '_cell_nodes', plus one past the end
+    std::vector<int> _cell_start;
+    /// Node indices sorted by cell
+    std::vector<int> _cell_nodes;
+};
+
+} // END namespace hrbf_grid ===================================================
+
+#endif // HRBF_GRID_HPP__
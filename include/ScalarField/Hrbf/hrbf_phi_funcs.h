@@ -30,4 +30,52 @@ struct Rbf_pow3
     static inline Scalar ddf(const Scalar& x) { return Scalar(6) * x;     }
 };
 
+/**
+ * @class Rbf_wendland_c2
+ * Wendland's compactly supported radial basis phi(x) = (1-x)^4 (4x+1),
+ * C2 and zero for x >= 1. Scale distances by the support radius before
+ * calling, HRBF_fit does this, see HRBF_fit::set_support_radius
+ **/
+template<typename Scalar>
+struct Rbf_wendland_c2
+{
+    // phi(x) = (1-x)^4 (4x+1)
+    static inline Scalar f  (const Scalar& x) { if(x >= Scalar(1)) return Scalar(0); Scalar t = Scalar(1) - x; return t*t*t*t * (Scalar(4)*x + Scalar(1)); }
+    // first derivative phi'(x) = -20x (1-x)^3
+    static inline Scalar df (const Scalar& x) { if(x >= Scalar(1)) return Scalar(0); Scalar t = Scalar(1) - x; return Scalar(-20) * x * t*t*t; }
+    // second derivative phi''(x) = 20 (1-x)^2 (4x-1)
+    static inline Scalar ddf(const Scalar& x) { if(x >= Scalar(1)) return Scalar(0); Scalar t = Scalar(1) - x; return Scalar(20) * t*t * (Scalar(4)*x - Scalar(1)); }
+};
+
+/**
+ * @class Rbf_wendland_c4
+ * Wendland's compactly supported radial basis phi(x) = (1-x)^6 (35x^2+18x+3),
+ * C4 and zero for x >= 1. The extra smoothness over Rbf_wendland_c2 keeps
+ * the Hessian terms of the Hermite system well behaved, prefer this one.
+ **/
+template<typename Scalar>
+struct Rbf_wendland_c4
+{
+    // phi(x) = (1-x)^6 (35x^2 + 18x + 3)
+    static inline Scalar f  (const Scalar& x) { if(x >= Scalar(1)) return Scalar(0); Scalar t = Scalar(1) - x; Scalar t3 = t*t*t; return t3*t3 * (Scalar(35)*x*x + Scalar(18)*x + Scalar(3)); }
+    // first derivative phi'(x) = -56x (1-x)^5 (5x+1)
+    static inline Scalar df (const Scalar& x) { if(x >= Scalar(1)) return Scalar(0); Scalar t = Scalar(1) - x; return Scalar(-56) * x * t*t*t*t*t * (Scalar(5)*x + Scalar(1)); }
+    // second derivative phi''(x) = -56 (1-x)^4 (1 + 4x - 35x^2)
+    static inline Scalar ddf(const Scalar& x) { if(x >= Scalar(1)) return Scalar(0); Scalar t = Scalar(1) - x; return Scalar(-56) * t*t*t*t * (Scalar(1) + Scalar(4)*x - Scalar(35)*x*x); }
+};
+
+/**
+ * @class Rbf_support
+ * Tells HRBF_fit whether a radial basis vanishes beyond x = 1. Compact
+ * kernels get a sparse system and a grid to find the nodes near a point.
+ **/
+template<typename Rbf>
+struct Rbf_support { enum { compact = 0 }; };
+
+template<typename Scalar>
+struct Rbf_support< Rbf_wendland_c2<Scalar> > { enum { compact = 1 }; };
+
+template<typename Scalar>
+struct Rbf_support< Rbf_wendland_c4<Scalar> > { enum { compact = 1 }; };
+
 #endif //HRBF_PHI_FUNCS_HPP_
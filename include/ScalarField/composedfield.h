@@ -50,6 +50,30 @@ public:
     /// @param _x : sample point
     float Eval(glm::vec3 _x);
 
+    /// @brief method to evaluate composed field at sample point on CPU with explicit field transforms,
+    /// leaves the transforms stored in the field functions untouched
+    /// @param _x : sample point
+    /// @param _transformA : transform into the space of field A
+    /// @param _transformB : transform into the space of field B
+    /// @param _error : largest voxel size each field may be sampled at, see FieldFunction::GetLevel, 0 for full detail
+    float Eval(glm::vec3 _x, const glm::mat4 &_transformA, const glm::mat4 &_transformB, const float _error = 0.0f);
+
+    /// @brief method to evaluate composed field at many sample points on CPU, the values are Eval's
+    /// @param _x : sample points
+    /// @param _numPoints : number of sample points
+    /// @param _f : output, composed field value per sample point
+    void EvalBatch(const glm::vec3 *_x, const unsigned int _numPoints, float *_f);
+
+    /// @brief method to evaluate composed field at many sample points on CPU with explicit field transforms, the values are Eval's.
+    /// Field values and the composition are looked up a batch at a time, with both fields the gradients are still taken a point at a time
+    /// @param _x : sample points
+    /// @param _numPoints : number of sample points
+    /// @param _transformA : transform into the space of field A
+    /// @param _transformB : transform into the space of field B
+    /// @param _f : output, composed field value per sample point
+    /// @param _error : largest voxel size each field may be sampled at, see FieldFunction::GetLevel, 0 for full detail
+    void EvalBatch(const glm::vec3 *_x, const unsigned int _numPoints, const glm::mat4 &_transformA, const glm::mat4 &_transformB, float *_f, const float _error = 0.0f);
+
 private:
     /// @brief composition operator
     std::shared_ptr<CompositionOp> m_compositionOp;
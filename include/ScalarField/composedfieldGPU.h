@@ -3,7 +3,12 @@
 
 //-------------------------------------------------------------------------------
 
+#ifndef NO_CUDA
 #include <cuda_runtime.h>
+#define COMPFIELD_HOST_DEVICE __host__ __device__
+#else
+#define COMPFIELD_HOST_DEVICE
+#endif
 
 
 //-------------------------------------------------------------------------------
@@ -13,12 +18,13 @@
 //-------------------------------------------------------------------------------
 
 /// @class ComposedFieldCuda
-/// @brief composed field class that can be used in CUDA, holds id of fields to compose and id to operator to compose them with
+/// @brief composed field class that can be used in CUDA, holds id of fields to compose and id to operator to compose them with.
+/// The CPU evaluation uses the same ids, so it is also built with NO_CUDA.
 class ComposedFieldCuda
 {
 public:
     /// @brief constructor
-    __host__ __device__ ComposedFieldCuda(int _fieldFuncA = -1, int _fieldFuncB = -1, int _compOp = -1) :
+    COMPFIELD_HOST_DEVICE ComposedFieldCuda(int _fieldFuncA = -1, int _fieldFuncB = -1, int _compOp = -1) :
         fieldFuncA(_fieldFuncA),
         fieldFuncB(_fieldFuncB),
         compOp(_compOp)
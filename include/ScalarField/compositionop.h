@@ -7,9 +7,11 @@
 
 #include <glm/glm.hpp>
 
+#ifndef NO_CUDA
 #include <cuda.h>
 
 #include "Texture/Texture3DCuda.h"
+#endif
 #include "Texture/Texture3DCpu.h"
 
 
@@ -44,21 +46,32 @@ public:
 
     /// @brief method to precompute composition operator into a texture
     /// @param _res : resolution of texture
-    void Precompute(const unsigned int _res = 32);
+    /// @param _gpuTexture : whether to also create the CUDA textures, false when no CUDA device is available
+    void Precompute(const unsigned int _res = 32, const bool _gpuTexture = true);
 
     /// @brief Method to compute the result value of the composed field functions
     float Eval(const float f1, const float f2, const float d);
 
+    /// @brief Method to compute the result values of many pairs of composed field values at once, the values are Eval's
+    /// @param _f1 : value of the first field per point
+    /// @param _f2 : value of the second field per point
+    /// @param _d : theta of the angle between the fields' gradients per point
+    /// @param _numPoints : number of points
+    /// @param _out : output, composed value per point
+    void EvalBatch(const float *_f1, const float *_f2, const float *_d, const unsigned int _numPoints, float *_out);
+
     /// @brief Method to map angle to a value between [0:1]
     /// Refered to as controller dc(alpha) parameter for composition operator
     /// in "Robust Iso-Surface Tracking for Interactive Character Skinning"
     float Theta(const float _angleRadians);
 
+#ifndef NO_CUDA
     /// @brief method to get composition operator precomputed 3D texture
     cudaTextureObject_t &GetFieldFunc3DTexture();
 
     /// @brief method to get theta opening function precomputed 1D texture
     cudaTextureObject_t &GetThetaTexture();
+#endif
 
 private:
     /// @brief theta opening function - remaps angle to value [0-1]
@@ -77,11 +90,13 @@ private:
     /// @brief cpu texture of composed field
     Texture3DCpu<float> m_field;
 
+#ifndef NO_CUDA
     /// @brief gpu texture of composed field
     Texture3DCuda<float4> d_field;
 
     /// @brief gpu texture of theta opening function
     cudaTextureObject_t d_theta;
+#endif
 
 
     /// @brief generic composition operator parameters from "A Gradient-Based Implicit Blend" paper
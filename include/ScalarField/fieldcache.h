@@ -0,0 +1,87 @@
+#ifndef FIELDCACHE_H
+#define FIELDCACHE_H
+
+//-------------------------------------------------------------------------------
+
+#include <string>
+#include <utility>
+
+#include <glm/glm.hpp>
+
+#include <ScalarField/fieldfunction.h>
+#include <Model/mesh.h>
+
+
+//-------------------------------------------------------------------------------
+/// @author Idris Miles
+/// @version 1.0
+/// @date 18/04/2017
+//-------------------------------------------------------------------------------
+
+
+/// @class FieldCache
+/// @brief An on disk cache of fitted and precomputed field functions, one file per field.
+/// Files are keyed by a hash of everything the field is generated from, so a warm start
+/// maps each file and restores the field without sampling the mesh, fitting or precomputing.
+class FieldCache
+{
+public:
+    /// @typedef Key
+    /// @brief Hash of a mesh part and the settings its field is generated with
+    typedef unsigned long long Key;
+
+    /// @brief constructor
+    /// @param _directory : directory the files are kept in, an empty string disables the cache
+    FieldCache(const std::string &_directory = DefaultDirectory());
+
+    /// @brief destructor
+    ~FieldCache();
+
+    /// @brief Method to get the directory used unless told otherwise, ImplicitSkinning/fields under $XDG_CACHE_HOME or ~/.cache
+    static std::string DefaultDirectory();
+
+    /// @brief Method to make the key of a field from what it is generated from,
+    /// the arguments match those of ImplicitSkinDeformer::GenerateGlobalFieldFunction
+    /// @param _meshPart : the mesh part the field is fit to
+    /// @param _boneEnds : the start and end joint of its bone
+    /// @param _numHrbfCentres : number of HRBF centres, or the most with a tolerance
+    /// @param _hrbfTolerance : tolerance of adaptive fits, 0 for a fixed number of centres
+    /// @param _numVoxels : number of voxels the textures are precomputed with
+    static Key MakeKey(const Mesh &_meshPart,
+                       const std::pair<glm::vec3, glm::vec3> &_boneEnds,
+                       const int _numHrbfCentres,
+                       const float _hrbfTolerance,
+                       const int _numVoxels);
+
+    /// @brief Method to set the directory the files are kept in, an empty string disables the cache
+    void SetDirectory(const std::string &_directory);
+
+    /// @brief Method to get the directory the files are kept in
+    std::string GetDirectory() const;
+
+    /// @brief Method to restore a field from its file
+    /// @param _key : key of the field
+    /// @param _fieldFunc : field to restore, left as it was on a miss
+    /// @param _gpuTexture : whether to also create the CUDA texture, false when no CUDA device is available
+    /// @return bool false if there is no valid file for the key
+    bool Load(const Key _key, FieldFunction &_fieldFunc, const bool _gpuTexture = true) const;
+
+    /// @brief Method to write a field to its file, replacing any file already there.
+    /// The file is written aside and renamed into place, so a concurrent or interrupted save never leaves half a file.
+    /// @param _key : key of the field
+    /// @param _fieldFunc : a fit and precomputed field
+    /// @return bool false if the cache is disabled, the field was not precomputed or the file could not be written
+    bool Save(const Key _key, const FieldFunction &_fieldFunc) const;
+
+
+private:
+    /// @brief Method to get the file of a key
+    std::string FilePath(const Key _key) const;
+
+    /// @brief Directory the files are kept in, empty when the cache is disabled
+    std::string m_directory;
+};
+
+//-------------------------------------------------------------------------------
+
+#endif // FIELDCACHE_H
@@ -5,15 +5,19 @@
 // includes
 
 #include <glm/glm.hpp>
+#include <atomic>
 #include <utility>
+#include <vector>
 
 #include "Hrbf/hrbf_core.h"
 #include "Hrbf/hrbf_phi_funcs.h"
 
+#ifndef NO_CUDA
 #include <cuda.h>
 
 #include "Texture/Texture3DCuda.h"
-#include "Texture/Texture3DCpu.h"
+#endif
+#include "Texture/SparseTexture3DCpu.h"
 
 
 //--------------------------------------------------------------------------------
@@ -24,8 +28,14 @@
 
 
 /// @typedef DistanceField
+/// @brief Stays on the globally supported r^3 kernel, Remap needs a distance that is defined everywhere,
+/// a compact kernel such as Rbf_wendland_c4 is zero away from the centres, inside and outside alike.
 typedef HRBF_fit<float, 3, Rbf_pow3<float> > DistanceField;
 
+/// @typedef DistanceFieldFit
+/// @brief Double precision twin of DistanceField the HRBF system is solved in, its weights are then evaluated in float.
+typedef HRBF_fit<double, 3, Rbf_pow3<double> > DistanceFieldFit;
+
 
 //-------------------------------------------------------------------------------
 
@@ -43,12 +53,93 @@ public:
     /// @param points : HRBF centres used to generate field function
     /// @param normals : HRBF normals used to generate field function
     /// @param _r : support radius of field function
+    /// @param _workspace : buffers to reuse for the design matrix, used by one fit at a time, nullptr to allocate them for this fit only
     void Fit(const std::vector<glm::vec3>& points,
              const std::vector<glm::vec3>& normals,
-             const float _r = 1.0f);
-
-    /// @brief Method to precompute field values and store them in m_field attribute.
-    void PrecomputeField(const unsigned int _res = 32, const float _dim = 8.0f);
+             const float _r = 1.0f,
+             DistanceFieldFit::Workspace *_workspace = nullptr);
+
+    /// @brief Method to precompute field values over the cube [-_dim:_dim] and store them in m_field attribute.
+    /// @param _res : resolution of textures
+    /// @param _dim : dimension of sample space to map to texture space
+    /// @param _gpuTexture : whether to also create the CUDA texture, false when no CUDA device is available
+    void PrecomputeField(const unsigned int _res = 32, const float _dim = 8.0f, const bool _gpuTexture = true);
+
+    /// @brief Method to precompute field values over a box, with its own resolution along each axis.
+    /// Only blocks of voxels within the support radius of the surface are evaluated in full, the rest are interpolated.
+    /// With incremental refitting on, and the same _res, box and transform as the last call,
+    /// only the blocks near the surface the refit changed are evaluated again.
+    /// @param _res : number of voxels along each axis
+    /// @param _boundsMin : lowest corner of the box the textures cover
+    /// @param _boundsMax : highest corner of the box the textures cover
+    /// @param _gpuTexture : whether to also create the CUDA texture, false when no CUDA device is available
+    void PrecomputeField(const glm::uvec3 &_res, const glm::vec3 &_boundsMin, const glm::vec3 &_boundsMax, const bool _gpuTexture = true);
+
+    /// @brief Method to get a box outside which the field remaps to 0, so textures only need to cover that box.
+    /// Starts from the HRBF centres and grows until the field is 0 at samples over its faces.
+    /// @param _boundsMin : output, lowest corner
+    /// @param _boundsMax : output, highest corner
+    void GetSupportBounds(glm::vec3 &_boundsMin, glm::vec3 &_boundsMax);
+
+    /// @brief Method to get the box the textures of the last PrecomputeField cover
+    /// @param _boundsMin : output, lowest corner
+    /// @param _boundsMax : output, highest corner
+    void GetTextureBounds(glm::vec3 &_boundsMin, glm::vec3 &_boundsMax) const;
+
+    /// @brief Method to get the number of voxels along each axis of the textures of the last PrecomputeField
+    /// @param _level : level of the CPU texture, see GetLevel, clamped to the coarsest
+    glm::uvec3 GetTextureResolution(const unsigned int _level = 0) const;
+
+    /// @brief Method to get the number of levels of the CPU texture, level 0 is the one PrecomputeField samples
+    /// and each level after it has half the voxels along each axis of the one before, over the same box
+    unsigned int GetNumLevels() const;
+
+    /// @brief Method to get the coarsest level whose voxels are no larger than _error,
+    /// for example the size of a pixel at the distance the field is seen from
+    /// @param _error : largest voxel side, in the units of the field's space
+    /// @return unsigned int the level, 0 when even its voxels are larger
+    unsigned int GetLevel(const float _error) const;
+
+    /// @brief Method to set the width in voxels of the blocks PrecomputeField works in. Blocks that cannot reach within
+    /// the support radius of the surface are interpolated from their corners, the rest are evaluated voxel by voxel.
+    /// A block size of 1 evaluates every voxel. The next PrecomputeField starts over rather than refitting incrementally.
+    /// @param _blockSize : block width, at least 1
+    void SetPrecomputeBlockSize(const unsigned int _blockSize);
+
+    /// @brief Method to get the width in voxels of the blocks PrecomputeField works in
+    unsigned int GetPrecomputeBlockSize() const;
+
+    /// @brief Method to keep the factorisation of the fit and the unremapped precomputed field,
+    /// so a later Fit with mostly the same centres only adds and removes the centres that changed
+    /// and PrecomputeField only updates the part of the textures that moved.
+    /// Costs the LU of the dense system and 16 bytes per voxel.
+    /// @param _incremental : whether to refit incrementally
+    void SetIncrementalRefit(const bool _incremental);
+
+    /// @brief Method to check whether this field refits incrementally
+    bool IsIncrementalRefit() const;
+
+    /// @brief Method to make PrecomputeField leave the bricks of the CPU texture near the surface unfilled,
+    /// each is filled by exact HRBF evaluation the first time a lookup reads from it, so only the bricks
+    /// an animation reaches are ever computed. Lookups on different threads fill different bricks in parallel.
+    /// Only applies when PrecomputeField does not create the CUDA texture and the field is not refit incrementally,
+    /// both need every voxel up front. Until every brick is filled there are no coarser levels and Serialise fails,
+    /// the lookup that fills the last brick builds the levels, or FinishLazyPrecompute fills what is left.
+    /// @param _lazy : whether to precompute lazily
+    void SetLazyPrecompute(const bool _lazy);
+
+    /// @brief Method to check whether this field precomputes lazily
+    bool IsLazyPrecompute() const;
+
+    /// @brief Method to check whether bricks a lazy PrecomputeField left are still to be filled
+    bool HasLazyBricks() const;
+
+    /// @brief Method to fill every brick a lazy PrecomputeField left and build the coarser levels,
+    /// leaving the field as an eager PrecomputeField would, so it can be serialised.
+    /// The field must not be evaluated at the same time.
+    /// @param _gpuTexture : whether to also create the CUDA texture, false when no CUDA device is available
+    /// @return bool false if the last PrecomputeField was not lazy or the field was finished already, nothing is done
+    bool FinishLazyPrecompute(const bool _gpuTexture = true);
 
     /// @brief Method to set the support radius in order to remap the distance field
     /// to a compact field function with range [0:1]
@@ -67,16 +158,76 @@ public:
     /// @param _x : sample point
     float Eval(const glm::vec3& _x);
 
+    /// @brief Method to evaluate this field with an explicit transform instead of the one set with SetTransform,
+    /// so several frames can sample the field at once
+    /// @param _x : sample point
+    /// @param _transform : transform from world space into this fields space
+    /// @param _level : level of the texture to sample, see GetLevel, clamped to the coarsest
+    float Eval(const glm::vec3& _x, const glm::mat4& _transform, const unsigned int _level = 0);
+
+    /// @brief Method to evaluate this field at many sample points with an explicit transform, the values are Eval's.
+    /// The points are looked up in the texture a batch at a time, see SparseTexture3DCpu::EvalBatch.
+    /// @param _x : sample points
+    /// @param _numPoints : number of sample points
+    /// @param _transform : transform from world space into this fields space
+    /// @param _f : output, field value per sample point
+    /// @param _level : level of the texture to sample, see GetLevel, clamped to the coarsest
+    void EvalBatch(const glm::vec3 *_x, const unsigned int _numPoints, const glm::mat4& _transform, float *_f, const unsigned int _level = 0);
+
     /// @brief Method to evaluate the underlying distance field function
     /// @param _x : sample point
     float EvalDist(const glm::vec3& x);
 
+    /// @brief Method to evaluate the underlying distance field function and its gradient at many points in one batch
+    /// @param _x : sample points
+    /// @param _dist : output, distance field value per sample point
+    /// @param _grad : output, distance field gradient per sample point
+    void EvalDistGrad(const std::vector<glm::vec3>& _x, std::vector<float>& _dist, std::vector<glm::vec3>& _grad);
+
     /// @brief Method to evaluate the gradient of the field
     /// @param _x : sample point
     glm::vec3 Grad(const glm::vec3& x);
 
+    /// @brief Method to evaluate the gradient of the field with an explicit transform
+    /// @param _x : sample point
+    /// @param _transform : transform from world space into this fields space
+    /// @param _level : level of the texture to sample, see GetLevel, clamped to the coarsest
+    glm::vec3 Grad(const glm::vec3& _x, const glm::mat4& _transform, const unsigned int _level = 0);
+
+    /// @brief Method to evaluate the field and its gradient with a single transform into the field's space
+    /// @param _x : sample point
+    /// @param _grad : output, gradient of the field at _x
+    float EvalGrad(const glm::vec3& _x, glm::vec3& _grad);
+
+    /// @brief Method to evaluate the field and its gradient with a single transform into the field's space and an explicit transform.
+    /// The value is Eval's, the gradient is the analytic one of the same trilinear interpolation with respect to _x,
+    /// 0 where the field is flat. See SparseTexture3DCpu::EvalCubic for a gradient that is continuous across voxels.
+    /// @param _x : sample point
+    /// @param _transform : transform from world space into this fields space
+    /// @param _grad : output, gradient of the field at _x
+    /// @param _level : level of the texture to sample, see GetLevel, clamped to the coarsest
+    float EvalGrad(const glm::vec3& _x, const glm::mat4& _transform, glm::vec3& _grad, const unsigned int _level = 0);
+
+#ifndef NO_CUDA
     /// @brief Method to Get the cuda texture object holding the field function
     cudaTextureObject_t &GetFieldFuncCudaTextureObject();
+#endif
+
+    /// @brief Method to append everything a precomputed field is evaluated from to a blob,
+    /// the HRBF weights, support radius, texture box and resolution and the CPU texture as it is stored.
+    /// Coarser levels are not stored, Deserialise builds them again.
+    /// The transform set with SetTransform and the incremental refit state are not included.
+    /// @param _out : buffer to append to
+    /// @return bool false if the field has not been fit and precomputed on the CPU or has bricks still to fill, nothing is appended
+    bool Serialise(std::vector<char> &_out) const;
+
+    /// @brief Method to restore a field appended by Serialise instead of fitting and precomputing it.
+    /// The GPU texture is built from the CPU texture, its gradient is the field's own, so 0 away from the narrow band.
+    /// @param _in : start of the field, moved past it
+    /// @param _end : end of the buffer
+    /// @param _gpuTexture : whether to also create the CUDA texture, false when no CUDA device is available
+    /// @return bool false if the buffer does not hold a valid field, the field is then left as it was
+    bool Deserialise(const char *&_in, const char *_end, const bool _gpuTexture = true);
 
 
 
@@ -92,6 +243,66 @@ private:
     /// @return glm::vec3 newly transformed point
     glm::vec3 TransformSpace(glm::vec3 _x);
 
+    /// @brief Method to apply _transform to point _x
+    glm::vec3 TransformSpace(const glm::vec3 &_x, const glm::mat4 &_transform) const;
+
+    /// @brief Method to update m_incrementalFit with the centres that differ from the ones it was fit to
+    /// @param _points : new HRBF centres
+    /// @param _normals : new HRBF normals
+    /// @return bool false when there is no factorisation to update or too much changed, a full fit is needed
+    bool UpdateFit(const std::vector<DistanceFieldFit::Vector> &_points,
+                   const std::vector<DistanceFieldFit::Vector> &_normals);
+
+    /// @brief Method to evaluate the distance field and its gradient at the corners of the blocks PrecomputeField works in
+    /// @param _corners : output, gradient and distance per block corner
+    void SampleBlockCorners(std::vector<glm::vec4> &_corners);
+
+    /// @brief Method to flag the blocks that can reach within the support radius of the surface, the rest remap to 0 or 1
+    /// @param _corners : gradient and distance per block corner
+    /// @param _bandBlocks : output, one flag per block
+    void FindBandBlocks(const std::vector<glm::vec4> &_corners,
+                        std::vector<unsigned char> &_bandBlocks);
+
+    /// @brief Method to flag the blocks next to a corner where the field differs from the one _rawField was precomputed from
+    /// @param _corners : gradient and distance per block corner
+    /// @param _rawField : gradient and distance of every voxel of the last precompute
+    /// @param _changedBlocks : output, one flag per block
+    void FindChangedBlocks(const std::vector<glm::vec4> &_corners,
+                           const std::vector<glm::vec4> &_rawField,
+                           std::vector<unsigned char> &_changedBlocks);
+
+    /// @brief Method to build the coarser levels of the CPU texture from the voxels of level 0
+    /// @param _field : field value per voxel of level 0, x fastest
+    void BuildFieldLevels(const float *_field);
+
+    /// @brief Method to get a level of the CPU texture, clamped to the coarsest
+    SparseTexture3DCpu<float, unsigned short> &FieldLevel(const unsigned int _level);
+
+    /// @brief Method to fill the lazily precomputed bricks a lookup at _x reads from, that are not filled yet
+    /// @param _x : sample point in the space of this field
+    void FillLazyBricks(const glm::vec3 &_x);
+
+    /// @brief Method to fill a lazily precomputed brick, or wait for the thread already filling it
+    /// @param _brick : which brick of m_field along each axis
+    void FillLazyBrick(const glm::uvec3 &_brick);
+
+    /// @brief Method to create the CUDA texture from field values and gradients of every voxel of the textures, does nothing built with NO_CUDA
+    /// @param _field : field value per voxel, x fastest
+    /// @param _grad : gradient per voxel
+    /// @param _maxGrad : largest magnitude of a component of the gradients
+    void CreateFieldTexture(const float *_field, const glm::vec3 *_grad, const float _maxGrad);
+
+    /// @brief Method to create the CUDA texture from field values alone, the gradient is taken by central differences,
+    /// negated to point along the distance gradient, so it is 0 away from the narrow band
+    /// @param _field : field value per voxel, x fastest
+    void CreateFieldTexture(const std::vector<float> &_field);
+
+    /// @brief Method to get the sample point of a voxel of the grid PrecomputeField is sampling, in the space of the distance field
+    DistanceField::Vector VoxelSamplePoint(const unsigned int _x, const unsigned int _y, const unsigned int _z);
+
+    /// @brief Method to get the sample point of a voxel of the grid with an explicit transform instead of the one set with SetTransform
+    DistanceField::Vector VoxelSamplePoint(const unsigned int _x, const unsigned int _y, const unsigned int _z, const glm::mat4 &_transform) const;
+
     /// @brief boolean too check whether field function has been fitted yet
     bool m_fit;
 
@@ -114,14 +325,69 @@ private:
     /// @brief an HRBF distance field generator
     DistanceField m_distanceField;
 
-    /// @brief A CPU based 3D texture to store precomputed field value
-    Texture3DCpu<float> m_field;
+    /// @brief boolean to check whether fits keep their factorisation for incremental refits
+    bool m_incrementalRefit;
+
+    /// @brief The double precision fit and its factorisation, used when refitting incrementally
+    DistanceFieldFit m_incrementalFit;
+
+    /// @brief HRBF centres and normals of m_incrementalFit in its node order
+    std::vector<DistanceFieldFit::Vector> m_fitPoints;
+    std::vector<DistanceFieldFit::Vector> m_fitNormals;
+
+    /// @brief Gradient and distance, before remapping, of every voxel of the last precompute, kept when refitting incrementally
+    std::vector<glm::vec4> m_rawField;
+
+    /// @brief Blocks of m_rawField that were evaluated rather than interpolated from their corners
+    std::vector<unsigned char> m_rawExactBlocks;
+
+    /// @brief The transform m_rawField was sampled with
+    glm::mat4 m_rawTransform;
+
+    /// @brief Width in voxels of the blocks PrecomputeField evaluates in full or interpolates from their corners
+    unsigned int m_precomputeBlockSize;
+
+    /// @brief Number of voxels along each axis of the textures
+    glm::uvec3 m_textureRes;
+
+    /// @brief The box the textures cover
+    glm::vec3 m_textureBoundsMin;
+    glm::vec3 m_textureBoundsMax;
+
+    /// @brief A CPU based 3D texture to store precomputed field value, bricks outside the narrow band are a shared 0 or 1.
+    /// Values are in [0:1], 16 bit normalised storage is within 1e-5 of them.
+    /// Values are sampled trilinearly, gradients are the analytic ones of a tricubic interpolation.
+    SparseTexture3DCpu<float, unsigned short> m_field;
+
+    /// @brief Levels 1 and on of m_field, each resampled from the one before with half the voxels along each axis.
+    /// Coarse levels cost little memory and stay in cache, for fields seen from far away. CPU only.
+    std::vector<SparseTexture3DCpu<float, unsigned short> > m_fieldLevels;
+
+    /// @brief Largest voxel side of each level, level 0 first
+    std::vector<float> m_levelVoxelSize;
+
+    /// @brief boolean to check whether PrecomputeField leaves bricks to be filled as they are sampled, see SetLazyPrecompute
+    bool m_lazyPrecompute;
+
+    /// @brief State of each brick of m_field, filled, waiting to be filled or being filled.
+    /// Empty unless the last PrecomputeField was lazy.
+    std::vector<std::atomic<unsigned char> > m_lazyBricks;
+
+    /// @brief Number of bricks of m_field not filled yet, lookups only check m_lazyBricks while it is above 0.
+    /// Only drops to 0 once the coarser levels are built, until then lookups only read level 0.
+    std::atomic<unsigned int> m_numLazyBricks;
+
+    /// @brief Number of bricks of m_field not filled yet, the one that fills the last builds the coarser levels
+    std::atomic<unsigned int> m_numUnfilledBricks;
 
-    /// @brief A CPU based 3D texture to store precomputed gradient value
-    Texture3DCpu<glm::vec3> m_grad;
+    /// @brief The transform lazy bricks are sampled with, the one set when PrecomputeField was called
+    glm::mat4 m_lazyTransform;
 
-    /// @brief A GPU based 3D texture to store precomputed field value
-    Texture3DCuda<float4> d_field;
+    /// @brief A GPU based 3D texture to store precomputed gradient and field value, 16 bit normalised.
+    /// The gradient is divided by its largest component, kernels only use its direction.
+#ifndef NO_CUDA
+    Texture3DCuda<short4> d_field;
+#endif
 
 };
 
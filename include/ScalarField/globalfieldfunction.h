@@ -7,6 +7,7 @@
 #include <ScalarField/fieldfunction.h>
 #include <ScalarField/composedfield.h>
 #include <ScalarField/composedfieldGPU.h>
+#include <ScalarField/fieldcache.h>
 
 #include <Model/mesh.h>
 #include <MeshSampler/meshsampler.h>
@@ -47,6 +48,28 @@ public:
     /// @ret] glm::vec3 : Gradient of field at sample point.
     glm::vec3 Grad(const glm::vec3 &_x);
 
+    /// @brief Public method to evaluate global field function at a sample point with explicit field transforms.
+    /// Does not touch the transforms set with SetRigidTransforms, so one frame can be sampled while another is being deformed.
+    /// @param glm::vec3 _x : Sample point to evaulate in global field.
+    /// @param _fieldTransforms : one transform per field function into that fields space, see GetFieldTransforms.
+    /// @param _error : largest voxel size each field may be sampled at, see FieldFunction::GetLevel, 0 for full detail.
+    /// @ret] float : Value of field at sample point.
+    float Eval(const glm::vec3 &_x, const std::vector<glm::mat4> &_fieldTransforms, const float _error = 0.0f);
+
+    /// @brief Public method to evaluate global field function at many sample points, a batch at a time, the values are Eval's.
+    /// @param _x : Sample points to evaulate in global field.
+    /// @param _numPoints : Number of sample points.
+    /// @param _f : Output, value of field per sample point.
+    void EvalBatch(const glm::vec3 *_x, const unsigned int _numPoints, float *_f);
+
+    /// @brief Public method to evaluate global field function at many sample points with explicit field transforms, the values are Eval's.
+    /// @param _x : Sample points to evaulate in global field.
+    /// @param _numPoints : Number of sample points.
+    /// @param _fieldTransforms : one transform per field function into that fields space, see GetFieldTransforms.
+    /// @param _f : Output, value of field per sample point.
+    /// @param _error : largest voxel size each field may be sampled at, see FieldFunction::GetLevel, 0 for full detail.
+    void EvalBatch(const glm::vec3 *_x, const unsigned int _numPoints, const std::vector<glm::mat4> &_fieldTransforms, float *_f, const float _error = 0.0f);
+
     //--------------------------------------------------------------------
     // Field generation functions
 
@@ -67,17 +90,66 @@ public:
     /// @param _hrbfCentres : the hrbf centre to be used ot geneate the field function
     /// @param _meshParts: the original mesh of the part we are generating a field from
     /// @param _id : id of the field function we want to generate
+    /// @param _workspace : buffers the fit reuses for its design matrix, nullptr to allocate them for this fit only
     /// @todo Should probably call GenerateHRBFCentres and PrecomputeFieldFunc from within this method so everything is handled at once.
-    void GenerateFieldFuncs(const Mesh &_hrbfCentres, const Mesh &_meshPart, const int _id);
+    void GenerateFieldFuncs(const Mesh &_hrbfCentres, const Mesh &_meshPart, const int _id, DistanceFieldFit::Workspace *_workspace = nullptr);
+
+    /// @brief method to generate an individual field function with only as many HRBF centres as the mesh part needs.
+    /// Starts from a few sampled centres, then adds centres at the mesh vertices furthest from the surface of the field
+    /// until every vertex is within the tolerance.
+    /// @param _meshPart : the original mesh of the part we are generating a field from
+    /// @param _boneEnds : the start and end joint of the bone
+    /// @param _id : id of the field function we want to generate
+    /// @param _tolerance : largest distance of a mesh vertex from the surface of the field, relative to the size of the mesh part
+    /// @param _maxHrbfCentres : the most HRBF centres to use, however large the error
+    /// @param _hrbfCentres : output, the HRBF centres the field was fit to
+    /// @param _workspace : buffers the fits reuse for their design matrix, nullptr to allocate them for each fit
+    void GenerateAdaptiveFieldFuncs(const Mesh &_meshPart,
+                                    const std::pair<glm::vec3, glm::vec3> &_boneEnds,
+                                    const int _id,
+                                    const float _tolerance,
+                                    const int _maxHrbfCentres,
+                                    Mesh &_hrbfCentres,
+                                    DistanceFieldFit::Workspace *_workspace = nullptr);
 
     /// @brief method to precompute fields into textures
     /// @param _id : id of field to precompute
     /// @param _res : resolution of textures
     /// @param _dim : dimension of sample space to map to texture space
-    void PrecomputeFieldFunc(const int _id, const int _res, const float _dim);
+    /// @param _gpuTexture : whether to also create the CUDA texture, false when no CUDA device is available
+    void PrecomputeFieldFunc(const int _id, const int _res, const float _dim, const bool _gpuTexture = true);
+
+    /// @brief method to precompute a field into textures covering only the box around its support,
+    /// with the voxels spread over the sides of the box in proportion to their lengths
+    /// @param _id : id of field to precompute
+    /// @param _numVoxels : number of voxels to spend on the textures
+    /// @param _gpuTexture : whether to also create the CUDA texture, false when no CUDA device is available
+    void PrecomputeFittedFieldFunc(const int _id, const int _numVoxels, const bool _gpuTexture = true);
+
+    /// @brief method to restore a fitted and precomputed field function from a cache instead of generating it
+    /// @param _cache : the cache to load from
+    /// @param _key : key of the field, see FieldCache::MakeKey
+    /// @param _id : id of the field function to restore
+    /// @param _gpuTexture : whether to also create the CUDA texture, false when no CUDA device is available
+    /// @return bool false on a miss, the field function then still has to be generated
+    bool LoadFieldFunc(const FieldCache &_cache, const FieldCache::Key _key, const int _id, const bool _gpuTexture = true);
+
+    /// @brief method to store a generated and precomputed field function in a cache
+    /// @param _cache : the cache to save to
+    /// @param _key : key of the field, see FieldCache::MakeKey
+    /// @param _id : id of the field function to store
+    void SaveFieldFunc(const FieldCache &_cache, const FieldCache::Key _key, const int _id) const;
+
+    /// @brief method to fill the bricks a lazy precompute of a field function left, see FieldFunction::FinishLazyPrecompute.
+    /// The field function must not be evaluated at the same time.
+    /// @param _id : id of the field function to finish
+    /// @param _gpuTexture : whether to also create the CUDA texture, false when no CUDA device is available
+    /// @return bool false if the field function was not precomputed lazily or was finished already
+    bool FinishLazyFieldFunc(const int _id, const bool _gpuTexture = true);
 
     /// @brief method to generate composition operators and composedd fields to build up global field
-    void GenerateGlobalFieldFunc();
+    /// @param _gpuTexture : whether to also create the CUDA textures of the composition operators
+    void GenerateGlobalFieldFunc(const bool _gpuTexture = true);
 
     /// @brief add a composed field to the global field
     /// @param _composedField : the composed field to add to the global field
@@ -94,6 +166,17 @@ public:
     //--------------------------------------------------------------------
     // Setters
 
+    /// @brief method to make GenerateFieldFuncs refit existing field functions in place, only adding and removing
+    /// the HRBF centres that changed and precomputing only the part of the field they moved.
+    /// The field being refit must not be evaluated at the same time.
+    /// @param _incremental : whether to refit incrementally
+    void SetIncrementalRefit(const bool _incremental);
+
+    /// @brief method to make field functions precomputed on the CPU only fill the bricks near their surface
+    /// the first time they are sampled, see FieldFunction::SetLazyPrecompute
+    /// @param _lazy : whether to precompute lazily
+    void SetLazyPrecompute(const bool _lazy);
+
     /// @brief method to set bone transforms for each field
     /// @param _transform : inverse bone transform to transform space before sampling field.
     void SetRigidTransforms(const std::vector<glm::mat4> &_transforms);
@@ -101,6 +184,11 @@ public:
     //--------------------------------------------------------------------
     // Getters
 
+    /// @brief method to get the field space transforms SetRigidTransforms would set for a pose, without setting them
+    /// @param _transforms : bone transforms of the pose
+    /// @param _fieldTransforms : output, one transform per field function
+    void GetFieldTransforms(const std::vector<glm::mat4> &_transforms, std::vector<glm::mat4> &_fieldTransforms) const;
+
     /// @brief method to get field functions
     std::vector<std::shared_ptr<FieldFunction>> &GetFieldFuncs();
 
@@ -113,14 +201,22 @@ public:
     /// @brief method to get GPU composed fields
     std::vector<ComposedFieldCuda> &GetCompFieldsCuda();
 
+#ifndef NO_CUDA
     /// @brief method to get all primitive field cuda textures
     std::vector<cudaTextureObject_t> GetFieldFunc3DTextures();
+#endif
 
     /// @brief method to check if the global field has been genrated
     bool IsGlobalFieldInit() const;
 
 private:
 
+    /// @brief method to set the support radius of a fitted field function from its mesh part and store it as field _id
+    /// @param _fieldFunc : the fitted field function
+    /// @param _meshPart: the original mesh of the part the field was fit to
+    /// @param _id : id of the field function
+    void SetFieldFunc(std::shared_ptr<FieldFunction> _fieldFunc, const Mesh &_meshPart, const int _id);
+
     /// @brief vector of composed fields
     std::vector<std::shared_ptr<ComposedField>> m_composedFields;
 
@@ -136,6 +232,12 @@ private:
     /// @brief bool to check if the global field has been generated yet.
     bool m_globalFieldInit;
 
+    /// @brief bool to check whether field functions are refit in place, see SetIncrementalRefit
+    bool m_incrementalRefit;
+
+    /// @brief bool to check whether field functions are precomputed lazily, see SetLazyPrecompute
+    bool m_lazyPrecompute;
+
 };
 
 //-------------------------------------------------------------------------------
@@ -0,0 +1,86 @@
+#ifndef BINARYBLOB_H
+#define BINARYBLOB_H
+
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+
+//-------------------------------------------------------------------------------
+/// @author Idris Miles
+/// @version 1.0
+/// @date 18/04/2017
+//-------------------------------------------------------------------------------
+
+
+/// @brief Methods to append plain data to a byte buffer and read it back in the same order.
+/// Values are stored as their bytes, so a blob is only read on the machine type it was written on.
+/// Reads check against the end of the buffer and return false rather than read past it.
+/// glm types are not always trivially copyable, write them a component at a time, as in WriteBlob(out, &v[0], 3).
+
+/// @brief Method to append a value
+template <typename T>
+void WriteBlob(std::vector<char> &_out, const T &_v)
+{
+    static_assert(std::is_trivially_copyable<T>::value, "Only plain data can be written to a blob");
+    const char *bytes = reinterpret_cast<const char*>(&_v);
+    _out.insert(_out.end(), bytes, bytes + sizeof(T));
+}
+
+/// @brief Method to append _count values
+template <typename T>
+void WriteBlob(std::vector<char> &_out, const T *_data, const std::size_t _count)
+{
+    static_assert(std::is_trivially_copyable<T>::value, "Only plain data can be written to a blob");
+    const char *bytes = reinterpret_cast<const char*>(_data);
+    _out.insert(_out.end(), bytes, bytes + (_count * sizeof(T)));
+}
+
+/// @brief Method to append the size of a vector followed by its values
+template <typename T>
+void WriteBlob(std::vector<char> &_out, const std::vector<T> &_v)
+{
+    WriteBlob(_out, (unsigned long long)_v.size());
+    WriteBlob(_out, _v.data(), _v.size());
+}
+
+//-------------------------------------------------------------------------------
+
+/// @brief Method to read _count values and move _in past them
+template <typename T>
+bool ReadBlob(const char *&_in, const char *_end, T *_data, const std::size_t _count)
+{
+    static_assert(std::is_trivially_copyable<T>::value, "Only plain data can be read from a blob");
+    if(_count > (std::size_t)(_end - _in) / sizeof(T))
+    {
+        return false;
+    }
+
+    std::memcpy(_data, _in, _count * sizeof(T));
+    _in += _count * sizeof(T);
+    return true;
+}
+
+/// @brief Method to read a value and move _in past it
+template <typename T>
+bool ReadBlob(const char *&_in, const char *_end, T &_v)
+{
+    return ReadBlob(_in, _end, &_v, 1);
+}
+
+/// @brief Method to read a vector written with its size
+template <typename T>
+bool ReadBlob(const char *&_in, const char *_end, std::vector<T> &_v)
+{
+    unsigned long long size;
+    if(!ReadBlob(_in, _end, size) || size > (unsigned long long)(_end - _in) / sizeof(T))
+    {
+        return false;
+    }
+
+    _v.resize(size);
+    return ReadBlob(_in, _end, _v.data(), _v.size());
+}
+
+
+#endif // BINARYBLOB_H
@@ -0,0 +1,862 @@
+#ifndef SPARSETEXTURE3DCPU_H
+#define SPARSETEXTURE3DCPU_H
+
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+#include "Texture/TextureStorage.h"
+#include "Texture/TextureBatch.h"
+#include "Texture/BinaryBlob.h"
+
+
+//-------------------------------------------------------------------------------
+/// @author Idris Miles
+/// @version 1.0
+/// @date 18/04/2017
+//-------------------------------------------------------------------------------
+
+
+/// @class SparseTexture3DCpu
+/// @brief A templated 3D texture class that resides on the CPU, with the same interface as Texture3DCpu.
+/// The volume is split into bricks of BrickSize^3 voxels, a brick index maps each brick either to its own
+/// voxels, to a single value shared by every voxel of the brick, or to the voxels at its corners.
+/// Bricks whose voxels are all equal, such as the 0 and 1 either side of a field function's narrow band,
+/// cost one index entry instead of a brick.
+/// Voxels are held as Storage, such as unsigned short for 16 bit normalised floats or Vec3Storage<Half>,
+/// see TextureStorage.h, and decoded as they are interpolated.
+template <typename T, typename Storage = T>
+class SparseTexture3DCpu
+{
+public:
+    /// @brief Width in voxels of a brick along each axis
+    enum { BrickShift = SparseTextureView::BrickShift, BrickSize = 1 << BrickShift, BrickVoxels = BrickSize * BrickSize * BrickSize };
+
+    /// @brief constructor
+    SparseTexture3DCpu(unsigned int _dim = 32);
+
+    /// @brief destructor
+    ~SparseTexture3DCpu();
+
+    /// @brief Method to set the texture space transform
+    void SetTextureSpaceTransform(glm::mat4 _textureSpaceTransform);
+
+    /// @brief Method to set the data within in the texture, bricks whose voxels are all equal are shared
+    /// @param _dim : dimension of uniform 3D volume
+    /// @param _data : _dim^3 voxels, x fastest
+    void SetData(unsigned int _dim, T *_data);
+
+    /// @brief Method to set the data within in the texture, bricks whose voxels are all equal are shared
+    /// @param _dim : number of voxels along each axis
+    /// @param _data : _dim.x*_dim.y*_dim.z voxels, x fastest
+    void SetData(const glm::uvec3 &_dim, T *_data);
+
+    /// @brief Method to set the data within in the texture, flagged bricks only keep the voxels at their corners,
+    /// the ones in between are interpolated from them
+    /// @param _dim : number of voxels along each axis
+    /// @param _data : _dim.x*_dim.y*_dim.z voxels, x fastest
+    /// @param _flatBricks : one flag per brick, x fastest, as returned by GetConstantBricks
+    void SetData(const glm::uvec3 &_dim, T *_data, const std::vector<unsigned char> &_flatBricks);
+
+    /// @brief Method to set the data within in the texture, flagged bricks are stored in full whatever their voxels
+    /// so they can be filled later with SetBrick without the brick index changing under lookups
+    /// @param _dim : number of voxels along each axis
+    /// @param _data : _dim.x*_dim.y*_dim.z voxels, x fastest, those of flagged bricks are placeholders
+    /// @param _lazyBricks : one flag per brick, x fastest
+    /// @param _scale : largest magnitude of any voxel, including those filled later
+    void SetLazyData(const glm::uvec3 &_dim, T *_data, const std::vector<unsigned char> &_lazyBricks, const float _scale);
+
+    /// @brief Method to fill a brick flagged in SetLazyData. Not synchronised, nothing may sample the brick meanwhile,
+    /// other bricks can be filled and sampled at the same time.
+    /// @param _brick : which brick along each axis
+    /// @param _voxels : BrickVoxels voxels, x fastest, those past the edge of the volume are never sampled
+    void SetBrick(const glm::uvec3 &_brick, const T *_voxels);
+
+    /// @brief Method to get value of texture at sample point
+    T Eval(const glm::vec3 &_samplePoint);
+
+    /// @brief Method to get value of texture at sample point
+    T Eval(const float _x, const float _y, const float _z);
+
+    /// @brief Method to get values of texture at many sample points, the same values Eval gives.
+    /// Float textures stored as unsigned short look up a lane of points at once where the CPU supports AVX2 or AVX-512,
+    /// see TextureBatch.h, points next to a coarse brick are looked up one at a time.
+    /// @param _samplePoints : sample points
+    /// @param _numPoints : number of sample points
+    /// @param _out : output, value per sample point
+    void EvalBatch(const glm::vec3 *_samplePoints, const unsigned int _numPoints, T *_out);
+
+    /// @brief Method to get value of texture at sample point along with the gradient of the trilinear interpolation,
+    /// both from the same 8 voxels, so a scalar texture needs no separate gradient texture. The value is Eval's,
+    /// the gradient is constant along each axis within a voxel and jumps between voxels, see EvalCubic for a continuous one.
+    /// Scalar textures only.
+    /// @param _samplePoint : point in the space the texture space transform maps from
+    /// @param _grad : output, gradient of the returned value with respect to _samplePoint
+    T EvalGrad(const glm::vec3 &_samplePoint, glm::vec3 &_grad);
+
+    /// @brief Method to get value of texture at sample point by Catmull-Rom tricubic interpolation along with its analytic gradient,
+    /// so a scalar texture needs no separate gradient texture. The value is smoother than Eval's and still passes through the voxels,
+    /// the gradient is continuous where trilinear differences are not. Scalar textures only.
+    /// @param _samplePoint : point in the space the texture space transform maps from
+    /// @param _grad : output, gradient of the returned value with respect to _samplePoint
+    T EvalCubic(const glm::vec3 &_samplePoint, glm::vec3 &_grad);
+
+    /// @brief Method to get which bricks are stored as a single value
+    /// @param _constantBricks : output, one flag per brick, x fastest
+    void GetConstantBricks(std::vector<unsigned char> &_constantBricks) const;
+
+    /// @brief Method to get the number of voxels along each axis
+    glm::uvec3 GetDim() const;
+
+    /// @brief Method to get the number of bricks along each axis
+    glm::uvec3 GetBrickDim() const;
+
+    /// @brief Method to get the bytes held by the brick index, bricks and constants
+    std::size_t GetMemorySize() const;
+
+    /// @brief Method to decode every voxel, coarse bricks are interpolated from their corners
+    /// @param _data : output, GetDim().x*GetDim().y*GetDim().z voxels, x fastest
+    void GetData(std::vector<T> &_data) const;
+
+    /// @brief Method to append the bricks, as they are stored, to a blob
+    /// @param _out : buffer to append to
+    void Serialise(std::vector<char> &_out) const;
+
+    /// @brief Method to read back bricks appended by Serialise, the texture space transform is left as it is
+    /// @param _in : start of the bricks, moved past them
+    /// @param _end : end of the buffer
+    /// @return bool false if the buffer is too short or the brick index does not match the bricks, the texture is then unchanged
+    bool Deserialise(const char *&_in, const char *_end);
+
+
+private:
+
+    /// @brief Method to store _data in bricks, a brick is constant when its voxels are all equal and coarse when flagged in _flatBricks.
+    /// Bricks flagged in _lazyBricks are always stored in full. A _scale of 0 is taken from _data.
+    void Build(const glm::uvec3 &_dim, T *_data, const std::vector<unsigned char> *_flatBricks,
+               const std::vector<unsigned char> *_lazyBricks = nullptr, const float _scale = 0.0f);
+
+    /// @brief Method to repeat each of m_constants over a brick into m_constantBricks
+    void ExpandConstants();
+
+    /// @brief Method to perform trilinear interpolation on the texture
+    /// @param _voxelGrad : optional output, gradient of the interpolation in voxel units, scalar textures only
+    T TrilinearInterpolate(const float _x, const float _y, const float _z, glm::vec3 *_voxelGrad = nullptr);
+
+    /// @brief Method to perform Catmull-Rom tricubic interpolation on the texture, and get the gradient in voxel units
+    T TricubicInterpolate(const glm::vec3 &_voxelCoord, glm::vec3 &_grad) const;
+
+    /// @brief Method to perform linear interpolatation between 2 values
+    T LinearInterpolate(const T _f1, const T _f2, const float _t) const;
+
+    /// @brief Method to look up a single voxel through the brick index
+    T Voxel(const unsigned int _x, const unsigned int _y, const unsigned int _z) const;
+
+    /// @brief Encoding of values as Storage
+    typedef TextureStorage<T, Storage> Codec;
+
+    /// @brief Flags set in a brick index entry when the rest of it indexes m_constants or m_coarseBricks rather than m_bricks
+    enum : unsigned int { ConstantBrick = SparseTextureView::ConstantBrick, CoarseBrick = SparseTextureView::CoarseBrick, BrickFlags = ConstantBrick | CoarseBrick };
+
+    /// @brief This attribute transform a local/word space coord into texture space
+    /// so that it can be used to sample the 3D texture/data.
+    glm::mat4 m_textureSpaceTransform;
+
+    /// @brief number of voxels along each axis.
+    glm::uvec3 m_dim;
+
+    /// @brief number of bricks along each axis.
+    glm::uvec3 m_brickDim;
+
+    /// @brief Entry per brick, the index of its voxels in m_bricks, or of its value in m_constants with ConstantBrick set.
+    std::vector<unsigned int> m_brickIndex;
+
+    /// @brief Voxels of the stored bricks, BrickVoxels per brick, x fastest within a brick.
+    std::vector<Storage> m_bricks;
+
+    /// @brief Values of the constant bricks, bricks with equal values share one entry.
+    std::vector<Storage> m_constants;
+
+    /// @brief Each of m_constants repeated over a brick, so tricubic sampling reads constant bricks as it does stored ones.
+    std::vector<Storage> m_constantBricks;
+
+    /// @brief Corner voxels of the coarse bricks, 8 per brick, x fastest. The far corners are the first voxels of the next bricks.
+    std::vector<Storage> m_coarseBricks;
+
+    /// @brief Largest magnitude of the values, normalised storage holds the values divided by it.
+    float m_scale;
+};
+
+
+
+
+//------------------------------------------------------------------------------------------------
+// Implementation
+//------------------------------------------------------------------------------------------------
+
+
+template <typename T, typename Storage>
+SparseTexture3DCpu<T, Storage>::SparseTexture3DCpu(unsigned int _dim)
+{
+    m_dim = glm::uvec3(_dim, _dim, _dim);
+    m_brickDim = (m_dim + glm::uvec3(BrickSize - 1)) / glm::uvec3(BrickSize);
+
+    // every brick starts as the same default value
+    m_scale = 1.0f;
+    m_constants.assign(1, Codec::Encode(T(), m_scale));
+    ExpandConstants();
+    m_brickIndex.assign(m_brickDim.x * m_brickDim.y * m_brickDim.z, ConstantBrick);
+
+    m_textureSpaceTransform = glm::mat4(1.0f);
+}
+
+//------------------------------------------------------------------------------------------------
+
+template <typename T, typename Storage>
+SparseTexture3DCpu<T, Storage>::~SparseTexture3DCpu()
+{
+}
+
+//------------------------------------------------------------------------------------------------
+
+template <typename T, typename Storage>
+void SparseTexture3DCpu<T, Storage>::SetTextureSpaceTransform(glm::mat4 _textureSpaceTransform)
+{
+    m_textureSpaceTransform = _textureSpaceTransform;
+}
+
+//------------------------------------------------------------------------------------------------
+
+template <typename T, typename Storage>
+void SparseTexture3DCpu<T, Storage>::SetData(unsigned int _dim, T *_data)
+{
+    Build(glm::uvec3(_dim, _dim, _dim), _data, nullptr);
+}
+
+//------------------------------------------------------------------------------------------------
+
+template <typename T, typename Storage>
+void SparseTexture3DCpu<T, Storage>::SetData(const glm::uvec3 &_dim, T *_data)
+{
+    Build(_dim, _data, nullptr);
+}
+
+//------------------------------------------------------------------------------------------------
+
+template <typename T, typename Storage>
+void SparseTexture3DCpu<T, Storage>::SetData(const glm::uvec3 &_dim, T *_data, const std::vector<unsigned char> &_flatBricks)
+{
+    Build(_dim, _data, &_flatBricks);
+}
+
+//------------------------------------------------------------------------------------------------
+
+template <typename T, typename Storage>
+void SparseTexture3DCpu<T, Storage>::SetLazyData(const glm::uvec3 &_dim, T *_data, const std::vector<unsigned char> &_lazyBricks, const float _scale)
+{
+    Build(_dim, _data, nullptr, &_lazyBricks, _scale);
+}
+
+//------------------------------------------------------------------------------------------------
+
+template <typename T, typename Storage>
+void SparseTexture3DCpu<T, Storage>::SetBrick(const glm::uvec3 &_brick, const T *_voxels)
+{
+    unsigned int brick = m_brickIndex[(_brick.z * m_brickDim.y * m_brickDim.x) + (_brick.y * m_brickDim.x) + _brick.x];
+    if(brick & BrickFlags)
+    {
+        return;
+    }
+
+    Storage *voxels = &m_bricks[brick * BrickVoxels];
+    for(unsigned int i=0; i<BrickVoxels; ++i)
+    {
+        voxels[i] = Codec::Encode(_voxels[i], m_scale);
+    }
+}
+
+//------------------------------------------------------------------------------------------------
+
+template <typename T, typename Storage>
+T SparseTexture3DCpu<T, Storage>::Eval(const glm::vec3 &_samplePoint)
+{
+    return TrilinearInterpolate(_samplePoint.x, _samplePoint.y, _samplePoint.z);
+}
+
+//------------------------------------------------------------------------------------------------
+
+template <typename T, typename Storage>
+T SparseTexture3DCpu<T, Storage>::Eval(const float _x, const float _y, const float _z)
+{
+    return TrilinearInterpolate(_x, _y, _z);
+}
+
+//------------------------------------------------------------------------------------------------
+
+template <typename T, typename Storage>
+void SparseTexture3DCpu<T, Storage>::EvalBatch(const glm::vec3 *_samplePoints, const unsigned int _numPoints, T *_out)
+{
+    for(unsigned int i=0; i<_numPoints; ++i)
+    {
+        _out[i] = TrilinearInterpolate(_samplePoints[i].x, _samplePoints[i].y, _samplePoints[i].z);
+    }
+}
+
+//------------------------------------------------------------------------------------------------
+
+template <>
+inline void SparseTexture3DCpu<float, unsigned short>::EvalBatch(const glm::vec3 *_samplePoints, const unsigned int _numPoints, float *_out)
+{
+    const TextureKernels &kernels = TextureKernels::Instance();
+    if(kernels.sparse == nullptr)
+    {
+        for(unsigned int i=0; i<_numPoints; ++i)
+        {
+            _out[i] = TrilinearInterpolate(_samplePoints[i].x, _samplePoints[i].y, _samplePoints[i].z);
+        }
+        return;
+    }
+
+    SparseTextureView view;
+    view.brickIndex = m_brickIndex.data();
+    view.bricks = m_bricks.data();
+    view.constantBricks = m_constantBricks.data();
+    view.textureSpaceTransform = m_textureSpaceTransform;
+    view.dim = m_dim;
+    view.brickDim = m_brickDim;
+    view.scale = m_scale;
+
+    // Points next to a coarse brick are left by the kernel, look them up here a chunk at a time
+    const unsigned int chunkSize = 256;
+    unsigned int coarse[chunkSize];
+    for(unsigned int start=0; start<_numPoints; start+=chunkSize)
+    {
+        unsigned int numPoints = std::min(_numPoints - start, chunkSize);
+        unsigned int numCoarse = kernels.sparse(view, _samplePoints + start, numPoints, _out + start, coarse);
+        for(unsigned int k=0; k<numCoarse; ++k)
+        {
+            const glm::vec3 &x = _samplePoints[start + coarse[k]];
+            _out[start + coarse[k]] = TrilinearInterpolate(x.x, x.y, x.z);
+        }
+    }
+}
+
+//------------------------------------------------------------------------------------------------
+
+template <typename T, typename Storage>
+T SparseTexture3DCpu<T, Storage>::EvalGrad(const glm::vec3 &_samplePoint, glm::vec3 &_grad)
+{
+    T val = TrilinearInterpolate(_samplePoint.x, _samplePoint.y, _samplePoint.z, &_grad);
+
+    // Voxel coords are texture space scaled by the dimensions, chain back through the texture space transform
+    _grad = glm::transpose(glm::mat3(m_textureSpaceTransform)) * (_grad * glm::vec3(m_dim));
+    return val;
+}
+
+//------------------------------------------------------------------------------------------------
+
+template <typename T, typename Storage>
+T SparseTexture3DCpu<T, Storage>::EvalCubic(const glm::vec3 &_samplePoint, glm::vec3 &_grad)
+{
+    glm::vec3 texSpace = glm::vec3(m_textureSpaceTransform*(glm::vec4(_samplePoint, 1.0f)));
+    glm::vec3 dim(m_dim);
+    T val = TricubicInterpolate(texSpace * dim, _grad);
+
+    // Voxel coords are texture space scaled by the dimensions, chain back through the texture space transform
+    _grad = glm::transpose(glm::mat3(m_textureSpaceTransform)) * (_grad * dim);
+    return val;
+}
+
+//------------------------------------------------------------------------------------------------
+
+template <typename T, typename Storage>
+void SparseTexture3DCpu<T, Storage>::GetConstantBricks(std::vector<unsigned char> &_constantBricks) const
+{
+    _constantBricks.resize(m_brickIndex.size());
+    for(unsigned int b=0; b<m_brickIndex.size(); ++b)
+    {
+        _constantBricks[b] = (m_brickIndex[b] & ConstantBrick) ? 1 : 0;
+    }
+}
+
+//------------------------------------------------------------------------------------------------
+
+template <typename T, typename Storage>
+glm::uvec3 SparseTexture3DCpu<T, Storage>::GetDim() const
+{
+    return m_dim;
+}
+
+//------------------------------------------------------------------------------------------------
+
+template <typename T, typename Storage>
+glm::uvec3 SparseTexture3DCpu<T, Storage>::GetBrickDim() const
+{
+    return m_brickDim;
+}
+
+//------------------------------------------------------------------------------------------------
+
+template <typename T, typename Storage>
+std::size_t SparseTexture3DCpu<T, Storage>::GetMemorySize() const
+{
+    return (m_brickIndex.capacity() * sizeof(unsigned int)) +
+           ((m_bricks.capacity() + m_constants.capacity() + m_constantBricks.capacity() + m_coarseBricks.capacity()) * sizeof(Storage));
+}
+
+//------------------------------------------------------------------------------------------------
+
+template <typename T, typename Storage>
+void SparseTexture3DCpu<T, Storage>::GetData(std::vector<T> &_data) const
+{
+    _data.resize(m_dim.x * m_dim.y * m_dim.z);
+    for(unsigned int z=0; z<m_dim.z; ++z)
+    {
+        for(unsigned int y=0; y<m_dim.y; ++y)
+        {
+            for(unsigned int x=0; x<m_dim.x; ++x)
+            {
+                _data[(z * m_dim.y * m_dim.x) + (y * m_dim.x) + x] = Voxel(x, y, z);
+            }
+        }
+    }
+}
+
+//------------------------------------------------------------------------------------------------
+
+template <typename T, typename Storage>
+void SparseTexture3DCpu<T, Storage>::Serialise(std::vector<char> &_out) const
+{
+    WriteBlob(_out, &m_dim[0], 3);
+    WriteBlob(_out, m_scale);
+    WriteBlob(_out, m_brickIndex);
+    WriteBlob(_out, m_bricks);
+    WriteBlob(_out, m_constants);
+    WriteBlob(_out, m_coarseBricks);
+}
+
+//------------------------------------------------------------------------------------------------
+
+template <typename T, typename Storage>
+bool SparseTexture3DCpu<T, Storage>::Deserialise(const char *&_in, const char *_end)
+{
+    glm::uvec3 dim;
+    float scale;
+    std::vector<unsigned int> brickIndex;
+    std::vector<Storage> bricks, constants, coarseBricks;
+    if(!ReadBlob(_in, _end, &dim[0], 3) || !ReadBlob(_in, _end, scale) || !ReadBlob(_in, _end, brickIndex) ||
+       !ReadBlob(_in, _end, bricks) || !ReadBlob(_in, _end, constants) || !ReadBlob(_in, _end, coarseBricks))
+    {
+        return false;
+    }
+
+    // Every entry must point inside the bricks it indexes, lookups are not checked
+    glm::uvec3 brickDim = (dim + glm::uvec3(BrickSize - 1)) / glm::uvec3(BrickSize);
+    if(dim.x == 0 || dim.y == 0 || dim.z == 0 || brickIndex.size() != (std::size_t)brickDim.x * brickDim.y * brickDim.z)
+    {
+        return false;
+    }
+    for(auto &&brick : brickIndex)
+    {
+        std::size_t index = brick & ~BrickFlags;
+        bool valid = (brick & ConstantBrick) ? index < constants.size() :
+                     (brick & CoarseBrick) ? (index + 1) * 8 <= coarseBricks.size() :
+                     (index + 1) * BrickVoxels <= bricks.size();
+        if(!valid)
+        {
+            return false;
+        }
+    }
+
+    m_dim = dim;
+    m_brickDim = brickDim;
+    m_scale = scale;
+    m_brickIndex.swap(brickIndex);
+    m_bricks.swap(bricks);
+    m_constants.swap(constants);
+    ExpandConstants();
+    m_coarseBricks.swap(coarseBricks);
+    return true;
+}
+
+//------------------------------------------------------------------------------------------------
+
+template <typename T, typename Storage>
+void SparseTexture3DCpu<T, Storage>::Build(const glm::uvec3 &_dim, T *_data, const std::vector<unsigned char> *_flatBricks,
+                                           const std::vector<unsigned char> *_lazyBricks, const float _scale)
+{
+    m_dim = _dim;
+    m_brickDim = (m_dim + glm::uvec3(BrickSize - 1)) / glm::uvec3(BrickSize);
+
+    const unsigned int numBricks = m_brickDim.x * m_brickDim.y * m_brickDim.z;
+    auto voxel = [this](unsigned int _x, unsigned int _y, unsigned int _z){
+        return (std::min(_z, m_dim.z - 1) * m_dim.y * m_dim.x) + (std::min(_y, m_dim.y - 1) * m_dim.x) + std::min(_x, m_dim.x - 1);
+    };
+    const bool flagged = _flatBricks != nullptr && _flatBricks->size() == numBricks;
+    const bool lazy = _lazyBricks != nullptr && _lazyBricks->size() == numBricks;
+
+    m_brickIndex.assign(numBricks, 0);
+    std::vector<Storage>().swap(m_bricks);
+    std::vector<Storage>().swap(m_constants);
+    std::vector<Storage>().swap(m_coarseBricks);
+
+    // Normalised storage spans the largest magnitude
+    m_scale = _scale;
+    if(Codec::Scaled() && m_scale <= 0.0f)
+    {
+        for(unsigned int i=0; i<_dim.x*_dim.y*_dim.z; ++i)
+        {
+            m_scale = std::max(m_scale, Codec::Magnitude(_data[i]));
+        }
+    }
+    m_scale = m_scale > 0.0f ? m_scale : 1.0f;
+
+    std::vector<Storage> brick(BrickVoxels);
+    for(unsigned int bz=0; bz<m_brickDim.z; ++bz)
+    {
+        for(unsigned int by=0; by<m_brickDim.y; ++by)
+        {
+            for(unsigned int bx=0; bx<m_brickDim.x; ++bx)
+            {
+                unsigned int b = (bz * m_brickDim.y * m_brickDim.x) + (by * m_brickDim.x) + bx;
+
+                // Gather the brick, voxels past the edge of the volume repeat the last one and are never sampled
+                Storage first = Codec::Encode(_data[voxel(bx*BrickSize, by*BrickSize, bz*BrickSize)], m_scale);
+                bool constant = true;
+                for(unsigned int z=0; z<BrickSize; ++z)
+                {
+                    unsigned int vz = bz*BrickSize + z;
+                    for(unsigned int y=0; y<BrickSize; ++y)
+                    {
+                        unsigned int vy = by*BrickSize + y;
+                        for(unsigned int x=0; x<BrickSize; ++x)
+                        {
+                            unsigned int vx = bx*BrickSize + x;
+                            bool inside = vx < m_dim.x && vy < m_dim.y && vz < m_dim.z;
+                            Storage v = Codec::Encode(_data[voxel(vx, vy, vz)], m_scale);
+
+                            brick[(z * BrickSize * BrickSize) + (y * BrickSize) + x] = v;
+                            constant = constant && (!inside || v == first);
+                        }
+                    }
+                }
+
+                if(constant && !(lazy && (*_lazyBricks)[b]))
+                {
+                    // Equal constants are shared, there are only a handful of distinct ones
+                    auto it = std::find(m_constants.begin(), m_constants.end(), first);
+                    m_brickIndex[b] = ConstantBrick | (unsigned int)(it - m_constants.begin());
+                    if(it == m_constants.end())
+                    {
+                        m_constants.push_back(first);
+                    }
+                }
+                else if(flagged && (*_flatBricks)[b])
+                {
+                    m_brickIndex[b] = CoarseBrick | (unsigned int)(m_coarseBricks.size() / 8);
+                    for(unsigned int c=0; c<8; ++c)
+                    {
+                        m_coarseBricks.push_back(Codec::Encode(_data[voxel((bx + (c & 1)) * BrickSize, (by + ((c >> 1) & 1)) * BrickSize, (bz + (c >> 2)) * BrickSize)], m_scale));
+                    }
+                }
+                else
+                {
+                    m_brickIndex[b] = (unsigned int)(m_bricks.size() / BrickVoxels);
+                    m_bricks.insert(m_bricks.end(), brick.begin(), brick.end());
+                }
+            }
+        }
+    }
+
+    m_bricks.shrink_to_fit();
+    m_constants.shrink_to_fit();
+    ExpandConstants();
+    m_coarseBricks.shrink_to_fit();
+}
+
+//------------------------------------------------------------------------------------------------
+
+template <typename T, typename Storage>
+void SparseTexture3DCpu<T, Storage>::ExpandConstants()
+{
+    m_constantBricks.resize(m_constants.size() * BrickVoxels);
+    for(unsigned int c=0; c<m_constants.size(); ++c)
+    {
+        std::fill(m_constantBricks.begin() + (c * BrickVoxels), m_constantBricks.begin() + ((c + 1) * BrickVoxels), m_constants[c]);
+    }
+    m_constantBricks.shrink_to_fit();
+}
+
+//------------------------------------------------------------------------------------------------
+
+template <typename T, typename Storage>
+T SparseTexture3DCpu<T, Storage>::TrilinearInterpolate(const float _x, const float _y, const float _z, glm::vec3 *_voxelGrad)
+{
+
+    //[0:1]
+    glm::vec3 texSpace = glm::vec3(m_textureSpaceTransform*(glm::vec4(_x, _y, _z, 1.0f)));
+
+    // Get data coords
+    float x = texSpace.x * m_dim.x;
+    float y = texSpace.y * m_dim.y;
+    float z = texSpace.z * m_dim.z;
+
+    // Adjust for potential out of bounds
+    auto clampCoord = [](float _c, unsigned int _dim){
+        return _c <= 0.0f ? 0u : (_c >= _dim - 1 ? _dim - 1 : (unsigned int)std::floor(_c));
+    };
+    unsigned int x0 = clampCoord(x, m_dim.x);
+    unsigned int y0 = clampCoord(y, m_dim.y);
+    unsigned int z0 = clampCoord(z, m_dim.z);
+
+    // Get other set of coords
+    unsigned int x1 = x0 >= m_dim.x -1 ? x0 : x0 + 1;
+    unsigned int y1 = y0 >= m_dim.y -1 ? y0 : y0 + 1;
+    unsigned int z1 = z0 >= m_dim.z -1 ? z0 : z0 + 1;
+
+    // Within a single constant brick there is nothing to interpolate
+    unsigned int brick = m_brickIndex[((z0 >> BrickShift) * m_brickDim.y * m_brickDim.x) + ((y0 >> BrickShift) * m_brickDim.x) + (x0 >> BrickShift)];
+    if((brick & ConstantBrick) && (((x0 ^ x1) | (y0 ^ y1) | (z0 ^ z1)) >> BrickShift) == 0)
+    {
+        if(_voxelGrad != nullptr)
+        {
+            *_voxelGrad = glm::vec3(0.0f);
+        }
+        return Codec::Decode(m_constants[brick & ~BrickFlags], m_scale);
+    }
+
+
+    // Get values
+    T val0 = Voxel(x0, y0, z0); //bottom font left
+    T val1 = Voxel(x1, y0, z0); //bottom front right
+    T val2 = Voxel(x0, y1, z0); //bottom back left
+    T val3 = Voxel(x1, y1, z0); //bottom back right
+
+    T val4 = Voxel(x0, y0, z1);
+    T val5 = Voxel(x1, y0, z1);
+    T val6 = Voxel(x0, y1, z1);
+    T val7 = Voxel(x1, y1, z1);
+
+
+    // do interpolation here
+    float dx = x - x0;
+    T valX0 = LinearInterpolate(val0, val1, dx);
+    T valX1 = LinearInterpolate(val2, val3, dx);
+    T valX2 = LinearInterpolate(val4, val5, dx);
+    T valX3 = LinearInterpolate(val6, val7, dx);
+
+    float dy = y - y0;
+    T valY0 = LinearInterpolate(valX0, valX1, dy);
+    T valY1 = LinearInterpolate(valX2, valX3, dy);
+
+    float dz = z - z0;
+    T valZ0 = LinearInterpolate(valY0, valY1, dz);
+
+
+    // Derivative of the same interpolation along each axis
+    if(_voxelGrad != nullptr)
+    {
+        T gx = LinearInterpolate(LinearInterpolate(val1 - val0, val3 - val2, dy), LinearInterpolate(val5 - val4, val7 - val6, dy), dz);
+        T gy = LinearInterpolate(valX1 - valX0, valX3 - valX2, dz);
+        T gz = valY1 - valY0;
+        *_voxelGrad = glm::vec3(gx, gy, gz);
+    }
+
+    return valZ0;
+}
+
+//------------------------------------------------------------------------------------------------
+
+template <typename T, typename Storage>
+T SparseTexture3DCpu<T, Storage>::TricubicInterpolate(const glm::vec3 &_voxelCoord, glm::vec3 &_grad) const
+{
+    // Per axis, the 4 voxels around the coord with their Catmull-Rom weights and the derivatives of those.
+    // Outside the texture the coord is clamped, the value carries on as at the edge so its derivative is 0.
+    unsigned int voxels[3][4];
+    float w[3][4];
+    float dw[3][4];
+    for(unsigned int axis=0; axis<3; ++axis)
+    {
+        const unsigned int last = m_dim[axis] - 1;
+        float c = _voxelCoord[axis];
+        bool outside = c < 0.0f || c > last;
+        c = c < 0.0f ? 0.0f : (c > last ? (float)last : c);
+
+        unsigned int i = std::min((unsigned int)c, last > 0 ? last - 1 : 0u);
+        float t = c - i;
+        float t2 = t*t;
+        float t3 = t2*t;
+        w[axis][0] = 0.5f * (-t3 + (2.0f*t2) - t);
+        w[axis][1] = 0.5f * ((3.0f*t3) - (5.0f*t2) + 2.0f);
+        w[axis][2] = 0.5f * ((-3.0f*t3) + (4.0f*t2) + t);
+        w[axis][3] = 0.5f * (t3 - t2);
+
+        float d = outside ? 0.0f : 0.5f;
+        dw[axis][0] = d * ((-3.0f*t2) + (4.0f*t) - 1.0f);
+        dw[axis][1] = d * ((9.0f*t2) - (10.0f*t));
+        dw[axis][2] = d * ((-9.0f*t2) + (8.0f*t) + 1.0f);
+        dw[axis][3] = d * ((3.0f*t2) - (2.0f*t));
+
+        for(unsigned int k=0; k<4; ++k)
+        {
+            voxels[axis][k] = std::min(i + k > 0 ? i + k - 1 : 0u, last);
+        }
+    }
+
+    // The 4^3 voxels span at most 2 bricks along each axis, when those are all the same constant there is nothing to interpolate
+    const unsigned int bx[2] = {voxels[0][0] >> BrickShift, voxels[0][3] >> BrickShift};
+    const unsigned int by[2] = {voxels[1][0] >> BrickShift, voxels[1][3] >> BrickShift};
+    const unsigned int bz[2] = {voxels[2][0] >> BrickShift, voxels[2][3] >> BrickShift};
+    unsigned int brick = m_brickIndex[(bz[0] * m_brickDim.y * m_brickDim.x) + (by[0] * m_brickDim.x) + bx[0]];
+    bool constant = (brick & ConstantBrick) != 0;
+    for(unsigned int c=1; c<8 && constant; ++c)
+    {
+        constant = m_brickIndex[(bz[c >> 2] * m_brickDim.y * m_brickDim.x) + (by[(c >> 1) & 1] * m_brickDim.x) + bx[c & 1]] == brick;
+    }
+    if(constant)
+    {
+        _grad = glm::vec3(0.0f);
+        return Codec::Decode(m_constants[brick & ~BrickFlags], m_scale);
+    }
+
+
+    // Resolve the up to 8 bricks once, constant bricks are read from their value repeated over a brick
+    // so every voxel is an offset within its brick. Coarse bricks are rare enough to go through Voxel.
+    const Storage *brickData[8];
+    bool coarse = false;
+    for(unsigned int c=0; c<8; ++c)
+    {
+        unsigned int b = m_brickIndex[(bz[c >> 2] * m_brickDim.y * m_brickDim.x) + (by[(c >> 1) & 1] * m_brickDim.x) + bx[c & 1]];
+        brickData[c] = (b & ConstantBrick) ? &m_constantBricks[(b & ~BrickFlags) * BrickVoxels] :
+                                             ((b & CoarseBrick) ? nullptr : &m_bricks[b * BrickVoxels]);
+        coarse = coarse || brickData[c] == nullptr;
+    }
+
+    // Per axis, which of the 2 bricks each of the 4 voxels is in as a bit of the brickData slot, and its offset within that brick
+    const unsigned int mask = BrickSize - 1;
+    unsigned int slot[3][4];
+    unsigned int offset[3][4];
+    for(unsigned int k=0; k<4; ++k)
+    {
+        slot[0][k] = (voxels[0][k] >> BrickShift) - bx[0];
+        slot[1][k] = ((voxels[1][k] >> BrickShift) - by[0]) << 1;
+        slot[2][k] = ((voxels[2][k] >> BrickShift) - bz[0]) << 2;
+        offset[0][k] = voxels[0][k] & mask;
+        offset[1][k] = (voxels[1][k] & mask) << BrickShift;
+        offset[2][k] = (voxels[2][k] & mask) << (2 * BrickShift);
+    }
+
+    // Gather all 64 first so the reductions below run over a plain array
+    T v[64];
+    if(coarse)
+    {
+        for(unsigned int i=0; i<64; ++i)
+        {
+            v[i] = Voxel(voxels[0][i & 3], voxels[1][(i >> 2) & 3], voxels[2][i >> 4]);
+        }
+    }
+    else if(bx[0] == bx[1] && by[0] == by[1] && bz[0] == bz[1] &&
+            voxels[0][3] - voxels[0][0] == 3 && voxels[1][3] - voxels[1][0] == 3 && voxels[2][3] - voxels[2][0] == 3)
+    {
+        // About a quarter of lookups fall within one brick away from the texture's edge, their voxels are fixed strides apart
+        const Storage *voxel = brickData[0] + offset[0][0] + offset[1][0] + offset[2][0];
+        for(unsigned int z=0; z<4; ++z)
+        {
+            for(unsigned int y=0; y<4; ++y)
+            {
+                for(unsigned int x=0; x<4; ++x)
+                {
+                    v[(z*16) + (y*4) + x] = Codec::Decode(voxel[(z << (2 * BrickShift)) + (y << BrickShift) + x], m_scale);
+                }
+            }
+        }
+    }
+    else
+    {
+        for(unsigned int z=0; z<4; ++z)
+        {
+            for(unsigned int y=0; y<4; ++y)
+            {
+                unsigned int slotYZ = slot[2][z] | slot[1][y];
+                unsigned int offsetYZ = offset[2][z] + offset[1][y];
+                for(unsigned int x=0; x<4; ++x)
+                {
+                    v[(z*16) + (y*4) + x] = Codec::Decode(brickData[slotYZ | slot[0][x]][offsetYZ + offset[0][x]], m_scale);
+                }
+            }
+        }
+    }
+
+    // Separable, reduce the 16 rows along x, then along y, then z, carrying the derivative along each axis
+    T rowX[16];
+    T rowDX[16];
+    for(unsigned int r=0; r<16; ++r)
+    {
+        rowX[r] = (w[0][0] * v[r*4]) + (w[0][1] * v[r*4 + 1]) + (w[0][2] * v[r*4 + 2]) + (w[0][3] * v[r*4 + 3]);
+        rowDX[r] = (dw[0][0] * v[r*4]) + (dw[0][1] * v[r*4 + 1]) + (dw[0][2] * v[r*4 + 2]) + (dw[0][3] * v[r*4 + 3]);
+    }
+
+    T val = T();
+    glm::vec3 grad(0.0f);
+    for(unsigned int z=0; z<4; ++z)
+    {
+        T rowY = T();
+        T rowDY = T();
+        T rowYDX = T();
+        for(unsigned int y=0; y<4; ++y)
+        {
+            rowY += w[1][y] * rowX[z*4 + y];
+            rowDY += dw[1][y] * rowX[z*4 + y];
+            rowYDX += w[1][y] * rowDX[z*4 + y];
+        }
+        val += w[2][z] * rowY;
+        grad.x += w[2][z] * rowYDX;
+        grad.y += w[2][z] * rowDY;
+        grad.z += dw[2][z] * rowY;
+    }
+
+    _grad = grad;
+    return val;
+}
+
+//------------------------------------------------------------------------------------------------
+
+template <typename T, typename Storage>
+T SparseTexture3DCpu<T, Storage>::LinearInterpolate(const T _f1, const T _f2, const float _t) const
+{
+    float t = _t < 0.0f ? 0.0f : (_t > 1.0f ? 1.0f : _t);
+    return _f1 + ((_f2-_f1) * t);
+}
+
+//------------------------------------------------------------------------------------------------
+
+template <typename T, typename Storage>
+T SparseTexture3DCpu<T, Storage>::Voxel(const unsigned int _x, const unsigned int _y, const unsigned int _z) const
+{
+    unsigned int brick = m_brickIndex[((_z >> BrickShift) * m_brickDim.y * m_brickDim.x) + ((_y >> BrickShift) * m_brickDim.x) + (_x >> BrickShift)];
+    const unsigned int mask = BrickSize - 1;
+    if(brick & ConstantBrick)
+    {
+        return Codec::Decode(m_constants[brick & ~BrickFlags], m_scale);
+    }
+    else if(brick & CoarseBrick)
+    {
+        const Storage *s = &m_coarseBricks[(brick & ~BrickFlags) * 8];
+        T c[8];
+        for(unsigned int i=0; i<8; ++i)
+        {
+            c[i] = Codec::Decode(s[i], m_scale);
+        }
+        const float scale = 1.0f / BrickSize;
+        T valY0 = LinearInterpolate(LinearInterpolate(c[0], c[1], (_x & mask) * scale), LinearInterpolate(c[2], c[3], (_x & mask) * scale), (_y & mask) * scale);
+        T valY1 = LinearInterpolate(LinearInterpolate(c[4], c[5], (_x & mask) * scale), LinearInterpolate(c[6], c[7], (_x & mask) * scale), (_y & mask) * scale);
+        return LinearInterpolate(valY0, valY1, (_z & mask) * scale);
+    }
+
+    return Codec::Decode(m_bricks[(brick * BrickVoxels) + ((_z & mask) << (2 * BrickShift)) + ((_y & mask) << BrickShift) + (_x & mask)], m_scale);
+}
+
+
+#endif // SPARSETEXTURE3DCPU_H
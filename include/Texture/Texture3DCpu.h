@@ -2,6 +2,11 @@
 #define FIELD1D_H
 
 #include <glm/glm.hpp>
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "Texture/TextureBatch.h"
 
 
 //-------------------------------------------------------------------------------
@@ -17,8 +22,19 @@ template <typename T>
 class Texture3DCpu
 {
 public:
+    /// @brief How voxels are laid out in memory.
+    /// Linear : x fastest over the whole volume, the 8 voxels of a lookup lie in 4 rows up to _dim^2 voxels apart.
+    /// Bricked : BrickSize^3 bricks, each also holding the voxels just past its far faces, so the 8 voxels of a lookup
+    /// are at fixed offsets within one brick and the far ones need no clamping. Takes PaddedBrickVoxels per BrickSize^3 voxels.
+    enum class Layout { Linear, Bricked };
+
+    /// @brief Width in voxels of a brick of the bricked layout along each axis, without and with its far faces
+    enum { BrickShift = DenseTextureView::BrickShift, BrickSize = 1 << BrickShift, PaddedBrickSize = BrickSize + 1, PaddedBrickVoxels = PaddedBrickSize * PaddedBrickSize * PaddedBrickSize };
+
     /// @brief constructor
-    Texture3DCpu(unsigned int _dim = 32);
+    /// @param _dim : dimension of uniform 3D volume
+    /// @param _layout : how voxels are laid out in memory
+    Texture3DCpu(unsigned int _dim = 32, const Layout _layout = Layout::Linear);
 
     /// @brief destructor
     ~Texture3DCpu();
@@ -27,25 +43,61 @@ public:
     void SetTextureSpaceTransform(glm::mat4 _textureSpaceTransform);
 
     /// @brief Method to set the data within in the texture
+    /// @param _dim : dimension of uniform 3D volume
+    /// @param _data : _dim^3 voxels, x fastest, whatever the layout
     void SetData(unsigned int _dim, T *_data);
 
+    /// @brief Method to set how voxels are laid out in memory, the voxels already set are laid out again.
+    /// Lookups give the same values with either layout.
+    void SetLayout(const Layout _layout);
+
+    /// @brief Method to get how voxels are laid out in memory
+    Layout GetLayout() const;
+
     /// @brief Method to get value of texture at sample point
     T Eval(const glm::vec3 &_samplePoint);
 
     /// @brief Method to get value of texture at sample point
     T Eval(const float _x, const float _y, const float _z);
 
+    /// @brief Method to get values of texture at many sample points, the same values Eval gives.
+    /// Float textures look up a lane of points at once where the CPU supports AVX2 or AVX-512, see TextureBatch.h.
+    /// @param _samplePoints : sample points
+    /// @param _numPoints : number of sample points
+    /// @param _out : output, value per sample point
+    void EvalBatch(const glm::vec3 *_samplePoints, const unsigned int _numPoints, T *_out);
+
+    /// @brief Method to get values of texture at many sample points given a component at a time
+    /// @param _x : x of each sample point
+    /// @param _y : y of each sample point
+    /// @param _z : z of each sample point
+    /// @param _numPoints : number of sample points
+    /// @param _out : output, value per sample point
+    void EvalBatch(const float *_x, const float *_y, const float *_z, const unsigned int _numPoints, T *_out);
+
 
 private:
 
     /// @brief Method to perform trilinear interpolation on the texture
     T TrilinearInterpolate(const float _x, const float _y, const float _z);
 
+    /// @brief Method to get what the batched lookups read, only float textures define it
+    DenseTextureView GetView() const;
+
     /// @brief Method to perform linear interpolatation between 2 values
     T LinearInterpolate(const T _f1, const T _f2, const float _t);
 
     /// @brief Method to hash x,y,z coords into a single value usedd to query the texture
-    int Hash(const int _x, const int _y, const int _z);
+    int Hash(const int _x, const int _y, const int _z) const;
+
+    /// @brief Method to get the index in m_data of a voxel of the bricked layout
+    unsigned int BrickedIndex(const unsigned int _x, const unsigned int _y, const unsigned int _z) const;
+
+    /// @brief Method to get the number of voxels m_data holds for the current dimension and layout
+    unsigned int DataSize() const;
+
+    /// @brief Method to copy _data, m_dim^3 voxels x fastest, into m_data as laid out by m_layout
+    void LayOut(const T *_data);
 
     /// @brief This attribute transform a local/word space coord into texture space
     /// so that it can be used to sample the 3D texture/data.
@@ -56,6 +108,12 @@ private:
 
     /// @brief Data stored in each voxel.
     T *m_data;
+
+    /// @brief How m_data is laid out.
+    Layout m_layout;
+
+    /// @brief number of bricks of the bricked layout along each axis.
+    unsigned int m_brickDim;
 };
 
 
@@ -67,10 +125,12 @@ private:
 
 
 template <typename T>
-Texture3DCpu<T>::Texture3DCpu(unsigned int _dim)
+Texture3DCpu<T>::Texture3DCpu(unsigned int _dim, const Layout _layout)
 {
     m_dim = _dim;
-    m_data = new T[m_dim * m_dim * m_dim];
+    m_layout = _layout;
+    m_brickDim = (m_dim + BrickSize - 1) >> BrickShift;
+    m_data = new T[DataSize()];
 
 
 //    m_textureSpaceTransform = [](glm::vec3 _v){return _v;};
@@ -109,12 +169,47 @@ void Texture3DCpu<T>::SetData(unsigned int _dim, T *_data)
     }
 
     m_dim = _dim;
-    m_data = new T[m_dim * m_dim * m_dim];
+    m_brickDim = (m_dim + BrickSize - 1) >> BrickShift;
+    m_data = new T[DataSize()];
 
-    for(unsigned int i=0; i<m_dim*m_dim*m_dim; ++i)
+    LayOut(_data);
+}
+
+//------------------------------------------------------------------------------------------------
+
+template <typename T>
+void Texture3DCpu<T>::SetLayout(const Layout _layout)
+{
+    if(_layout == m_layout)
     {
-        m_data[i] = _data[i];
+        return;
     }
+
+    // Read the voxels back in linear order before laying them out again
+    std::vector<T> data(m_dim * m_dim * m_dim);
+    for(unsigned int z=0; z<m_dim; ++z)
+    {
+        for(unsigned int y=0; y<m_dim; ++y)
+        {
+            for(unsigned int x=0; x<m_dim; ++x)
+            {
+                data[Hash(x, y, z)] = m_layout == Layout::Bricked ? m_data[BrickedIndex(x, y, z)] : m_data[Hash(x, y, z)];
+            }
+        }
+    }
+
+    m_layout = _layout;
+    delete [] m_data;
+    m_data = new T[DataSize()];
+    LayOut(&data[0]);
+}
+
+//------------------------------------------------------------------------------------------------
+
+template <typename T>
+typename Texture3DCpu<T>::Layout Texture3DCpu<T>::GetLayout() const
+{
+    return m_layout;
 }
 
 //------------------------------------------------------------------------------------------------
@@ -135,6 +230,78 @@ T Texture3DCpu<T>::Eval(const float _x, const float _y, const float _z)
 
 //------------------------------------------------------------------------------------------------
 
+template <typename T>
+void Texture3DCpu<T>::EvalBatch(const glm::vec3 *_samplePoints, const unsigned int _numPoints, T *_out)
+{
+    for(unsigned int i=0; i<_numPoints; ++i)
+    {
+        _out[i] = TrilinearInterpolate(_samplePoints[i].x, _samplePoints[i].y, _samplePoints[i].z);
+    }
+}
+
+//------------------------------------------------------------------------------------------------
+
+template <typename T>
+void Texture3DCpu<T>::EvalBatch(const float *_x, const float *_y, const float *_z, const unsigned int _numPoints, T *_out)
+{
+    for(unsigned int i=0; i<_numPoints; ++i)
+    {
+        _out[i] = TrilinearInterpolate(_x[i], _y[i], _z[i]);
+    }
+}
+
+//------------------------------------------------------------------------------------------------
+
+template <>
+inline DenseTextureView Texture3DCpu<float>::GetView() const
+{
+    DenseTextureView view;
+    view.data = m_data;
+    view.textureSpaceTransform = m_textureSpaceTransform;
+    view.dim = m_dim;
+    view.brickDim = m_brickDim;
+    view.bricked = m_layout == Layout::Bricked;
+    return view;
+}
+
+//------------------------------------------------------------------------------------------------
+
+template <>
+inline void Texture3DCpu<float>::EvalBatch(const glm::vec3 *_samplePoints, const unsigned int _numPoints, float *_out)
+{
+    const TextureKernels &kernels = TextureKernels::Instance();
+    if(kernels.dense == nullptr)
+    {
+        for(unsigned int i=0; i<_numPoints; ++i)
+        {
+            _out[i] = TrilinearInterpolate(_samplePoints[i].x, _samplePoints[i].y, _samplePoints[i].z);
+        }
+        return;
+    }
+
+    kernels.dense(GetView(), _samplePoints, _numPoints, _out);
+}
+
+//------------------------------------------------------------------------------------------------
+
+template <>
+inline void Texture3DCpu<float>::EvalBatch(const float *_x, const float *_y, const float *_z, const unsigned int _numPoints, float *_out)
+{
+    const TextureKernels &kernels = TextureKernels::Instance();
+    if(kernels.denseComponents == nullptr)
+    {
+        for(unsigned int i=0; i<_numPoints; ++i)
+        {
+            _out[i] = TrilinearInterpolate(_x[i], _y[i], _z[i]);
+        }
+        return;
+    }
+
+    kernels.denseComponents(GetView(), _x, _y, _z, _numPoints, _out);
+}
+
+//------------------------------------------------------------------------------------------------
+
 template <typename T>
 T Texture3DCpu<T>::TrilinearInterpolate(const float _x, const float _y, const float _z)
 {
@@ -147,35 +314,50 @@ T Texture3DCpu<T>::TrilinearInterpolate(const float _x, const float _y, const fl
     float y = texSpace.y * m_dim;
     float z = texSpace.z * m_dim;
 
-    unsigned int x0 = floor(x);
-    unsigned int y0 = floor(y);
-    unsigned int z0 = floor(z);
-
-    // Adjust for potential out of bounds
-    x0 = x0 >= m_dim ? m_dim - 1 : x0;
-    y0 = y0 >= m_dim ? m_dim - 1 : y0;
-    z0 = z0 >= m_dim ? m_dim - 1 : z0;
-
-    x0 = x0 < 0 ? 0 : x0;
-    y0 = y0 < 0 ? 0 : y0;
-    z0 = z0 < 0 ? 0 : z0;
+    // Adjust for potential out of bounds, before converting as negative coords do not fit an unsigned int
+    auto clampCoord = [](float _c, unsigned int _dim){
+        return _c <= 0.0f ? 0u : (_c >= _dim - 1 ? _dim - 1 : (unsigned int)std::floor(_c));
+    };
+    unsigned int x0 = clampCoord(x, m_dim);
+    unsigned int y0 = clampCoord(y, m_dim);
+    unsigned int z0 = clampCoord(z, m_dim);
 
-    // Get other set of coords
-    unsigned int x1 = x0 >= m_dim -1 ? x0 : x0 + 1;
-    unsigned int y1 = y0 >= m_dim -1 ? y0 : y0 + 1;
-    unsigned int z1 = z0 >= m_dim -1 ? z0 : z0 + 1;
-
-
-    // Get values
-    T val0 = m_data[Hash(x0, y0, z0)]; //bottom font left
-    T val1 = m_data[Hash(x1, y0, z0)]; //bottom front right
-    T val2 = m_data[Hash(x0, y1, z0)]; //bottom back left
-    T val3 = m_data[Hash(x1, y1, z0)]; //bottom back right
-
-    T val4 = m_data[Hash(x0, y0, z1)];
-    T val5 = m_data[Hash(x1, y0, z1)];
-    T val6 = m_data[Hash(x0, y1, z1)];
-    T val7 = m_data[Hash(x1, y1, z1)];
+    T val0, val1, val2, val3, val4, val5, val6, val7;
+    if(m_layout == Layout::Bricked)
+    {
+        // The brick holds the voxels past its far faces, clamped at the edge of the texture, so the other 7 are at fixed offsets
+        const T *v = &m_data[BrickedIndex(x0, y0, z0)];
+        const unsigned int dy = PaddedBrickSize;
+        const unsigned int dz = PaddedBrickSize * PaddedBrickSize;
+        val0 = v[0];
+        val1 = v[1];
+        val2 = v[dy];
+        val3 = v[dy + 1];
+
+        val4 = v[dz];
+        val5 = v[dz + 1];
+        val6 = v[dz + dy];
+        val7 = v[dz + dy + 1];
+    }
+    else
+    {
+        // Get other set of coords
+        unsigned int x1 = x0 >= m_dim -1 ? x0 : x0 + 1;
+        unsigned int y1 = y0 >= m_dim -1 ? y0 : y0 + 1;
+        unsigned int z1 = z0 >= m_dim -1 ? z0 : z0 + 1;
+
+
+        // Get values
+        val0 = m_data[Hash(x0, y0, z0)]; //bottom font left
+        val1 = m_data[Hash(x1, y0, z0)]; //bottom front right
+        val2 = m_data[Hash(x0, y1, z0)]; //bottom back left
+        val3 = m_data[Hash(x1, y1, z0)]; //bottom back right
+
+        val4 = m_data[Hash(x0, y0, z1)];
+        val5 = m_data[Hash(x1, y0, z1)];
+        val6 = m_data[Hash(x0, y1, z1)];
+        val7 = m_data[Hash(x1, y1, z1)];
+    }
 
 
     // do interpolation here
@@ -209,10 +391,68 @@ T Texture3DCpu<T>::LinearInterpolate(const T _f1, const T _f2, const float _t)
 //------------------------------------------------------------------------------------------------
 
 template <typename T>
-int Texture3DCpu<T>::Hash(const int _x, const int _y, const int _z)
+int Texture3DCpu<T>::Hash(const int _x, const int _y, const int _z) const
 {
     return _x + (_y * m_dim) + (_z * m_dim * m_dim);
 }
 
+//------------------------------------------------------------------------------------------------
+
+template <typename T>
+unsigned int Texture3DCpu<T>::BrickedIndex(const unsigned int _x, const unsigned int _y, const unsigned int _z) const
+{
+    const unsigned int mask = BrickSize - 1;
+    unsigned int brick = ((((_z >> BrickShift) * m_brickDim) + (_y >> BrickShift)) * m_brickDim) + (_x >> BrickShift);
+    return (brick * PaddedBrickVoxels) + ((((_z & mask) * PaddedBrickSize) + (_y & mask)) * PaddedBrickSize) + (_x & mask);
+}
+
+//------------------------------------------------------------------------------------------------
+
+template <typename T>
+unsigned int Texture3DCpu<T>::DataSize() const
+{
+    return m_layout == Layout::Bricked ? m_brickDim * m_brickDim * m_brickDim * PaddedBrickVoxels : m_dim * m_dim * m_dim;
+}
+
+//------------------------------------------------------------------------------------------------
+
+template <typename T>
+void Texture3DCpu<T>::LayOut(const T *_data)
+{
+    if(m_layout == Layout::Linear)
+    {
+        for(unsigned int i=0; i<m_dim*m_dim*m_dim; ++i)
+        {
+            m_data[i] = _data[i];
+        }
+        return;
+    }
+
+    // Voxels past the edge of the texture repeat the last one, as clamping the coords would
+    unsigned int i = 0;
+    for(unsigned int bz=0; bz<m_brickDim; ++bz)
+    {
+        for(unsigned int by=0; by<m_brickDim; ++by)
+        {
+            for(unsigned int bx=0; bx<m_brickDim; ++bx)
+            {
+                for(unsigned int z=0; z<PaddedBrickSize; ++z)
+                {
+                    unsigned int vz = std::min(bz*BrickSize + z, m_dim - 1);
+                    for(unsigned int y=0; y<PaddedBrickSize; ++y)
+                    {
+                        unsigned int vy = std::min(by*BrickSize + y, m_dim - 1);
+                        for(unsigned int x=0; x<PaddedBrickSize; ++x)
+                        {
+                            unsigned int vx = std::min(bx*BrickSize + x, m_dim - 1);
+                            m_data[i++] = _data[Hash(vx, vy, vz)];
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
 
 #endif // FIELD1D_H
@@ -18,7 +18,7 @@
 
 /// @class Cuda3DTexture<T>
 /// @brief A templated class for creating a 3D cuda texture object.
-/// @brief Templates can only be float1, float2 and float4
+/// @brief Templates can only be float1, float2 and float4, or 8 and 16 bit integer vectors read as normalised floats
 template<typename T>
 class Texture3DCuda
 {
@@ -33,7 +33,15 @@ public:
     /// @brief Method to create a 3D texture cudaTextureObject from host side array
     /// @param _dim : the dimensions of the 3D texture.
     /// @param _data : The host side array of data to fill 3D texture with.
-    void CreateCudaTexture(unsigned int _dim, T *_data, cudaTextureFilterMode _filterMode = cudaFilterModePoint);
+    /// @param _readMode : cudaReadModeNormalizedFloat to read integer textures as floats in [0:1] or [-1:1], needed for linear filtering
+    void CreateCudaTexture(unsigned int _dim, T *_data, cudaTextureFilterMode _filterMode = cudaFilterModePoint,
+                           cudaTextureReadMode _readMode = cudaReadModeElementType);
+
+    /// @brief Method to create a 3D texture cudaTextureObject with a different number of voxels along each axis
+    /// @param _dimX, _dimY, _dimZ : the dimensions of the 3D texture.
+    /// @param _data : The host side array of data to fill 3D texture with, x fastest.
+    void CreateCudaTexture(unsigned int _dimX, unsigned int _dimY, unsigned int _dimZ, T *_data, cudaTextureFilterMode _filterMode = cudaFilterModePoint,
+                           cudaTextureReadMode _readMode = cudaReadModeElementType);
 
     /// @brief Methot to get the cudaTextureObject_t for use within kernels.
     /// @return cudaTextureObject_t
@@ -83,7 +91,15 @@ Texture3DCuda<T>::~Texture3DCuda()
 //------------------------------------------------------------------------------------------------
 
 template<typename T>
-void Texture3DCuda<T>::CreateCudaTexture(unsigned int _dim, T *_data, cudaTextureFilterMode _filterMode)
+void Texture3DCuda<T>::CreateCudaTexture(unsigned int _dim, T *_data, cudaTextureFilterMode _filterMode, cudaTextureReadMode _readMode)
+{
+    CreateCudaTexture(_dim, _dim, _dim, _data, _filterMode, _readMode);
+}
+
+//------------------------------------------------------------------------------------------------
+
+template<typename T>
+void Texture3DCuda<T>::CreateCudaTexture(unsigned int _dimX, unsigned int _dimY, unsigned int _dimZ, T *_data, cudaTextureFilterMode _filterMode, cudaTextureReadMode _readMode)
 {
     // just in case it's already been created
     DeleteCudaTexture();
@@ -91,14 +107,14 @@ void Texture3DCuda<T>::CreateCudaTexture(unsigned int _dim, T *_data, cudaTextur
 
     // Initialise cuda array
     cudaChannelFormatDesc channelDesc = cudaCreateChannelDesc<T>();
-    checkCudaErrors(cudaMalloc3DArray(&d_cuArray, &channelDesc, make_cudaExtent(_dim, _dim, _dim)));
+    checkCudaErrors(cudaMalloc3DArray(&d_cuArray, &channelDesc, make_cudaExtent(_dimX, _dimY, _dimZ)));
 
 
     // Upload host data to device array
     cudaMemcpy3DParms copy3DParams = {0};
-    copy3DParams.srcPtr = make_cudaPitchedPtr((void*)_data, _dim*sizeof(T), _dim, _dim);
+    copy3DParams.srcPtr = make_cudaPitchedPtr((void*)_data, _dimX*sizeof(T), _dimX, _dimY);
     copy3DParams.dstArray = d_cuArray;
-    copy3DParams.extent = make_cudaExtent(_dim, _dim, _dim);
+    copy3DParams.extent = make_cudaExtent(_dimX, _dimY, _dimZ);
     copy3DParams.kind = cudaMemcpyHostToDevice;
     checkCudaErrors(cudaMemcpy3D(&copy3DParams));
 
@@ -115,7 +131,7 @@ void Texture3DCuda<T>::CreateCudaTexture(unsigned int _dim, T *_data, cudaTextur
     texDesc.addressMode[1] = cudaAddressModeClamp;
     texDesc.addressMode[2] = cudaAddressModeClamp;
     texDesc.filterMode = _filterMode;// cudaFilterModePoint;// cudaFilterModeLinear;
-    texDesc.readMode = cudaReadModeElementType;
+    texDesc.readMode = _readMode;
     texDesc.normalizedCoords = 1;
 
     d_cuTex = 0;
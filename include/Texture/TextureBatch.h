@@ -0,0 +1,121 @@
+#ifndef TEXTUREBATCH_H
+#define TEXTUREBATCH_H
+
+#include <glm/glm.hpp>
+
+
+//-------------------------------------------------------------------------------
+/// @author Idris Miles
+/// @version 1.0
+/// @date 18/04/2017
+//-------------------------------------------------------------------------------
+
+
+/// @struct DenseTextureView
+/// @brief What a batched lookup of a Texture3DCpu<float> reads, see Texture3DCpu for the layouts
+struct DenseTextureView
+{
+    /// @brief Width in voxels of a brick of the bricked layout, without and with its far faces
+    enum { BrickShift = 3, BrickSize = 1 << BrickShift, PaddedBrickSize = BrickSize + 1, PaddedBrickVoxels = PaddedBrickSize * PaddedBrickSize * PaddedBrickSize };
+
+    const float *data;
+    glm::mat4 textureSpaceTransform;
+    unsigned int dim;
+    unsigned int brickDim;
+    bool bricked;
+};
+
+/// @struct SparseTextureView
+/// @brief What a batched lookup of a SparseTexture3DCpu<float, unsigned short> reads, see SparseTexture3DCpu for the bricks
+struct SparseTextureView
+{
+    /// @brief Width in voxels of a brick, and the flags of a brick index entry
+    enum : unsigned int { BrickShift = 3, ConstantBrick = 0x80000000u, CoarseBrick = 0x40000000u };
+
+    const unsigned int *brickIndex;
+    const unsigned short *bricks;
+    const unsigned short *constantBricks;
+    glm::mat4 textureSpaceTransform;
+    glm::uvec3 dim;
+    glm::uvec3 brickDim;
+    float scale;
+};
+
+
+/// @class TextureKernels
+/// @brief The batched trilinear lookups of Texture3DCpu<float> and SparseTexture3DCpu<float, unsigned short>, one sample point per SIMD lane.
+/// The AVX2 and AVX-512 kernels are built for their instruction set whatever the rest of the build targets,
+/// the best one the CPU supports is picked the first time Instance is called. Without either the kernels are null
+/// and EvalBatch loops over the scalar lookups.
+/// Coordinates are computed with the same operations, in the same order, as the scalar lookups so both give the same values,
+/// up to the last bit where the compiler fuses multiplies and adds (-ffp-contract) in the scalar lookups.
+class TextureKernels
+{
+public:
+    /// @brief Instruction set a set of kernels is built for
+    enum class Isa { Scalar, Avx2, Avx512 };
+
+    /// @typedef DenseKernel, trilinear lookups of a dense texture at _numPoints points
+    typedef void (*DenseKernel)(const DenseTextureView &_texture, const glm::vec3 *_points, const unsigned int _numPoints, float *_out);
+
+    /// @typedef DenseComponentsKernel, trilinear lookups of a dense texture at _numPoints points given a component at a time
+    typedef void (*DenseComponentsKernel)(const DenseTextureView &_texture, const float *_x, const float *_y, const float *_z,
+                                          const unsigned int _numPoints, float *_out);
+
+    /// @typedef SparseKernel, trilinear lookups of a sparse texture at _numPoints points. Points next to a coarse brick are skipped,
+    /// their indices are written to _coarse, which has room for _numPoints, and how many there are is returned.
+    typedef unsigned int (*SparseKernel)(const SparseTextureView &_texture, const glm::vec3 *_points, const unsigned int _numPoints,
+                                         float *_out, unsigned int *_coarse);
+
+    /// @brief Method to get the kernels in use, the best the CPU supports unless Select was called.
+    static const TextureKernels &Instance();
+
+    /// @brief Method to check if the CPU and the build support an instruction set
+    static bool IsSupported(const Isa _isa);
+
+    /// @brief Method to use the kernels of another instruction set, to compare them in tests and benchmarks.
+    /// Must not be called while anything is looking up a texture.
+    /// @return bool false if the instruction set is not supported, the kernels are then unchanged
+    static bool Select(const Isa _isa);
+
+    /// @brief Method to get the name of an instruction set
+    static const char *GetName(const Isa _isa);
+
+    /// @brief The instruction set of these kernels.
+    Isa isa;
+
+    /// @brief Lookups of Texture3DCpu<float>, null for Isa::Scalar.
+    DenseKernel dense;
+
+    /// @brief Component at a time lookups of Texture3DCpu<float>, null for Isa::Scalar.
+    DenseComponentsKernel denseComponents;
+
+    /// @brief Lookups of SparseTexture3DCpu<float, unsigned short>, null for Isa::Scalar.
+    SparseKernel sparse;
+
+private:
+    /// @brief Method to get the kernels of an instruction set
+    static TextureKernels Make(const Isa _isa);
+
+    /// @brief Method to get the kernels Instance returns
+    static TextureKernels &Current();
+};
+
+
+/// @brief Kernels built for AVX2, in src/Texture/TextureBatchAvx2.cpp, only call them through TextureKernels
+namespace TextureBatchAvx2
+{
+    void EvalDense(const DenseTextureView &_texture, const glm::vec3 *_points, const unsigned int _numPoints, float *_out);
+    void EvalDenseComponents(const DenseTextureView &_texture, const float *_x, const float *_y, const float *_z, const unsigned int _numPoints, float *_out);
+    unsigned int EvalSparse(const SparseTextureView &_texture, const glm::vec3 *_points, const unsigned int _numPoints, float *_out, unsigned int *_coarse);
+}
+
+/// @brief Kernels built for AVX-512, in src/Texture/TextureBatchAvx512.cpp, only call them through TextureKernels
+namespace TextureBatchAvx512
+{
+    void EvalDense(const DenseTextureView &_texture, const glm::vec3 *_points, const unsigned int _numPoints, float *_out);
+    void EvalDenseComponents(const DenseTextureView &_texture, const float *_x, const float *_y, const float *_z, const unsigned int _numPoints, float *_out);
+    unsigned int EvalSparse(const SparseTextureView &_texture, const glm::vec3 *_points, const unsigned int _numPoints, float *_out, unsigned int *_coarse);
+}
+
+#endif // TEXTUREBATCH_H
@@ -0,0 +1,303 @@
+#ifndef TEXTURELANES_H
+#define TEXTURELANES_H
+
+//-------------------------------------------------------------------------------
+/// @author Idris Miles
+/// @version 1.0
+/// @date 18/04/2017
+//-------------------------------------------------------------------------------
+
+
+/// @class TextureLanes
+/// @brief The batched trilinear lookups of TextureKernels, written once over the registers and operations of an instruction set, L.
+/// L defines Lanes, the Float, Int and Mask registers and the operations on them, see src/Texture/TextureBatchAvx2.cpp.
+/// Only included by the kernel sources after they switch on their instruction set, so it includes nothing itself,
+/// a header first included here would be built for that instruction set too.
+template <typename L>
+struct TextureLanes
+{
+    typedef typename L::Float Float;
+    typedef typename L::Int Int;
+    typedef typename L::Mask Mask;
+
+    /// @brief Method to load up to Lanes sample points, lanes past _lanes repeat the first point
+    /// @param _points : sample points
+    /// @param _lanes : number of sample points to load
+    /// @param _p : output, x, y and z of the sample points
+    static inline void LoadPoints(const glm::vec3 *_points, const unsigned int _lanes, Float _p[3])
+    {
+        float p[3][L::Lanes];
+        for(unsigned int k=0; k<L::Lanes; ++k)
+        {
+            const glm::vec3 &x = _points[k < _lanes ? k : 0];
+            p[0][k] = x.x;
+            p[1][k] = x.y;
+            p[2][k] = x.z;
+        }
+        _p[0] = L::Load(p[0]);
+        _p[1] = L::Load(p[1]);
+        _p[2] = L::Load(p[2]);
+    }
+
+    /// @brief Method to load up to Lanes sample points given a component at a time
+    static inline void LoadPoints(const float *_x, const float *_y, const float *_z, const unsigned int _lanes, Float _p[3])
+    {
+        if(_lanes == L::Lanes)
+        {
+            _p[0] = L::Load(_x);
+            _p[1] = L::Load(_y);
+            _p[2] = L::Load(_z);
+            return;
+        }
+
+        float p[3][L::Lanes];
+        for(unsigned int k=0; k<L::Lanes; ++k)
+        {
+            p[0][k] = _x[k < _lanes ? k : 0];
+            p[1][k] = _y[k < _lanes ? k : 0];
+            p[2][k] = _z[k < _lanes ? k : 0];
+        }
+        _p[0] = L::Load(p[0]);
+        _p[1] = L::Load(p[1]);
+        _p[2] = L::Load(p[2]);
+    }
+
+    /// @brief Method to store the first _lanes values
+    static inline void StoreLanes(float *_out, const unsigned int _lanes, const Float _v)
+    {
+        if(_lanes == L::Lanes)
+        {
+            L::Store(_out, _v);
+            return;
+        }
+
+        float v[L::Lanes];
+        L::Store(v, _v);
+        for(unsigned int k=0; k<_lanes; ++k)
+        {
+            _out[k] = v[k];
+        }
+    }
+
+    /// @brief Method to take sample points into voxel coordinates, as glm does _transform * vec4(p, 1) and then scales by _dim
+    static inline void VoxelCoords(const glm::mat4 &_transform, const glm::uvec3 &_dim, const Float _p[3], Float _c[3])
+    {
+        for(unsigned int axis=0; axis<3; ++axis)
+        {
+            Float xy = L::Add(L::Mul(L::Set(_transform[0][axis]), _p[0]), L::Mul(L::Set(_transform[1][axis]), _p[1]));
+            Float zw = L::Add(L::Mul(L::Set(_transform[2][axis]), _p[2]), L::Set(_transform[3][axis]));
+            _c[axis] = L::Mul(L::Add(xy, zw), L::Set((float)_dim[axis]));
+        }
+    }
+
+    /// @brief Method to get the 2 voxels either side of a voxel coordinate, clamped to the texture, and how far it is between them
+    /// @param _c : voxel coordinate along one axis
+    /// @param _dim : number of voxels along that axis
+    /// @param _i0 : output, voxel at or below _c
+    /// @param _i1 : output, voxel above _i0, or _i0 at the last voxel
+    /// @param _t : output, _c less _i0, LinearInterpolate clamps it
+    static inline void Cell(const Float _c, const unsigned int _dim, Int &_i0, Int &_i1, Float &_t)
+    {
+        _i0 = L::Truncate(L::Min(L::Max(_c, L::Set(0.0f)), L::Set((float)(_dim - 1))));
+        _i1 = L::MinInt(L::AddInt(_i0, L::SetInt(1)), L::SetInt(_dim - 1));
+        _t = L::Sub(_c, L::ToFloat(_i0));
+    }
+
+    /// @brief Method to perform linear interpolatation between 2 values of each lane, _t is clamped to [0:1]
+    static inline Float LinearInterpolate(const Float _f1, const Float _f2, const Float _t)
+    {
+        Float t = L::Min(L::Max(_t, L::Set(0.0f)), L::Set(1.0f));
+        return L::Add(_f1, L::Mul(L::Sub(_f2, _f1), t));
+    }
+
+    /// @brief Method to perform trilinear interpolation of a dense texture at a lane of sample points, as Texture3DCpu::TrilinearInterpolate
+    static inline Float DenseTrilinear(const DenseTextureView &_texture, const Float _p[3])
+    {
+        typedef DenseTextureView V;
+        const unsigned int dimension = _texture.dim;
+
+        Float c[3];
+        VoxelCoords(_texture.textureSpaceTransform, glm::uvec3(dimension), _p, c);
+
+        Int i0[3], i1[3];
+        Float t[3];
+        for(unsigned int axis=0; axis<3; ++axis)
+        {
+            Cell(c[axis], dimension, i0[axis], i1[axis], t[axis]);
+        }
+
+        const float *data = _texture.data;
+        if(_texture.bricked)
+        {
+            // Gather the voxel at i0 and the other 7 at fixed offsets from it within its brick
+            const Int shift = L::SetInt(V::BrickShift);
+            const Int mask = L::SetInt(V::BrickSize - 1);
+            const Int brickDim = L::SetInt(_texture.brickDim);
+            const Int paddedSize = L::SetInt(V::PaddedBrickSize);
+            Int brick = L::AddInt(L::MulInt(L::AddInt(L::MulInt(L::ShiftRight(i0[2], shift), brickDim), L::ShiftRight(i0[1], shift)), brickDim), L::ShiftRight(i0[0], shift));
+            Int voxel = L::AddInt(L::MulInt(L::AddInt(L::MulInt(L::AndInt(i0[2], mask), paddedSize), L::AndInt(i0[1], mask)), paddedSize), L::AndInt(i0[0], mask));
+            Int index = L::AddInt(L::MulInt(brick, L::SetInt(V::PaddedBrickVoxels)), voxel);
+
+            const unsigned int dy = V::PaddedBrickSize;
+            const unsigned int dz = V::PaddedBrickSize * V::PaddedBrickSize;
+            Float valX0 = LinearInterpolate(L::Gather(data, index), L::Gather(data + 1, index), t[0]);
+            Float valX1 = LinearInterpolate(L::Gather(data + dy, index), L::Gather(data + dy + 1, index), t[0]);
+            Float valX2 = LinearInterpolate(L::Gather(data + dz, index), L::Gather(data + dz + 1, index), t[0]);
+            Float valX3 = LinearInterpolate(L::Gather(data + dz + dy, index), L::Gather(data + dz + dy + 1, index), t[0]);
+
+            Float valY0 = LinearInterpolate(valX0, valX1, t[1]);
+            Float valY1 = LinearInterpolate(valX2, valX3, t[1]);
+
+            return LinearInterpolate(valY0, valY1, t[2]);
+        }
+
+        // Rows of the 8 voxels, then gather along each row
+        const Int dim = L::SetInt(dimension);
+        const Int dim2 = L::SetInt(dimension * dimension);
+        Int y0 = L::MulInt(i0[1], dim);
+        Int y1 = L::MulInt(i1[1], dim);
+        Int z0 = L::MulInt(i0[2], dim2);
+        Int z1 = L::MulInt(i1[2], dim2);
+        Int row0 = L::AddInt(y0, z0);
+        Int row1 = L::AddInt(y1, z0);
+        Int row2 = L::AddInt(y0, z1);
+        Int row3 = L::AddInt(y1, z1);
+
+        Float valX0 = LinearInterpolate(L::Gather(data, L::AddInt(row0, i0[0])), L::Gather(data, L::AddInt(row0, i1[0])), t[0]);
+        Float valX1 = LinearInterpolate(L::Gather(data, L::AddInt(row1, i0[0])), L::Gather(data, L::AddInt(row1, i1[0])), t[0]);
+        Float valX2 = LinearInterpolate(L::Gather(data, L::AddInt(row2, i0[0])), L::Gather(data, L::AddInt(row2, i1[0])), t[0]);
+        Float valX3 = LinearInterpolate(L::Gather(data, L::AddInt(row3, i0[0])), L::Gather(data, L::AddInt(row3, i1[0])), t[0]);
+
+        Float valY0 = LinearInterpolate(valX0, valX1, t[1]);
+        Float valY1 = LinearInterpolate(valX2, valX3, t[1]);
+
+        return LinearInterpolate(valY0, valY1, t[2]);
+    }
+
+    /// @brief Method to perform trilinear interpolation of a sparse texture at a lane of sample points, as SparseTexture3DCpu::TrilinearInterpolate
+    /// @param _texture : the texture
+    /// @param _p : x, y and z of the sample points
+    /// @param _coarseLanes : output, bit per lane that reads a coarse brick and is left for the scalar lookup
+    static inline Float SparseTrilinear(const SparseTextureView &_texture, const Float _p[3], int &_coarseLanes)
+    {
+        typedef SparseTextureView V;
+        const unsigned int brickSize = 1u << V::BrickShift;
+
+        Float c[3];
+        VoxelCoords(_texture.textureSpaceTransform, _texture.dim, _p, c);
+
+        // Per axis, the part of the brick index and of the offset within the brick of both voxels
+        const Int mask = L::SetInt(brickSize - 1);
+        const Int shift = L::SetInt(V::BrickShift);
+        const unsigned int brickStride[3] = {1, _texture.brickDim.x, _texture.brickDim.y * _texture.brickDim.x};
+        const unsigned int voxelShift[3] = {0, V::BrickShift, 2 * V::BrickShift};
+        Int brick[3][2], offset[3][2];
+        Float t[3];
+        for(unsigned int axis=0; axis<3; ++axis)
+        {
+            Int i[2];
+            Cell(c[axis], _texture.dim[axis], i[0], i[1], t[axis]);
+            for(unsigned int k=0; k<2; ++k)
+            {
+                brick[axis][k] = L::MulInt(L::ShiftRight(i[k], shift), L::SetInt(brickStride[axis]));
+                offset[axis][k] = L::ShiftLeft(L::AndInt(i[k], mask), L::SetInt(voxelShift[axis]));
+            }
+        }
+
+        // Gather each voxel's brick then the voxel, from the stored bricks or from the expanded constant bricks.
+        // Voxels are 16 bit, gather the aligned 32 bits holding each so no lane reads past the end of the array.
+        const int *brickIndex = reinterpret_cast<const int*>(_texture.brickIndex);
+        const int *bricks = reinterpret_cast<const int*>(_texture.bricks);
+        const int *constantBricks = reinterpret_cast<const int*>(_texture.constantBricks);
+        const Int constantFlag = L::SetInt(V::ConstantBrick);
+        const Int coarseFlag = L::SetInt(V::CoarseBrick);
+        const Int index = L::SetInt(~(V::ConstantBrick | V::CoarseBrick));
+        const Int brickVoxelsShift = L::SetInt(3 * V::BrickShift);
+        const Int one = L::SetInt(1);
+        const Int halfShift = L::SetInt(4);
+        const Int low = L::SetInt(0xffff);
+        const Float decode = L::Set(1.0f / 65535.0f);
+        const Float scale = L::Set(_texture.scale);
+        Mask coarse = L::NoLanes();
+        Float val[8];
+        for(unsigned int v=0; v<8; ++v)
+        {
+            const unsigned int x = v & 1, y = (v >> 1) & 1, z = v >> 2;
+            Int b = L::GatherInt(brickIndex, L::AddInt(L::AddInt(brick[2][z], brick[1][y]), brick[0][x]));
+            Mask constant = L::Test(b, constantFlag);
+            Mask flagged = L::MaskOr(constant, L::Test(b, coarseFlag));
+            Mask stored = L::MaskAndNot(flagged, L::AllLanes());
+            coarse = L::MaskOr(coarse, L::MaskAndNot(constant, flagged));
+
+            Int voxel = L::AddInt(L::ShiftLeft(L::AndInt(b, index), brickVoxelsShift), L::AddInt(L::AddInt(offset[2][z], offset[1][y]), offset[0][x]));
+            Int word = L::ShiftRight(voxel, one);
+            Int s = L::GatherInt(L::SetInt(0), stored, bricks, word);
+            s = L::GatherInt(s, constant, constantBricks, word);
+            s = L::AndInt(L::ShiftRight(s, L::ShiftLeft(L::AndInt(voxel, one), halfShift)), low);
+
+            val[v] = L::Mul(L::Mul(L::ToFloat(s), decode), scale);
+        }
+        _coarseLanes = L::Bits(coarse);
+
+        Float valX0 = LinearInterpolate(val[0], val[1], t[0]);
+        Float valX1 = LinearInterpolate(val[2], val[3], t[0]);
+        Float valX2 = LinearInterpolate(val[4], val[5], t[0]);
+        Float valX3 = LinearInterpolate(val[6], val[7], t[0]);
+
+        Float valY0 = LinearInterpolate(valX0, valX1, t[1]);
+        Float valY1 = LinearInterpolate(valX2, valX3, t[1]);
+
+        return LinearInterpolate(valY0, valY1, t[2]);
+    }
+
+    /// @brief TextureKernels::DenseKernel
+    static void EvalDense(const DenseTextureView &_texture, const glm::vec3 *_points, const unsigned int _numPoints, float *_out)
+    {
+        for(unsigned int start=0; start<_numPoints; start+=L::Lanes)
+        {
+            unsigned int lanes = _numPoints - start < (unsigned int)L::Lanes ? _numPoints - start : (unsigned int)L::Lanes;
+            Float p[3];
+            LoadPoints(_points + start, lanes, p);
+            StoreLanes(_out + start, lanes, DenseTrilinear(_texture, p));
+        }
+    }
+
+    /// @brief TextureKernels::DenseComponentsKernel
+    static void EvalDenseComponents(const DenseTextureView &_texture, const float *_x, const float *_y, const float *_z,
+                                    const unsigned int _numPoints, float *_out)
+    {
+        for(unsigned int start=0; start<_numPoints; start+=L::Lanes)
+        {
+            unsigned int lanes = _numPoints - start < (unsigned int)L::Lanes ? _numPoints - start : (unsigned int)L::Lanes;
+            Float p[3];
+            LoadPoints(_x + start, _y + start, _z + start, lanes, p);
+            StoreLanes(_out + start, lanes, DenseTrilinear(_texture, p));
+        }
+    }
+
+    /// @brief TextureKernels::SparseKernel
+    static unsigned int EvalSparse(const SparseTextureView &_texture, const glm::vec3 *_points, const unsigned int _numPoints,
+                                   float *_out, unsigned int *_coarse)
+    {
+        unsigned int numCoarse = 0;
+        for(unsigned int start=0; start<_numPoints; start+=L::Lanes)
+        {
+            unsigned int lanes = _numPoints - start < (unsigned int)L::Lanes ? _numPoints - start : (unsigned int)L::Lanes;
+            Float p[3];
+            int coarseLanes;
+            LoadPoints(_points + start, lanes, p);
+            StoreLanes(_out + start, lanes, SparseTrilinear(_texture, p, coarseLanes));
+
+            for(unsigned int k=0; k<lanes && coarseLanes != 0; ++k)
+            {
+                if(coarseLanes & (1 << k))
+                {
+                    _coarse[numCoarse++] = start + k;
+                }
+            }
+        }
+        return numCoarse;
+    }
+};
+
+#endif // TEXTURELANES_H
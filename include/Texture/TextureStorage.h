@@ -0,0 +1,190 @@
+#ifndef TEXTURESTORAGE_H
+#define TEXTURESTORAGE_H
+
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__F16C__)
+#include <immintrin.h>
+#endif
+
+
+//-------------------------------------------------------------------------------
+/// @author Idris Miles
+/// @version 1.0
+/// @date 18/04/2017
+//-------------------------------------------------------------------------------
+
+
+/// @brief Half precision float, 1 sign, 5 exponent and 10 mantissa bits
+struct Half
+{
+    unsigned short bits;
+    bool operator==(const Half &_h) const { return bits == _h.bits; }
+};
+
+/// @brief Three components stored as S each
+template <typename S>
+struct Vec3Storage
+{
+    S x, y, z;
+    bool operator==(const Vec3Storage &_v) const { return x == _v.x && y == _v.y && z == _v.z; }
+};
+
+//-------------------------------------------------------------------------------
+
+/// @brief Method to round a float to the nearest half
+inline Half FloatToHalf(const float _f)
+{
+    Half h;
+#if defined(__F16C__)
+    h.bits = _cvtss_sh(_f, 0);
+#else
+    unsigned int x;
+    std::memcpy(&x, &_f, sizeof(x));
+    unsigned int sign = (x >> 16) & 0x8000u;
+    unsigned int absX = x & 0x7fffffffu;
+
+    if(absX >= 0x47800000u)
+    {
+        // too big for a half, infinity or nan
+        h.bits = (unsigned short)(sign | (absX > 0x7f800000u ? 0x7e00u : 0x7c00u));
+    }
+    else if(absX < 0x38800000u)
+    {
+        // below the smallest normal half, a multiple of 2^-24
+        float a;
+        std::memcpy(&a, &absX, sizeof(a));
+        h.bits = (unsigned short)(sign | (unsigned int)std::lrint(a * 16777216.0f));
+    }
+    else
+    {
+        // rebias the exponent and round the mantissa to nearest even, a carry rolls into the exponent
+        unsigned int bits = (absX - 0x38000000u) >> 13;
+        unsigned int rest = absX & 0x1fffu;
+        bits += (rest > 0x1000u || (rest == 0x1000u && (bits & 1u))) ? 1u : 0u;
+        h.bits = (unsigned short)(sign | bits);
+    }
+#endif
+    return h;
+}
+
+/// @brief Method to get the float a half holds
+inline float HalfToFloat(const Half _h)
+{
+#if defined(__F16C__)
+    return _cvtsh_ss(_h.bits);
+#else
+    unsigned int sign = (unsigned int)(_h.bits & 0x8000u) << 16;
+    unsigned int exponent = (_h.bits >> 10) & 0x1fu;
+    unsigned int mantissa = _h.bits & 0x3ffu;
+
+    if(exponent == 0)
+    {
+        float f = mantissa * (1.0f / 16777216.0f);
+        return sign ? -f : f;
+    }
+
+    unsigned int x = sign | (mantissa << 13) | (exponent == 31 ? 0x7f800000u : ((exponent + 112) << 23));
+    float f;
+    std::memcpy(&f, &x, sizeof(f));
+    return f;
+#endif
+}
+
+//-------------------------------------------------------------------------------
+
+/// @brief How a single float is stored, Scaled codecs are given values divided by the largest magnitude in the texture
+template <typename S>
+struct ScalarCodec;
+
+/// @brief Plain float
+template <>
+struct ScalarCodec<float>
+{
+    enum { Scaled = false };
+    static float Encode(const float _v) { return _v; }
+    static float Decode(const float _s) { return _s; }
+};
+
+/// @brief Half float, about 3 significant digits over any range
+template <>
+struct ScalarCodec<Half>
+{
+    enum { Scaled = false };
+    static Half Encode(const float _v) { return FloatToHalf(_v); }
+    static float Decode(const Half _s) { return HalfToFloat(_s); }
+};
+
+/// @brief 8 bit normalised, [0:1] in steps of 1/255
+template <>
+struct ScalarCodec<unsigned char>
+{
+    enum { Scaled = true };
+    static unsigned char Encode(const float _v) { return (unsigned char)std::lrint(std::min(std::max(_v, 0.0f), 1.0f) * 255.0f); }
+    static float Decode(const unsigned char _s) { return _s * (1.0f / 255.0f); }
+};
+
+/// @brief 16 bit normalised, [0:1] in steps of 1/65535
+template <>
+struct ScalarCodec<unsigned short>
+{
+    enum { Scaled = true };
+    static unsigned short Encode(const float _v) { return (unsigned short)std::lrint(std::min(std::max(_v, 0.0f), 1.0f) * 65535.0f); }
+    static float Decode(const unsigned short _s) { return _s * (1.0f / 65535.0f); }
+};
+
+/// @brief 16 bit signed normalised, [-1:1] in steps of 1/32767
+template <>
+struct ScalarCodec<short>
+{
+    enum { Scaled = true };
+    static short Encode(const float _v) { return (short)std::lrint(std::min(std::max(_v, -1.0f), 1.0f) * 32767.0f); }
+    static float Decode(const short _s) { return std::max(_s * (1.0f / 32767.0f), -1.0f); }
+};
+
+//-------------------------------------------------------------------------------
+
+/// @brief How a texture stores values of type T as Storage. Encode and Decode take the texture's scale,
+/// the largest magnitude of its values for normalised storage and 1 otherwise.
+/// Unless specialised below values are stored as they are, Storage is T.
+template <typename T, typename Storage>
+struct TextureStorage
+{
+    static float Magnitude(const T &) { return 0.0f; }
+    static bool Scaled() { return false; }
+    static T Encode(const T &_v, const float) { return _v; }
+    static T Decode(const T &_s, const float) { return _s; }
+};
+
+/// @brief Floats stored through ScalarCodec<S>
+template <typename S>
+struct TextureStorage<float, S>
+{
+    static float Magnitude(const float &_v) { return std::fabs(_v); }
+    static bool Scaled() { return ScalarCodec<S>::Scaled; }
+    static S Encode(const float &_v, const float _scale) { return ScalarCodec<S>::Encode(_v / _scale); }
+    static float Decode(const S &_s, const float _scale) { return ScalarCodec<S>::Decode(_s) * _scale; }
+};
+
+/// @brief Vectors stored a component at a time through ScalarCodec<S>
+template <typename S>
+struct TextureStorage<glm::vec3, Vec3Storage<S> >
+{
+    static float Magnitude(const glm::vec3 &_v) { return std::max(std::fabs(_v.x), std::max(std::fabs(_v.y), std::fabs(_v.z))); }
+    static bool Scaled() { return ScalarCodec<S>::Scaled; }
+    static Vec3Storage<S> Encode(const glm::vec3 &_v, const float _scale)
+    {
+        Vec3Storage<S> s = {ScalarCodec<S>::Encode(_v.x / _scale), ScalarCodec<S>::Encode(_v.y / _scale), ScalarCodec<S>::Encode(_v.z / _scale)};
+        return s;
+    }
+    static glm::vec3 Decode(const Vec3Storage<S> &_s, const float _scale)
+    {
+        return glm::vec3(ScalarCodec<S>::Decode(_s.x), ScalarCodec<S>::Decode(_s.y), ScalarCodec<S>::Decode(_s.z)) * _scale;
+    }
+};
+
+
+#endif // TEXTURESTORAGE_H
@@ -0,0 +1,179 @@
+#ifndef FRAMEPIPELINE_H
+#define FRAMEPIPELINE_H
+
+//--------------------------------------------------------------------------------
+
+#include <memory>
+#include <utility>
+#include <future>
+#include <exception>
+#include <initializer_list>
+#include <functional>
+
+#include "Threading/threadpool.h"
+
+
+//--------------------------------------------------------------------------------
+/// @author Idris Miles
+/// @version 1.0
+/// @data 18/04/2017
+//--------------------------------------------------------------------------------
+
+
+/// @class FramePipeline
+/// @brief Overlaps three stages of consecutive frames.
+/// Each call to Advance runs the first stage of the new frame N+1 and the last stage of frame N-1 on the pool,
+/// while the middle stage of frame N runs on the calling thread, so OpenGL and CUDA interop work can stay on the thread that owns the context.
+/// A frame takes three calls to come out, but throughput is bounded by the slowest stage rather than the sum of all three.
+/// Stages of different frames run at the same time, so they must only share state that is read only or owned by a single stage.
+/// Frames are swapped in and out rather than copied, so passing the previously finished frame back in reuses its buffers.
+template<typename Frame>
+class FramePipeline
+{
+public:
+    typedef std::function<void(Frame &)> Stage;
+
+    /// @brief Constructor.
+    /// @param _first : stage run on the pool on newly pushed frames, for example evaluating the rig pose
+    /// @param _middle : stage run on the calling thread, for example skinning the mesh
+    /// @param _last : stage run on the pool on frames that have been through the middle stage, for example polygonising the iso surface
+    /// @param _pool : pool the first and last stages run on
+    FramePipeline(Stage _first, Stage _middle, Stage _last, ThreadPool &_pool = ThreadPool::Instance()) :
+        m_first(_first),
+        m_middle(_middle),
+        m_last(_last),
+        m_pool(_pool)
+    {
+    }
+
+    /// @brief Method to push a new frame in and move every frame in flight on by one stage.
+    /// Returns once all three stages have finished. Must not be called from inside a pool task.
+    /// @param _frame : the new frame
+    /// @param _finished : output, the frame that has been through all three stages
+    /// @return true if a frame came out of the pipeline
+    bool Advance(Frame _frame, Frame &_finished)
+    {
+        std::unique_ptr<Frame> incoming = std::move(m_spare);
+        if(incoming == nullptr)
+        {
+            incoming.reset(new Frame());
+        }
+        std::swap(*incoming, _frame);
+
+        return Step(std::move(incoming), _finished);
+    }
+
+    /// @brief Method to move the frames in flight on by one stage without pushing a new frame.
+    /// Call until it returns false to drain the pipeline.
+    /// @param _finished : output, the frame that has been through all three stages
+    /// @return true if a frame came out of the pipeline
+    bool Flush(Frame &_finished)
+    {
+        return Step(nullptr, _finished);
+    }
+
+    /// @brief Method to drop every frame in flight, for example when the scene changes.
+    void Reset()
+    {
+        m_firstDone = nullptr;
+        m_middleDone = nullptr;
+    }
+
+    /// @brief Method to check if any frame is still in flight.
+    bool Empty() const
+    {
+        return m_firstDone == nullptr && m_middleDone == nullptr;
+    }
+
+
+private:
+    /// @brief Method to run one step of the pipeline.
+    bool Step(std::unique_ptr<Frame> _incoming, Frame &_finished)
+    {
+        std::future<void> first;
+        std::future<void> last;
+
+        Frame *incoming = _incoming.get();
+        Frame *middleDone = m_middleDone.get();
+
+        if(incoming != nullptr)
+        {
+            first = m_pool.Submit([this, incoming](){ m_first(*incoming); });
+        }
+        if(middleDone != nullptr)
+        {
+            last = m_pool.Submit([this, middleDone](){ m_last(*middleDone); });
+        }
+
+        // The pool tasks reference frames owned here, so wait for both even if a stage throws
+        std::exception_ptr error;
+        try
+        {
+            if(m_firstDone != nullptr)
+            {
+                m_middle(*m_firstDone);
+            }
+        }
+        catch(...)
+        {
+            error = std::current_exception();
+        }
+
+        for(auto *stage : {&first, &last})
+        {
+            if(!stage->valid())
+            {
+                continue;
+            }
+
+            try
+            {
+                stage->get();
+            }
+            catch(...)
+            {
+                error = error ? error : std::current_exception();
+            }
+        }
+
+        if(error)
+        {
+            Reset();
+            std::rethrow_exception(error);
+        }
+
+        bool finished = (m_middleDone != nullptr);
+        if(finished)
+        {
+            std::swap(_finished, *m_middleDone);
+            m_spare = std::move(m_middleDone);
+        }
+
+        m_middleDone = std::move(m_firstDone);
+        m_firstDone = std::move(_incoming);
+
+        return finished;
+    }
+
+
+    /// @brief The three stages.
+    Stage m_first;
+    Stage m_middle;
+    Stage m_last;
+
+    /// @brief Pool the first and last stages run on.
+    ThreadPool &m_pool;
+
+    /// @brief Frame that has been through the first stage.
+    std::unique_ptr<Frame> m_firstDone;
+
+    /// @brief Frame that has been through the middle stage.
+    std::unique_ptr<Frame> m_middleDone;
+
+    /// @brief Finished frame slot kept for the next Advance.
+    std::unique_ptr<Frame> m_spare;
+};
+
+//--------------------------------------------------------------------------------
+
+#endif // FRAMEPIPELINE_H
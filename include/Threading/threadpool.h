@@ -0,0 +1,135 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+//--------------------------------------------------------------------------------
+
+#include <vector>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <future>
+#include <functional>
+#include <exception>
+
+
+//--------------------------------------------------------------------------------
+/// @author Idris Miles
+/// @version 1.0
+/// @data 18/04/2017
+//--------------------------------------------------------------------------------
+
+
+/// @class ThreadPool
+/// @brief A persistent work-stealing thread pool.
+/// Each worker owns a task deque, it pops its own newest task first and steals the oldest task
+/// from the other workers when it runs dry. ParallelFor also runs chunks on the calling thread,
+/// so nested calls from inside a task never wait on work that nobody can pick up.
+class ThreadPool
+{
+public:
+    /// @brief How ParallelFor splits its range into chunks.
+    /// Static : one equal chunk per thread, lowest overhead for uniform work.
+    /// Guided : chunks shrink as the remaining work shrinks, never below the grain size.
+    /// Dynamic : fixed chunks of the grain size, best for very uneven work.
+    enum class Schedule { Static, Guided, Dynamic };
+
+    /// @brief Constructor.
+    /// @param _numWorkers : number of worker threads, the calling thread of ParallelFor also does work.
+    ThreadPool(const unsigned int _numWorkers = DefaultNumWorkers());
+
+    /// @brief Destructor, finishes all queued tasks then joins the workers.
+    ~ThreadPool();
+
+    /// @brief Method to get the pool shared by the whole application.
+    static ThreadPool &Instance();
+
+    /// @brief Method to get the default number of workers, one less than the hardware threads.
+    static unsigned int DefaultNumWorkers();
+
+    /// @brief Method to change the number of workers, waits for queued tasks to finish first.
+    /// Must not be called from inside a task.
+    /// @param _numWorkers : new number of worker threads
+    void SetNumWorkers(const unsigned int _numWorkers);
+
+    /// @brief Method to get the number of worker threads.
+    unsigned int GetNumWorkers() const;
+
+    /// @brief Method to split [0:_dataSize) into chunks and run _func on each chunk across the pool and the calling thread.
+    /// Returns once every chunk has finished. If a chunk throws, the chunks not yet started are skipped
+    /// and the first exception is rethrown on the calling thread once nothing is running _func.
+    /// @param _func : function taking the start and end of a chunk
+    /// @param _dataSize : the number of elements to process
+    /// @param _schedule : how the range is split into chunks
+    /// @param _grainSize : the smallest chunk Guided and Dynamic will hand out
+    void ParallelFor(const std::function<void(int, int)> &_func,
+                     const int _dataSize,
+                     const Schedule _schedule = Schedule::Static,
+                     const int _grainSize = 1);
+
+    /// @brief Method to queue a task on the pool.
+    /// Waiting on the future from inside another task can deadlock if every worker is waiting.
+    /// @param _func : callable with no arguments
+    /// @return a future holding the result of _func
+    template<typename F>
+    auto Submit(F &&_func) -> std::future<decltype(_func())>
+    {
+        typedef decltype(_func()) ReturnType;
+        auto task = std::make_shared<std::packaged_task<ReturnType()>>(std::forward<F>(_func));
+        std::future<ReturnType> result = task->get_future();
+        Push([task](){ (*task)(); });
+        return result;
+    }
+
+
+private:
+    /// @struct WorkQueue
+    /// @brief A workers task deque.
+    struct WorkQueue
+    {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    /// @brief Method to start the workers.
+    void StartWorkers(const unsigned int _numWorkers);
+
+    /// @brief Method to finish queued tasks and join the workers.
+    void StopWorkers();
+
+    /// @brief Method run by each worker thread.
+    void WorkerLoop(const unsigned int _workerId);
+
+    /// @brief Method to queue a task, onto the callers own deque when called from a worker.
+    void Push(std::function<void()> _task);
+
+    /// @brief Method to take a task, from the back of _workerId's deque or else from the front of another deque.
+    bool Pop(const unsigned int _workerId, std::function<void()> &_task);
+
+    /// @brief The worker threads.
+    std::vector<std::thread> m_workers;
+
+    /// @brief One task deque per worker.
+    std::vector<std::unique_ptr<WorkQueue>> m_queues;
+
+    /// @brief Number of queued tasks that have not been picked up yet.
+    std::atomic<int> m_numPendingTasks;
+
+    /// @brief Round robin index for tasks pushed from outside the pool.
+    std::atomic<unsigned int> m_nextQueue;
+
+    /// @brief Mutex idle workers sleep on.
+    std::mutex m_sleepMutex;
+
+    /// @brief Condition variable idle workers sleep on.
+    std::condition_variable m_sleepCond;
+
+    /// @brief Flag telling workers to exit once the queues are empty.
+    bool m_stop;
+};
+
+//--------------------------------------------------------------------------------
+
+#endif // THREADPOOL_H
@@ -0,0 +1,113 @@
+#ifndef TRIPLEBUFFER_H
+#define TRIPLEBUFFER_H
+
+//--------------------------------------------------------------------------------
+
+#include <atomic>
+#include <cstdint>
+
+
+//--------------------------------------------------------------------------------
+/// @author Idris Miles
+/// @version 1.0
+/// @data 18/04/2017
+//--------------------------------------------------------------------------------
+
+
+/// @class TripleBuffer
+/// @brief Lock free handoff of the newest value from one producer thread to one consumer thread.
+/// The producer writes into its own slot and publishes it by swapping it with a shared slot, the consumer
+/// swaps the shared slot with its own when something new has been published. Neither side ever blocks,
+/// allocates or sees a half written value, and the consumer always gets the newest published value,
+/// older ones are simply overwritten.
+template<typename T>
+class TripleBuffer
+{
+public:
+    /// @brief Constructor.
+    TripleBuffer() :
+        m_shared(1),
+        m_writeIndex(0),
+        m_readIndex(2)
+    {
+    }
+
+    /// @brief Method to set every slot to _value and drop anything published, not thread safe.
+    /// Use this to size the slots up front so later writes do not allocate.
+    /// @param _value : initial value of all three slots
+    void Reset(const T &_value)
+    {
+        for(auto &buffer : m_buffers)
+        {
+            buffer = _value;
+        }
+
+        m_shared = 1;
+        m_writeIndex = 0;
+        m_readIndex = 2;
+    }
+
+    //--------------------------------------------------------------------
+    // Producer
+
+    /// @brief Method to get the slot the producer writes into, only the producer may touch it until Publish.
+    T &GetWriteBuffer()
+    {
+        return m_buffers[m_writeIndex];
+    }
+
+    /// @brief Method to publish the write slot and take the shared slot as the new write slot.
+    void Publish()
+    {
+        // release: the consumer must see the writes to the slot, acquire: the consumer has finished reading the slot we get back
+        uint8_t previous = m_shared.exchange(m_writeIndex | NewData, std::memory_order_acq_rel);
+        m_writeIndex = previous & IndexMask;
+    }
+
+    //--------------------------------------------------------------------
+    // Consumer
+
+    /// @brief Method to take the newest published value, if there is one.
+    /// @return true if the read slot changed
+    bool Update()
+    {
+        if((m_shared.load(std::memory_order_relaxed) & NewData) == 0)
+        {
+            return false;
+        }
+
+        uint8_t previous = m_shared.exchange(m_readIndex, std::memory_order_acq_rel);
+        m_readIndex = previous & IndexMask;
+        return true;
+    }
+
+    /// @brief Method to get the slot the consumer reads, it stays valid until the next Update.
+    const T &GetReadBuffer() const
+    {
+        return m_buffers[m_readIndex];
+    }
+
+
+private:
+    /// @brief Flag set on the shared index when it holds a value the consumer has not taken yet.
+    static const uint8_t NewData = 4;
+
+    /// @brief Mask of the slot index in the shared index.
+    static const uint8_t IndexMask = 3;
+
+    /// @brief The three slots.
+    T m_buffers[3];
+
+    /// @brief Index of the slot in the middle, plus the NewData flag.
+    std::atomic<uint8_t> m_shared;
+
+    /// @brief Index of the producers slot, only touched by the producer.
+    uint8_t m_writeIndex;
+
+    /// @brief Index of the consumers slot, only touched by the consumer.
+    uint8_t m_readIndex;
+};
+
+//--------------------------------------------------------------------------------
+
+#endif // TRIPLEBUFFER_H
@@ -27,6 +27,8 @@ SOURCES +=  src/*.cpp               \
             src/Machingcube/*.cpp   \
             src/MeshSampler/*.cpp   \
             src/Model/*.cpp         \
+            src/Threading/*.cpp     \
+            src/Texture/*.cpp       \
             src/GUI/*.cpp
 
 HEADERS  += include/ScalarField/*.h         \
@@ -34,6 +36,7 @@ HEADERS  += include/ScalarField/*.h         \
             include/Machingcube/*.h         \
             include/MeshSampler/*.h         \
             include/Model/*.h               \
+            include/Threading/*.h           \
             include/GUI/*.h                 \
             include/Texture/*.h
 
@@ -9,6 +9,26 @@ cd ../Texture3DCpu
 make clean
 make
 
+cd ../Threading
+make clean
+make
+
+cd ../Hrbf
+make clean
+make
+
+cd ../FieldCache
+make clean
+make
+
+cd ../FieldFunction
+make clean
+make
+
 cd ../bin
 ./TestMesh
-./TestTexture3DCpu
\ No newline at end of file
+./TestTexture3DCpu
+./TestThreading
+./TestHrbf
+./TestFieldCache
+./TestFieldFunction
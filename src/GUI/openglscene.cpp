@@ -49,8 +49,13 @@ std::shared_ptr<Model> OpenGLScene::AddModel(const std::string &_modelFile)
 
     if(m_initGL)
     {
+        auto model = std::shared_ptr<Model>(new Model());
+        if(!ModelLoader::LoadModel(_modelFile, model->GetMesh(), model->GetRigMesh(), model->GetRig()))
+        {
+            return nullptr;
+        }
+
         makeCurrent();
-        auto model = std::shared_ptr<Model>(ModelLoader::LoadModel(_modelFile));
         m_models.push_back(model);
         m_models.back()->Initialise();
         doneCurrent();
@@ -287,5 +292,13 @@ void OpenGLScene::keyPressEvent(QKeyEvent *event)
             model->ToggleSkinnedImplicitSurface();
         }
     }
+
+    if(event->key() == Qt::Key_Y)
+    {
+        for(auto &&model : m_models)
+        {
+            model->CycleDeformerBackend();
+        }
+    }
 }
 //-----------------------------------------------------------------------------------------------------
@@ -0,0 +1,173 @@
+#include "Model/cpudeformerbackend.h"
+#include "Model/implicitskincpukernels.h"
+#include "Threading/threadpool.h"
+
+
+//------------------------------------------------------------------------
+
+CpuDeformerBackend::CpuDeformerBackend(const bool _multithreaded):
+    m_multithreaded(_multithreaded),
+    m_meshData(nullptr),
+    m_globalField(nullptr),
+    m_initIsoValues(false)
+{
+}
+
+//------------------------------------------------------------------------------------------------
+
+CpuDeformerBackend::~CpuDeformerBackend()
+{
+}
+
+//------------------------------------------------------------------------------------------------
+
+std::string CpuDeformerBackend::GetName() const
+{
+    return m_multithreaded ? "cpu-mt" : "cpu";
+}
+
+//------------------------------------------------------------------------------------------------
+
+void CpuDeformerBackend::AttachMesh(const DeformerMeshData &_meshData, const BufferId _meshVBO, const BufferId _meshNBO)
+{
+    // The CPU backend deforms host side copies, the caller uploads them to any OpenGL buffers
+    (void)_meshVBO;
+    (void)_meshNBO;
+    m_meshData = &_meshData;
+    m_initIsoValues = false;
+
+    m_deformedMeshVerts = _meshData.origVerts;
+    m_deformedMeshNorms = _meshData.origNorms;
+    m_relaxedMeshVerts.resize(_meshData.numVerts);
+    m_origVertIso.assign(_meshData.numVerts, 0.0f);
+    m_vertIsoGrad.assign(_meshData.numVerts, glm::vec3(0.0f));
+    m_transforms = _meshData.restTransforms;
+}
+
+//------------------------------------------------------------------------------------------------
+
+void CpuDeformerBackend::AttachGlobalField(GlobalFieldFunction &_globalField)
+{
+    m_globalField = &_globalField;
+
+    if(m_meshData == nullptr || !_globalField.IsGlobalFieldInit())
+    {
+        return;
+    }
+
+    // Iso values are taken in the rest pose, evaluate with identity field transforms rather than resetting
+    // the field's own, which the model may be evaluating meanwhile
+    const std::vector<glm::mat4> restFieldTransforms(_globalField.GetFieldFuncs().size(), glm::mat4(1.0f));
+
+    ParallelFor([&, this](int startVert, int endVert){
+        isck::EvalGradGlobalField(&m_origVertIso[startVert], &m_vertIsoGrad[startVert], &m_meshData->origVerts[startVert],
+                                  endVert - startVert, *m_globalField, &restFieldTransforms);
+    }, m_meshData->numVerts);
+
+    m_initIsoValues = true;
+}
+
+//------------------------------------------------------------------------------------------------
+
+void CpuDeformerBackend::SetRigidTransforms(const std::vector<glm::mat4> &_transforms)
+{
+    m_transforms = _transforms;
+}
+
+//------------------------------------------------------------------------------------------------
+
+void CpuDeformerBackend::PerformLBWSkinning()
+{
+    if(m_meshData == nullptr)
+    {
+        return;
+    }
+
+    ParallelFor([this](int startVert, int endVert){
+        isck::LinearBlendWeightSkin(&m_deformedMeshVerts[0],
+                                    &m_meshData->origVerts[0],
+                                    &m_deformedMeshNorms[0],
+                                    &m_meshData->origNorms[0],
+                                    &m_transforms[0],
+                                    &m_meshData->boneIds[0],
+                                    &m_meshData->weights[0],
+                                    startVert,
+                                    endVert);
+    }, m_meshData->numVerts);
+}
+
+//------------------------------------------------------------------------------------------------
+
+void CpuDeformerBackend::PerformImplicitSkinning(const float _sigma, const float _contactAngle, const int _iterations)
+{
+    if(m_meshData == nullptr || !m_initIsoValues)
+    {
+        return;
+    }
+
+    for(int i=0; i<_iterations; i++)
+    {
+        ParallelFor([&, this](int startVert, int endVert){
+            isck::VertexProjection(&m_deformedMeshVerts[0], &m_origVertIso[0], &m_vertIsoGrad[0],
+                                   *m_globalField, _sigma, _contactAngle,
+                                   startVert, endVert);
+        }, m_meshData->numVerts);
+
+        ParallelFor([this](int startVert, int endVert){
+            isck::TangentialRelaxation(&m_relaxedMeshVerts[0], &m_deformedMeshVerts[0], &m_origVertIso[0], &m_vertIsoGrad[0],
+                                       *m_globalField,
+                                       &m_meshData->oneRingIds[0], &m_meshData->centroidWeights[0], &m_meshData->oneRingScatterAddr[0],
+                                       startVert, endVert);
+        }, m_meshData->numVerts);
+
+        m_deformedMeshVerts.swap(m_relaxedMeshVerts);
+    }
+}
+
+//------------------------------------------------------------------------------------------------
+
+void CpuDeformerBackend::EvalGlobalField(std::vector<float> &_output, const std::vector<glm::vec3> &_samplePoints)
+{
+    if(m_globalField == nullptr)
+    {
+        return;
+    }
+
+    // Each chunk is looked up a batch at a time
+    auto threadFunc = [&, this](int startChunk, int endChunk){
+        m_globalField->EvalBatch(&_samplePoints[startChunk], endChunk - startChunk, &_output[startChunk]);
+    };
+
+    // Evalue field in each thread
+    ParallelFor(threadFunc, _samplePoints.size());
+}
+
+//------------------------------------------------------------------------------------------------
+
+const std::vector<glm::vec3> &CpuDeformerBackend::GetDeformedMeshVerts()
+{
+    return m_deformedMeshVerts;
+}
+
+//------------------------------------------------------------------------------------------------
+
+const std::vector<glm::vec3> &CpuDeformerBackend::GetDeformedMeshNorms()
+{
+    return m_deformedMeshNorms;
+}
+
+//------------------------------------------------------------------------------------------------
+
+void CpuDeformerBackend::ParallelFor(const std::function<void(int, int)> &_threadFunc, const int _dataSize)
+{
+    if(!m_multithreaded)
+    {
+        _threadFunc(0, _dataSize);
+        return;
+    }
+
+    // Field evaluation cost varies with how many fields overlap a vertex, so let idle threads take more
+    ThreadPool::Instance().ParallelFor(_threadFunc, _dataSize, ThreadPool::Schedule::Guided, 64);
+}
+
+//------------------------------------------------------------------------------------------------
@@ -0,0 +1,444 @@
+#include "Model/cudadeformerbackend.h"
+#include "ImplicitSkinGpuWrapper.h"
+#include "helper_cuda.h"
+
+
+//------------------------------------------------------------------------
+
+CudaDeformerBackend::CudaDeformerBackend():
+    m_useMeshBuffers(false),
+    m_deformedMeshVertsMapped(false),
+    m_deformedMeshNormsMapped(false),
+    m_initMeshCudaMem(false),
+    m_initFieldCudaMem(false),
+    m_numVerts(0),
+    m_numFields(0),
+    m_numCompOps(0),
+    m_numCompFields(0),
+    m_numTransforms(0)
+{
+    checkCudaErrors(cudaSetDevice(0));
+}
+
+//------------------------------------------------------------------------------------------------
+
+CudaDeformerBackend::~CudaDeformerBackend()
+{
+    DestroyMeshCudaMem();
+
+    DestroyFieldCudaMem();
+}
+
+//------------------------------------------------------------------------------------------------
+
+bool CudaDeformerBackend::IsAvailable()
+{
+    int numDevices = 0;
+    if(cudaGetDeviceCount(&numDevices) == cudaSuccess && numDevices > 0)
+    {
+        return true;
+    }
+
+    // clear the error left by a missing driver or device
+    cudaGetLastError();
+    return false;
+}
+
+//------------------------------------------------------------------------------------------------
+
+std::string CudaDeformerBackend::GetName() const
+{
+    return "cuda";
+}
+
+//------------------------------------------------------------------------------------------------
+
+void CudaDeformerBackend::AttachMesh(const DeformerMeshData &_meshData, const BufferId _meshVBO, const BufferId _meshNBO)
+{
+    InitMeshCudaMem(_meshData, _meshVBO, _meshNBO);
+}
+
+//------------------------------------------------------------------------------------------------
+
+void CudaDeformerBackend::AttachGlobalField(GlobalFieldFunction &_globalField)
+{
+    InitFieldCudaMem(_globalField);
+    InitialiseIsoValues();
+}
+
+//------------------------------------------------------------------------------------------------
+
+void CudaDeformerBackend::SetRigidTransforms(const std::vector<glm::mat4> &_transforms)
+{
+    if(m_initMeshCudaMem)
+    {
+        m_numTransforms = _transforms.size();
+        checkCudaErrors(cudaMemcpy((void*)d_transformPtr, &_transforms[0][0][0], m_numTransforms * sizeof(glm::mat4), cudaMemcpyHostToDevice));
+    }
+}
+
+//------------------------------------------------------------------------------------------------
+
+void CudaDeformerBackend::PerformLBWSkinning()
+{
+
+    if(!m_initMeshCudaMem)
+    {
+        return;
+    }
+
+
+    isgw::LinearBlendWeightSkin(GetDeformedMeshVertsDevicePtr(),
+                                   d_origMeshVertsPtr,
+                                   GetDeformedMeshNormsDevicePtr(),
+                                   d_origMeshNormsPtr,
+                                   d_transformPtr,
+                                   d_boneIdPtr,
+                                   d_weightPtr,
+                                   m_numVerts,
+                                   m_numTransforms);
+
+
+    cudaThreadSynchronize();
+    getLastCudaError("LinearBlendWeightSkin Failed");
+
+
+    // release cuda resources so openGL can render
+    ReleaseDeformedMeshVertsDevicePtr();
+    ReleaseDeformedMeshNormsDevicePtr();
+}
+
+//------------------------------------------------------------------------------------------------
+
+void CudaDeformerBackend::PerformImplicitSkinning(const float _sigma, const float _contactAngle, const int _iterations)
+{
+    if(!m_initMeshCudaMem || !m_initFieldCudaMem)
+    {
+        return;
+    }
+
+
+    isgw::SimpleImplicitSkin(GetDeformedMeshVertsDevicePtr(), GetDeformedMeshNormsDevicePtr(), d_origVertIsoPtr, d_vertIsoGradPtr, m_numVerts,
+                             d_textureSpacePtr, d_transformPtr, d_fieldsPtr, m_numFields,
+                             d_compOpPtr, d_thetaPtr, m_numCompOps, d_compFieldPtr, m_numCompFields,
+                             d_oneRingIdPtr, d_centroidWeightsPtr, d_oneRingScatterAddrPtr,
+                             _sigma, _contactAngle, _iterations);
+
+
+
+    cudaThreadSynchronize();
+    getLastCudaError("Implicit Skinning Failed");
+
+
+    // release cuda resources so openGL can render
+    ReleaseDeformedMeshVertsDevicePtr();
+    ReleaseDeformedMeshNormsDevicePtr();
+}
+
+//------------------------------------------------------------------------------------------------
+
+void CudaDeformerBackend::EvalGlobalField(std::vector<float> &_output, const std::vector<glm::vec3> &_samplePoints)
+{
+    if(!m_initMeshCudaMem || !m_initFieldCudaMem || _samplePoints.empty())
+    {
+        return;
+    }
+
+    // allocate device memory
+    float *d_output;
+    glm::vec3 *d_samplePoints;
+    checkCudaErrors(cudaMalloc(&d_output, _samplePoints.size() * sizeof(float)));
+    checkCudaErrors(cudaMalloc(&d_samplePoints, _samplePoints.size() * sizeof(glm::vec3)));
+
+    // upload data to device
+    checkCudaErrors(cudaMemcpy((void*)d_samplePoints, &_samplePoints[0], _samplePoints.size() * sizeof(glm::vec3), cudaMemcpyHostToDevice));
+
+    // run kernel
+    isgw::EvalGlobalField(d_output, d_samplePoints, _samplePoints.size(), d_textureSpacePtr, d_transformPtr, d_fieldsPtr, m_numFields, d_compOpPtr, d_thetaPtr, m_numCompOps, d_compFieldPtr, m_numCompFields);
+    getLastCudaError("isgw::EvalGlobalField");
+
+    // download data to host
+    checkCudaErrors(cudaMemcpy(&_output[0], d_output, _samplePoints.size() * sizeof(float), cudaMemcpyDeviceToHost));
+
+    // free memory
+    checkCudaErrors(cudaFree(d_output));
+    checkCudaErrors(cudaFree(d_samplePoints));
+}
+
+//------------------------------------------------------------------------------------------------
+
+const std::vector<glm::vec3> &CudaDeformerBackend::GetDeformedMeshVerts()
+{
+    if(m_initMeshCudaMem)
+    {
+        m_deformedMeshVerts.resize(m_numVerts);
+        checkCudaErrors(cudaMemcpy(&m_deformedMeshVerts[0], GetDeformedMeshVertsDevicePtr(), m_numVerts * sizeof(glm::vec3), cudaMemcpyDeviceToHost));
+        ReleaseDeformedMeshVertsDevicePtr();
+    }
+
+    return m_deformedMeshVerts;
+}
+
+//------------------------------------------------------------------------------------------------
+
+const std::vector<glm::vec3> &CudaDeformerBackend::GetDeformedMeshNorms()
+{
+    if(m_initMeshCudaMem)
+    {
+        m_deformedMeshNorms.resize(m_numVerts);
+        checkCudaErrors(cudaMemcpy(&m_deformedMeshNorms[0], GetDeformedMeshNormsDevicePtr(), m_numVerts * sizeof(glm::vec3), cudaMemcpyDeviceToHost));
+        ReleaseDeformedMeshNormsDevicePtr();
+    }
+
+    return m_deformedMeshNorms;
+}
+
+//------------------------------------------------------------------------------------------------
+
+bool CudaDeformerBackend::DeformsMeshBuffers() const
+{
+    return m_useMeshBuffers;
+}
+
+//------------------------------------------------------------------------------------------------
+
+bool CudaDeformerBackend::SamplesGpuTextures() const
+{
+    return true;
+}
+
+//------------------------------------------------------------------------------------------------
+
+void CudaDeformerBackend::InitialiseIsoValues()
+{
+    if(!m_initFieldCudaMem || !m_initMeshCudaMem)
+    {
+        return;
+    }
+
+    std::cout<<"init iso\n";
+    // allocate and initialise temporary device memory
+    std::vector<glm::mat4> tmpTransform(m_numTransforms, glm::mat4(1.0f));
+    glm::mat4 * d_tmpTransform;
+    checkCudaErrors(cudaMalloc(&d_tmpTransform, m_numTransforms * sizeof(glm::mat4)));
+    checkCudaErrors(cudaMemcpy(d_tmpTransform, &tmpTransform[0][0][0], m_numTransforms * sizeof(glm::mat4), cudaMemcpyHostToDevice));
+
+
+    // run kernel
+    isgw::EvalGradGlobalField(d_origVertIsoPtr, d_vertIsoGradPtr, d_origMeshVertsPtr, m_numVerts, d_textureSpacePtr, d_tmpTransform, d_fieldsPtr, m_numFields, d_compOpPtr, d_thetaPtr, m_numCompOps, d_compFieldPtr, m_numCompFields);
+    getLastCudaError("isgw::EvalGradGlobalField");
+
+
+    // free temporary device memory
+    checkCudaErrors(cudaFree(d_tmpTransform));
+}
+
+//------------------------------------------------------------------------------------------------
+
+void CudaDeformerBackend::InitMeshCudaMem(const DeformerMeshData &_meshData,
+                                          const BufferId _meshVBO,
+                                          const BufferId _meshNBO)
+{
+
+    if(m_initMeshCudaMem) { return; }
+
+    std::cout<<"init mesh cuda\n";
+
+    m_numVerts = _meshData.numVerts;
+    m_numTransforms = _meshData.restTransforms.size();
+    m_useMeshBuffers = (_meshVBO != 0 && _meshNBO != 0);
+
+    if(m_useMeshBuffers)
+    {
+        // Register vertex buffer with CUDA
+        checkCudaErrors(cudaGraphicsGLRegisterBuffer(&m_meshVBO_CUDA, _meshVBO, cudaGraphicsMapFlagsWriteDiscard));
+        checkCudaErrors(cudaGraphicsGLRegisterBuffer(&m_meshNBO_CUDA, _meshNBO, cudaGraphicsMapFlagsWriteDiscard));
+    }
+    else
+    {
+        // No OpenGL context, deform into plain device memory
+        checkCudaErrorsMsg(cudaMalloc(&d_deformedMeshVertsPtr,  m_numVerts * sizeof(glm::vec3)),  "Allocate memory for deformed mesh verts");
+        checkCudaErrorsMsg(cudaMalloc(&d_deformedMeshNormsPtr,  m_numVerts * sizeof(glm::vec3)),  "Allocate memory for deformed mesh normals");
+        checkCudaErrors(cudaMemcpy((void*)d_deformedMeshVertsPtr, (void*)&_meshData.origVerts[0], m_numVerts * sizeof(glm::vec3), cudaMemcpyHostToDevice));
+        checkCudaErrors(cudaMemcpy((void*)d_deformedMeshNormsPtr, (void*)&_meshData.origNorms[0], m_numVerts * sizeof(glm::vec3), cudaMemcpyHostToDevice));
+    }
+
+
+    // Allocate cuda memory
+    checkCudaErrorsMsg(cudaMalloc(&d_origMeshVertsPtr,  m_numVerts * sizeof(glm::vec3)),          "Allocate memory for original mesh verts");
+    checkCudaErrorsMsg(cudaMalloc(&d_origMeshNormsPtr,  m_numVerts * sizeof(glm::vec3)),          "Allocate memory for original mesh normals");
+    checkCudaErrorsMsg(cudaMalloc(&d_origVertIsoPtr,    m_numVerts * sizeof(float)),          "Allocate memory for original vert iso values");
+    checkCudaErrorsMsg(cudaMalloc(&d_vertIsoGradPtr,    m_numVerts * sizeof(glm::vec3)),          "Allocate memory for new vert iso Grad values");
+    checkCudaErrorsMsg(cudaMalloc(&d_transformPtr,      m_numTransforms * sizeof(glm::mat4)),  "Allocate memory for transforms");
+    checkCudaErrorsMsg(cudaMalloc(&d_boneIdPtr,         m_numVerts * 4 * sizeof(unsigned int)),     "Allocate memory for bone Ids");
+    checkCudaErrorsMsg(cudaMalloc(&d_weightPtr,         m_numVerts * 4 * sizeof(float)),            "Allocate memory for bone weights");
+    checkCudaErrorsMsg(cudaMalloc(&d_oneRingIdPtr,      _meshData.oneRingIds.size() * sizeof(int)),     "Allocate memory for one ring ids");
+    checkCudaErrorsMsg(cudaMalloc(&d_centroidWeightsPtr,   _meshData.centroidWeights.size() * sizeof(float)), "Allocate memory for one ring centroid weights");
+    checkCudaErrorsMsg(cudaMalloc(&d_oneRingScatterAddrPtr, (m_numVerts+1) * sizeof(int)),      "Allocate memory for one ring scatter address");
+
+
+    // copy memory over to cuda, the one ring and centroid weights are built once on the host by the deformer
+    checkCudaErrors(cudaMemcpy((void*)d_origMeshVertsPtr, (void*)&_meshData.origVerts[0], m_numVerts * sizeof(glm::vec3), cudaMemcpyHostToDevice));
+    checkCudaErrors(cudaMemcpy((void*)d_origMeshNormsPtr, (void*)&_meshData.origNorms[0], m_numVerts * sizeof(glm::vec3), cudaMemcpyHostToDevice));
+    checkCudaErrors(cudaMemcpy((void*)d_transformPtr, (void*)&_meshData.restTransforms[0][0][0], m_numTransforms * sizeof(glm::mat4), cudaMemcpyHostToDevice));
+    checkCudaErrors(cudaMemcpy((void*)d_boneIdPtr, (void*)&_meshData.boneIds[0], m_numVerts *4* sizeof(unsigned int), cudaMemcpyHostToDevice));
+    checkCudaErrors(cudaMemcpy((void*)d_weightPtr, (void*)&_meshData.weights[0], m_numVerts *4* sizeof(float), cudaMemcpyHostToDevice));
+    checkCudaErrors(cudaMemcpy((void*)d_oneRingIdPtr, (void*)&_meshData.oneRingIds[0], _meshData.oneRingIds.size() * sizeof(int), cudaMemcpyHostToDevice));
+    checkCudaErrors(cudaMemcpy((void*)d_centroidWeightsPtr, (void*)&_meshData.centroidWeights[0], _meshData.centroidWeights.size() * sizeof(float), cudaMemcpyHostToDevice));
+    checkCudaErrors(cudaMemcpy((void*)d_oneRingScatterAddrPtr, (void*)&_meshData.oneRingScatterAddr[0], (m_numVerts+1) * sizeof(int), cudaMemcpyHostToDevice));
+
+
+    m_initMeshCudaMem = true;
+}
+
+//------------------------------------------------------------------------------------------------
+
+void CudaDeformerBackend::InitFieldCudaMem(GlobalFieldFunction &_globalField)
+{
+    if(!_globalField.IsGlobalFieldInit() || m_initFieldCudaMem) { return; }
+
+    std::cout<<"init field cuda\n";
+
+    auto fieldFuncs = _globalField.GetFieldFuncs();
+    auto compOps = _globalField.GetCompOps();
+    auto compFields = _globalField.GetCompFieldsCuda();
+
+    // create device memory here
+    m_numFields = fieldFuncs.size();
+    m_numCompOps = compOps.size();
+    m_numCompFields = compFields.size();
+
+    // allocate memory
+    checkCudaErrors(cudaMalloc(&d_textureSpacePtr, m_numFields * sizeof(glm::mat4)));
+    checkCudaErrors(cudaMalloc(&d_fieldsPtr, m_numFields * sizeof(cudaTextureObject_t)));
+    checkCudaErrors(cudaMalloc(&d_compOpPtr, m_numCompOps * sizeof(cudaTextureObject_t)));
+    checkCudaErrors(cudaMalloc(&d_thetaPtr, m_numCompOps * sizeof(cudaTextureObject_t)));
+    checkCudaErrors(cudaMalloc(&d_compFieldPtr, m_numCompFields * sizeof(ComposedFieldCuda)));
+
+    // upload data
+    std::vector<glm::mat4> texSpaceTrans(m_numFields);
+    for(uint i=0; i<m_numFields; ++i)
+    {
+        texSpaceTrans[i] = fieldFuncs[i]->GetTextureSpaceTransform();
+        auto fieldTex = fieldFuncs[i]->GetFieldFuncCudaTextureObject();
+        cudaMemcpy(d_fieldsPtr+i, &fieldTex, 1*sizeof(cudaTextureObject_t), cudaMemcpyHostToDevice);
+    }
+    for(uint i=0; i<m_numCompOps; ++i)
+    {
+        auto compOpTex = compOps[i]->GetFieldFunc3DTexture();
+        auto thetaTex = compOps[i]->GetThetaTexture();
+        cudaMemcpy(d_compOpPtr+i, &compOpTex, 1*sizeof(cudaTextureObject_t), cudaMemcpyHostToDevice);
+        cudaMemcpy(d_thetaPtr+i, &thetaTex, 1*sizeof(cudaTextureObject_t), cudaMemcpyHostToDevice);
+    }
+    for(uint i=0; i<m_numCompFields; ++i)
+    {
+        auto cf = compFields[i];
+        cudaMemcpy(d_compFieldPtr+i, &cf, 1*sizeof(ComposedFieldCuda), cudaMemcpyHostToDevice);
+    }
+    checkCudaErrors(cudaMemcpy((void*)d_textureSpacePtr, &texSpaceTrans[0][0][0], texSpaceTrans.size() * sizeof(glm::mat4), cudaMemcpyHostToDevice));
+
+    m_initFieldCudaMem = true;
+}
+
+//------------------------------------------------------------------------------------------------
+
+void CudaDeformerBackend::DestroyMeshCudaMem()
+{
+    if(m_initMeshCudaMem)
+    {
+        if(m_useMeshBuffers)
+        {
+            checkCudaErrors(cudaGraphicsUnregisterResource(m_meshVBO_CUDA));
+            checkCudaErrors(cudaGraphicsUnregisterResource(m_meshNBO_CUDA));
+        }
+        else
+        {
+            checkCudaErrors(cudaFree(d_deformedMeshVertsPtr));
+            checkCudaErrors(cudaFree(d_deformedMeshNormsPtr));
+        }
+        checkCudaErrors(cudaFree(d_origMeshVertsPtr));
+        checkCudaErrors(cudaFree(d_origMeshNormsPtr));
+        checkCudaErrors(cudaFree(d_origVertIsoPtr));
+        checkCudaErrors(cudaFree(d_vertIsoGradPtr));
+        checkCudaErrors(cudaFree(d_transformPtr));
+        checkCudaErrors(cudaFree(d_boneIdPtr));
+        checkCudaErrors(cudaFree(d_weightPtr));
+        checkCudaErrors(cudaFree(d_oneRingIdPtr));
+        checkCudaErrors(cudaFree(d_centroidWeightsPtr));
+        checkCudaErrors(cudaFree(d_oneRingScatterAddrPtr));
+
+        m_initMeshCudaMem = false;
+    }
+}
+
+//------------------------------------------------------------------------------------------------
+
+void CudaDeformerBackend::DestroyFieldCudaMem()
+{
+    if(m_initFieldCudaMem)
+    {
+        checkCudaErrors(cudaFree(d_textureSpacePtr));
+        checkCudaErrors(cudaFree(d_fieldsPtr));
+        checkCudaErrors(cudaFree(d_compOpPtr));
+        checkCudaErrors(cudaFree(d_thetaPtr));
+        checkCudaErrors(cudaFree(d_compFieldPtr));
+
+        m_initFieldCudaMem = false;
+    }
+}
+
+//------------------------------------------------------------------------------------------------
+
+glm::vec3 *CudaDeformerBackend::GetDeformedMeshVertsDevicePtr()
+{
+    if(m_useMeshBuffers && !m_deformedMeshVertsMapped)
+    {
+        size_t numBytes;
+        checkCudaErrors(cudaGraphicsMapResources(1, &m_meshVBO_CUDA, 0));
+        checkCudaErrors(cudaGraphicsResourceGetMappedPointer((void **)&d_deformedMeshVertsPtr, &numBytes, m_meshVBO_CUDA));
+
+        m_deformedMeshVertsMapped = true;
+    }
+
+    return d_deformedMeshVertsPtr;
+}
+
+//------------------------------------------------------------------------------------------------
+
+void CudaDeformerBackend::ReleaseDeformedMeshVertsDevicePtr()
+{
+    if(m_deformedMeshVertsMapped)
+    {
+        checkCudaErrors(cudaGraphicsUnmapResources(1, &m_meshVBO_CUDA, 0));
+        m_deformedMeshVertsMapped = false;
+    }
+}
+
+//------------------------------------------------------------------------------------------------
+
+glm::vec3 *CudaDeformerBackend::GetDeformedMeshNormsDevicePtr()
+{
+    if(m_useMeshBuffers && !m_deformedMeshNormsMapped)
+    {
+        size_t numBytes;
+        checkCudaErrors(cudaGraphicsMapResources(1, &m_meshNBO_CUDA, 0));
+        checkCudaErrors(cudaGraphicsResourceGetMappedPointer((void **)&d_deformedMeshNormsPtr, &numBytes, m_meshNBO_CUDA));
+
+        m_deformedMeshNormsMapped = true;
+    }
+
+    return d_deformedMeshNormsPtr;
+}
+
+//------------------------------------------------------------------------------------------------
+
+void CudaDeformerBackend::ReleaseDeformedMeshNormsDevicePtr()
+{
+    if(m_deformedMeshNormsMapped)
+    {
+        checkCudaErrors(cudaGraphicsUnmapResources(1, &m_meshNBO_CUDA, 0));
+        m_deformedMeshNormsMapped = false;
+    }
+}
+
+//------------------------------------------------------------------------------------------------
@@ -0,0 +1,123 @@
+#include "Model/deformerbackendregistry.h"
+#include "Model/cpudeformerbackend.h"
+#ifndef NO_CUDA
+#include "Model/cudadeformerbackend.h"
+#endif
+#include "Threading/threadpool.h"
+
+#include <iostream>
+#include <algorithm>
+
+
+//------------------------------------------------------------------------
+
+DeformerBackendRegistry &DeformerBackendRegistry::Instance()
+{
+    static DeformerBackendRegistry registry;
+    return registry;
+}
+
+//------------------------------------------------------------------------------------------------
+
+DeformerBackendRegistry::DeformerBackendRegistry()
+{
+#ifndef NO_CUDA
+    Register("cuda", 100,
+             [](){ return std::unique_ptr<DeformerBackend>(new CudaDeformerBackend()); },
+             [](){ return CudaDeformerBackend::IsAvailable(); });
+#endif
+
+    Register("cpu-mt", 50,
+             [](){ return std::unique_ptr<DeformerBackend>(new CpuDeformerBackend(true)); },
+             [](){ return ThreadPool::Instance().GetNumWorkers() > 0; });
+
+    Register("cpu", 10,
+             [](){ return std::unique_ptr<DeformerBackend>(new CpuDeformerBackend(false)); },
+             [](){ return true; });
+}
+
+//------------------------------------------------------------------------------------------------
+
+void DeformerBackendRegistry::Register(const std::string &_name, const int _priority, Factory _factory, AvailabilityCheck _isAvailable)
+{
+    m_entries.erase(std::remove_if(m_entries.begin(), m_entries.end(), [&_name](const Entry &e){ return e.name == _name; }),
+                    m_entries.end());
+
+    Entry entry;
+    entry.name = _name;
+    entry.priority = _priority;
+    entry.factory = _factory;
+    entry.isAvailable = _isAvailable;
+
+    auto it = std::find_if(m_entries.begin(), m_entries.end(), [_priority](const Entry &e){ return e.priority < _priority; });
+    m_entries.insert(it, entry);
+}
+
+//------------------------------------------------------------------------------------------------
+
+std::unique_ptr<DeformerBackend> DeformerBackendRegistry::Create(const std::string &_name) const
+{
+    for(auto &entry : m_entries)
+    {
+        if(entry.name == _name)
+        {
+            if(!entry.isAvailable())
+            {
+                std::cout<<"Deformer backend "<<_name<<" is not available on this machine\n";
+                return nullptr;
+            }
+            return entry.factory();
+        }
+    }
+
+    std::cout<<"Unknown deformer backend "<<_name<<"\n";
+    return nullptr;
+}
+
+//------------------------------------------------------------------------------------------------
+
+std::unique_ptr<DeformerBackend> DeformerBackendRegistry::CreateFastestAvailable() const
+{
+    for(auto &entry : m_entries)
+    {
+        if(entry.isAvailable())
+        {
+            return entry.factory();
+        }
+    }
+
+    return nullptr;
+}
+
+//------------------------------------------------------------------------------------------------
+
+bool DeformerBackendRegistry::IsAvailable(const std::string &_name) const
+{
+    for(auto &entry : m_entries)
+    {
+        if(entry.name == _name)
+        {
+            return entry.isAvailable();
+        }
+    }
+
+    return false;
+}
+
+//------------------------------------------------------------------------------------------------
+
+std::vector<std::string> DeformerBackendRegistry::GetAvailableBackends() const
+{
+    std::vector<std::string> names;
+    for(auto &entry : m_entries)
+    {
+        if(entry.isAvailable())
+        {
+            names.push_back(entry.name);
+        }
+    }
+
+    return names;
+}
+
+//------------------------------------------------------------------------------------------------
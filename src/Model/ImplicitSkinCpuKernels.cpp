@@ -0,0 +1,318 @@
+#include "Model/implicitskincpukernels.h"
+
+#include <algorithm>
+#include <float.h>
+#include <math.h>
+#include <vector>
+
+#include <glm/gtx/vector_angle.hpp>
+
+
+/// @brief Sample points per GlobalFieldFunction::EvalBatch in the batched EvalGradGlobalField,
+/// their 4 forward difference points fill one of the global field's batches
+static const int EvalGradBatchSize = 64;
+
+
+//------------------------------------------------------------------------------------------------
+
+glm::vec3 isck::ProjectPointOnToPlane(const glm::vec3 &_point, const glm::vec3 &_planeOrigin, const glm::vec3 &_planeNormal)
+{
+    return (_point - (glm::dot(_point - _planeOrigin, _planeNormal) * _planeNormal));
+}
+
+//------------------------------------------------------------------------------------------------
+
+void isck::EvalGradGlobalField(float &_outputF,
+                               glm::vec3 &_outputG,
+                               const glm::vec3 &_samplePoint,
+                               GlobalFieldFunction &_globalField)
+{
+    // Same step as isgw so both paths converge to the same surface
+    float h = 60.0f / 64.0f;
+
+    float f = _globalField.Eval(_samplePoint);
+    float x2 = _globalField.Eval(_samplePoint + glm::vec3(h, 0.0f, 0.0f));
+    float y2 = _globalField.Eval(_samplePoint + glm::vec3(0.0f, h, 0.0f));
+    float z2 = _globalField.Eval(_samplePoint + glm::vec3(0.0f, 0.0f, h));
+
+    _outputF = f;
+    _outputG = glm::vec3((x2-f)/h, (y2-f)/h, (z2-f)/h);
+}
+
+//------------------------------------------------------------------------------------------------
+
+void isck::EvalGradGlobalField(float *_outputF,
+                               glm::vec3 *_outputG,
+                               const glm::vec3 *_samplePoints,
+                               const int _numPoints,
+                               GlobalFieldFunction &_globalField,
+                               const std::vector<glm::mat4> *_fieldTransforms)
+{
+    float h = 60.0f / 64.0f;
+
+    // Each sample point followed by its x, y and z steps
+    glm::vec3 points[4 * EvalGradBatchSize];
+    float f[4 * EvalGradBatchSize];
+    for(int start=0; start<_numPoints; start+=EvalGradBatchSize)
+    {
+        int count = std::min(_numPoints - start, EvalGradBatchSize);
+        for(int i=0; i<count; i++)
+        {
+            const glm::vec3 &x = _samplePoints[start + i];
+            points[(i*4) + 0] = x;
+            points[(i*4) + 1] = x + glm::vec3(h, 0.0f, 0.0f);
+            points[(i*4) + 2] = x + glm::vec3(0.0f, h, 0.0f);
+            points[(i*4) + 3] = x + glm::vec3(0.0f, 0.0f, h);
+        }
+
+        if(_fieldTransforms != nullptr)
+        {
+            _globalField.EvalBatch(points, count * 4, *_fieldTransforms, f);
+        }
+        else
+        {
+            _globalField.EvalBatch(points, count * 4, f);
+        }
+
+        for(int i=0; i<count; i++)
+        {
+            float f0 = f[(i*4) + 0];
+            _outputF[start + i] = f0;
+            _outputG[start + i] = glm::vec3((f[(i*4) + 1]-f0)/h, (f[(i*4) + 2]-f0)/h, (f[(i*4) + 3]-f0)/h);
+        }
+    }
+}
+
+//------------------------------------------------------------------------------------------------
+
+void isck::LinearBlendWeightSkin(glm::vec3 *_deformedVert,
+                                 const glm::vec3 *_origVert,
+                                 glm::vec3 *_deformedNorms,
+                                 const glm::vec3 *_origNorms,
+                                 const glm::mat4 *_transform,
+                                 const unsigned int *_boneId,
+                                 const float *_weight,
+                                 const int _startVert,
+                                 const int _endVert)
+{
+    for(int v=_startVert; v<_endVert; v++)
+    {
+        glm::mat4 boneTransform = glm::mat4(0.0f);
+
+        for(int i=0; i<4; i++)
+        {
+            unsigned int boneId = _boneId[(v*4) + i];
+            float w = _weight[(v*4) + i];
+            boneTransform += (_transform[boneId] * w);
+        }
+
+        _deformedVert[v] = glm::vec3(boneTransform * glm::vec4(_origVert[v], 1.0f));
+        _deformedNorms[v] = glm::transpose(glm::inverse(glm::mat3(boneTransform))) * _origNorms[v];
+    }
+}
+
+//------------------------------------------------------------------------------------------------
+
+void isck::VertexProjection(glm::vec3 *_deformedVert,
+                            const float *_origIsoValue,
+                            glm::vec3 *_prevIsoGrad,
+                            GlobalFieldFunction &_globalField,
+                            const float _sigma,
+                            const float _contactAngle,
+                            const int _startVert,
+                            const int _endVert)
+{
+    float newIsoValues[EvalGradBatchSize];
+    glm::vec3 newGrads[EvalGradBatchSize];
+    for(int startChunk=_startVert; startChunk<_endVert; startChunk+=EvalGradBatchSize)
+    {
+        int endChunk = std::min(startChunk + EvalGradBatchSize, _endVert);
+        EvalGradGlobalField(newIsoValues, newGrads, _deformedVert + startChunk, endChunk - startChunk, _globalField);
+
+        for(int v=startChunk; v<endChunk; v++)
+        {
+            glm::vec3 deformedVert = _deformedVert[v];
+            float origIsoValue = _origIsoValue[v];
+            glm::vec3 prevGrad = _prevIsoGrad[v];
+            glm::vec3 newGrad = newGrads[v - startChunk];
+            float newIsoValue = newIsoValues[v - startChunk];
+
+            float angle = glm::degrees(glm::angle(glm::normalize(newGrad), glm::normalize(prevGrad)));
+            if(angle <= _contactAngle)
+            {
+                glm::vec3 displacement = ( _sigma * (newIsoValue - origIsoValue) * (newGrad / glm::dot(newGrad, newGrad)));
+                deformedVert = deformedVert + displacement;
+            }
+
+            _deformedVert[v] = deformedVert;
+            _prevIsoGrad[v] = newGrad;
+        }
+    }
+}
+
+//------------------------------------------------------------------------------------------------
+
+void isck::TangentialRelaxation(glm::vec3 *_relaxedVert,
+                                const glm::vec3 *_deformedVert,
+                                const float *_origIsoValue,
+                                glm::vec3 *_prevIsoGrad,
+                                GlobalFieldFunction &_globalField,
+                                const int *_oneRingVerts,
+                                const float *_centroidWeights,
+                                const int *_oneRingScatterAddr,
+                                const int _startVert,
+                                const int _endVert)
+{
+    float newIsoValues[EvalGradBatchSize];
+    glm::vec3 newGrads[EvalGradBatchSize];
+    for(int startChunk=_startVert; startChunk<_endVert; startChunk+=EvalGradBatchSize)
+    {
+        int endChunk = std::min(startChunk + EvalGradBatchSize, _endVert);
+        EvalGradGlobalField(newIsoValues, newGrads, _deformedVert + startChunk, endChunk - startChunk, _globalField);
+
+        for(int v=startChunk; v<endChunk; v++)
+        {
+            glm::vec3 deformedVert = _deformedVert[v];
+            float origIsoValue = _origIsoValue[v];
+            int startNeighAddr = _oneRingScatterAddr[v];
+            int numNeighs = _oneRingScatterAddr[v+1] - startNeighAddr;
+            const int *oneRing = (_oneRingVerts + startNeighAddr);
+            const float *centroidWeights = (_centroidWeights + startNeighAddr);
+            glm::vec3 newGrad = newGrads[v - startChunk];
+            float newIsoValue = newIsoValues[v - startChunk];
+
+            float tmp = fabs(newIsoValue - origIsoValue) - 1.0f;
+            float mu = 1.0f - pow(tmp, 4.0f);
+            mu = mu > 0.0f ? mu : 0.0f;
+
+
+            // compute normal - don't trust transformed normals
+            glm::vec3 norm(0.0f, 0.0f, 0.0f);
+            for(int i=0; i<numNeighs; i++)
+            {
+                int nextNeigh = ((i+1)%numNeighs);
+                glm::vec3 neighVert = _deformedVert[oneRing[i]];
+                glm::vec3 nextNeighVert = _deformedVert[oneRing[nextNeigh]];
+                norm += glm::cross(neighVert - deformedVert, nextNeighVert - deformedVert);
+            }
+            norm = glm::normalize(norm);
+
+
+            // calculate centroid
+            glm::vec3 sumWeightedCentroid(0.0f);
+            for(int i=0; i<numNeighs; i++)
+            {
+                glm::vec3 projNeighVert = ProjectPointOnToPlane(_deformedVert[oneRing[i]], deformedVert, norm);
+                sumWeightedCentroid += centroidWeights[i] * projNeighVert;
+            }
+
+
+            _relaxedVert[v] = ((1.0f - mu) * deformedVert) + (mu * sumWeightedCentroid);
+            _prevIsoGrad[v] = newGrad;
+        }
+    }
+}
+
+//------------------------------------------------------------------------------------------------
+
+void isck::GenerateOneRingCentroidWeights(const glm::vec3 *_verts,
+                                          const glm::vec3 *_normals,
+                                          float *_centroidWeights,
+                                          const int *_oneRingVerts,
+                                          const int *_oneRingScatterAddr,
+                                          const int _startVert,
+                                          const int _endVert)
+{
+    std::vector<glm::vec3> q;
+    std::vector<glm::vec3> s;
+    std::vector<float> r;
+    std::vector<float> A;
+    std::vector<float> D;
+    std::vector<float> tanalpha;
+
+    for(int v=_startVert; v<_endVert; v++)
+    {
+        glm::vec3 vert = _verts[v];
+        glm::vec3 n = _normals[v];
+        int startNeighAddr = _oneRingScatterAddr[v];
+        int numNeighs = _oneRingScatterAddr[v+1] - startNeighAddr;
+        float *centroidWeights = _centroidWeights + startNeighAddr;
+
+        q.resize(numNeighs);
+        s.resize(numNeighs);
+        r.resize(numNeighs);
+        A.resize(numNeighs);
+        D.resize(numNeighs);
+        tanalpha.resize(numNeighs);
+
+        for(int i=0; i<numNeighs; ++i)
+        {
+            q[i] = ProjectPointOnToPlane(_verts[_oneRingVerts[startNeighAddr + i]], vert, n);
+            s[i] = q[i] - vert;
+            centroidWeights[i] = 0.0f;
+        }
+
+
+        // Check for coords close to/on boundary of cage
+        bool onBoundary = false;
+        for(int i=0; i<numNeighs && !onBoundary; ++i)
+        {
+            int nextI = (i+1)%numNeighs;
+
+            r[i] = glm::length(s[i]);
+            A[i] = 0.5f * glm::length(glm::cross(s[i], s[nextI]));
+            D[i] = glm::dot(s[i], s[nextI]);
+
+            if(r[i] < FLT_EPSILON)
+            {
+                centroidWeights[i] = 1.0f;
+                onBoundary = true;
+            }
+            else if(fabs(A[i]) < FLT_EPSILON && D[i] < 0.0f)
+            {
+                float dl = glm::length(q[nextI] - q[i]);
+                float mu = glm::length(vert - q[i]) / dl;
+                centroidWeights[i] = 1.0f - mu;
+                centroidWeights[nextI] = mu;
+                onBoundary = true;
+            }
+        }
+
+        if(onBoundary)
+        {
+            continue;
+        }
+
+
+        for(int i=0; i<numNeighs; ++i)
+        {
+            int nextI = (i+1)%numNeighs;
+            tanalpha[i] = (r[i]*r[nextI] - D[i])/(2.0f*A[i]);
+        }
+
+        float W = 0.0f;
+        for(int i=0; i<numNeighs; ++i)
+        {
+            int prevI = (numNeighs+i-1)%numNeighs;
+            centroidWeights[i] = 2.0f*(tanalpha[i] + tanalpha[prevI])/r[i];
+            W += centroidWeights[i];
+        }
+
+        if(fabs(W) > 0.0f)
+        {
+            for(int i=0; i<numNeighs; ++i)
+            {
+                centroidWeights[i] /= W;
+            }
+        }
+        else
+        {
+            for(int i=0; i<numNeighs; ++i)
+            {
+                centroidWeights[i] = 0.0f;
+            }
+        }
+    }
+}
+
+//------------------------------------------------------------------------------------------------
@@ -1,229 +1,231 @@
 #include "Model/implicitskindeformer.h"
-#include "ImplicitSkinGpuWrapper.h"
-#include "helper_cuda.h"
-#include <glm/gtx/string_cast.hpp>
+#include "Model/implicitskincpukernels.h"
+#include "Model/deformerbackendregistry.h"
+#include "Threading/threadpool.h"
+
+#include <algorithm>
+#include <iterator>
+#include <numeric>
+#include <mutex>
 
 
 //------------------------------------------------------------------------
 
 ImplicitSkinDeformer::ImplicitSkinDeformer():
-    m_initMeshCudaMem(false),
-    m_initFieldCudaMem(false),
-    m_deformedMeshVertsMapped(false),
-    m_deformedMeshNormsMapped(false),
+    m_backend(nullptr),
+    m_gpuTextures(false),
+    m_lazyPrecompute(false),
+    m_initMeshData(false),
+    m_meshVBO(0),
+    m_meshNBO(0),
     m_sigma(0.35f),
     m_contactAngle(55.0f),
     m_numIterations(1)
 {
-    m_threads.resize(std::thread::hardware_concurrency()-1);
-    checkCudaErrors(cudaSetDevice(0));
+    // CUDA textures are only needed if the cuda backend can be selected
+    auto &registry = DeformerBackendRegistry::Instance();
+    m_gpuTextures = registry.IsAvailable("cuda");
+
+    auto backend = registry.CreateFastestAvailable();
+    std::string name = backend->GetName();
+    m_backend = backend.get();
+    m_backends[name] = std::move(backend);
+    std::cout<<"Using "<<name<<" deformer backend\n";
 }
 
 //------------------------------------------------------------------------------------------------
 
 ImplicitSkinDeformer::~ImplicitSkinDeformer()
 {
-    for(int i=0; i<m_threads.size(); i++)
-    {
-        if(m_threads[i].joinable())
-        {
-            m_threads[i].join();
-        }
-    }
-
-    DestroyMeshCudaMem();
-
-    DestroyFieldCudaMem();
+    // Backends hold device resources that must be released before the global field textures
+    m_backends.clear();
 }
 
 //------------------------------------------------------------------------------------------------
 
-void ImplicitSkinDeformer::InitialiseIsoValues()
+void ImplicitSkinDeformer::AttachMesh(const Mesh _origMesh,
+                                      const BufferId _meshVBO,
+                                      const BufferId _meshNBO,
+                                      const std::vector<glm::mat4> &_transform)
 {
-    if(m_initFieldCudaMem && m_initMeshCudaMem & m_globalFieldFunction.IsGlobalFieldInit())
-    {
-        std::cout<<"init iso\n";
-        // allocate and initialise temporary device memory
-        glm::mat4 tmpTransform(1.0f);
-        glm::mat4 * d_tmpTransform;
-        checkCudaErrors(cudaMalloc(&d_tmpTransform, m_numTransforms * sizeof(glm::mat4)));
-        for(int i=0;i<m_numTransforms;i++)
-        {
-            checkCudaErrors(cudaMemcpy(d_tmpTransform+i, &tmpTransform[0][0], sizeof(glm::mat4), cudaMemcpyHostToDevice));
-        }
-
-
-        // run kernel
-        isgw::EvalGradGlobalField(d_origVertIsoPtr, d_vertIsoGradPtr, d_origMeshVertsPtr, m_numVerts, d_textureSpacePtr, d_tmpTransform, d_fieldsPtr, m_numFields, d_compOpPtr, d_thetaPtr, m_numCompOps, d_compFieldPtr, m_numCompFields);
-        getLastCudaError("isgw::EvalGradGlobalField");
+    if(m_initMeshData) { return; }
 
+    m_meshVBO = _meshVBO;
+    m_meshNBO = _meshNBO;
+    InitMeshData(_origMesh, _transform);
 
-        // free temporary device memory
-        checkCudaErrors(cudaFree(d_tmpTransform));
+    for(auto &backend : m_backends)
+    {
+        backend.second->AttachMesh(m_meshData, m_meshVBO, m_meshNBO);
     }
-
 }
 
 //------------------------------------------------------------------------------------------------
 
 void ImplicitSkinDeformer::AttachMesh(const Mesh _origMesh,
-                                      const GLuint _meshVBO,
-                                      const GLuint _meshNBO,
                                       const std::vector<glm::mat4> &_transform)
 {
-    InitMeshCudaMem(_origMesh, _meshVBO, _meshNBO, _transform);
+    AttachMesh(_origMesh, 0, 0, _transform);
 }
 
 //------------------------------------------------------------------------------------------------
 
 void ImplicitSkinDeformer::GenerateGlobalFieldFunction(const std::vector<Mesh> &_meshParts,
                                                        const std::vector<std::pair<glm::vec3, glm::vec3> > &_boneEnds,
-                                                       const int _numHrbfCentres)
+                                                       const int _numHrbfCentres,
+                                                       const float _hrbfTolerance)
 {
     m_globalFieldFunction.Fit(_meshParts.size());
-    float dim = FLT_MIN;
-    dim = fabs(m_minBBox.x) > dim ? fabs(m_minBBox.x) : dim;
-    dim = fabs(m_minBBox.y) > dim ? fabs(m_minBBox.y) : dim;
-    dim = fabs(m_minBBox.z) > dim ? fabs(m_minBBox.z) : dim;
-    dim = fabs(m_maxBBox.x) > dim ? fabs(m_maxBBox.x) : dim;
-    dim = fabs(m_maxBBox.y) > dim ? fabs(m_maxBBox.y) : dim;
-    dim = fabs(m_maxBBox.z) > dim ? fabs(m_maxBBox.z) : dim;
-    dim *= 1.5f;
-    int res = 64;
-
-    // Generate individual field functions per mesh part
-    auto threadFunc = [&, this](int startId, int endId){
-        for(int mp=startId; mp<endId; mp++)
-        {
-            Mesh hrbfCentres;
-            m_globalFieldFunction.GenerateHRBFCentres(_meshParts[mp], _boneEnds[mp], _numHrbfCentres, hrbfCentres);
-            m_globalFieldFunction.GenerateFieldFuncs(hrbfCentres, _meshParts[mp], mp);
-            m_globalFieldFunction.PrecomputeFieldFunc(mp, res, dim);
-
-        }
-    };
-
-    int numThreads = m_threads.size() + 1;
-    int dataSize = _meshParts.size();
-    int chunkSize = dataSize / numThreads;
-    int numBigChunks = dataSize % numThreads;
-    int bigChunkSize = chunkSize + (numBigChunks>0 ? 1 : 0);
-    int startChunk = 0;
-    int threadId=0;
-
-    // Generate Field functions in each thread
-    for(threadId=0; threadId<numBigChunks; threadId++)
-    {
-        m_threads[threadId] = std::thread(threadFunc, startChunk, startChunk+bigChunkSize);
-        startChunk+=bigChunkSize;
-    }
-    for(; threadId<numThreads-1; threadId++)
-    {
-        m_threads[threadId] = std::thread(threadFunc, startChunk, startChunk+chunkSize);
-        startChunk+=chunkSize;
-    }
-    threadFunc(startChunk, _meshParts.size());
 
-    for(int i=0; i<numThreads-1; i++)
+    // Lazy fields have no CUDA textures until they are finished, backends sampling them are created again once they are
+    const bool lazy = m_lazyPrecompute && !m_backend->SamplesGpuTextures();
+    const bool gpuTextures = m_gpuTextures && !lazy;
+    m_globalFieldFunction.SetLazyPrecompute(lazy);
+    m_lazyFields.clear();
+    if(lazy)
     {
-        if(m_threads[i].joinable())
+        for(auto it = m_backends.begin(); it != m_backends.end();)
         {
-            m_threads[i].join();
+            it = it->second->SamplesGpuTextures() ? m_backends.erase(it) : std::next(it);
         }
     }
 
-    // Generate global field function
-    m_globalFieldFunction.GenerateGlobalFieldFunc();
+    // Every field gets as many voxels as a 64^3 texture, spread over the box around its own part
+    int numVoxels = 64*64*64;
+
+    // Start the most expensive parts first so a big part is not left running alone at the end,
+    // fit cost scales with the number of triangles the support radius is measured over
+    std::vector<int> partOrder(_meshParts.size());
+    std::iota(partOrder.begin(), partOrder.end(), 0);
+    std::sort(partOrder.begin(), partOrder.end(), [&_meshParts](int a, int b){
+        return _meshParts[a].m_meshTris.size() > _meshParts[b].m_meshTris.size();
+    });
+
+    // Fits reuse the design matrix buffers of the last fit on a free workspace, at most one per thread is made,
+    // and they are all freed once every field has been generated
+    std::vector<std::unique_ptr<DistanceFieldFit::Workspace>> workspaces;
+    std::mutex workspaceMutex;
+    std::mutex lazyFieldMutex;
+
+    // Generate individual field functions per mesh part, or load them if this part was generated before,
+    // PrecomputeFieldFunc splits its grid into z slabs that idle threads steal
+    auto threadFunc = [&, this](int startId, int endId){
+        for(int i=startId; i<endId; i++)
+        {
+            int mp = partOrder[i];
+            FieldCache::Key key = FieldCache::MakeKey(_meshParts[mp], _boneEnds[mp], _numHrbfCentres, _hrbfTolerance, numVoxels);
+            if(m_globalFieldFunction.LoadFieldFunc(m_fieldCache, key, mp, gpuTextures))
+            {
+                continue;
+            }
 
+            std::unique_ptr<DistanceFieldFit::Workspace> workspace;
+            {
+                std::lock_guard<std::mutex> lock(workspaceMutex);
+                if(workspaces.empty())
+                {
+                    workspace.reset(new DistanceFieldFit::Workspace());
+                }
+                else
+                {
+                    workspace = std::move(workspaces.back());
+                    workspaces.pop_back();
+                }
+            }
 
-    InitFieldCudaMem();
+            Mesh hrbfCentres;
+            if(_hrbfTolerance > 0.0f)
+            {
+                m_globalFieldFunction.GenerateAdaptiveFieldFuncs(_meshParts[mp], _boneEnds[mp], mp, _hrbfTolerance, _numHrbfCentres, hrbfCentres, workspace.get());
+            }
+            else
+            {
+                m_globalFieldFunction.GenerateHRBFCentres(_meshParts[mp], _boneEnds[mp], _numHrbfCentres, hrbfCentres);
+                m_globalFieldFunction.GenerateFieldFuncs(hrbfCentres, _meshParts[mp], mp, workspace.get());
+            }
 
-    InitialiseIsoValues();
-}
+            {
+                std::lock_guard<std::mutex> lock(workspaceMutex);
+                workspaces.push_back(std::move(workspace));
+            }
 
-//------------------------------------------------------------------------------------------------
+            m_globalFieldFunction.PrecomputeFittedFieldFunc(mp, numVoxels, gpuTextures);
+            if(lazy)
+            {
+                // Lazy fields can not be saved until every brick is filled
+                std::lock_guard<std::mutex> lock(lazyFieldMutex);
+                m_lazyFields.push_back(std::make_pair(mp, key));
+            }
+            else
+            {
+                m_globalFieldFunction.SaveFieldFunc(m_fieldCache, key, mp);
+            }
 
-void ImplicitSkinDeformer::Deform()
-{
-    PerformLBWSkinning();
-    PerformImplicitSkinning();
+        }
+    };
 
+    // One mesh part per task, handed out dynamically
+    ThreadPool::Instance().ParallelFor(threadFunc, _meshParts.size(), ThreadPool::Schedule::Dynamic);
 
-//    isgw::EvalGradGlobalField(d_newVertIsoPtr, d_vertIsoGradPtr, GetDeformedMeshVertsDevicePtr(), m_numVerts, d_textureSpacePtr, d_transformPtr, d_fieldsPtr, m_numFields, d_compOpPtr, d_thetaPtr, m_numCompOps, d_compFieldPtr, m_numCompFields);
-//    getLastCudaError("isgw::EvalGradGlobalField");
-//    ReleaseDeformedMeshVertsDevicePtr();
+    // Generate global field function
+    m_globalFieldFunction.GenerateGlobalFieldFunc(m_gpuTextures);
 
-//    float h_iso[m_numVerts];
-//    glm::vec3 h_grad[m_numVerts];
-//    checkCudaErrors(cudaMemcpy(h_iso, d_newVertIsoPtr, m_numVerts*sizeof(float), cudaMemcpyDeviceToHost));
-//    checkCudaErrors(cudaMemcpy(h_grad, d_vertIsoGradPtr, m_numVerts*sizeof(glm::vec3), cudaMemcpyDeviceToHost));
-//    for(int i=0;i<m_numVerts;i++)
-//    {
-//        if(h_iso[i] > 0.2f && h_iso[i] < 0.8f)
-//        {
-//            std::cout<<h_iso[i]<<", "<<glm::to_string(h_grad[i])<<"\n";
-//        }
-//    }
-//    std::cout<<"---------------------------------\n";
 
+    // Attach the field to every backend created so far, this initialises their iso values
+    for(auto &backend : m_backends)
+    {
+        backend.second->AttachGlobalField(m_globalFieldFunction);
+    }
 }
 
 //------------------------------------------------------------------------------------------------
 
-void ImplicitSkinDeformer::PerformLBWSkinning()
+void ImplicitSkinDeformer::SetFieldCacheDirectory(const std::string &_directory)
 {
+    m_fieldCache.SetDirectory(_directory);
+}
 
-    if(!m_initMeshCudaMem)
-    {
-        return;
-    }
-
-
-    isgw::LinearBlendWeightSkin(GetDeformedMeshVertsDevicePtr(),
-                                   d_origMeshVertsPtr,
-                                   GetDeformedMeshNormsDevicePtr(),
-                                   d_origMeshNormsPtr,
-                                   d_transformPtr,
-                                   d_boneIdPtr,
-                                   d_weightPtr,
-                                   m_numVerts,
-                                   m_numTransforms);
-
-
-    cudaThreadSynchronize();
-    getLastCudaError("LinearBlendWeightSkin Failed");
-
+//------------------------------------------------------------------------------------------------
 
-    // release cuda resources so openGL can render
-    ReleaseDeformedMeshVertsDevicePtr();
-    ReleaseDeformedMeshNormsDevicePtr();
+void ImplicitSkinDeformer::SetLazyPrecompute(const bool _lazy)
+{
+    m_lazyPrecompute = _lazy;
 }
 
 //------------------------------------------------------------------------------------------------
 
-void ImplicitSkinDeformer::PerformImplicitSkinning()
+void ImplicitSkinDeformer::FinishLazyPrecompute()
 {
-    if(!m_initMeshCudaMem || !m_initFieldCudaMem)
+    for(auto &&field : m_lazyFields)
     {
-        return;
+        if(m_globalFieldFunction.FinishLazyFieldFunc(field.first, m_gpuTextures))
+        {
+            m_globalFieldFunction.SaveFieldFunc(m_fieldCache, field.second, field.first);
+        }
     }
+    m_lazyFields.clear();
+}
 
+//------------------------------------------------------------------------------------------------
 
-    isgw::SimpleImplicitSkin(GetDeformedMeshVertsDevicePtr(), GetDeformedMeshNormsDevicePtr(), d_origVertIsoPtr, d_vertIsoGradPtr, m_numVerts,
-                             d_textureSpacePtr, d_transformPtr, d_fieldsPtr, m_numFields,
-                             d_compOpPtr, d_thetaPtr, m_numCompOps, d_compFieldPtr, m_numCompFields,
-                             d_oneRingIdPtr, d_centroidWeightsPtr, d_oneRingScatterAddrPtr,
-                             m_sigma, m_contactAngle, m_numIterations);
-
+void ImplicitSkinDeformer::Deform()
+{
+    PerformLBWSkinning();
+    PerformImplicitSkinning();
+}
 
+//------------------------------------------------------------------------------------------------
 
-    cudaThreadSynchronize();
-    getLastCudaError("Implicit Skinning Failed");
+void ImplicitSkinDeformer::PerformLBWSkinning()
+{
+    m_backend->PerformLBWSkinning();
+}
 
+//------------------------------------------------------------------------------------------------
 
-    // release cuda resources so openGL can render
-    ReleaseDeformedMeshVertsDevicePtr();
-    ReleaseDeformedMeshNormsDevicePtr();
+void ImplicitSkinDeformer::PerformImplicitSkinning()
+{
+    m_backend->PerformImplicitSkinning(m_sigma, m_contactAngle, m_numIterations);
 }
 
 //------------------------------------------------------------------------------------------------
@@ -255,10 +257,13 @@ void ImplicitSkinDeformer::SetRigidTransforms(const std::vector<glm::mat4> &_tra
         m_globalFieldFunction.SetRigidTransforms(_transforms);
     }
 
-    if(m_initMeshCudaMem)
+    if(m_initMeshData)
     {
-        m_numTransforms = _transforms.size();
-        checkCudaErrors(cudaMemcpy((void*)d_transformPtr, &_transforms[0][0][0], m_numTransforms * sizeof(glm::mat4), cudaMemcpyHostToDevice));
+        m_transforms = _transforms;
+        for(auto &backend : m_backends)
+        {
+            backend.second->SetRigidTransforms(_transforms);
+        }
     }
 }
 
@@ -285,376 +290,225 @@ void ImplicitSkinDeformer::SetIterations(int _iterations)
 
 //------------------------------------------------------------------------------------------------
 
-void ImplicitSkinDeformer::EvalGlobalField(std::vector<float> &_output, const std::vector<glm::vec3> &_samplePoints)
+bool ImplicitSkinDeformer::SetBackend(const std::string &_name)
 {
-    _output.clear();
-    if(!m_globalFieldFunction.IsGlobalFieldInit())
+    DeformerBackend *backend = GetBackend(_name);
+    if(backend == nullptr)
     {
-        return;
+        std::cout<<"Deformer backend "<<_name<<" unavailable, staying with "<<m_backend->GetName()<<"\n";
+        return false;
     }
 
-    _output.resize(_samplePoints.size());
-
-    if(!m_initMeshCudaMem || !m_initFieldCudaMem)
-    {
-        EvalGlobalFieldCPU(_output, _samplePoints);
-    }
-    else
-    {
-        EvalGlobalFieldGPU(_output, _samplePoints);
-    }
+    m_backend = backend;
+    std::cout<<"Using "<<_name<<" deformer backend\n";
+    return true;
 }
 
 //------------------------------------------------------------------------------------------------
 
-void ImplicitSkinDeformer::EvalGlobalFieldInCube(std::vector<float> &_output, const int res, const float dim)
+std::string ImplicitSkinDeformer::GetBackendName() const
 {
-    _output.clear();
-    if(!m_globalFieldFunction.IsGlobalFieldInit())
-    {
-        return;
-    }
-
-    _output.resize(res *res *res);
-
-    if(!m_initMeshCudaMem || !m_initFieldCudaMem)
-    {
-        EvalFieldInCubeCPU(_output, res, dim);
-    }
-    else
-    {
-        EvalFieldInCubeGPU(_output, res, dim);
-    }
+    return m_backend->GetName();
 }
 
 //------------------------------------------------------------------------------------------------
 
-void ImplicitSkinDeformer::EvalGlobalFieldCPU(std::vector<float> &_output, const std::vector<glm::vec3> &_samplePoints)
+DeformerBackend *ImplicitSkinDeformer::GetBackend(const std::string &_name)
 {
-    unsigned int numSamples = _samplePoints.size();
-
-    int numThreads = m_threads.size() + 1;
-    int chunkSize = numSamples / numThreads;
-    int numBigChunks = numSamples % numThreads;
-    int bigChunkSize = chunkSize + (numBigChunks>0 ? 1 : 0);
-    int startChunk = 0;
-    int threadId=0;
-
-
-    auto threadFunc = [&, this](int startChunk, int endChunk){
-        for(int i=startChunk;i<endChunk;i++)
-        {
-            _output[i] = m_globalFieldFunction.Eval(_samplePoints[i]);
-        }
-    };
-
-
-    // Evalue field in each thread
-    for(threadId=0; threadId<numBigChunks; threadId++)
+    auto it = m_backends.find(_name);
+    if(it != m_backends.end())
     {
-        m_threads[threadId] = std::thread(threadFunc, startChunk, (startChunk+bigChunkSize));
-        startChunk+=bigChunkSize;
+        return it->second.get();
     }
-    for(; threadId<numThreads-1; threadId++)
+
+    auto backend = DeformerBackendRegistry::Instance().Create(_name);
+    if(backend == nullptr)
     {
-        m_threads[threadId] = std::thread(threadFunc, startChunk, (startChunk+chunkSize));
-        startChunk+=chunkSize;
+        return nullptr;
     }
-    threadFunc(startChunk, numSamples);
 
-    for(int i=0; i<numThreads-1; i++)
+    // Lazily precomputed fields have no CUDA textures until every brick is filled
+    if(backend->SamplesGpuTextures())
     {
-        if(m_threads[i].joinable())
-        {
-            m_threads[i].join();
-        }
+        FinishLazyPrecompute();
     }
+
+    InitBackend(*backend);
+    DeformerBackend *ptr = backend.get();
+    m_backends[_name] = std::move(backend);
+
+    return ptr;
 }
 
 //------------------------------------------------------------------------------------------------
 
-
-void ImplicitSkinDeformer::EvalGlobalFieldGPU(std::vector<float> &_output, const std::vector<glm::vec3> &_samplePoints)
+bool ImplicitSkinDeformer::DeformsMeshBuffers() const
 {
-    m_numFields = m_globalFieldFunction.GetFieldFuncs().size();
-
-    // allocate device memory
-    float *d_output;
-    glm::vec3 *d_samplePoints;
-    checkCudaErrors(cudaMalloc(&d_output, _samplePoints.size() * sizeof(float)));
-    checkCudaErrors(cudaMalloc(&d_samplePoints, _samplePoints.size() * sizeof(glm::vec3)));
+    return m_backend->DeformsMeshBuffers();
+}
 
-    // upload data to device
-    checkCudaErrors(cudaMemcpy((void*)d_samplePoints, &_samplePoints[0], _samplePoints.size() * sizeof(glm::vec3), cudaMemcpyHostToDevice));
+//------------------------------------------------------------------------------------------------
 
-    // run kernel
-    isgw::EvalGlobalField(d_output, d_samplePoints, _samplePoints.size(), d_textureSpacePtr, d_transformPtr, d_fieldsPtr, m_numFields, d_compOpPtr, d_thetaPtr, m_numCompOps, d_compFieldPtr, m_numCompFields);
-    getLastCudaError("isgw::EvalGlobalField");
+const std::vector<glm::vec3> &ImplicitSkinDeformer::GetDeformedMeshVerts()
+{
+    return m_backend->GetDeformedMeshVerts();
+}
 
-    // download data to host
-    checkCudaErrors(cudaMemcpy(&_output[0], d_output, _samplePoints.size() * sizeof(float), cudaMemcpyDeviceToHost));
+//------------------------------------------------------------------------------------------------
 
-    // free memory
-    checkCudaErrors(cudaFree(d_output));
-    checkCudaErrors(cudaFree(d_samplePoints));
+const std::vector<glm::vec3> &ImplicitSkinDeformer::GetDeformedMeshNorms()
+{
+    return m_backend->GetDeformedMeshNorms();
 }
 
 //------------------------------------------------------------------------------------------------
 
-void ImplicitSkinDeformer::EvalFieldInCubeCPU(std::vector<float> &_output, const int res, const float dim)
+void ImplicitSkinDeformer::EvalGlobalField(std::vector<float> &_output, const std::vector<glm::vec3> &_samplePoints)
 {
+    _output.clear();
+    if(!m_globalFieldFunction.IsGlobalFieldInit())
+    {
+        return;
+    }
 
+    _output.resize(_samplePoints.size());
+    m_backend->EvalGlobalField(_output, _samplePoints);
 }
 
 //------------------------------------------------------------------------------------------------
 
-void ImplicitSkinDeformer::EvalFieldInCubeGPU(std::vector<float> &_output, const int res, const float dim)
+void ImplicitSkinDeformer::EvalGlobalField(std::vector<float> &_output, const std::vector<glm::vec3> &_samplePoints, const std::vector<glm::mat4> &_transforms, const float _error)
 {
+    _output.clear();
+    if(!m_globalFieldFunction.IsGlobalFieldInit())
+    {
+        return;
+    }
+
+    std::vector<glm::mat4> fieldTransforms;
+    m_globalFieldFunction.GetFieldTransforms(_transforms, fieldTransforms);
 
+    _output.resize(_samplePoints.size());
+    ThreadPool::Instance().ParallelFor([&, this](int startChunk, int endChunk){
+        m_globalFieldFunction.EvalBatch(&_samplePoints[startChunk], endChunk - startChunk, fieldTransforms, &_output[startChunk], _error);
+    }, _samplePoints.size(), ThreadPool::Schedule::Guided, 64);
 }
 
 //------------------------------------------------------------------------------------------------
 
-void ImplicitSkinDeformer::InitMeshCudaMem(const Mesh _origMesh,
-                                           const GLuint _meshVBO,
-                                           const GLuint _meshNBO,
-                                           const std::vector<glm::mat4> &_transform)
+void ImplicitSkinDeformer::EvalGlobalFieldInCube(std::vector<float> &_output, const int res, const float dim)
 {
+    _output.clear();
+    if(!m_globalFieldFunction.IsGlobalFieldInit())
+    {
+        return;
+    }
 
-    if(m_initMeshCudaMem) { return; }
+    std::vector<glm::vec3> samplePoints(res*res*res);
+    ThreadPool::Instance().ParallelFor([&](int startZ, int endZ){
+        for(int z=startZ; z<endZ; z++)
+        {
+            for(int y=0; y<res; y++)
+            {
+                for(int x=0; x<res; x++)
+                {
+                    samplePoints[(z*res*res) + (y*res) + x] = glm::vec3(dim*((((float)x/res)*2.0f)-1.0f),
+                                                                        dim*((((float)y/res)*2.0f)-1.0f),
+                                                                        dim*((((float)z/res)*2.0f)-1.0f));
+                }
+            }
+        }
+    }, res);
 
-    std::cout<<"init mesh cuda\n";
+    EvalGlobalField(_output, samplePoints);
+}
+
+//------------------------------------------------------------------------------------------------
 
-    m_numVerts = _origMesh.m_meshVerts.size();
-    m_numTransforms = _transform.size();
+void ImplicitSkinDeformer::InitMeshData(const Mesh &_origMesh, const std::vector<glm::mat4> &_transform)
+{
+    if(m_initMeshData) { return; }
+
+    int numVerts = _origMesh.m_meshVerts.size();
     m_minBBox = _origMesh.m_minBBox;
     m_maxBBox = _origMesh.m_maxBBox;
+    m_transforms = _transform;
+
+    m_meshData.numVerts = numVerts;
+    m_meshData.origVerts = _origMesh.m_meshVerts;
+    m_meshData.origNorms = _origMesh.m_meshNorms;
+    m_meshData.restTransforms = _transform;
+
 
     // Get bone ID and weights per vertex
-    unsigned int boneIds[m_numVerts *4];
-    float weights[m_numVerts *4];
+    m_meshData.boneIds.resize(numVerts * 4);
+    m_meshData.weights.resize(numVerts * 4);
     int i=0;
     for(auto &bw : _origMesh.m_meshBoneWeights)
     {
         float totalW = 0.0f;
         for(int j=0; j<4; j++)
         {
-            boneIds[i+j] = bw.boneID[j];
-            weights[i+j] = bw.boneWeight[j];
+            m_meshData.boneIds[i+j] = bw.boneID[j];
+            m_meshData.weights[i+j] = bw.boneWeight[j];
             totalW += bw.boneWeight[j];
         }
 
         // Normalize weights
-        if(totalW < 1.0f)
+        if(totalW < 1.0f && totalW > 0.0f)
         {
             for(int j=0; j<4; j++)
             {
-                weights[i+j] /= totalW;
+                m_meshData.weights[i+j] /= totalW;
             }
         }
         i+=4;
     }
 
+
     // Get one ring neighbourhood
     std::vector<std::vector<int>> oneRing;
-    std::vector<int> oneRingIdFlat;
-    std::vector<glm::vec3> oneRingVertFlat;
-    std::vector<int>numNeighsPerVertex;
     _origMesh.GetOneRingNeighours(oneRing);
 
-    for(auto &neighList : oneRing)
-    {
-        numNeighsPerVertex.push_back(neighList.size());
-
-        oneRingIdFlat.insert(oneRingIdFlat.begin(), neighList.begin(), neighList.end());
-
-        for(auto &neighId : neighList)
-        {
-            oneRingVertFlat.push_back(_origMesh.m_meshVerts[neighId]);
-        }
-    }
-
-
-    // Register vertex buffer with CUDA
-    checkCudaErrors(cudaGraphicsGLRegisterBuffer(&m_meshVBO_CUDA, _meshVBO, cudaGraphicsMapFlagsWriteDiscard));
-    checkCudaErrors(cudaGraphicsGLRegisterBuffer(&m_meshNBO_CUDA, _meshNBO, cudaGraphicsMapFlagsWriteDiscard));
-
-
-    // Allocate cuda memory
-    checkCudaErrorsMsg(cudaMalloc(&d_origMeshVertsPtr,  m_numVerts * sizeof(glm::vec3)),          "Allocate memory for original mesh verts");
-    checkCudaErrorsMsg(cudaMalloc(&d_origMeshNormsPtr,  m_numVerts * sizeof(glm::vec3)),          "Allocate memory for original mesh normals");
-    checkCudaErrorsMsg(cudaMalloc(&d_origVertIsoPtr,    m_numVerts * sizeof(float)),          "Allocate memory for original vert iso values");
-    checkCudaErrorsMsg(cudaMalloc(&d_newVertIsoPtr,    m_numVerts * sizeof(float)),          "Allocate memory for new vert iso values");
-    checkCudaErrorsMsg(cudaMalloc(&d_vertIsoGradPtr,    m_numVerts * sizeof(glm::vec3)),          "Allocate memory for new vert iso Grad values");
-    checkCudaErrorsMsg(cudaMalloc(&d_transformPtr,      _transform.size() * sizeof(glm::mat4)),  "Allocate memory for transforms");
-    checkCudaErrorsMsg(cudaMalloc(&d_boneIdPtr,         m_numVerts * 4 * sizeof(unsigned int)),     "Allocate memory for bone Ids");
-    checkCudaErrorsMsg(cudaMalloc(&d_weightPtr,         m_numVerts * 4 * sizeof(float)),            "Allocate memory for bone weights");
-    checkCudaErrorsMsg(cudaMalloc(&d_oneRingIdPtr,      oneRingIdFlat.size() * sizeof(int)),     "Allocate memory for one ring ids");
-    checkCudaErrorsMsg(cudaMalloc(&d_oneRingVertPtr,    oneRingVertFlat.size() * sizeof(glm::vec3)), "Allocate memory for one ring verts");
-    checkCudaErrorsMsg(cudaMalloc(&d_centroidWeightsPtr,   oneRingVertFlat.size() * sizeof(float)), "Allocate memory for one ring centroid weights");
-    checkCudaErrorsMsg(cudaMalloc(&d_numNeighsPerVertPtr, (m_numVerts+1) * sizeof(int)),        "Allocate memory for num neighs per vertex");
-    checkCudaErrorsMsg(cudaMalloc(&d_oneRingScatterAddrPtr, (m_numVerts+1) * sizeof(int)),      "Allocate memory for one ring scatter address");
-
-
-    // copy memory over to cuda
-    checkCudaErrors(cudaMemcpy((void*)d_origMeshVertsPtr, (void*)&_origMesh.m_meshVerts[0], m_numVerts * sizeof(glm::vec3), cudaMemcpyHostToDevice));
-    checkCudaErrors(cudaMemcpy((void*)d_origMeshNormsPtr, (void*)&_origMesh.m_meshNorms[0], m_numVerts * sizeof(glm::vec3), cudaMemcpyHostToDevice));
-    checkCudaErrors(cudaMemcpy((void*)d_transformPtr, (void*)&_transform[0][0][0], _transform.size() * sizeof(glm::mat4), cudaMemcpyHostToDevice));
-    checkCudaErrors(cudaMemcpy((void*)d_boneIdPtr, (void*)boneIds, m_numVerts *4* sizeof(unsigned int), cudaMemcpyHostToDevice));
-    checkCudaErrors(cudaMemcpy((void*)d_weightPtr, (void*)weights, m_numVerts *4* sizeof(float), cudaMemcpyHostToDevice));
-    checkCudaErrors(cudaMemcpy((void*)d_oneRingIdPtr, (void*)&oneRingIdFlat[0], oneRingIdFlat.size() * sizeof(int), cudaMemcpyHostToDevice));
-    checkCudaErrors(cudaMemcpy((void*)d_oneRingVertPtr, (void*)&oneRingVertFlat[0], oneRingVertFlat.size() * sizeof(glm::vec3), cudaMemcpyHostToDevice));
-    checkCudaErrors(cudaMemcpy((void*)d_numNeighsPerVertPtr, (void*)&numNeighsPerVertex[0], m_numVerts * sizeof(int), cudaMemcpyHostToDevice));
-    isgw::GenerateScatterAddress(d_numNeighsPerVertPtr, (d_numNeighsPerVertPtr+m_numVerts+1), d_oneRingScatterAddrPtr);
-    isgw::GenerateOneRingCentroidWeights(d_origMeshVertsPtr, d_origMeshNormsPtr, m_numVerts, d_centroidWeightsPtr, d_oneRingIdPtr, d_oneRingVertPtr, d_numNeighsPerVertPtr, d_oneRingScatterAddrPtr);
-
-
-    m_initMeshCudaMem = true;
-}
-
-//------------------------------------------------------------------------------------------------
-
-void ImplicitSkinDeformer::InitFieldCudaMem()
-{
-    if(!m_globalFieldFunction.IsGlobalFieldInit() || m_initFieldCudaMem) { return; }
-
-    std::cout<<"init field cuda\n";
-
-    auto fieldFuncs = m_globalFieldFunction.GetFieldFuncs();
-    auto compOps = m_globalFieldFunction.GetCompOps();
-    auto compFields = m_globalFieldFunction.GetCompFieldsCuda();
-
-    // create device memory here
-    m_numFields = fieldFuncs.size();
-    m_numCompOps = compOps.size();
-    m_numCompFields = compFields.size();
-
-    // allocate memory
-    checkCudaErrors(cudaMalloc(&d_textureSpacePtr, m_numFields * sizeof(glm::mat4)));
-    checkCudaErrors(cudaMalloc(&d_fieldsPtr, m_numFields * sizeof(cudaTextureObject_t)));
-    checkCudaErrors(cudaMalloc(&d_compOpPtr, m_numCompOps * sizeof(cudaTextureObject_t)));
-    checkCudaErrors(cudaMalloc(&d_thetaPtr, m_numCompOps * sizeof(cudaTextureObject_t)));
-    checkCudaErrors(cudaMalloc(&d_compFieldPtr, m_numCompFields * sizeof(ComposedFieldCuda)));
-
-    // upload data
-    std::vector<glm::mat4> texSpaceTrans(m_numFields);
-    for(int i=0; i<m_numFields; ++i)
-    {
-        texSpaceTrans[i] = fieldFuncs[i]->GetTextureSpaceTransform();
-        auto fieldTex = fieldFuncs[i]->GetFieldFuncCudaTextureObject();
-        cudaMemcpy(d_fieldsPtr+i, &fieldTex, 1*sizeof(cudaTextureObject_t), cudaMemcpyHostToDevice);
-    }
-    for(int i=0; i<m_numCompOps; ++i)
-    {
-        auto compOpTex = compOps[i]->GetFieldFunc3DTexture();
-        auto thetaTex = compOps[i]->GetThetaTexture();
-        cudaMemcpy(d_compOpPtr+i, &compOpTex, 1*sizeof(cudaTextureObject_t), cudaMemcpyHostToDevice);
-        cudaMemcpy(d_thetaPtr+i, &thetaTex, 1*sizeof(cudaTextureObject_t), cudaMemcpyHostToDevice);
-    }
-    for(int i=0; i<m_numCompFields; ++i)
+    m_meshData.oneRingIds.clear();
+    m_meshData.oneRingScatterAddr.resize(numVerts+1);
+    m_meshData.oneRingScatterAddr[0] = 0;
+    for(int v=0; v<numVerts; v++)
     {
-        auto cf = compFields[i];
-        cudaMemcpy(d_compFieldPtr+i, &cf, 1*sizeof(ComposedFieldCuda), cudaMemcpyHostToDevice);
+        m_meshData.oneRingIds.insert(m_meshData.oneRingIds.end(), oneRing[v].begin(), oneRing[v].end());
+        m_meshData.oneRingScatterAddr[v+1] = m_meshData.oneRingScatterAddr[v] + oneRing[v].size();
     }
-    checkCudaErrors(cudaMemcpy((void*)d_textureSpacePtr, &texSpaceTrans[0][0][0], texSpaceTrans.size() * sizeof(glm::mat4), cudaMemcpyHostToDevice));
 
-    m_initFieldCudaMem = true;
-}
 
-//------------------------------------------------------------------------------------------------
+    // Generate centroid weights
+    m_meshData.centroidWeights.resize(m_meshData.oneRingIds.size());
+    ThreadPool::Instance().ParallelFor([this](int startVert, int endVert){
+        isck::GenerateOneRingCentroidWeights(&m_meshData.origVerts[0], &m_meshData.origNorms[0], &m_meshData.centroidWeights[0],
+                                             &m_meshData.oneRingIds[0], &m_meshData.oneRingScatterAddr[0],
+                                             startVert, endVert);
+    }, numVerts, ThreadPool::Schedule::Guided, 256);
 
-void ImplicitSkinDeformer::DestroyMeshCudaMem()
-{
-    if(m_initMeshCudaMem)
-    {
-        checkCudaErrors(cudaGraphicsUnregisterResource(m_meshVBO_CUDA));
-        checkCudaErrors(cudaGraphicsUnregisterResource(m_meshNBO_CUDA));
-        checkCudaErrors(cudaFree(d_origMeshVertsPtr));
-        checkCudaErrors(cudaFree(d_origMeshNormsPtr));
-        checkCudaErrors(cudaFree(d_origVertIsoPtr));
-        checkCudaErrors(cudaFree(d_newVertIsoPtr));
-        checkCudaErrors(cudaFree(d_vertIsoGradPtr));
-        checkCudaErrors(cudaFree(d_transformPtr));
-        checkCudaErrors(cudaFree(d_boneIdPtr));
-        checkCudaErrors(cudaFree(d_weightPtr));
-        checkCudaErrors(cudaFree(d_oneRingIdPtr));
-        checkCudaErrors(cudaFree(d_oneRingVertPtr));
-        checkCudaErrors(cudaFree(d_centroidWeightsPtr));
-        checkCudaErrors(cudaFree(d_numNeighsPerVertPtr));
-        checkCudaErrors(cudaFree(d_oneRingScatterAddrPtr));
-
-        m_initMeshCudaMem = false;
-    }
-}
 
-//------------------------------------------------------------------------------------------------
-
-void ImplicitSkinDeformer::DestroyFieldCudaMem()
-{
-    if(m_initFieldCudaMem)
-    {
-        checkCudaErrors(cudaFree(d_textureSpacePtr));
-        checkCudaErrors(cudaFree(d_fieldsPtr));
-        checkCudaErrors(cudaFree(d_compOpPtr));
-        checkCudaErrors(cudaFree(d_thetaPtr));
-        checkCudaErrors(cudaFree(d_compFieldPtr));
-
-        m_initFieldCudaMem = false;
-    }
-}
-
-//------------------------------------------------------------------------------------------------
-
-glm::vec3 *ImplicitSkinDeformer::GetDeformedMeshVertsDevicePtr()
-{
-    if(!m_deformedMeshVertsMapped)
-    {
-        size_t numBytes;
-        checkCudaErrors(cudaGraphicsMapResources(1, &m_meshVBO_CUDA, 0));
-        checkCudaErrors(cudaGraphicsResourceGetMappedPointer((void **)&d_deformedMeshVertsPtr, &numBytes, m_meshVBO_CUDA));
-
-        m_deformedMeshVertsMapped = true;
-    }
-
-    return d_deformedMeshVertsPtr;
+    m_initMeshData = true;
 }
 
 //------------------------------------------------------------------------------------------------
 
-void ImplicitSkinDeformer::ReleaseDeformedMeshVertsDevicePtr()
+void ImplicitSkinDeformer::InitBackend(DeformerBackend &_backend)
 {
-    if(m_deformedMeshVertsMapped)
+    if(!m_initMeshData)
     {
-        checkCudaErrors(cudaGraphicsUnmapResources(1, &m_meshVBO_CUDA, 0));
-        m_deformedMeshVertsMapped = false;
+        return;
     }
-}
 
-//------------------------------------------------------------------------------------------------
+    _backend.AttachMesh(m_meshData, m_meshVBO, m_meshNBO);
 
-glm::vec3 *ImplicitSkinDeformer::GetDeformedMeshNormsDevicePtr()
-{
-    if(!m_deformedMeshNormsMapped)
+    if(m_globalFieldFunction.IsGlobalFieldInit())
     {
-        size_t numBytes;
-        checkCudaErrors(cudaGraphicsMapResources(1, &m_meshNBO_CUDA, 0));
-        checkCudaErrors(cudaGraphicsResourceGetMappedPointer((void **)&d_deformedMeshNormsPtr, &numBytes, m_meshNBO_CUDA));
-
-        m_deformedMeshNormsMapped = true;
+        _backend.AttachGlobalField(m_globalFieldFunction);
     }
 
-    return d_deformedMeshNormsPtr;
-}
-
-//------------------------------------------------------------------------------------------------
-
-void ImplicitSkinDeformer::ReleaseDeformedMeshNormsDevicePtr()
-{
-    if(m_deformedMeshNormsMapped)
-    {
-        checkCudaErrors(cudaGraphicsUnmapResources(1, &m_meshNBO_CUDA, 0));
-        m_deformedMeshNormsMapped = false;
-    }
+    _backend.SetRigidTransforms(m_transforms);
 }
 
 //------------------------------------------------------------------------------------------------
@@ -1,5 +1,7 @@
 #include "Model/model.h"
 #include "MeshSampler/meshsampler.h"
+#include "Model/deformerbackendregistry.h"
+#include "Threading/threadpool.h"
 
 #include <QOpenGLContext>
 
@@ -23,9 +25,8 @@ Model::Model()
     m_drawSkin = true;
     m_deformImplicitSkin = true;
 
+    m_implicitSkinner = nullptr;
     m_initGL = false;
-
-    m_threads.resize(std::thread::hardware_concurrency() - 1);
 }
 
 Model::~Model()
@@ -52,67 +53,7 @@ void Model::Initialise()
 
 void Model::GenerateMeshParts(std::vector<Mesh> &_meshParts)
 {
-    unsigned int numParts = m_rig.m_boneNameIdMapping.size();
-    _meshParts.resize(numParts);
-
-
-    for(unsigned int t=0; t<m_mesh.m_meshTris.size(); t++)
-    {
-        int v1 = m_mesh.m_meshTris[t].x;
-        int v2 = m_mesh.m_meshTris[t].y;
-        int v3 = m_mesh.m_meshTris[t].z;
-
-        float weight[3] = {0.0f, 0.0f, 0.0f};
-        int boneId[3] = {-1, -1, -1};
-        for(int bw = 0; bw<4; bw++)
-        {
-            if(m_mesh.m_meshBoneWeights[v1].boneWeight[bw] > weight[0])
-            {
-                weight[0] = m_mesh.m_meshBoneWeights[v1].boneWeight[bw];
-                boneId[0] = m_mesh.m_meshBoneWeights[v1].boneID[bw];
-            }
-
-            if(m_mesh.m_meshBoneWeights[v2].boneWeight[bw] > weight[1])
-            {
-                weight[1] = m_mesh.m_meshBoneWeights[v2].boneWeight[bw];
-                boneId[1] = m_mesh.m_meshBoneWeights[v2].boneID[bw];
-            }
-
-            if(m_mesh.m_meshBoneWeights[v3].boneWeight[bw] > weight[2])
-            {
-                weight[2] = m_mesh.m_meshBoneWeights[v3].boneWeight[bw];
-                boneId[2] = m_mesh.m_meshBoneWeights[v3].boneID[bw];
-            }
-        }
-
-        for(unsigned int v=0; v<3; v++)
-        {
-            if(boneId[v] < 0 || boneId[v] >= (int)numParts)
-            {
-                continue;
-            }
-            if(v==1 && boneId[1] == boneId[0])
-            {
-                continue;
-            }
-            if((v==2) && (boneId[2] == boneId[1] || boneId[2] == boneId[0]))
-            {
-                continue;
-            }
-
-            if(weight[v] >0.2f)
-                _meshParts[boneId[v]].m_meshTris.push_back(glm::ivec3(v1, v2, v3));
-        }
-
-    }
-
-
-    for(unsigned int i=0 ;i<_meshParts.size(); i++)
-    {
-        _meshParts[i].m_meshVerts = m_mesh.m_meshVerts;
-        _meshParts[i].m_meshNorms = m_mesh.m_meshNorms;
-    }
-
+    m_mesh.GenerateMeshParts(_meshParts, m_rig.m_boneNameIdMapping.size());
 }
 
 //---------------------------------------------------------------------------------
@@ -127,11 +68,30 @@ void Model::DeformSkin()
     {
         m_implicitSkinner->PerformLBWSkinning();
     }
+
+
+    // The cuda backend writes straight into our buffers, the others need uploading
+    if(!m_implicitSkinner->DeformsMeshBuffers())
+    {
+        auto &deformedVerts = m_implicitSkinner->GetDeformedMeshVerts();
+        auto &deformedNorms = m_implicitSkinner->GetDeformedMeshNorms();
+
+        m_meshVBO[SKINNED].bind();
+        m_meshVBO[SKINNED].write(0, &deformedVerts[0], deformedVerts.size() * sizeof(glm::vec3));
+        m_meshVBO[SKINNED].release();
+
+        m_meshNBO[SKINNED].bind();
+        m_meshNBO[SKINNED].write(0, &deformedNorms[0], deformedNorms.size() * sizeof(glm::vec3));
+        m_meshNBO[SKINNED].release();
+    }
 }
 
 //---------------------------------------------------------------------------------
 
-void Model::UpdateIsoSurface(int xRes,
+void Model::UpdateIsoSurface(const std::vector<glm::mat4> &_transforms,
+                             std::vector<glm::vec3> &_verts,
+                             std::vector<glm::vec3> &_norms,
+                             int xRes,
                                   int yRes,
                                   int zRes,
                                   float dim,
@@ -144,14 +104,6 @@ void Model::UpdateIsoSurface(int xRes,
     std::vector<glm::vec3> samplePoints(xRes*yRes*zRes);
 
     //-------------------------------------------------------
-    int numThreads = m_threads.size() + 1;
-    int chunkSize = zRes / numThreads;
-    int numBigChunks = zRes % numThreads;
-    int bigChunkSize = chunkSize + (numBigChunks>0 ? 1 : 0);
-    int startChunk = 0;
-    int threadId=0;
-
-
     auto threadFunc = [&](int startChunk, int endChunk){
         for(int z=startChunk;z<endChunk;z++)
         {
@@ -169,36 +121,30 @@ void Model::UpdateIsoSurface(int xRes,
 
 
     // Generate sample points
-    for(threadId=0; threadId<numBigChunks; threadId++)
-    {
-        m_threads[threadId] = std::thread(threadFunc, startChunk, (startChunk+bigChunkSize));
-        startChunk+=bigChunkSize;
-    }
-    for(; threadId<numThreads-1; threadId++)
-    {
-        m_threads[threadId] = std::thread(threadFunc, startChunk, (startChunk+chunkSize));
-        startChunk+=chunkSize;
-    }
-    threadFunc(startChunk, zRes);
-
-    for(int i=0; i<numThreads-1; i++)
-    {
-        if(m_threads[i].joinable())
-        {
-            m_threads[i].join();
-        }
-    }
+    ThreadPool::Instance().ParallelFor(threadFunc, zRes);
     //-------------------------------------------------------
 
 
-    // Evaluate field
+    // Evaluate field for this frames pose, the deformers own transforms may already belong to the next frame.
+    // Marching cubes cannot resolve detail finer than its grid, so the fields may be sampled at levels no coarser than it
+    const float gridSpacing = (2.0f * dim) / std::max(xRes, std::max(yRes, zRes));
     std::vector<float> f;
-    m_implicitSkinner->EvalGlobalField(f, samplePoints);
+    m_implicitSkinner->EvalGlobalField(f, samplePoints, _transforms, gridSpacing);
+    if(f.empty())
+    {
+        return;
+    }
 
 
     // Polygonize scalar field using maching cube
-//    MachingCube::Polygonize(m_meshIsoSurface.m_meshVerts, m_meshIsoSurface.m_meshNorms, &f[0], 0.5f, xRes, yRes, zRes, xScale, yScale, zScale);
-    MachingCube::PolygonizeGPU(m_meshIsoSurface.m_meshVerts, m_meshIsoSurface.m_meshNorms, &f[0], 0.5f, xRes, yRes, zRes, xScale, yScale, zScale);
+    if(DeformerBackendRegistry::Instance().IsAvailable("cuda"))
+    {
+        MachingCube::PolygonizeGPU(_verts, _norms, &f[0], 0.5f, xRes, yRes, zRes, xScale, yScale, zScale);
+    }
+    else
+    {
+        MachingCube::Polygonize(_verts, _norms, &f[0], 0.5f, xRes, yRes, zRes, xScale, yScale, zScale);
+    }
 }
 
 
@@ -217,8 +163,13 @@ void Model::DrawMesh()
     else
     {
         //-------------------------------------------------------------------------------------
-        // Skin our mesh
-        DeformSkin();
+        // Skin our mesh, this also poses the next frame and polygonises the previous frames iso surface
+        m_spareFrame.isoSurface = m_drawIsoSurface;
+        if(m_framePipeline->Advance(std::move(m_spareFrame), m_spareFrame) && m_spareFrame.isoSurface)
+        {
+            m_meshIsoSurface.m_meshVerts.swap(m_spareFrame.isoVerts);
+            m_meshIsoSurface.m_meshNorms.swap(m_spareFrame.isoNorms);
+        }
 
 
         //-------------------------------------------------------------------------------------
@@ -253,20 +204,6 @@ void Model::DrawMesh()
             glUniformMatrix3fv(m_normalMatrixLoc[ISO_SURFACE], 1, true, &normalMatrix[0][0]);
 
 
-            // Get Scalar field for each mesh part and polygonize
-            int xRes = 64;
-            int yRes = 64;
-            int zRes = 64;
-            glm::vec3 min(fabs(m_mesh.m_minBBox.x), fabs(m_mesh.m_minBBox.y), fabs(m_mesh.m_minBBox.z));
-            glm::vec3 max(fabs(m_mesh.m_maxBBox.x), fabs(m_mesh.m_maxBBox.y), fabs(m_mesh.m_maxBBox.z));
-            float dim = glm::compMax(min) > glm::compMax(max) ? glm::compMax(min) : glm::compMax(max);
-            dim = dim *1.1f * m_rig.m_globalInverseTransform[0][0];
-            float xScale = 1.0f* dim;
-            float yScale = 1.0f* dim;
-            float zScale = 1.0f* dim;
-            UpdateIsoSurface(xRes, yRes, zRes, dim, xScale, yScale, zScale);
-
-
             // upload new verts
             glUniform3fv(m_colourLoc[ISO_SURFACE], 1, &m_meshIsoSurface.m_colour[0]);// Setup our vertex buffer object.
             m_meshVBO[ISO_SURFACE].bind();
@@ -325,19 +262,9 @@ void Model::DrawRig()
 
 void Model::Animate(const float _animationTime)
 {
-    m_rig.Animate(_animationTime);
-
-
-    m_shaderProg[SKINNED]->bind();
-    UploadBonesToShader(SKINNED);
-    UploadBoneColoursToShader(SKINNED);
-    m_shaderProg[SKINNED]->release();
-
-    m_shaderProg[RIG]->bind();
-    UploadBonesToShader(RIG);
-    m_shaderProg[RIG]->release();
-
-    m_implicitSkinner->SetRigidTransforms(m_rig.m_boneTransforms);
+    // Slots are sized to the rig, so evaluating into them does not allocate
+    m_rig.EvaluatePose(_animationTime, m_poseBuffer.GetWriteBuffer());
+    m_poseBuffer.Publish();
 }
 
 void Model::ToggleWireframe()
@@ -355,6 +282,17 @@ void Model::ToggleSkinnedImplicitSurface()
     m_deformImplicitSkin = !m_deformImplicitSkin;
 }
 
+void Model::CycleDeformerBackend()
+{
+    auto backends = DeformerBackendRegistry::Instance().GetAvailableBackends();
+    auto current = std::find(backends.begin(), backends.end(), m_implicitSkinner->GetBackendName());
+    if(current == backends.end() || ++current == backends.end())
+    {
+        current = backends.begin();
+    }
+    m_implicitSkinner->SetBackend(*current);
+}
+
 void Model::ToggleIsoSurface()
 {
     m_drawIsoSurface = !m_drawIsoSurface;
@@ -773,13 +711,76 @@ void Model::InitImplicitSkinner()
     {
         boneEnds.push_back(std::make_pair(m_rigMesh.m_meshVerts[i*2], m_rigMesh.m_meshVerts[(i*2) + 1]));
     }
-    m_implicitSkinner->GenerateGlobalFieldFunction(meshParts, boneEnds, 50);
+    // As many HRBF centres per part as it takes to fit its vertices within 1% of its size, at most 100
+    m_implicitSkinner->GenerateGlobalFieldFunction(meshParts, boneEnds, 100, 0.01f);
+
+    InitFramePipeline();
+}
+
+//---------------------------------------------------------------------------------
+
+void Model::InitFramePipeline()
+{
+    m_poseBuffer.Reset(m_rig.m_boneTransforms);
+
+    // Take the newest complete pose, or keep the last one if the animation timer has not published since
+    auto poseFrame = [this](AnimFrame &_frame){
+        m_poseBuffer.Update();
+        _frame.boneTransforms = m_poseBuffer.GetReadBuffer();
+    };
+
+    auto skinFrame = [this](AnimFrame &_frame){
+        SkinFrame(_frame);
+    };
+
+    auto polygoniseFrame = [this](AnimFrame &_frame){
+        if(!_frame.isoSurface)
+        {
+            return;
+        }
+
+        // Get Scalar field for each mesh part and polygonize
+        int xRes = 64;
+        int yRes = 64;
+        int zRes = 64;
+        glm::vec3 min(fabs(m_mesh.m_minBBox.x), fabs(m_mesh.m_minBBox.y), fabs(m_mesh.m_minBBox.z));
+        glm::vec3 max(fabs(m_mesh.m_maxBBox.x), fabs(m_mesh.m_maxBBox.y), fabs(m_mesh.m_maxBBox.z));
+        float dim = glm::compMax(min) > glm::compMax(max) ? glm::compMax(min) : glm::compMax(max);
+        dim = dim *1.1f * m_rig.m_globalInverseTransform[0][0];
+        float xScale = 1.0f* dim;
+        float yScale = 1.0f* dim;
+        float zScale = 1.0f* dim;
+        UpdateIsoSurface(_frame.boneTransforms, _frame.isoVerts, _frame.isoNorms, xRes, yRes, zRes, dim, xScale, yScale, zScale);
+    };
+
+    m_framePipeline.reset(new FramePipeline<AnimFrame>(poseFrame, skinFrame, polygoniseFrame));
+}
+
+//---------------------------------------------------------------------------------
+
+void Model::SkinFrame(AnimFrame &_frame)
+{
+    m_rig.m_boneTransforms = _frame.boneTransforms;
+
+    m_shaderProg[SKINNED]->bind();
+    UploadBonesToShader(SKINNED);
+    UploadBoneColoursToShader(SKINNED);
+    m_shaderProg[SKINNED]->release();
+
+    m_shaderProg[RIG]->bind();
+    UploadBonesToShader(RIG);
+    m_shaderProg[RIG]->release();
+
+    m_implicitSkinner->SetRigidTransforms(_frame.boneTransforms);
+    DeformSkin();
 }
 
 //---------------------------------------------------------------------------------
 
 void Model::DeleteImplicitSkinner()
 {
+    m_framePipeline = nullptr;
+
     if(m_implicitSkinner != nullptr)
     {
         delete m_implicitSkinner;
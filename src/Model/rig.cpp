@@ -13,27 +13,42 @@ Rig::~Rig()
 
 
 void Rig::Animate(const float _animationTime)
+{
+    EvaluatePose(_animationTime, m_boneTransforms);
+
+    for(auto &bone : m_bones)
+    {
+        auto boneId = m_boneNameIdMapping.find(bone.first);
+        if(boneId != m_boneNameIdMapping.end() && boneId->second < m_boneTransforms.size())
+        {
+            bone.second->m_currentTransform = m_boneTransforms[boneId->second];
+        }
+    }
+}
+
+
+void Rig::EvaluatePose(const float _animationTime, std::vector<glm::mat4> &_boneTransforms) const
 {
     glm::mat4 identity;
 
     if(!m_animExists)
     {
-        m_boneTransforms.resize(1);
-        m_boneTransforms[0] = glm::mat4(1.0);
+        _boneTransforms.resize(1);
+        _boneTransforms[0] = glm::mat4(1.0);
         return;
     }
 
     unsigned int numBones = m_boneNameIdMapping.size();
-    m_boneTransforms.resize(numBones);
+    _boneTransforms.resize(numBones);
 
     float timeInTicks = _animationTime * m_ticksPerSecond;
     float animationTime = fmod(timeInTicks, m_animationDuration);
 
-    UpdateBoneHierarchy(animationTime, m_rootBone, identity);
+    UpdateBoneHierarchy(animationTime, m_rootBone, identity, _boneTransforms);
 }
 
 
-void Rig::UpdateBoneHierarchy(const float _animationTime, std::shared_ptr<Bone> _pBone, const glm::mat4& _parentTransform)
+void Rig::UpdateBoneHierarchy(const float _animationTime, std::shared_ptr<Bone> _pBone, const glm::mat4& _parentTransform, std::vector<glm::mat4> &_boneTransforms) const
 {
     if(_pBone == nullptr)
     {
@@ -50,7 +65,10 @@ void Rig::UpdateBoneHierarchy(const float _animationTime, std::shared_ptr<Bone>
     // Set defualt to bind pose
     glm::mat4 boneTransform(_pBone->m_transform);
 
-    BoneAnim boneAnim = m_boneAnims[_pBone->m_name];
+    // Bones without animation fall back to an empty one
+    static const BoneAnim noAnim;
+    auto boneAnimIt = m_boneAnims.find(_pBone->m_name);
+    const BoneAnim &boneAnim = boneAnimIt != m_boneAnims.end() ? boneAnimIt->second : noAnim;
 
 
     // Interpolate scaling and generate scaling transformation matrix
@@ -81,13 +99,13 @@ void Rig::UpdateBoneHierarchy(const float _animationTime, std::shared_ptr<Bone>
 
     if (BoneIndex != -1)
     {
-//        m_boneTransforms[BoneIndex] = _pBone->m_currentTransform = glm::mat4(1.0f);
-        m_boneTransforms[BoneIndex] = _pBone->m_currentTransform = m_globalInverseTransform * globalTransformation * _pBone->m_boneOffset;
+//        _boneTransforms[BoneIndex] = glm::mat4(1.0f);
+        _boneTransforms[BoneIndex] = m_globalInverseTransform * globalTransformation * _pBone->m_boneOffset;
     }
 
     for (uint i = 0 ; i < _pBone->m_children.size() ; i++)
     {
-        UpdateBoneHierarchy(_animationTime, _pBone->m_children[i], globalTransformation);
+        UpdateBoneHierarchy(_animationTime, _pBone->m_children[i], globalTransformation, _boneTransforms);
     }
 
 }
@@ -95,7 +113,7 @@ void Rig::UpdateBoneHierarchy(const float _animationTime, std::shared_ptr<Bone>
 
 
 
-void Rig::CalcInterpolatedRotation(glm::quat& _out, const float _animationTime, const BoneAnim &_boneAnin)
+void Rig::CalcInterpolatedRotation(glm::quat& _out, const float _animationTime, const BoneAnim &_boneAnin) const
 {
     if (_boneAnin.m_rotAnim.size() < 1) {
         glm::mat4 a(1.0f);
@@ -121,7 +139,7 @@ void Rig::CalcInterpolatedRotation(glm::quat& _out, const float _animationTime,
     glm::normalize(_out);
 }
 
-void Rig::CalcInterpolatedPosition(glm::vec3& _out, const float _animationTime, const BoneAnim &_boneAnim)
+void Rig::CalcInterpolatedPosition(glm::vec3& _out, const float _animationTime, const BoneAnim &_boneAnim) const
 {
     if (_boneAnim.m_posAnim.size() < 1) {
         _out = glm::vec3(0.0f, 0.0f, 0.0f);
@@ -146,7 +164,7 @@ void Rig::CalcInterpolatedPosition(glm::vec3& _out, const float _animationTime,
 
 }
 
-void Rig::CalcInterpolatedScaling(glm::vec3& _out, const float _animationTime, const BoneAnim &_boneAnim)
+void Rig::CalcInterpolatedScaling(glm::vec3& _out, const float _animationTime, const BoneAnim &_boneAnim) const
 {
     if (_boneAnim.m_scaleAnim.size() < 1) {
         _out = glm::vec3(1.0f, 1.0f, 1.0f);
@@ -171,7 +189,7 @@ void Rig::CalcInterpolatedScaling(glm::vec3& _out, const float _animationTime, c
 
 }
 
-uint Rig::FindRotationKeyFrame(const float _animationTime, const BoneAnim &_boneAnim)
+uint Rig::FindRotationKeyFrame(const float _animationTime, const BoneAnim &_boneAnim) const
 {
     assert(_boneAnim.m_rotAnim.size() > 0);
 
@@ -185,7 +203,7 @@ uint Rig::FindRotationKeyFrame(const float _animationTime, const BoneAnim &_bone
     assert(0);
 }
 
-uint Rig::FindPositionKeyFrame(const float _animationTime, const BoneAnim &_boneAnim)
+uint Rig::FindPositionKeyFrame(const float _animationTime, const BoneAnim &_boneAnim) const
 {
     assert(_boneAnim.m_posAnim.size() > 0);
 
@@ -199,7 +217,7 @@ uint Rig::FindPositionKeyFrame(const float _animationTime, const BoneAnim &_bone
     assert(0);
 }
 
-uint Rig::FindScalingKeyFrame(const float _animationTime, const BoneAnim &_boneAnim)
+uint Rig::FindScalingKeyFrame(const float _animationTime, const BoneAnim &_boneAnim) const
 {
     assert(_boneAnim.m_scaleAnim.size() > 0);
 
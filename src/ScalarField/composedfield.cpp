@@ -1,5 +1,9 @@
 #include "include/ScalarField/composedfield.h"
 #include <glm/gtx/vector_angle.hpp>
+#include <algorithm>
+
+/// @brief Sample points EvalBatch composes at a time, the field values of a batch are held on the stack.
+static const unsigned int EvalBatchSize = 256;
 
 ComposedField::ComposedField()
 {
@@ -51,6 +55,15 @@ void ComposedField::SetCompositionOp(std::shared_ptr<CompositionOp> _composition
 
 
 float ComposedField::Eval(glm::vec3 _x)
+{
+    glm::mat4 transformA = m_fieldFunctionA != nullptr ? m_fieldFunctionA->GetTransform() : glm::mat4(1.0f);
+    glm::mat4 transformB = m_fieldFunctionB != nullptr ? m_fieldFunctionB->GetTransform() : glm::mat4(1.0f);
+
+    return Eval(_x, transformA, transformB);
+}
+
+
+float ComposedField::Eval(glm::vec3 _x, const glm::mat4 &_transformA, const glm::mat4 &_transformB, const float _error)
 {
     // Do a bit of error checking
     if(m_compositionOp == nullptr)
@@ -63,24 +76,90 @@ float ComposedField::Eval(glm::vec3 _x)
     float f1 = 0.0f;
     float f2 = 0.0f;
     float d = 0.0f;
-    if(m_fieldFunctionA != nullptr)
+    const unsigned int levelA = m_fieldFunctionA != nullptr ? m_fieldFunctionA->GetLevel(_error) : 0;
+    const unsigned int levelB = m_fieldFunctionB != nullptr ? m_fieldFunctionB->GetLevel(_error) : 0;
+    if(m_fieldFunctionA != nullptr && m_fieldFunctionB != nullptr)
     {
-        f1 = m_fieldFunctionA->Eval(_x);
-    }
+        // Each field and its gradient come from one transform into its space
+        glm::vec3 g1, g2;
+        f1 = m_fieldFunctionA->EvalGrad(_x, _transformA, g1, levelA);
+        f2 = m_fieldFunctionB->EvalGrad(_x, _transformB, g2, levelB);
+
+        // Where either field is flat its gradient is 0 and the fields are not in contact, take them as parallel
+        float l1 = glm::length(g1);
+        float l2 = glm::length(g2);
+        float angle = (l1 > 0.0f && l2 > 0.0f) ? glm::angle(g1 / l1, g2 / l2) : 0.0f;
 
-    if(m_fieldFunctionB != nullptr)
+        d = m_compositionOp->Theta(angle);
+    }
+    else if(m_fieldFunctionA != nullptr)
     {
-        f2 = m_fieldFunctionB->Eval(_x);
+        f1 = m_fieldFunctionA->Eval(_x, _transformA, levelA);
     }
-
-    if(m_fieldFunctionA != nullptr && m_fieldFunctionB != nullptr)
+    else if(m_fieldFunctionB != nullptr)
     {
-        glm::vec3 g1 = m_fieldFunctionA->Grad(_x);
-        glm::vec3 g2 = m_fieldFunctionB->Grad(_x);
-        float angle = glm::angle(g1, g2);
-
-        d = m_compositionOp->Theta(angle);
+        f2 = m_fieldFunctionB->Eval(_x, _transformB, levelB);
     }
 
     return m_compositionOp->Eval(f1, f2, d);
 }
+
+
+void ComposedField::EvalBatch(const glm::vec3 *_x, const unsigned int _numPoints, float *_f)
+{
+    glm::mat4 transformA = m_fieldFunctionA != nullptr ? m_fieldFunctionA->GetTransform() : glm::mat4(1.0f);
+    glm::mat4 transformB = m_fieldFunctionB != nullptr ? m_fieldFunctionB->GetTransform() : glm::mat4(1.0f);
+
+    EvalBatch(_x, _numPoints, transformA, transformB, _f);
+}
+
+
+void ComposedField::EvalBatch(const glm::vec3 *_x, const unsigned int _numPoints, const glm::mat4 &_transformA, const glm::mat4 &_transformB, float *_f, const float _error)
+{
+    // Do a bit of error checking
+    if(m_compositionOp == nullptr)
+    {
+        std::cout<<"Composition op null in interiornode\n";
+    }
+
+
+    const unsigned int levelA = m_fieldFunctionA != nullptr ? m_fieldFunctionA->GetLevel(_error) : 0;
+    const unsigned int levelB = m_fieldFunctionB != nullptr ? m_fieldFunctionB->GetLevel(_error) : 0;
+    float f1[EvalBatchSize];
+    float f2[EvalBatchSize];
+    float d[EvalBatchSize];
+    for(unsigned int start=0; start<_numPoints; start+=EvalBatchSize)
+    {
+        const unsigned int count = std::min(_numPoints - start, EvalBatchSize);
+        std::fill(f1, f1 + count, 0.0f);
+        std::fill(f2, f2 + count, 0.0f);
+        std::fill(d, d + count, 0.0f);
+
+        if(m_fieldFunctionA != nullptr && m_fieldFunctionB != nullptr)
+        {
+            // The angle between the fields needs both gradients, the lookup that gives a gradient gives the value with it
+            for(unsigned int i=0; i<count; ++i)
+            {
+                glm::vec3 g1, g2;
+                f1[i] = m_fieldFunctionA->EvalGrad(_x[start + i], _transformA, g1, levelA);
+                f2[i] = m_fieldFunctionB->EvalGrad(_x[start + i], _transformB, g2, levelB);
+
+                float l1 = glm::length(g1);
+                float l2 = glm::length(g2);
+                float angle = (l1 > 0.0f && l2 > 0.0f) ? glm::angle(g1 / l1, g2 / l2) : 0.0f;
+
+                d[i] = m_compositionOp->Theta(angle);
+            }
+        }
+        else if(m_fieldFunctionA != nullptr)
+        {
+            m_fieldFunctionA->EvalBatch(_x + start, count, _transformA, f1, levelA);
+        }
+        else if(m_fieldFunctionB != nullptr)
+        {
+            m_fieldFunctionB->EvalBatch(_x + start, count, _transformB, f2, levelB);
+        }
+
+        m_compositionOp->EvalBatch(f1, f2, d, count, _f + start);
+    }
+}
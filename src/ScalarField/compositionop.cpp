@@ -1,4 +1,5 @@
 #include "ScalarField/compositionop.h"
+#include "Threading/threadpool.h"
 
 
 CompositionOp::CompositionOp(const unsigned int _dim):
@@ -107,65 +108,77 @@ void CompositionOp::SetParams(float _alpha0, float _alpha1, float _alpha2,
 
 //-----------------------------------------------------------------------------------------------------
 
-void CompositionOp::Precompute(const unsigned int _res)
+void CompositionOp::Precompute(const unsigned int _res, const bool _gpuTexture)
 {
-    float data[_res*_res*_res];
-    float4 *cuGrad = new float4[_res*_res*_res];
+    std::vector<float> data(_res*_res*_res);
 
     // field value
-    for(unsigned int z=0; z<_res; ++z)
-    {
-        for(unsigned int y=0; y<_res; ++y)
+    ThreadPool::Instance().ParallelFor([&, this](int startZ, int endZ){
+        for(unsigned int z=startZ; z<(unsigned int)endZ; ++z)
         {
-            for(unsigned int x=0; x<_res; ++x)
+            for(unsigned int y=0; y<_res; ++y)
             {
-                float f1 = (float)x/_res;
-                float f2 = (float)y/_res;
-                float d = (float)z/_res;
-                float Ci = f1;
+                for(unsigned int x=0; x<_res; ++x)
+                {
+                    float f1 = (float)x/_res;
+                    float f2 = (float)y/_res;
+                    float d = (float)z/_res;
 
 
-                // old
-                float f = m_compositionOp(f1, f2, d);
-                data[(z*_res*_res) + (y*_res) + x] = f;
+                    // old
+                    float f = m_compositionOp(f1, f2, d);
+                    data[(z*_res*_res) + (y*_res) + x] = f;
+                }
             }
         }
+    }, _res, ThreadPool::Schedule::Dynamic);
+
+    m_field.SetData(_res, &data[0]);
+    m_precomputed = true;
+
+    // CPU evaluation only needs m_field, theta is evaluated analytically
+    if(!_gpuTexture)
+    {
+        return;
     }
 
+#ifndef NO_CUDA
     // gradient
-    for(unsigned int z=0; z<_res; ++z)
-    {
-        for(unsigned int y=0; y<_res; ++y)
+    float4 *cuGrad = new float4[_res*_res*_res];
+    ThreadPool::Instance().ParallelFor([&](int startZ, int endZ){
+        for(unsigned int z=startZ; z<(unsigned int)endZ; ++z)
         {
-            for(unsigned int x=0; x<_res; ++x)
+            for(unsigned int y=0; y<_res; ++y)
             {
-                int id = (z*_res*_res) + (y*_res) + x;
-                int right = (z*_res*_res) + (y*_res) + (x+1);
-                int left = (z*_res*_res) + (y*_res) + (x-1);
-                int up = (z*_res*_res) + ((y+1)*_res) + (x);
-                int down = (z*_res*_res) + ((y-1)*_res) + (x);
-                int forward = ((z+1)*_res*_res) + (y*_res) + (x);
-                int backward = ((z-1)*_res*_res) + (y*_res) + (x);
+                for(unsigned int x=0; x<_res; ++x)
+                {
+                    int id = (z*_res*_res) + (y*_res) + x;
+                    int right = (z*_res*_res) + (y*_res) + (x+1);
+                    int left = (z*_res*_res) + (y*_res) + (x-1);
+                    int up = (z*_res*_res) + ((y+1)*_res) + (x);
+                    int down = (z*_res*_res) + ((y-1)*_res) + (x);
+                    int forward = ((z+1)*_res*_res) + (y*_res) + (x);
+                    int backward = ((z-1)*_res*_res) + (y*_res) + (x);
 
-                float x1, x2, y1, y2, z1, z2;
+                    float x1, x2, y1, y2, z1, z2;
 
-                x1 = (x==0) ? data[right] : data[id];
-                x2 = (x==0) ? data[id] : data[left];
+                    x1 = (x==0) ? data[right] : data[id];
+                    x2 = (x==0) ? data[id] : data[left];
 
-                y1 = (y==0) ? data[up] : data[id];
-                y2 = (y==0) ? data[id] : data[down];
+                    y1 = (y==0) ? data[up] : data[id];
+                    y2 = (y==0) ? data[id] : data[down];
 
-                z1 = (z==0) ? data[forward] : data[id];
-                z2 = (z==0) ? data[id] : data[backward];
+                    z1 = (z==0) ? data[forward] : data[id];
+                    z2 = (z==0) ? data[id] : data[backward];
 
 
-                cuGrad[id] = make_float4(x1-x2, y1-y2, z1-z2, data[id]);
+                    cuGrad[id] = make_float4(x1-x2, y1-y2, z1-z2, data[id]);
 
+                }
             }
         }
-    }
+    }, _res, ThreadPool::Schedule::Dynamic);
 
-    m_field.SetData(_res, data);
     d_field.CreateCudaTexture(_res, cuGrad, cudaFilterModeLinear);
     delete [] cuGrad;
 
@@ -201,10 +214,7 @@ void CompositionOp::Precompute(const unsigned int _res)
 
     d_theta = 0;
     checkCudaErrors(cudaCreateTextureObject(&d_theta, &resDesc, &texDesc, NULL));
-
-
-
-    m_precomputed = true;
+#endif
 }
 
 //-----------------------------------------------------------------------------------------------------
@@ -223,6 +233,23 @@ float CompositionOp::Eval(const float f1, const float f2, const float d)
 
 //-----------------------------------------------------------------------------------------------------
 
+void CompositionOp::EvalBatch(const float *_f1, const float *_f2, const float *_d, const unsigned int _numPoints, float *_out)
+{
+    if(m_precomputed)
+    {
+        m_field.EvalBatch(_f1, _f2, _d, _numPoints, _out);
+    }
+    else
+    {
+        for(unsigned int i=0; i<_numPoints; ++i)
+        {
+            _out[i] = m_compositionOp(_f1[i], _f2[i], _d[i]);
+        }
+    }
+}
+
+//-----------------------------------------------------------------------------------------------------
+
 float CompositionOp::Theta(const float _angleRadians)
 {
     return m_theta(_angleRadians);
@@ -231,6 +258,7 @@ float CompositionOp::Theta(const float _angleRadians)
 
 //-----------------------------------------------------------------------------------------------------
 
+#ifndef NO_CUDA
 cudaTextureObject_t &CompositionOp::GetFieldFunc3DTexture()
 {
     return d_field.GetCudaTextureObject();
@@ -242,3 +270,4 @@ cudaTextureObject_t &CompositionOp::GetThetaTexture()
 {
     return d_theta;
 }
+#endif
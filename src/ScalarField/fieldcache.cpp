@@ -0,0 +1,220 @@
+#include "ScalarField/fieldcache.h"
+#include "Texture/BinaryBlob.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+/// @brief First bytes of every cache file.
+static const char FieldCacheMagic[4] = {'I', 'S', 'F', 'C'};
+
+/// @brief Version of the file layout and of the way fields are generated, bump it whenever either changes so old files miss.
+static const unsigned int FieldCacheVersion = 2;
+
+//------------------------------------------------------------------------------------------------
+
+/// @brief Method to fold bytes into a 64 bit FNV-1a hash
+static FieldCache::Key HashBytes(FieldCache::Key _hash, const void *_data, const std::size_t _size)
+{
+    const unsigned char *bytes = static_cast<const unsigned char*>(_data);
+    for(std::size_t i=0; i<_size; ++i)
+    {
+        _hash = (_hash ^ bytes[i]) * 1099511628211ull;
+    }
+    return _hash;
+}
+
+//------------------------------------------------------------------------------------------------
+
+FieldCache::FieldCache(const std::string &_directory) :
+    m_directory(_directory)
+{
+}
+
+//------------------------------------------------------------------------------------------------
+
+FieldCache::~FieldCache()
+{
+}
+
+//------------------------------------------------------------------------------------------------
+
+std::string FieldCache::DefaultDirectory()
+{
+    const char *cacheHome = std::getenv("XDG_CACHE_HOME");
+    const char *home = std::getenv("HOME");
+    if(cacheHome && cacheHome[0] != '\0')
+    {
+        return std::string(cacheHome) + "/ImplicitSkinning/fields";
+    }
+    else if(home && home[0] != '\0')
+    {
+        return std::string(home) + "/.cache/ImplicitSkinning/fields";
+    }
+
+    return std::string();
+}
+
+//------------------------------------------------------------------------------------------------
+
+FieldCache::Key FieldCache::MakeKey(const Mesh &_meshPart,
+                                    const std::pair<glm::vec3, glm::vec3> &_boneEnds,
+                                    const int _numHrbfCentres,
+                                    const float _hrbfTolerance,
+                                    const int _numVoxels)
+{
+    Key hash = 14695981039346656037ull;
+    hash = HashBytes(hash, &FieldCacheVersion, sizeof(FieldCacheVersion));
+
+    // Sizes first, so the same bytes split differently between the arrays hash differently
+    unsigned long long sizes[3] = {_meshPart.m_meshVerts.size(), _meshPart.m_meshNorms.size(), _meshPart.m_meshTris.size()};
+    hash = HashBytes(hash, sizes, sizeof(sizes));
+    hash = HashBytes(hash, _meshPart.m_meshVerts.data(), _meshPart.m_meshVerts.size() * sizeof(glm::vec3));
+    hash = HashBytes(hash, _meshPart.m_meshNorms.data(), _meshPart.m_meshNorms.size() * sizeof(glm::vec3));
+    hash = HashBytes(hash, _meshPart.m_meshTris.data(), _meshPart.m_meshTris.size() * sizeof(glm::ivec3));
+
+    float boneEnds[6] = {_boneEnds.first.x, _boneEnds.first.y, _boneEnds.first.z,
+                         _boneEnds.second.x, _boneEnds.second.y, _boneEnds.second.z};
+    hash = HashBytes(hash, boneEnds, sizeof(boneEnds));
+    hash = HashBytes(hash, &_numHrbfCentres, sizeof(_numHrbfCentres));
+    hash = HashBytes(hash, &_hrbfTolerance, sizeof(_hrbfTolerance));
+    hash = HashBytes(hash, &_numVoxels, sizeof(_numVoxels));
+
+    return hash;
+}
+
+//------------------------------------------------------------------------------------------------
+
+void FieldCache::SetDirectory(const std::string &_directory)
+{
+    m_directory = _directory;
+}
+
+//------------------------------------------------------------------------------------------------
+
+std::string FieldCache::GetDirectory() const
+{
+    return m_directory;
+}
+
+//------------------------------------------------------------------------------------------------
+
+bool FieldCache::Load(const Key _key, FieldFunction &_fieldFunc, const bool _gpuTexture) const
+{
+    if(m_directory.empty())
+    {
+        return false;
+    }
+
+    int fd = open(FilePath(_key).c_str(), O_RDONLY);
+    if(fd < 0)
+    {
+        return false;
+    }
+
+    // Map the file rather than read it, the textures are copied straight out of the page cache
+    struct stat fileStat;
+    void *mapped = MAP_FAILED;
+    if(fstat(fd, &fileStat) == 0 && fileStat.st_size > 0)
+    {
+        mapped = mmap(nullptr, fileStat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    close(fd);
+    if(mapped == MAP_FAILED)
+    {
+        return false;
+    }
+
+    const char *in = static_cast<const char*>(mapped);
+    const char *end = in + fileStat.st_size;
+
+    char magic[4];
+    unsigned int version;
+    Key key;
+    bool loaded = ReadBlob(in, end, magic, 4) && std::memcmp(magic, FieldCacheMagic, 4) == 0 &&
+                  ReadBlob(in, end, version) && version == FieldCacheVersion &&
+                  ReadBlob(in, end, key) && key == _key &&
+                  _fieldFunc.Deserialise(in, end, _gpuTexture);
+
+    munmap(mapped, fileStat.st_size);
+    return loaded;
+}
+
+//------------------------------------------------------------------------------------------------
+
+bool FieldCache::Save(const Key _key, const FieldFunction &_fieldFunc) const
+{
+    if(m_directory.empty())
+    {
+        return false;
+    }
+
+    std::vector<char> blob;
+    WriteBlob(blob, FieldCacheMagic, 4);
+    WriteBlob(blob, FieldCacheVersion);
+    WriteBlob(blob, _key);
+    if(!_fieldFunc.Serialise(blob))
+    {
+        return false;
+    }
+
+    // Create the directory a level at a time, levels that already exist fail with EEXIST
+    for(std::size_t slash = m_directory.find('/', 1); ; slash = m_directory.find('/', slash + 1))
+    {
+        std::string level = m_directory.substr(0, slash);
+        if(mkdir(level.c_str(), 0755) != 0 && errno != EEXIST)
+        {
+            return false;
+        }
+        if(slash == std::string::npos)
+        {
+            break;
+        }
+    }
+
+    // Threads saving the same key each write their own file, the last rename wins
+    std::string path = FilePath(_key);
+    std::ostringstream tmpPath;
+    tmpPath << path << ".tmp" << std::hash<std::thread::id>()(std::this_thread::get_id());
+    {
+        std::ofstream file(tmpPath.str(), std::ios::binary | std::ios::trunc);
+        file.write(blob.data(), blob.size());
+        file.close();
+        if(!file)
+        {
+            std::remove(tmpPath.str().c_str());
+            return false;
+        }
+    }
+
+    if(std::rename(tmpPath.str().c_str(), path.c_str()) != 0)
+    {
+        std::remove(tmpPath.str().c_str());
+        return false;
+    }
+
+    return true;
+}
+
+//------------------------------------------------------------------------------------------------
+
+std::string FieldCache::FilePath(const Key _key) const
+{
+    std::ostringstream path;
+    path << m_directory << "/" << std::hex << _key << ".field";
+    return path.str();
+}
+
+//------------------------------------------------------------------------------------------------
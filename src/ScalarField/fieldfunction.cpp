@@ -1,16 +1,134 @@
 #include "ScalarField/fieldfunction.h"
+#include "Threading/threadpool.h"
 
 #include <float.h>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <functional>
+#include <map>
+#include <thread>
 
 #include <glm/gtx/string_cast.hpp>
 #include <glm/gtx/transform.hpp>
 
+
+/// @brief Above this many HRBF centres the dense system, (4n)^2 doubles plus its factorisation, gets too big and the fit goes matrix free.
+static const unsigned int MaxDenseHrbfCentres = 1000;
+
+/// @brief Largest error of the float field at the HRBF centres, value plus gradient, before falling back to a float fit.
+static const float MaxFloatFitError = 1e-2f;
+
+/// @brief Change of the distance field, relative to the support radius, and of its gradient below which a voxel is not precomputed again.
+static const float MaxRegionalPrecomputeError = 1e-3f;
+
+/// @brief Default width in voxels of the blocks PrecomputeField evaluates in full or interpolates from their corners.
+static const unsigned int PrecomputeBlockSize = 4;
+
+/// @brief Padding of the box around the HRBF centres GetSupportBounds starts from, relative to its diagonal.
+static const float SupportBoundsPadding = 0.1f;
+
+/// @brief Samples along each edge of a face of the box GetSupportBounds checks the field is 0 on.
+static const unsigned int SupportBoundsFaceSamples = 16;
+
+/// @brief Times GetSupportBounds grows the box before giving up on the field reaching 0 on its faces.
+static const unsigned int MaxSupportBoundsGrowth = 4;
+
+/// @brief Fewest voxels along any axis of a level of the CPU texture, a level any coarser is not built.
+static const unsigned int MinFieldLevelRes = 8;
+
+/// @brief Sample points EvalBatch takes into the field's space at a time, before looking them all up in the texture.
+static const unsigned int EvalBatchSize = 256;
+
+/// @brief State of a brick of a lazily precomputed field, see FieldFunction::SetLazyPrecompute.
+enum LazyBrickState : unsigned char { LazyFilled = 0, LazyPending, LazyFilling };
+
+//------------------------------------------------------------------------------------------------
+
+/// @brief Method to resample a grid along one axis to fewer voxels covering the same box, interpolating linearly between
+/// the voxels either side of each coarser one. Filtering any wider only blurs the narrow band further, a coarse level
+/// is closer to the field sampled directly at its voxels. Voxel i of n sits at i/n of the box, as in VoxelSamplePoint.
+/// @param _src : voxels of the grid, x fastest
+/// @param _srcRes : number of voxels along each axis of _src
+/// @param _axis : axis to resample along
+/// @param _dstDim : number of voxels along _axis after resampling
+/// @param _dst : output, the resampled grid
+static void DownsampleAxis(const std::vector<float> &_src,
+                           const glm::uvec3 &_srcRes,
+                           const unsigned int _axis,
+                           const unsigned int _dstDim,
+                           std::vector<float> &_dst)
+{
+    const unsigned int srcDim = _srcRes[_axis];
+    const float scale = (float)srcDim / _dstDim;
+
+    // Taps of each coarse voxel, the fine voxels either side of it, clamped at the edges
+    std::vector<std::vector<std::pair<unsigned int, float>>> taps(_dstDim);
+    for(unsigned int j=0; j<_dstDim; ++j)
+    {
+        const float centre = j * scale;
+        float sum = 0.0f;
+        for(int i=(int)std::ceil(centre - 1.0f); i<=(int)std::floor(centre + 1.0f); ++i)
+        {
+            float w = 1.0f - std::fabs(i - centre);
+            if(w > 0.0f)
+            {
+                taps[j].push_back(std::make_pair((unsigned int)std::min(std::max(i, 0), (int)srcDim - 1), w));
+                sum += w;
+            }
+        }
+        for(auto &&tap : taps[j])
+        {
+            tap.second /= sum;
+        }
+    }
+
+    glm::uvec3 dstRes = _srcRes;
+    dstRes[_axis] = _dstDim;
+    const glm::uvec3 srcStride(1, _srcRes.x, _srcRes.x * _srcRes.y);
+    const glm::uvec3 dstStride(1, dstRes.x, dstRes.x * dstRes.y);
+
+    _dst.assign(dstRes.x * dstRes.y * dstRes.z, 0.0f);
+    for(unsigned int z=0; z<dstRes.z; ++z)
+    {
+        for(unsigned int y=0; y<dstRes.y; ++y)
+        {
+            for(unsigned int x=0; x<dstRes.x; ++x)
+            {
+                glm::uvec3 voxel(x, y, z);
+                unsigned int j = voxel[_axis];
+                voxel[_axis] = 0;
+                const float *src = &_src[(voxel.z * srcStride.z) + (voxel.y * srcStride.y) + voxel.x];
+
+                float f = 0.0f;
+                for(auto &&tap : taps[j])
+                {
+                    f += tap.second * src[tap.first * srcStride[_axis]];
+                }
+                _dst[(z * dstStride.z) + (y * dstStride.y) + x] = f;
+            }
+        }
+    }
+}
+
+//------------------------------------------------------------------------------------------------
+
 FieldFunction::FieldFunction() :
     m_fit(false),
     m_precomputedGPU(false),
     m_precomputedCPU(false),
     m_transform(glm::mat4(1.0f)),
-    m_textureSpaceTransform(glm::mat4(1.0f))
+    m_textureSpaceTransform(glm::mat4(1.0f)),
+    m_incrementalRefit(false),
+    m_rawTransform(glm::mat4(1.0f)),
+    m_precomputeBlockSize(PrecomputeBlockSize),
+    m_textureRes(0, 0, 0),
+    m_textureBoundsMin(0.0f),
+    m_textureBoundsMax(0.0f),
+    m_lazyPrecompute(false),
+    m_numLazyBricks(0),
+    m_numUnfilledBricks(0),
+    m_lazyTransform(glm::mat4(1.0f))
 {
 }
 
@@ -25,7 +143,8 @@ FieldFunction::~FieldFunction()
 
 void FieldFunction::Fit(const std::vector<glm::vec3>& points,
                         const std::vector<glm::vec3>& normals,
-                        const float _r)
+                        const float _r,
+                        DistanceFieldFit::Workspace *_workspace)
 {
     if(points.size() < 3 || normals.size() < 3)
     {
@@ -50,70 +169,408 @@ void FieldFunction::Fit(const std::vector<glm::vec3>& points,
         DFVnormals.emplace_back(DistanceField::Vector(n.x, n.y, n.z));
     }
 
-    m_distanceField.hermite_fit(DFVpoints, DFVnormals);
+    // Rows of the design matrix get shorter down the upper triangle, so hand them out dynamically
+    auto parallelFor = [](const std::function<void(int, int)> &func, int size){
+        ThreadPool::Instance().ParallelFor(func, size, ThreadPool::Schedule::Dynamic, 8);
+    };
+    auto solver = points.size() > MaxDenseHrbfCentres ? DistanceFieldFit::ITERATIVE : DistanceFieldFit::LDLT;
+
+    // Fit in double, the r^3 system is too badly conditioned for float without the slow full pivoting LU
+    std::vector<DistanceFieldFit::Vector> fitPoints;
+    fitPoints.reserve(DFVpoints.size());
+    std::vector<DistanceFieldFit::Vector> fitNormals;
+    fitNormals.reserve(DFVnormals.size());
+    for(unsigned int i=0; i<DFVpoints.size(); i++)
+    {
+        fitPoints.emplace_back(DFVpoints[i].cast<double>());
+        fitNormals.emplace_back(DFVnormals[i].cast<double>());
+    }
+
+    // Refitting incrementally only the centres that changed go through the kept factorisation
+    bool updated = m_incrementalRefit && m_fit && UpdateFit(fitPoints, fitNormals);
+
+    DistanceFieldFit localFit;
+    DistanceFieldFit &fit = m_incrementalRefit ? m_incrementalFit : localFit;
+    if(!updated)
+    {
+        fit.set_parallel_for(parallelFor);
+        fit.set_solver(solver);
+        fit.set_keep_factorisation(m_incrementalRefit);
+        fit.hermite_fit(fitPoints, fitNormals, _workspace);
+
+        if(m_incrementalRefit)
+        {
+            m_fitPoints = fitPoints;
+            m_fitNormals = fitNormals;
+        }
+    }
+
+    // and evaluate in float
+    m_distanceField.assign_from(fit);
+
+    // Nearly coincident centres get huge weights that cancel in double but not in float, fit those in float instead
+    std::vector<float> values(DFVpoints.size());
+    std::vector<DistanceField::Vector> grads(DFVpoints.size());
+    m_distanceField.eval_grad(DFVpoints.data(), DFVpoints.size(), values.data(), grads.data());
+
+    float maxError = 0.0f;
+    for(unsigned int i=0; i<DFVpoints.size(); i++)
+    {
+        maxError = std::max(maxError, std::fabs(values[i]) + (grads[i] - DFVnormals[i]).norm());
+    }
+
+    if(!(maxError <= MaxFloatFitError))
+    {
+        m_distanceField.set_parallel_for(parallelFor);
+        m_distanceField.set_solver(solver == DistanceFieldFit::ITERATIVE ? DistanceField::ITERATIVE : DistanceField::LDLT);
+        m_distanceField.hermite_fit(DFVpoints, DFVnormals);
+    }
 
     m_fit = true;
 }
 
 //------------------------------------------------------------------------------------------------
 
-void FieldFunction::PrecomputeField(const unsigned int _res, const float _dim)
+void FieldFunction::PrecomputeField(const unsigned int _res, const float _dim, const bool _gpuTexture)
 {
-    float *data = new float[_res*_res*_res];
-    glm::vec3 *grad = new glm::vec3[_res*_res*_res];
-    float4 *cuFieldNGrad = new float4[_res*_res*_res];
+    PrecomputeField(glm::uvec3(_res, _res, _res), glm::vec3(-_dim, -_dim, -_dim), glm::vec3(_dim, _dim, _dim), _gpuTexture);
+}
 
-    for(unsigned int z=0; z<_res; ++z)
+//------------------------------------------------------------------------------------------------
+
+void FieldFunction::PrecomputeField(const glm::uvec3 &_res, const glm::vec3 &_boundsMin, const glm::vec3 &_boundsMax, const bool _gpuTexture)
+{
+    const unsigned int numVoxels = _res.x*_res.y*_res.z;
+    const unsigned int step = m_precomputeBlockSize;
+    const glm::uvec3 numBlocks = (_res + glm::uvec3(step - 1)) / glm::uvec3(step);
+    const glm::uvec3 numCorners = numBlocks + glm::uvec3(1);
+
+    // Refitting incrementally, keep the gradient and distance before remapping, and which blocks hold evaluated
+    // rather than interpolated voxels. On the same grid, evaluated blocks the refit did not change are kept.
+    bool keepRaw = m_incrementalRefit && m_fit;
+
+    // Lazily, blocks near the surface are only interpolated from their corners here, as placeholders,
+    // their bricks are filled exactly as lookups reach them
+    const bool lazy = m_lazyPrecompute && m_fit && !keepRaw && !_gpuTexture;
+    bool regional = keepRaw && m_rawField.size() == numVoxels && m_textureRes == _res &&
+            m_textureBoundsMin == _boundsMin && m_textureBoundsMax == _boundsMax && m_rawTransform == m_transform;
+    std::vector<glm::vec4> rawField;
+    std::vector<unsigned char> exactBlocks;
+    if(regional)
+    {
+        rawField.swap(m_rawField);
+        exactBlocks.swap(m_rawExactBlocks);
+    }
+    else if(keepRaw)
     {
-        for(unsigned int y=0; y<_res; ++y)
+        rawField.resize(numVoxels);
+    }
+
+    m_textureRes = _res;
+    m_textureBoundsMin = _boundsMin;
+    m_textureBoundsMax = _boundsMax;
+
+    // Remap is flat further than the support radius from the surface, so evaluate the block corners first
+    // and only evaluate every voxel of the blocks that can reach into that band
+    std::vector<glm::vec4> corners;
+    std::vector<unsigned char> bandBlocks(numBlocks.x*numBlocks.y*numBlocks.z, 0);
+    std::vector<unsigned char> evalBlocks(numBlocks.x*numBlocks.y*numBlocks.z, 0);
+    if(m_fit)
+    {
+        SampleBlockCorners(corners);
+        FindBandBlocks(corners, bandBlocks);
+
+        std::vector<unsigned char> changedBlocks;
+        if(regional)
         {
-            for(unsigned int x=0; x<_res; ++x)
-            {
-                glm::vec3 point(_dim*((((float)x/_res)*2.0f)-1.0f),
-                                _dim*((((float)y/_res)*2.0f)-1.0f),
-                                _dim*((((float)z/_res)*2.0f)-1.0f));
+            FindChangedBlocks(corners, rawField, changedBlocks);
+        }
+
+        for(unsigned int b=0; b<evalBlocks.size(); ++b)
+        {
+            evalBlocks[b] = !lazy && bandBlocks[b] && (!regional || !exactBlocks[b] || changedBlocks[b]);
+        }
+    }
+
+    // Interpolation weight of each voxel between the corners of its block, per axis
+    std::vector<float> blockWeights[3];
+    for(unsigned int axis=0; axis<3; ++axis)
+    {
+        blockWeights[axis].resize(_res[axis]);
+        for(unsigned int x=0; x<_res[axis]; ++x)
+        {
+            unsigned int x0 = std::min((x/step)*step, _res[axis]-1);
+            unsigned int x1 = std::min((x/step + 1)*step, _res[axis]-1);
+            blockWeights[axis][x] = x1 > x0 ? float(x - x0) / (x1 - x0) : 0.0f;
+        }
+    }
 
-                glm::vec3 tx = TransformSpace(point);
-                auto samplePoint = DistanceField::Vector(tx.x, tx.y, tx.z);
+    float *data = new float[numVoxels];
+    // The CPU gradient comes from the field texture itself, only the CUDA texture stores one
+    glm::vec3 *grad = _gpuTexture ? new glm::vec3[numVoxels] : nullptr;
+    std::vector<float> maxGrad(_res.z, 0.0f);
+
+    // Each z slab is its own task so large grids spread across idle threads, even when called from a task already
+    auto slabFunc = [&, this](int startZ, int endZ){
+        // A row of samples at a time goes through the batched HRBF evaluation
+        std::vector<DistanceField::Vector> samplePoints(_res.x);
+        std::vector<DistanceField::Vector> sampleGrads(_res.x);
+        std::vector<float> sampleValues(_res.x);
+        std::vector<unsigned int> sampleX(_res.x);
+        std::vector<glm::vec4> rowCorners(numCorners.x);
+        std::vector<glm::vec4> row(_res.x, glm::vec4(0.0f));
+
+        for(unsigned int z=startZ; z<(unsigned int)endZ; ++z)
+        {
+            unsigned int bz = z / step;
+            for(unsigned int y=0; y<_res.y; ++y)
+            {
+                unsigned int by = y / step;
+                unsigned int rowStart = (z*_res.y*_res.x) + (y*_res.x);
 
-                float d = 0.0f;
-                DistanceField::Vector g(0.0f, 0.0f, 0.0f);
                 if(m_fit)
                 {
-                    d = Remap(m_distanceField.eval(samplePoint));
-                    g = m_distanceField.grad(samplePoint);
+                    // Corners interpolated to this row, so interpolated voxels are one lerp along x
+                    for(unsigned int cx=0; cx<numCorners.x; ++cx)
+                    {
+                        auto corner = [&](unsigned int j, unsigned int k){
+                            return corners[((bz+k)*numCorners.y*numCorners.x) + ((by+j)*numCorners.x) + cx];
+                        };
+                        rowCorners[cx] = glm::mix(glm::mix(corner(0, 0), corner(1, 0), blockWeights[1][y]),
+                                                  glm::mix(corner(0, 1), corner(1, 1), blockWeights[1][y]),
+                                                  blockWeights[2][z]);
+                    }
+
+                    unsigned int numSamples = 0;
+                    for(unsigned int x=0; x<_res.x; ++x)
+                    {
+                        unsigned int bx = x / step;
+                        unsigned int block = (bz*numBlocks.y*numBlocks.x) + (by*numBlocks.x) + bx;
+
+                        if(evalBlocks[block])
+                        {
+                            sampleX[numSamples] = x;
+                            samplePoints[numSamples] = VoxelSamplePoint(x, y, z);
+                            numSamples++;
+                        }
+                        else if(bandBlocks[block] && !lazy)
+                        {
+                            row[x] = rawField[rowStart + x];
+                        }
+                        else
+                        {
+                            row[x] = glm::mix(rowCorners[bx], rowCorners[bx+1], blockWeights[0][x]);
+                        }
+                    }
+
+                    if(numSamples > 0)
+                    {
+                        m_distanceField.eval_grad(samplePoints.data(), numSamples, sampleValues.data(), sampleGrads.data());
+                    }
+
+                    for(unsigned int i=0; i<numSamples; ++i)
+                    {
+                        const DistanceField::Vector &g = sampleGrads[i];
+                        row[sampleX[i]] = glm::vec4(g(0), g(1), g(2), sampleValues[i]);
+                    }
+
+                    if(keepRaw)
+                    {
+                        std::copy(row.begin(), row.end(), rawField.begin() + rowStart);
+                    }
                 }
 
-                data[(z*_res*_res) + (y*_res)+ x] = d;
-                grad[(z*_res*_res) + (y*_res)+ x] = glm::vec3(g(0), g(1), g(2));
-                cuFieldNGrad[(z*_res*_res) + (y*_res)+ x] = make_float4(g(0), g(1), g(2), d);
+                for(unsigned int x=0; x<_res.x; ++x)
+                {
+                    const glm::vec4 &r = row[x];
+                    float d = m_fit ? Remap(r.w) : 0.0f;
+
+                    data[rowStart + x] = d;
+                    if(grad)
+                    {
+                        grad[rowStart + x] = glm::vec3(r.x, r.y, r.z);
+                        maxGrad[z] = std::max(maxGrad[z], std::max(std::fabs(r.x), std::max(std::fabs(r.y), std::fabs(r.z))));
+                    }
+                }
             }
         }
-    }
+    };
 
-    if(m_fit)
+    ThreadPool::Instance().ParallelFor(slabFunc, _res.z, ThreadPool::Schedule::Dynamic);
+
+    // create texture space transform, the box maps to [0:1] along each axis
+    m_textureSpaceTransform = glm::scale(glm::mat4(1.0f), 1.0f / (_boundsMax - _boundsMin));
+    m_textureSpaceTransform = glm::translate(m_textureSpaceTransform, -_boundsMin);
+
+    m_field.SetTextureSpaceTransform(m_textureSpaceTransform);
+
+    std::vector<std::atomic<unsigned char> >().swap(m_lazyBricks);
+    m_numLazyBricks = 0;
+    m_numUnfilledBricks = 0;
+    if(lazy)
+    {
+        // A brick is filled lazily when any of its blocks is in the band, the field is in [0:1] whatever the placeholders are
+        const unsigned int brickSize = SparseTexture3DCpu<float, unsigned short>::BrickSize;
+        const glm::uvec3 brickDim = (_res + glm::uvec3(brickSize - 1)) / glm::uvec3(brickSize);
+        std::vector<unsigned char> lazyBricks(brickDim.x*brickDim.y*brickDim.z, 0);
+        for(unsigned int bz=0; bz<numBlocks.z; ++bz)
+        {
+            for(unsigned int by=0; by<numBlocks.y; ++by)
+            {
+                for(unsigned int bx=0; bx<numBlocks.x; ++bx)
+                {
+                    if(bandBlocks[(bz*numBlocks.y*numBlocks.x) + (by*numBlocks.x) + bx])
+                    {
+                        glm::uvec3 brick = (glm::uvec3(bx, by, bz) * step) / glm::uvec3(brickSize);
+                        lazyBricks[(brick.z*brickDim.y*brickDim.x) + (brick.y*brickDim.x) + brick.x] = 1;
+                    }
+                }
+            }
+        }
+
+        m_field.SetLazyData(_res, data, lazyBricks, 1.0f);
+        std::vector<std::atomic<unsigned char> >(lazyBricks.size()).swap(m_lazyBricks);
+        for(unsigned int b=0; b<lazyBricks.size(); ++b)
+        {
+            m_lazyBricks[b] = lazyBricks[b] ? LazyPending : LazyFilled;
+            m_numLazyBricks += lazyBricks[b];
+        }
+        m_numUnfilledBricks = m_numLazyBricks.load();
+        m_lazyTransform = m_transform;
+        BuildFieldLevels(data);
+        m_precomputedCPU = true;
+    }
+    else if(m_fit)
     {
         m_field.SetData(_res, data);
-        m_grad.SetData(_res, grad);
+        BuildFieldLevels(data);
         m_precomputedCPU = true;
     }
-    d_field.CreateCudaTexture(_res, cuFieldNGrad, cudaFilterModeLinear);
-//    d_grad.CreateCudaTexture(_res, cuFieldNGrad, cudaFilterModeLinear);
-    delete [] cuFieldNGrad;
+    if(_gpuTexture)
+    {
+        CreateFieldTexture(data, grad, *std::max_element(maxGrad.begin(), maxGrad.end()));
+    }
     delete [] data;
     delete [] grad;
-    m_precomputedGPU = true;
 
+    // Keep what the next incremental precompute starts from
+    if(keepRaw)
+    {
+        m_rawField.swap(rawField);
+        m_rawExactBlocks.swap(bandBlocks);
+        m_rawTransform = m_transform;
+    }
+    else
+    {
+        std::vector<glm::vec4>().swap(m_rawField);
+        std::vector<unsigned char>().swap(m_rawExactBlocks);
+    }
 
-    // create texture space transform
-    m_textureSpaceTransform = glm::scale(glm::mat4(1.0f), glm::vec3(0.5f, 0.5f, 0.5f));
-    m_textureSpaceTransform = glm::translate(m_textureSpaceTransform, glm::vec3(1.0f, 1.0f, 1.0f));
-    m_textureSpaceTransform = glm::scale(m_textureSpaceTransform, glm::vec3(1.0f/_dim, 1.0f/_dim, 1.0f/_dim));
+}
 
+//------------------------------------------------------------------------------------------------
 
-    m_field.SetTextureSpaceTransform(m_textureSpaceTransform);
-    m_grad.SetTextureSpaceTransform(m_textureSpaceTransform);
+void FieldFunction::GetSupportBounds(glm::vec3 &_boundsMin, glm::vec3 &_boundsMax)
+{
+    _boundsMin = glm::vec3(-1.0f, -1.0f, -1.0f);
+    _boundsMax = glm::vec3(1.0f, 1.0f, 1.0f);
+    if(!m_fit || m_distanceField._node_centers.cols() == 0)
+    {
+        return;
+    }
+
+    // The surface goes through the HRBF centres, start from their box plus the band around the surface
+    const auto &centers = m_distanceField._node_centers;
+    _boundsMin = glm::vec3(centers.row(0).minCoeff(), centers.row(1).minCoeff(), centers.row(2).minCoeff());
+    _boundsMax = glm::vec3(centers.row(0).maxCoeff(), centers.row(1).maxCoeff(), centers.row(2).maxCoeff());
+    glm::vec3 padding((SupportBoundsPadding * glm::distance(_boundsMin, _boundsMax)) + m_supportRad);
+    _boundsMin -= padding;
+    _boundsMax += padding;
+
+    // Between centres the surface can bulge out of that box, grow it until the field is 0 all over its faces
+    const unsigned int n = SupportBoundsFaceSamples;
+    std::vector<DistanceField::Vector> samplePoints;
+    samplePoints.reserve(6*n*n);
+    std::vector<DistanceField::Vector> sampleGrads(6*n*n);
+    std::vector<float> sampleValues(6*n*n);
+    for(unsigned int attempt=0; attempt<MaxSupportBoundsGrowth; ++attempt)
+    {
+        samplePoints.clear();
+        for(unsigned int axis=0; axis<3; ++axis)
+        {
+            for(unsigned int side=0; side<2; ++side)
+            {
+                for(unsigned int j=0; j<n; ++j)
+                {
+                    for(unsigned int i=0; i<n; ++i)
+                    {
+                        glm::vec3 t(0.0f);
+                        t[axis] = float(side);
+                        t[(axis+1)%3] = float(i) / (n-1);
+                        t[(axis+2)%3] = float(j) / (n-1);
+                        glm::vec3 p = TransformSpace(_boundsMin + ((_boundsMax - _boundsMin) * t));
+                        samplePoints.emplace_back(DistanceField::Vector(p.x, p.y, p.z));
+                    }
+                }
+            }
+        }
+
+        m_distanceField.eval_grad(samplePoints.data(), samplePoints.size(), sampleValues.data(), sampleGrads.data());
+        if(std::all_of(sampleValues.begin(), sampleValues.end(), [this](float d){ return d >= m_supportRad; }))
+        {
+            break;
+        }
 
+        glm::vec3 grow = 0.25f * (_boundsMax - _boundsMin);
+        _boundsMin -= grow;
+        _boundsMax += grow;
+    }
+}
+
+//------------------------------------------------------------------------------------------------
+
+void FieldFunction::GetTextureBounds(glm::vec3 &_boundsMin, glm::vec3 &_boundsMax) const
+{
+    _boundsMin = m_textureBoundsMin;
+    _boundsMax = m_textureBoundsMax;
+}
+
+//------------------------------------------------------------------------------------------------
+
+glm::uvec3 FieldFunction::GetTextureResolution(const unsigned int _level) const
+{
+    if(_level == 0 || m_numLazyBricks > 0 || m_fieldLevels.empty())
+    {
+        return m_textureRes;
+    }
+
+    return m_fieldLevels[std::min(_level, (unsigned int)m_fieldLevels.size()) - 1].GetDim();
+}
+
+//------------------------------------------------------------------------------------------------
+
+unsigned int FieldFunction::GetNumLevels() const
+{
+    return m_numLazyBricks > 0 ? 1 : 1 + m_fieldLevels.size();
+}
+
+//------------------------------------------------------------------------------------------------
+
+unsigned int FieldFunction::GetLevel(const float _error) const
+{
+    // The coarser levels may be being built by the lookup that fills the last lazy brick
+    if(m_numLazyBricks > 0)
+    {
+        return 0;
+    }
+
+    unsigned int level = 0;
+    while(level + 1 < m_levelVoxelSize.size() && m_levelVoxelSize[level + 1] <= _error)
+    {
+        ++level;
+    }
+
+    return level;
 }
 
 //------------------------------------------------------------------------------------------------
@@ -125,6 +582,116 @@ void FieldFunction::SetSupportRadius(const float _r)
 
 //------------------------------------------------------------------------------------------------
 
+void FieldFunction::SetPrecomputeBlockSize(const unsigned int _blockSize)
+{
+    const unsigned int blockSize = std::max(_blockSize, 1u);
+    if(blockSize != m_precomputeBlockSize)
+    {
+        // The evaluated blocks of the last precompute no longer line up
+        m_precomputeBlockSize = blockSize;
+        std::vector<glm::vec4>().swap(m_rawField);
+        std::vector<unsigned char>().swap(m_rawExactBlocks);
+    }
+}
+
+//------------------------------------------------------------------------------------------------
+
+unsigned int FieldFunction::GetPrecomputeBlockSize() const
+{
+    return m_precomputeBlockSize;
+}
+
+//------------------------------------------------------------------------------------------------
+
+void FieldFunction::SetIncrementalRefit(const bool _incremental)
+{
+    m_incrementalRefit = _incremental;
+
+    if(!m_incrementalRefit)
+    {
+        m_incrementalFit = DistanceFieldFit();
+        std::vector<DistanceFieldFit::Vector>().swap(m_fitPoints);
+        std::vector<DistanceFieldFit::Vector>().swap(m_fitNormals);
+        std::vector<glm::vec4>().swap(m_rawField);
+        std::vector<unsigned char>().swap(m_rawExactBlocks);
+    }
+}
+
+//------------------------------------------------------------------------------------------------
+
+bool FieldFunction::IsIncrementalRefit() const
+{
+    return m_incrementalRefit;
+}
+
+//------------------------------------------------------------------------------------------------
+
+void FieldFunction::SetLazyPrecompute(const bool _lazy)
+{
+    m_lazyPrecompute = _lazy;
+}
+
+//------------------------------------------------------------------------------------------------
+
+bool FieldFunction::IsLazyPrecompute() const
+{
+    return m_lazyPrecompute;
+}
+
+//------------------------------------------------------------------------------------------------
+
+bool FieldFunction::HasLazyBricks() const
+{
+    return m_numLazyBricks > 0;
+}
+
+//------------------------------------------------------------------------------------------------
+
+bool FieldFunction::FinishLazyPrecompute(const bool _gpuTexture)
+{
+    if(m_lazyBricks.empty())
+    {
+        return false;
+    }
+
+    // The bricks no lookup has reached, filled in parallel as lookups on different threads would fill them
+    const glm::uvec3 brickDim = m_field.GetBrickDim();
+    std::vector<glm::uvec3> pendingBricks;
+    for(unsigned int bz=0; bz<brickDim.z; ++bz)
+    {
+        for(unsigned int by=0; by<brickDim.y; ++by)
+        {
+            for(unsigned int bx=0; bx<brickDim.x; ++bx)
+            {
+                if(m_lazyBricks[(bz*brickDim.y*brickDim.x) + (by*brickDim.x) + bx].load(std::memory_order_acquire) != LazyFilled)
+                {
+                    pendingBricks.push_back(glm::uvec3(bx, by, bz));
+                }
+            }
+        }
+    }
+
+    ThreadPool::Instance().ParallelFor([&, this](int startBrick, int endBrick){
+        for(int b=startBrick; b<endBrick; ++b)
+        {
+            FillLazyBrick(pendingBricks[b]);
+        }
+    }, pendingBricks.size(), ThreadPool::Schedule::Dynamic);
+    std::vector<std::atomic<unsigned char> >().swap(m_lazyBricks);
+
+    // Every voxel is exact now and the last brick filled built the coarser levels, lookups may have filled them all already
+    if(_gpuTexture)
+    {
+        std::vector<float> fieldData;
+        m_field.GetData(fieldData);
+        CreateFieldTexture(fieldData);
+    }
+
+    return true;
+}
+
+//------------------------------------------------------------------------------------------------
+
 void FieldFunction::SetTransform(glm::mat4 _transform)
 {
     m_transform = _transform;
@@ -147,16 +714,27 @@ glm::mat4 FieldFunction::GetTextureSpaceTransform() const
 //------------------------------------------------------------------------------------------------
 
 float FieldFunction::Eval(const glm::vec3 &_x)
+{
+    return Eval(_x, m_transform);
+}
+
+//------------------------------------------------------------------------------------------------
+
+float FieldFunction::Eval(const glm::vec3 &_x, const glm::mat4 &_transform, const unsigned int _level)
 {
     if(!m_fit)
     {
         return 0.0f;
     }
 
-    glm::vec3 tx = TransformSpace(_x);
+    glm::vec3 tx = TransformSpace(_x, _transform);
+    if(m_numLazyBricks > 0)
+    {
+        FillLazyBricks(tx);
+    }
 
     // texture lookup
-    float f = m_field.Eval(tx);
+    float f = FieldLevel(_level).Eval(tx);
 
     // accurate evaluation
 //    float f = Remap(m_distanceField.eval(DistanceField::Vector(tx.x, tx.y, tx.z)));
@@ -167,6 +745,33 @@ float FieldFunction::Eval(const glm::vec3 &_x)
 
 //------------------------------------------------------------------------------------------------
 
+void FieldFunction::EvalBatch(const glm::vec3 *_x, const unsigned int _numPoints, const glm::mat4 &_transform, float *_f, const unsigned int _level)
+{
+    if(!m_fit)
+    {
+        std::fill(_f, _f + _numPoints, 0.0f);
+        return;
+    }
+
+    glm::vec3 tx[EvalBatchSize];
+    for(unsigned int start=0; start<_numPoints; start+=EvalBatchSize)
+    {
+        unsigned int count = std::min(_numPoints - start, EvalBatchSize);
+        for(unsigned int i=0; i<count; ++i)
+        {
+            tx[i] = TransformSpace(_x[start + i], _transform);
+            if(m_numLazyBricks > 0)
+            {
+                FillLazyBricks(tx[i]);
+            }
+        }
+
+        FieldLevel(_level).EvalBatch(tx, count, _f + start);
+    }
+}
+
+//------------------------------------------------------------------------------------------------
+
 float FieldFunction::EvalDist(const glm::vec3& x)
 {
     if(!m_fit)
@@ -180,18 +785,58 @@ float FieldFunction::EvalDist(const glm::vec3& x)
 
 //------------------------------------------------------------------------------------------------
 
+void FieldFunction::EvalDistGrad(const std::vector<glm::vec3>& _x, std::vector<float>& _dist, std::vector<glm::vec3>& _grad)
+{
+    _dist.assign(_x.size(), 0.0f);
+    _grad.assign(_x.size(), glm::vec3(0.0f, 1.0f, 0.0f));
+    if(!m_fit || _x.empty())
+    {
+        return;
+    }
+
+    std::vector<DistanceField::Vector> samplePoints;
+    samplePoints.reserve(_x.size());
+    for(auto &&x : _x)
+    {
+        glm::vec3 tx = TransformSpace(x);
+        samplePoints.emplace_back(DistanceField::Vector(tx.x, tx.y, tx.z));
+    }
+
+    std::vector<DistanceField::Vector> sampleGrads(_x.size());
+    m_distanceField.eval_grad(samplePoints.data(), samplePoints.size(), _dist.data(), sampleGrads.data());
+
+    for(unsigned int i=0; i<_x.size(); i++)
+    {
+        _grad[i] = glm::vec3(sampleGrads[i](0), sampleGrads[i](1), sampleGrads[i](2));
+    }
+}
+
+//------------------------------------------------------------------------------------------------
+
 glm::vec3 FieldFunction::Grad(const glm::vec3& x)
+{
+    return Grad(x, m_transform);
+}
+
+//------------------------------------------------------------------------------------------------
+
+glm::vec3 FieldFunction::Grad(const glm::vec3& _x, const glm::mat4& _transform, const unsigned int _level)
 {
     if(!m_fit)
     {
         return glm::vec3(0.0f, 1.0f, 0.0f);
     }
 
-    glm::vec3 tx = TransformSpace(x);
-
+    glm::vec3 tx = TransformSpace(_x, _transform);
+    if(m_numLazyBricks > 0)
+    {
+        FillLazyBricks(tx);
+    }
 
-    // texture lookup
-    glm::vec3 grad = m_grad.Eval(tx);
+    // EvalGrad's gradient without its value, for callers that look the values up in a batch
+    glm::vec3 grad;
+    FieldLevel(_level).EvalGrad(tx, grad);
+    grad = glm::transpose(glm::mat3(_transform)) * grad;
 
     // more accurate but heavy gradient computation
 //    glm::vec3 tx = TransformSpace(x);
@@ -204,10 +849,45 @@ glm::vec3 FieldFunction::Grad(const glm::vec3& x)
 
 //------------------------------------------------------------------------------------------------
 
+float FieldFunction::EvalGrad(const glm::vec3 &_x, glm::vec3 &_grad)
+{
+    return EvalGrad(_x, m_transform, _grad);
+}
+
+//------------------------------------------------------------------------------------------------
+
+float FieldFunction::EvalGrad(const glm::vec3 &_x, const glm::mat4 &_transform, glm::vec3 &_grad, const unsigned int _level)
+{
+    if(!m_fit)
+    {
+        _grad = glm::vec3(0.0f, 1.0f, 0.0f);
+        return 0.0f;
+    }
+
+    glm::vec3 tx = TransformSpace(_x, _transform);
+    if(m_numLazyBricks > 0)
+    {
+        FillLazyBricks(tx);
+    }
+
+    // Value and gradient from the one trilinear lookup, this is on the per vertex path of the deformer so the
+    // tricubic EvalCubic, 64 voxels a lookup, is left to callers that need a continuous gradient.
+    // The gradient is in the space of this field so take it back through _transform
+    glm::vec3 grad;
+    float f = FieldLevel(_level).EvalGrad(tx, grad);
+    _grad = glm::transpose(glm::mat3(_transform)) * grad;
+
+    return f;
+}
+
+//------------------------------------------------------------------------------------------------
+
+#ifndef NO_CUDA
 cudaTextureObject_t &FieldFunction::GetFieldFuncCudaTextureObject()
 {
     return d_field.GetCudaTextureObject();
 }
+#endif
 
 //------------------------------------------------------------------------------------------------
 
@@ -218,6 +898,103 @@ cudaTextureObject_t &FieldFunction::GetFieldFuncCudaTextureObject()
 
 //------------------------------------------------------------------------------------------------
 
+bool FieldFunction::Serialise(std::vector<char> &_out) const
+{
+    if(!m_fit || !m_precomputedCPU || m_numLazyBricks > 0)
+    {
+        return false;
+    }
+
+    WriteBlob(_out, m_supportRad);
+    WriteBlob(_out, &m_textureRes[0], 3);
+    WriteBlob(_out, &m_textureBoundsMin[0], 3);
+    WriteBlob(_out, &m_textureBoundsMax[0], 3);
+    WriteBlob(_out, &m_textureSpaceTransform[0][0], 16);
+
+    // Float weights, the double precision fit they came from is only needed to refit
+    unsigned int numCentres = m_distanceField._node_centers.cols();
+    WriteBlob(_out, numCentres);
+    WriteBlob(_out, m_distanceField._node_centers.data(), 3 * numCentres);
+    WriteBlob(_out, m_distanceField._alphas.data(), numCentres);
+    WriteBlob(_out, m_distanceField._betas.data(), 3 * numCentres);
+
+    m_field.Serialise(_out);
+    return true;
+}
+
+//------------------------------------------------------------------------------------------------
+
+bool FieldFunction::Deserialise(const char *&_in, const char *_end, const bool _gpuTexture)
+{
+    float supportRad;
+    glm::uvec3 res;
+    glm::vec3 boundsMin, boundsMax;
+    glm::mat4 textureSpaceTransform;
+    unsigned int numCentres;
+    if(!ReadBlob(_in, _end, supportRad) || !ReadBlob(_in, _end, &res[0], 3) ||
+       !ReadBlob(_in, _end, &boundsMin[0], 3) || !ReadBlob(_in, _end, &boundsMax[0], 3) ||
+       !ReadBlob(_in, _end, &textureSpaceTransform[0][0], 16) || !ReadBlob(_in, _end, numCentres) ||
+       numCentres < 3 || numCentres > (std::size_t)(_end - _in) / (7 * sizeof(float)))
+    {
+        return false;
+    }
+
+    DistanceField distanceField;
+    distanceField._node_centers.resize(3, numCentres);
+    distanceField._alphas.resize(numCentres);
+    distanceField._betas.resize(3, numCentres);
+    if(!ReadBlob(_in, _end, distanceField._node_centers.data(), 3 * numCentres) ||
+       !ReadBlob(_in, _end, distanceField._alphas.data(), numCentres) ||
+       !ReadBlob(_in, _end, distanceField._betas.data(), 3 * numCentres))
+    {
+        return false;
+    }
+
+    SparseTexture3DCpu<float, unsigned short> field;
+    if(!field.Deserialise(_in, _end) || field.GetDim() != res)
+    {
+        return false;
+    }
+
+
+    // Everything checked out, take it in place of a fit and precompute
+    distanceField.update_batch_nodes();
+    m_distanceField = distanceField;
+    m_supportRad = supportRad;
+    m_fit = true;
+
+    m_textureRes = res;
+    m_textureBoundsMin = boundsMin;
+    m_textureBoundsMax = boundsMax;
+    m_textureSpaceTransform = textureSpaceTransform;
+    m_field = field;
+    m_field.SetTextureSpaceTransform(m_textureSpaceTransform);
+    m_precomputedCPU = true;
+    std::vector<std::atomic<unsigned char> >().swap(m_lazyBricks);
+    m_numLazyBricks = 0;
+    m_numUnfilledBricks = 0;
+
+    std::vector<float> fieldData;
+    m_field.GetData(fieldData);
+    BuildFieldLevels(fieldData.data());
+
+    // Nothing to refit from, the next fit is a full one
+    m_incrementalFit = DistanceFieldFit();
+    std::vector<DistanceFieldFit::Vector>().swap(m_fitPoints);
+    std::vector<DistanceFieldFit::Vector>().swap(m_fitNormals);
+    std::vector<glm::vec4>().swap(m_rawField);
+    std::vector<unsigned char>().swap(m_rawExactBlocks);
+
+    if(_gpuTexture)
+    {
+        CreateFieldTexture(fieldData);
+    }
+
+    return true;
+}
+
+//------------------------------------------------------------------------------------------------
+
 float FieldFunction::Remap(float _df)
 {
     float f = 0.0f;
@@ -247,7 +1024,438 @@ float FieldFunction::Remap(float _df)
 
 glm::vec3 FieldFunction::TransformSpace(glm::vec3 _x)
 {
-    return glm::vec3(m_transform * glm::vec4(_x, 1.0f));
+    return TransformSpace(_x, m_transform);
+}
+
+//------------------------------------------------------------------------------------------------
+
+glm::vec3 FieldFunction::TransformSpace(const glm::vec3 &_x, const glm::mat4 &_transform) const
+{
+    return glm::vec3(_transform * glm::vec4(_x, 1.0f));
+}
+
+//------------------------------------------------------------------------------------------------
+
+bool FieldFunction::UpdateFit(const std::vector<DistanceFieldFit::Vector> &_points,
+                              const std::vector<DistanceFieldFit::Vector> &_normals)
+{
+    if(!m_incrementalFit.has_factorisation() || m_fitPoints.size() != (unsigned int)m_incrementalFit._node_centers.cols())
+    {
+        return false;
+    }
+
+    // Centres are matched on position and normal, a centre whose normal changed is removed and added again
+    typedef std::array<double, 6> CentreKey;
+    auto key = [](const DistanceFieldFit::Vector &p, const DistanceFieldFit::Vector &n){
+        return CentreKey{{p(0), p(1), p(2), n(0), n(1), n(2)}};
+    };
+
+    std::multimap<CentreKey, int> unmatched;
+    for(unsigned int i=0; i<m_fitPoints.size(); i++)
+    {
+        unmatched.emplace(key(m_fitPoints[i], m_fitNormals[i]), i);
+    }
+
+    std::vector<DistanceFieldFit::Vector> addedPoints;
+    std::vector<DistanceFieldFit::Vector> addedNormals;
+    for(unsigned int i=0; i<_points.size(); i++)
+    {
+        auto it = unmatched.find(key(_points[i], _normals[i]));
+        if(it != unmatched.end())
+        {
+            unmatched.erase(it);
+        }
+        else
+        {
+            addedPoints.push_back(_points[i]);
+            addedNormals.push_back(_normals[i]);
+        }
+    }
+
+    std::vector<int> removed;
+    for(auto &&centre : unmatched)
+    {
+        removed.push_back(centre.second);
+    }
+
+    // Every changed centre costs O(n^2), past a quarter of them the full O(n^3) fit is about as quick
+    if(4 * (removed.size() + addedPoints.size()) > _points.size())
+    {
+        return false;
+    }
+
+    if(!removed.empty())
+    {
+        m_incrementalFit.remove_nodes(removed);
+
+        // the remaining centres keep their order
+        std::sort(removed.begin(), removed.end(), std::greater<int>());
+        for(auto &&i : removed)
+        {
+            m_fitPoints.erase(m_fitPoints.begin() + i);
+            m_fitNormals.erase(m_fitNormals.begin() + i);
+        }
+    }
+
+    if(!addedPoints.empty())
+    {
+        // added centres go after the existing ones
+        m_incrementalFit.add_nodes(addedPoints, addedNormals);
+        m_fitPoints.insert(m_fitPoints.end(), addedPoints.begin(), addedPoints.end());
+        m_fitNormals.insert(m_fitNormals.end(), addedNormals.begin(), addedNormals.end());
+    }
+
+    return true;
+}
+
+//------------------------------------------------------------------------------------------------
+
+void FieldFunction::SampleBlockCorners(std::vector<glm::vec4> &_corners)
+{
+    // The last corner of each axis is on the last voxel
+    const glm::uvec3 &res = m_textureRes;
+    const unsigned int step = m_precomputeBlockSize;
+    const glm::uvec3 numCorners = (res + glm::uvec3(step - 1)) / glm::uvec3(step) + glm::uvec3(1);
+    _corners.resize(numCorners.x*numCorners.y*numCorners.z);
+
+    auto slabFunc = [&, this](int startZ, int endZ){
+        std::vector<DistanceField::Vector> samplePoints(numCorners.x);
+        std::vector<DistanceField::Vector> sampleGrads(numCorners.x);
+        std::vector<float> sampleValues(numCorners.x);
+
+        for(unsigned int cz=startZ; cz<(unsigned int)endZ; ++cz)
+        {
+            for(unsigned int cy=0; cy<numCorners.y; ++cy)
+            {
+                for(unsigned int cx=0; cx<numCorners.x; ++cx)
+                {
+                    samplePoints[cx] = VoxelSamplePoint(std::min(cx*step, res.x-1),
+                                                        std::min(cy*step, res.y-1),
+                                                        std::min(cz*step, res.z-1));
+                }
+
+                m_distanceField.eval_grad(samplePoints.data(), numCorners.x, sampleValues.data(), sampleGrads.data());
+
+                for(unsigned int cx=0; cx<numCorners.x; ++cx)
+                {
+                    const DistanceField::Vector &g = sampleGrads[cx];
+                    _corners[(cz*numCorners.y*numCorners.x) + (cy*numCorners.x) + cx] = glm::vec4(g(0), g(1), g(2), sampleValues[cx]);
+                }
+            }
+        }
+    };
+
+    ThreadPool::Instance().ParallelFor(slabFunc, numCorners.z, ThreadPool::Schedule::Dynamic);
+}
+
+//------------------------------------------------------------------------------------------------
+
+void FieldFunction::FindBandBlocks(const std::vector<glm::vec4> &_corners,
+                                   std::vector<unsigned char> &_bandBlocks)
+{
+    const glm::uvec3 &res = m_textureRes;
+    const unsigned int step = m_precomputeBlockSize;
+    const glm::uvec3 numBlocks = (res + glm::uvec3(step - 1)) / glm::uvec3(step);
+    const glm::uvec3 numCorners = numBlocks + glm::uvec3(1);
+
+    _bandBlocks.assign(numBlocks.x*numBlocks.y*numBlocks.z, 0);
+    for(unsigned int bz=0; bz<numBlocks.z; ++bz)
+    {
+        for(unsigned int by=0; by<numBlocks.y; ++by)
+        {
+            for(unsigned int bx=0; bx<numBlocks.x; ++bx)
+            {
+                float minDist = FLT_MAX;
+                float maxGrad = 0.0f;
+                bool inside = false;
+                bool outside = false;
+                for(unsigned int c=0; c<8; ++c)
+                {
+                    const glm::vec4 &corner = _corners[((bz + (c>>2))*numCorners.y*numCorners.x) + ((by + ((c>>1)&1))*numCorners.x) + bx + (c&1)];
+                    minDist = std::min(minDist, std::fabs(corner.w));
+                    maxGrad = std::max(maxGrad, glm::length(glm::vec3(corner)));
+                    inside |= corner.w < 0.0f;
+                    outside |= corner.w >= 0.0f;
+                }
+
+                float halfDiagonal = 0.5f * (VoxelSamplePoint(std::min((bx+1)*step, res.x-1), std::min((by+1)*step, res.y-1), std::min((bz+1)*step, res.z-1)) -
+                                  VoxelSamplePoint(bx*step, by*step, bz*step)).norm();
+
+                // A block reaches the band when it straddles the surface, or when its closest corner is within the support radius
+                // plus as far as the steepest corner gradient moves the distance to the middle of the block
+                _bandBlocks[(bz*numBlocks.y*numBlocks.x) + (by*numBlocks.x) + bx] =
+                        (inside && outside) || !(minDist - (maxGrad * halfDiagonal) >= m_supportRad);
+            }
+        }
+    }
+}
+
+//------------------------------------------------------------------------------------------------
+
+void FieldFunction::FindChangedBlocks(const std::vector<glm::vec4> &_corners,
+                                      const std::vector<glm::vec4> &_rawField,
+                                      std::vector<unsigned char> &_changedBlocks)
+{
+    const glm::uvec3 &res = m_textureRes;
+    const unsigned int step = m_precomputeBlockSize;
+    const glm::uvec3 numBlocks = (res + glm::uvec3(step - 1)) / glm::uvec3(step);
+    const glm::uvec3 numCorners = numBlocks + glm::uvec3(1);
+    const float valueTolerance = MaxRegionalPrecomputeError * m_supportRad;
+    const float gradTolerance = MaxRegionalPrecomputeError;
+
+    // Corners are voxels, so the change at a corner is its new value less the one precomputed last time
+    std::vector<unsigned char> changedCorners(_corners.size(), 0);
+    for(unsigned int cz=0; cz<numCorners.z; ++cz)
+    {
+        for(unsigned int cy=0; cy<numCorners.y; ++cy)
+        {
+            for(unsigned int cx=0; cx<numCorners.x; ++cx)
+            {
+                unsigned int c = (cz*numCorners.y*numCorners.x) + (cy*numCorners.x) + cx;
+                unsigned int voxel = (std::min(cz*step, res.z-1)*res.y*res.x) + (std::min(cy*step, res.y-1)*res.x) + std::min(cx*step, res.x-1);
+                glm::vec4 diff = _corners[c] - _rawField[voxel];
+                changedCorners[c] = !(std::fabs(diff.w) <= valueTolerance && glm::length(glm::vec3(diff)) <= gradTolerance);
+            }
+        }
+    }
+
+    // A block is evaluated again when a corner of it or of a neighbouring block changed
+    _changedBlocks.assign(numBlocks.x*numBlocks.y*numBlocks.z, 0);
+    for(unsigned int bz=0; bz<numBlocks.z; ++bz)
+    {
+        for(unsigned int by=0; by<numBlocks.y; ++by)
+        {
+            for(unsigned int bx=0; bx<numBlocks.x; ++bx)
+            {
+                bool changed = false;
+                for(unsigned int cz=(bz > 0 ? bz-1 : 0); cz<=std::min(bz+2, numCorners.z-1) && !changed; ++cz)
+                {
+                    for(unsigned int cy=(by > 0 ? by-1 : 0); cy<=std::min(by+2, numCorners.y-1) && !changed; ++cy)
+                    {
+                        for(unsigned int cx=(bx > 0 ? bx-1 : 0); cx<=std::min(bx+2, numCorners.x-1) && !changed; ++cx)
+                        {
+                            changed = changedCorners[(cz*numCorners.y*numCorners.x) + (cy*numCorners.x) + cx];
+                        }
+                    }
+                }
+
+                _changedBlocks[(bz*numBlocks.y*numBlocks.x) + (by*numBlocks.x) + bx] = changed;
+            }
+        }
+    }
+}
+
+//------------------------------------------------------------------------------------------------
+
+DistanceField::Vector FieldFunction::VoxelSamplePoint(const unsigned int _x, const unsigned int _y, const unsigned int _z)
+{
+    return VoxelSamplePoint(_x, _y, _z, m_transform);
+}
+
+//------------------------------------------------------------------------------------------------
+
+DistanceField::Vector FieldFunction::VoxelSamplePoint(const unsigned int _x, const unsigned int _y, const unsigned int _z, const glm::mat4 &_transform) const
+{
+    glm::vec3 t((float)_x/m_textureRes.x, (float)_y/m_textureRes.y, (float)_z/m_textureRes.z);
+    glm::vec3 point = m_textureBoundsMin + ((m_textureBoundsMax - m_textureBoundsMin) * t);
+
+    glm::vec3 tx = TransformSpace(point, _transform);
+    return DistanceField::Vector(tx.x, tx.y, tx.z);
+}
+
+//------------------------------------------------------------------------------------------------
+
+void FieldFunction::FillLazyBricks(const glm::vec3 &_x)
+{
+    const unsigned int brickShift = SparseTexture3DCpu<float, unsigned short>::BrickShift;
+    const glm::uvec3 brickDim = m_field.GetBrickDim();
+
+    // A tricubic lookup reads the voxel below _x, clamped short of the last, the one before it and the 2 after, trilinear ones fewer
+    glm::vec3 voxel = glm::vec3(m_textureSpaceTransform * glm::vec4(_x, 1.0f)) * glm::vec3(m_textureRes);
+    glm::uvec3 brickMin, brickMax;
+    for(unsigned int axis=0; axis<3; ++axis)
+    {
+        const unsigned int last = m_textureRes[axis] - 1;
+        unsigned int v = voxel[axis] <= 0.0f ? 0u : std::min(voxel[axis] >= last ? last : (unsigned int)voxel[axis], last > 0 ? last - 1 : 0u);
+        brickMin[axis] = (v > 0 ? v - 1 : 0u) >> brickShift;
+        brickMax[axis] = std::min(v + 2, last) >> brickShift;
+    }
+
+    for(unsigned int bz=brickMin.z; bz<=brickMax.z; ++bz)
+    {
+        for(unsigned int by=brickMin.y; by<=brickMax.y; ++by)
+        {
+            for(unsigned int bx=brickMin.x; bx<=brickMax.x; ++bx)
+            {
+                if(m_lazyBricks[(bz*brickDim.y*brickDim.x) + (by*brickDim.x) + bx].load(std::memory_order_acquire) != LazyFilled)
+                {
+                    FillLazyBrick(glm::uvec3(bx, by, bz));
+                }
+            }
+        }
+    }
+}
+
+//------------------------------------------------------------------------------------------------
+
+void FieldFunction::FillLazyBrick(const glm::uvec3 &_brick)
+{
+    const unsigned int brickSize = SparseTexture3DCpu<float, unsigned short>::BrickSize;
+    const unsigned int brickVoxels = SparseTexture3DCpu<float, unsigned short>::BrickVoxels;
+    const glm::uvec3 brickDim = m_field.GetBrickDim();
+    std::atomic<unsigned char> &state = m_lazyBricks[(_brick.z*brickDim.y*brickDim.x) + (_brick.y*brickDim.x) + _brick.x];
+
+    // The first thread to reach the brick fills it, any other waits rather than read it half filled
+    unsigned char pending = LazyPending;
+    if(!state.compare_exchange_strong(pending, LazyFilling, std::memory_order_acquire))
+    {
+        while(state.load(std::memory_order_acquire) != LazyFilled)
+        {
+            std::this_thread::yield();
+        }
+        return;
+    }
+
+    // Voxels past the edge of the volume repeat the last one, as SparseTexture3DCpu stores them
+    std::vector<DistanceField::Vector> samplePoints(brickVoxels);
+    std::vector<DistanceField::Vector> sampleGrads(brickVoxels);
+    std::vector<float> sampleValues(brickVoxels);
+    for(unsigned int z=0; z<brickSize; ++z)
+    {
+        for(unsigned int y=0; y<brickSize; ++y)
+        {
+            for(unsigned int x=0; x<brickSize; ++x)
+            {
+                samplePoints[(z*brickSize*brickSize) + (y*brickSize) + x] = VoxelSamplePoint(std::min((_brick.x*brickSize) + x, m_textureRes.x-1),
+                                                                                             std::min((_brick.y*brickSize) + y, m_textureRes.y-1),
+                                                                                             std::min((_brick.z*brickSize) + z, m_textureRes.z-1),
+                                                                                             m_lazyTransform);
+            }
+        }
+    }
+
+    m_distanceField.eval_grad(samplePoints.data(), brickVoxels, sampleValues.data(), sampleGrads.data());
+    for(auto &&value : sampleValues)
+    {
+        value = Remap(value);
+    }
+
+    m_field.SetBrick(_brick, sampleValues.data());
+    state.store(LazyFilled, std::memory_order_release);
+
+    // The last brick filled builds the coarser levels before m_numLazyBricks can reach 0, lookups never see them half built
+    if(m_numUnfilledBricks.fetch_sub(1) == 1)
+    {
+        std::vector<float> fieldData;
+        m_field.GetData(fieldData);
+        BuildFieldLevels(fieldData.data());
+    }
+    m_numLazyBricks--;
+}
+
+//------------------------------------------------------------------------------------------------
+
+void FieldFunction::BuildFieldLevels(const float *_field)
+{
+    m_fieldLevels.clear();
+    m_levelVoxelSize.clear();
+
+    const glm::vec3 size = m_textureBoundsMax - m_textureBoundsMin;
+    glm::uvec3 res = m_textureRes;
+    m_levelVoxelSize.push_back(std::max(size.x / res.x, std::max(size.y / res.y, size.z / res.z)));
+
+    // Coarser levels would be resampled from the placeholders of bricks still to be filled
+    if(m_numUnfilledBricks > 0)
+    {
+        return;
+    }
+
+    std::vector<float> level(_field, _field + (res.x * res.y * res.z));
+    std::vector<float> filtered;
+    while(std::min(res.x, std::min(res.y, res.z)) >= 2 * MinFieldLevelRes)
+    {
+        // Separable, resample along x, then y, then z
+        for(unsigned int axis=0; axis<3; ++axis)
+        {
+            DownsampleAxis(level, res, axis, (res[axis] + 1) / 2, filtered);
+            res[axis] = (res[axis] + 1) / 2;
+            level.swap(filtered);
+        }
+
+        m_fieldLevels.push_back(SparseTexture3DCpu<float, unsigned short>());
+        m_fieldLevels.back().SetData(res, level.data());
+        m_fieldLevels.back().SetTextureSpaceTransform(m_textureSpaceTransform);
+        m_levelVoxelSize.push_back(std::max(size.x / res.x, std::max(size.y / res.y, size.z / res.z)));
+    }
+}
+
+//------------------------------------------------------------------------------------------------
+
+SparseTexture3DCpu<float, unsigned short> &FieldFunction::FieldLevel(const unsigned int _level)
+{
+    if(_level == 0 || m_numLazyBricks > 0 || m_fieldLevels.empty())
+    {
+        return m_field;
+    }
+
+    return m_fieldLevels[std::min(_level, (unsigned int)m_fieldLevels.size()) - 1];
+}
+
+//------------------------------------------------------------------------------------------------
+
+void FieldFunction::CreateFieldTexture(const float *_field, const glm::vec3 *_grad, const float _maxGrad)
+{
+#ifndef NO_CUDA
+    const unsigned int numVoxels = m_textureRes.x*m_textureRes.y*m_textureRes.z;
+
+    // Normalised so the largest gradient component is 1, the field is already in [0:1]
+    float gradScale = _maxGrad > 0.0f ? 32767.0f / _maxGrad : 0.0f;
+    auto quantise = [](float _v){ return (short)std::lrint(std::min(std::max(_v, -32767.0f), 32767.0f)); };
+    short4 *cuFieldNGrad = new short4[numVoxels];
+    for(unsigned int i=0; i<numVoxels; ++i)
+    {
+        cuFieldNGrad[i] = make_short4(quantise(_grad[i].x * gradScale), quantise(_grad[i].y * gradScale),
+                                      quantise(_grad[i].z * gradScale), quantise(_field[i] * 32767.0f));
+    }
+
+    d_field.CreateCudaTexture(m_textureRes.x, m_textureRes.y, m_textureRes.z, cuFieldNGrad, cudaFilterModeLinear, cudaReadModeNormalizedFloat);
+    delete [] cuFieldNGrad;
+    m_precomputedGPU = true;
+#else
+    (void)_field;
+    (void)_grad;
+    (void)_maxGrad;
+#endif
+}
+
+//------------------------------------------------------------------------------------------------
+
+void FieldFunction::CreateFieldTexture(const std::vector<float> &_field)
+{
+    // Central differences of the field, negated to point along the distance gradient PrecomputeField stores.
+    // Where the field is flat they are 0, the composition angle does not matter there.
+    const glm::vec3 voxelsPerUnit = glm::vec3(m_textureRes) / (m_textureBoundsMax - m_textureBoundsMin);
+    std::vector<glm::vec3> gradData(_field.size());
+    float maxGrad = 0.0f;
+    for(unsigned int z=0; z<m_textureRes.z; ++z)
+    {
+        for(unsigned int y=0; y<m_textureRes.y; ++y)
+        {
+            for(unsigned int x=0; x<m_textureRes.x; ++x)
+            {
+                auto voxel = [&](unsigned int _vx, unsigned int _vy, unsigned int _vz){
+                    return _field[(std::min(_vz, m_textureRes.z-1)*m_textureRes.y*m_textureRes.x) + (std::min(_vy, m_textureRes.y-1)*m_textureRes.x) + std::min(_vx, m_textureRes.x-1)];
+                };
+                glm::vec3 g(voxel(x > 0 ? x-1 : 0, y, z) - voxel(x+1, y, z),
+                            voxel(x, y > 0 ? y-1 : 0, z) - voxel(x, y+1, z),
+                            voxel(x, y, z > 0 ? z-1 : 0) - voxel(x, y, z+1));
+                g = g * voxelsPerUnit;
+                gradData[(z*m_textureRes.y*m_textureRes.x) + (y*m_textureRes.x) + x] = g;
+                maxGrad = std::max(maxGrad, std::max(std::fabs(g.x), std::max(std::fabs(g.y), std::fabs(g.z))));
+            }
+        }
+    }
+    CreateFieldTexture(_field.data(), gradData.data(), maxGrad);
 }
 
 //------------------------------------------------------------------------------------------------
@@ -1,8 +1,24 @@
 #include "ScalarField/globalfieldfunction.h"
 #include <algorithm>
+#include <numeric>
+#include <float.h>
+
+/// @brief Sample points EvalBatch takes the max of the composed fields over at a time.
+static const unsigned int EvalBatchSize = 256;
+
+/// @brief HRBF centres a mesh part starts with before GenerateAdaptiveFieldFuncs adds any, bone end caps included.
+static const int InitialAdaptiveHrbfCentres = 8;
+
+/// @brief HRBF centres GenerateHRBFCentres adds past the ends of the bone on top of those sampled on the mesh.
+static const int NumBoneCapHrbfCentres = 2;
+
+/// @brief Fewest voxels along any axis PrecomputeFittedFieldFunc gives a field, keeps thin boxes at least a brick thick.
+static const unsigned int MinFittedTextureRes = 8;
 
 GlobalFieldFunction::GlobalFieldFunction():
-    m_globalFieldInit(false)
+    m_globalFieldInit(false),
+    m_incrementalRefit(false),
+    m_lazyPrecompute(false)
 {
 
 }
@@ -18,14 +34,15 @@ GlobalFieldFunction::~GlobalFieldFunction()
 
 float GlobalFieldFunction::Eval(const glm::vec3 &_x)
 {
-    std::vector<float> composedFieldValues(m_composedFields.size());
-    int i=0;
+    // Field values are in [0:1], keep a running max rather than allocating per sample
+    float maxF = 0.0f;
     for(auto &cf : m_composedFields)
     {
-        composedFieldValues[i++] = cf->Eval(_x);
+        float f = cf->Eval(_x);
+        maxF = f > maxF ? f : maxF;
     }
 
-    return *std::max_element(composedFieldValues.begin(), composedFieldValues.end());
+    return maxF;
 }
 
 //----------------------------------------------------------------------------------------------------
@@ -44,6 +61,74 @@ glm::vec3 GlobalFieldFunction::Grad(const glm::vec3 &_x)
 
 //----------------------------------------------------------------------------------------------------
 
+float GlobalFieldFunction::Eval(const glm::vec3 &_x, const std::vector<glm::mat4> &_fieldTransforms, const float _error)
+{
+    const glm::mat4 identity(1.0f);
+
+    float maxF = 0.0f;
+    for(unsigned int i=0; i<m_composedFields.size(); i++)
+    {
+        // The cuda composed fields hold the field ids of each composed field
+        const ComposedFieldCuda &ids = m_composedFieldsCuda[i];
+        const glm::mat4 &transformA = ids.fieldFuncA >= 0 ? _fieldTransforms[ids.fieldFuncA] : identity;
+        const glm::mat4 &transformB = ids.fieldFuncB >= 0 ? _fieldTransforms[ids.fieldFuncB] : identity;
+
+        float f = m_composedFields[i]->Eval(_x, transformA, transformB, _error);
+        maxF = f > maxF ? f : maxF;
+    }
+
+    return maxF;
+}
+
+//----------------------------------------------------------------------------------------------------
+
+void GlobalFieldFunction::EvalBatch(const glm::vec3 *_x, const unsigned int _numPoints, float *_f)
+{
+    std::fill(_f, _f + _numPoints, 0.0f);
+
+    float f[EvalBatchSize];
+    for(unsigned int start=0; start<_numPoints; start+=EvalBatchSize)
+    {
+        const unsigned int count = std::min(_numPoints - start, EvalBatchSize);
+        for(auto &cf : m_composedFields)
+        {
+            cf->EvalBatch(_x + start, count, f);
+            for(unsigned int i=0; i<count; ++i)
+            {
+                _f[start + i] = f[i] > _f[start + i] ? f[i] : _f[start + i];
+            }
+        }
+    }
+}
+
+//----------------------------------------------------------------------------------------------------
+
+void GlobalFieldFunction::EvalBatch(const glm::vec3 *_x, const unsigned int _numPoints, const std::vector<glm::mat4> &_fieldTransforms, float *_f, const float _error)
+{
+    const glm::mat4 identity(1.0f);
+    std::fill(_f, _f + _numPoints, 0.0f);
+
+    float f[EvalBatchSize];
+    for(unsigned int start=0; start<_numPoints; start+=EvalBatchSize)
+    {
+        const unsigned int count = std::min(_numPoints - start, EvalBatchSize);
+        for(unsigned int c=0; c<m_composedFields.size(); c++)
+        {
+            const ComposedFieldCuda &ids = m_composedFieldsCuda[c];
+            const glm::mat4 &transformA = ids.fieldFuncA >= 0 ? _fieldTransforms[ids.fieldFuncA] : identity;
+            const glm::mat4 &transformB = ids.fieldFuncB >= 0 ? _fieldTransforms[ids.fieldFuncB] : identity;
+
+            m_composedFields[c]->EvalBatch(_x + start, count, transformA, transformB, f, _error);
+            for(unsigned int i=0; i<count; ++i)
+            {
+                _f[start + i] = f[i] > _f[start + i] ? f[i] : _f[start + i];
+            }
+        }
+    }
+}
+
+//----------------------------------------------------------------------------------------------------
+
 void GlobalFieldFunction::Fit(const int _numMeshParts)
 {
     m_fieldFuncs.resize(_numMeshParts);
@@ -110,13 +195,136 @@ void GlobalFieldFunction::GenerateHRBFCentres(const Mesh &_meshPart,
 
 //----------------------------------------------------------------------------------------------------
 
-void GlobalFieldFunction::GenerateFieldFuncs(const Mesh &_hrbfCentres, const Mesh &_meshPart, const int _id)
+void GlobalFieldFunction::GenerateFieldFuncs(const Mesh &_hrbfCentres, const Mesh &_meshPart, const int _id, DistanceFieldFit::Workspace *_workspace)
+{
+    // Generate HRBF fit and thus scalar field/implicit function, refitting the existing one keeps its factorisation
+    std::shared_ptr<FieldFunction> fieldFunc;
+    if(m_incrementalRefit && (std::size_t)_id < m_fieldFuncs.size() && m_fieldFuncs[_id])
+    {
+        fieldFunc = m_fieldFuncs[_id];
+    }
+    else
+    {
+        fieldFunc = std::shared_ptr<FieldFunction>(new FieldFunction());
+        fieldFunc->SetIncrementalRefit(m_incrementalRefit);
+    }
+    fieldFunc->Fit(_hrbfCentres.m_meshVerts, _hrbfCentres.m_meshNorms, 1.0f, _workspace);
+
+    SetFieldFunc(fieldFunc, _meshPart, _id);
+}
+
+//----------------------------------------------------------------------------------------------------
+
+void GlobalFieldFunction::GenerateAdaptiveFieldFuncs(const Mesh &_meshPart,
+                                                     const std::pair<glm::vec3, glm::vec3> &_boneEnds,
+                                                     const int _id,
+                                                     const float _tolerance,
+                                                     const int _maxHrbfCentres,
+                                                     Mesh &_hrbfCentres,
+                                                     DistanceFieldFit::Workspace *_workspace)
 {
-    // Generate HRBF fit and thus scalar field/implicit function
+    // Start from a few evenly spread centres, the bone end caps count towards the most centres
+    int numSampled = std::min(InitialAdaptiveHrbfCentres, _maxHrbfCentres) - NumBoneCapHrbfCentres;
+    GenerateHRBFCentres(_meshPart, _boneEnds, std::max(numSampled, 1), _hrbfCentres);
+
+
+    // Errors are relative to the size of the part, new centres are spread out relative to its area
+    glm::vec3 minCorner(FLT_MAX, FLT_MAX, FLT_MAX);
+    glm::vec3 maxCorner(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+    for(auto &&v : _meshPart.m_meshVerts)
+    {
+        minCorner = glm::min(minCorner, v);
+        maxCorner = glm::max(maxCorner, v);
+    }
+    float maxError = _tolerance * glm::distance(minCorner, maxCorner);
+
+    float area = 0.0f;
+    for(auto &&tri : _meshPart.m_meshTris)
+    {
+        glm::vec3 e1 = _meshPart.m_meshVerts[tri.y] - _meshPart.m_meshVerts[tri.x];
+        glm::vec3 e2 = _meshPart.m_meshVerts[tri.z] - _meshPart.m_meshVerts[tri.x];
+        area += 0.5f * glm::length(glm::cross(e1, e2));
+    }
+
+
+    // Centres are only ever added, so every fit after the first updates the kept factorisation
     auto fieldFunc = std::shared_ptr<FieldFunction>(new FieldFunction());
-    fieldFunc->Fit(_hrbfCentres.m_meshVerts, _hrbfCentres.m_meshNorms);
+    fieldFunc->SetIncrementalRefit(true);
+
+    std::vector<float> dists;
+    std::vector<glm::vec3> grads;
+    std::vector<float> errors(_meshPart.m_meshVerts.size());
+    std::vector<int> worst;
+    std::vector<int> added;
+    for(;;)
+    {
+        fieldFunc->Fit(_hrbfCentres.m_meshVerts, _hrbfCentres.m_meshNorms, 1.0f, _workspace);
+
+        // Add up to a quarter more centres a round, few enough for the incremental refit
+        int numCentres = _hrbfCentres.m_meshVerts.size();
+        int numToAdd = std::min(std::max(numCentres / 4, 1), _maxHrbfCentres - numCentres);
+        if(numToAdd <= 0)
+        {
+            break;
+        }
+
+        // First order distance of each vertex from the surface of the field, not amplified where the gradient is small
+        fieldFunc->EvalDistGrad(_meshPart.m_meshVerts, dists, grads);
+        worst.clear();
+        for(unsigned int i=0; i<errors.size(); i++)
+        {
+            errors[i] = std::fabs(dists[i]) / std::max(glm::length(grads[i]), 1.0f);
+            if(errors[i] > maxError)
+            {
+                worst.push_back(i);
+            }
+        }
+
+        if(worst.empty())
+        {
+            break;
+        }
+
+        std::sort(worst.begin(), worst.end(), [&errors](int a, int b){
+            return errors[a] > errors[b];
+        });
 
 
+        // Neighbouring vertices share most of their error, so skip those close to a centre added this round
+        float spacing = std::max(0.5f * std::sqrt(area / (numCentres + numToAdd)), FLT_EPSILON);
+        added.clear();
+        for(auto &&v : worst)
+        {
+            glm::vec3 p = _meshPart.m_meshVerts[v];
+            bool spaced = std::all_of(added.begin(), added.end(), [&](int a){
+                return glm::distance(_meshPart.m_meshVerts[a], p) >= spacing;
+            });
+
+            if(spaced)
+            {
+                added.push_back(v);
+                _hrbfCentres.m_meshVerts.push_back(p);
+                _hrbfCentres.m_meshNorms.push_back(glm::normalize(_meshPart.m_meshNorms[v]));
+
+                if(added.size() == (unsigned int)numToAdd)
+                {
+                    break;
+                }
+            }
+        }
+    }
+
+    SetFieldFunc(fieldFunc, _meshPart, _id);
+}
+
+//----------------------------------------------------------------------------------------------------
+
+void GlobalFieldFunction::SetFieldFunc(std::shared_ptr<FieldFunction> _fieldFunc, const Mesh &_meshPart, const int _id)
+{
+    // Adaptive fits refit incrementally while adding centres, keep the factorisation only if asked to
+    _fieldFunc->SetIncrementalRefit(m_incrementalRefit);
+    _fieldFunc->SetLazyPrecompute(m_lazyPrecompute);
+
     // Find maximun range of scalar field
     float maxDist = FLT_MIN;
     for(auto &&tri : _meshPart.m_meshTris)
@@ -125,19 +333,79 @@ void GlobalFieldFunction::GenerateFieldFuncs(const Mesh &_hrbfCentres, const Mes
         glm::vec3 v1 = _meshPart.m_meshVerts[tri.y];
         glm::vec3 v2 = _meshPart.m_meshVerts[tri.z];
 
-        float f0 = fieldFunc->EvalDist(v0);
+        float f0 = _fieldFunc->EvalDist(v0);
         maxDist = f0 > maxDist ? f0 : maxDist;
-        float f1 = fieldFunc->EvalDist(v1);
+        float f1 = _fieldFunc->EvalDist(v1);
         maxDist = f1 > maxDist ? f1 : maxDist;
-        float f2 = fieldFunc->EvalDist(v2);
+        float f2 = _fieldFunc->EvalDist(v2);
         maxDist = f2 > maxDist ? f2 : maxDist;
     }
 
 
     // Set R in order to make field function compactly supported
-    fieldFunc->SetSupportRadius(maxDist);
+    _fieldFunc->SetSupportRadius(maxDist);
 
     if(_id < m_fieldFuncs.size())
+    {
+        m_fieldFuncs[_id] = _fieldFunc;
+    }
+    else
+    {
+        AddFieldFunction(_fieldFunc);
+    }
+}
+
+//----------------------------------------------------------------------------------------------------
+
+void GlobalFieldFunction::PrecomputeFieldFunc(const int _id, const int _res, const float _dim, const bool _gpuTexture)
+{
+    m_fieldFuncs[_id]->PrecomputeField(_res, _dim, _gpuTexture);
+}
+
+//----------------------------------------------------------------------------------------------------
+
+void GlobalFieldFunction::PrecomputeFittedFieldFunc(const int _id, const int _numVoxels, const bool _gpuTexture)
+{
+    auto &fieldFunc = m_fieldFuncs[_id];
+
+    glm::vec3 boundsMin, boundsMax;
+    fieldFunc->GetSupportBounds(boundsMin, boundsMax);
+
+    // Refitting incrementally, keep the last box while it still holds the support so only what changed is precomputed
+    glm::vec3 textureMin, textureMax;
+    fieldFunc->GetTextureBounds(textureMin, textureMax);
+    glm::uvec3 textureRes = fieldFunc->GetTextureResolution();
+    if(fieldFunc->IsIncrementalRefit() && textureRes.x > 0 &&
+            glm::all(glm::lessThanEqual(textureMin, boundsMin)) && glm::all(glm::lessThanEqual(boundsMax, textureMax)))
+    {
+        fieldFunc->PrecomputeField(textureRes, textureMin, textureMax, _gpuTexture);
+        return;
+    }
+
+    // Cubic voxels, as many as fit in the budget
+    glm::vec3 extent = boundsMax - boundsMin;
+    float voxelSize = std::cbrt((extent.x * extent.y * extent.z) / std::max(_numVoxels, 1));
+    glm::uvec3 res;
+    for(int axis=0; axis<3; axis++)
+    {
+        res[axis] = std::max(MinFittedTextureRes, (unsigned int)std::lround(extent[axis] / voxelSize));
+    }
+
+    fieldFunc->PrecomputeField(res, boundsMin, boundsMax, _gpuTexture);
+}
+
+//----------------------------------------------------------------------------------------------------
+
+bool GlobalFieldFunction::LoadFieldFunc(const FieldCache &_cache, const FieldCache::Key _key, const int _id, const bool _gpuTexture)
+{
+    auto fieldFunc = std::shared_ptr<FieldFunction>(new FieldFunction());
+    if(!_cache.Load(_key, *fieldFunc, _gpuTexture))
+    {
+        return false;
+    }
+    fieldFunc->SetIncrementalRefit(m_incrementalRefit);
+
+    if((std::size_t)_id < m_fieldFuncs.size())
     {
         m_fieldFuncs[_id] = fieldFunc;
     }
@@ -145,18 +413,30 @@ void GlobalFieldFunction::GenerateFieldFuncs(const Mesh &_hrbfCentres, const Mes
     {
         AddFieldFunction(fieldFunc);
     }
+
+    return true;
 }
 
 //----------------------------------------------------------------------------------------------------
 
-void GlobalFieldFunction::PrecomputeFieldFunc(const int _id, const int _res, const float _dim)
+void GlobalFieldFunction::SaveFieldFunc(const FieldCache &_cache, const FieldCache::Key _key, const int _id) const
 {
-    m_fieldFuncs[_id]->PrecomputeField(_res, _dim);
+    if((std::size_t)_id < m_fieldFuncs.size() && m_fieldFuncs[_id])
+    {
+        _cache.Save(_key, *m_fieldFuncs[_id]);
+    }
 }
 
 //----------------------------------------------------------------------------------------------------
 
-void GlobalFieldFunction::GenerateGlobalFieldFunc()
+bool GlobalFieldFunction::FinishLazyFieldFunc(const int _id, const bool _gpuTexture)
+{
+    return (std::size_t)_id < m_fieldFuncs.size() && m_fieldFuncs[_id] && m_fieldFuncs[_id]->FinishLazyPrecompute(_gpuTexture);
+}
+
+//----------------------------------------------------------------------------------------------------
+
+void GlobalFieldFunction::GenerateGlobalFieldFunc(const bool _gpuTexture)
 {
     // Time to build composition tree
     typedef std::shared_ptr<CompositionOp> CompositionOpPtr;
@@ -186,8 +466,8 @@ void GlobalFieldFunction::GenerateGlobalFieldFunc()
         return _angleRadians <= M_PI ? (0.5f*(cosf(2.0f*_angleRadians)+1.0f)) : 1.0f;
     });
 
-    contactOp->Precompute(64);
-    bulgeOp->Precompute(64);
+    contactOp->Precompute(64, _gpuTexture);
+    bulgeOp->Precompute(64, _gpuTexture);
     m_compOps.push_back(contactOp);
     m_compOps.push_back(bulgeOp);
 
@@ -236,6 +516,36 @@ void GlobalFieldFunction::AddCompositionOp(std::shared_ptr<CompositionOp> _compO
 
 //----------------------------------------------------------------------------------------------------
 
+void GlobalFieldFunction::SetIncrementalRefit(const bool _incremental)
+{
+    m_incrementalRefit = _incremental;
+
+    for(auto &&fieldFunc : m_fieldFuncs)
+    {
+        if(fieldFunc)
+        {
+            fieldFunc->SetIncrementalRefit(_incremental);
+        }
+    }
+}
+
+//----------------------------------------------------------------------------------------------------
+
+void GlobalFieldFunction::SetLazyPrecompute(const bool _lazy)
+{
+    m_lazyPrecompute = _lazy;
+
+    for(auto &&fieldFunc : m_fieldFuncs)
+    {
+        if(fieldFunc)
+        {
+            fieldFunc->SetLazyPrecompute(_lazy);
+        }
+    }
+}
+
+//----------------------------------------------------------------------------------------------------
+
 void GlobalFieldFunction::SetRigidTransforms(const std::vector<glm::mat4> &_transforms)
 {
     for(unsigned int mp=0; mp<_transforms.size(); mp++)
@@ -246,6 +556,17 @@ void GlobalFieldFunction::SetRigidTransforms(const std::vector<glm::mat4> &_tran
 
 //----------------------------------------------------------------------------------------------------
 
+void GlobalFieldFunction::GetFieldTransforms(const std::vector<glm::mat4> &_transforms, std::vector<glm::mat4> &_fieldTransforms) const
+{
+    _fieldTransforms.resize(m_fieldFuncs.size());
+    for(unsigned int mp=0; mp<m_fieldFuncs.size(); mp++)
+    {
+        _fieldTransforms[mp] = mp < _transforms.size() ? glm::inverse(_transforms[mp]) : m_fieldFuncs[mp]->GetTransform();
+    }
+}
+
+//----------------------------------------------------------------------------------------------------
+
 std::vector<std::shared_ptr<FieldFunction> > &GlobalFieldFunction::GetFieldFuncs()
 {
     return m_fieldFuncs;
@@ -274,6 +595,7 @@ std::vector<ComposedFieldCuda> &GlobalFieldFunction::GetCompFieldsCuda()
 
 //----------------------------------------------------------------------------------------------------
 
+#ifndef NO_CUDA
 std::vector<cudaTextureObject_t> GlobalFieldFunction::GetFieldFunc3DTextures()
 {
     std::vector<cudaTextureObject_t> textures;
@@ -284,6 +606,7 @@ std::vector<cudaTextureObject_t> GlobalFieldFunction::GetFieldFunc3DTextures()
 
     return textures;
 }
+#endif
 
 //----------------------------------------------------------------------------------------------------
 
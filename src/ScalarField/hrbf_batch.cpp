@@ -0,0 +1,81 @@
+#include "ScalarField/Hrbf/hrbf_batch.h"
+
+
+namespace hrbf_batch {
+
+//-----------------------------------------------------------------------------------------------------
+
+/// @brief The kernel in use and its instruction set, checked once, the first batch of any field pays for it
+static Isa& current_isa()
+{
+    static Isa isa = is_supported(Isa::Avx512) ? Isa::Avx512 :
+                     is_supported(Isa::Avx2) ? Isa::Avx2 :
+                     Isa::Portable;
+    return isa;
+}
+
+//-----------------------------------------------------------------------------------------------------
+
+Pow3Kernel pow3_kernel()
+{
+    switch(current_isa())
+    {
+#if defined(__x86_64__) || defined(__i386__)
+    case Isa::Avx2: return &avx2::eval_grad_pow3;
+    case Isa::Avx512: return &avx512::eval_grad_pow3;
+#endif
+    default: return nullptr;
+    }
+}
+
+//-----------------------------------------------------------------------------------------------------
+
+Isa selected()
+{
+    return current_isa();
+}
+
+//-----------------------------------------------------------------------------------------------------
+
+bool is_supported(Isa isa)
+{
+    switch(isa)
+    {
+    case Isa::Portable: return true;
+#if defined(__x86_64__) || defined(__i386__)
+    case Isa::Avx2: return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+    case Isa::Avx512: return __builtin_cpu_supports("avx512f");
+#endif
+    default: return false;
+    }
+}
+
+//-----------------------------------------------------------------------------------------------------
+
+bool select(Isa isa)
+{
+    if(!is_supported(isa))
+    {
+        return false;
+    }
+
+    current_isa() = isa;
+    return true;
+}
+
+//-----------------------------------------------------------------------------------------------------
+
+const char* get_name(Isa isa)
+{
+    switch(isa)
+    {
+    case Isa::Portable: return "portable";
+    case Isa::Avx2: return "avx2";
+    case Isa::Avx512: return "avx512";
+    default: return "unknown";
+    }
+}
+
+//-----------------------------------------------------------------------------------------------------
+
+} // END namespace hrbf_batch
@@ -0,0 +1,59 @@
+#include "ScalarField/Hrbf/hrbf_batch.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+
+#include <immintrin.h>
+
+// Everything below is built for AVX2 and FMA whatever the rest of the build targets, pow3_kernel only returns it when the CPU supports them.
+// Nothing may be included below, it would be built for AVX2 as well.
+#if defined(__clang__)
+#pragma clang attribute push(__attribute__((target("avx2,fma"))), apply_to = function)
+#else
+#pragma GCC push_options
+#pragma GCC target("avx2,fma")
+#endif
+
+
+namespace
+{
+
+/// @brief The registers and operations of AVX2 Pow3Lanes is written over, 8 lanes
+struct Avx2Lanes
+{
+    enum { Lanes = 8 };
+    typedef __m256 Reg;
+    static inline Reg set1(float a)                 { return _mm256_set1_ps(a); }
+    static inline Reg load(const float* a)          { return _mm256_loadu_ps(a); }
+    static inline void store(float* a, Reg r)       { _mm256_storeu_ps(a, r); }
+    static inline Reg sub(Reg a, Reg b)             { return _mm256_sub_ps(a, b); }
+    static inline Reg mul(Reg a, Reg b)             { return _mm256_mul_ps(a, b); }
+    static inline Reg fmadd(Reg a, Reg b, Reg c)    { return _mm256_fmadd_ps(a, b, c); }
+    static inline Reg sqrt(Reg a)                   { return _mm256_sqrt_ps(a); }
+    static inline Reg safe_inv(Reg l)
+    {
+        Reg mask = _mm256_cmp_ps(l, _mm256_setzero_ps(), _CMP_GT_OQ);
+        return _mm256_and_ps(mask, _mm256_div_ps(_mm256_set1_ps(1.0f), l));
+    }
+};
+
+}
+
+
+#include "ScalarField/Hrbf/hrbf_batch_lanes.h"
+
+
+//-----------------------------------------------------------------------------------------------------
+
+void hrbf_batch::avx2::eval_grad_pow3(const Nodes<float, 3>& nodes, const float* points, int nb_points, float* values, float* grads)
+{
+    Pow3Lanes<Avx2Lanes>::eval_grad(nodes, points, nb_points, values, grads);
+}
+
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#else
+#pragma GCC pop_options
+#endif
+
+#endif
@@ -0,0 +1,61 @@
+#include "ScalarField/Hrbf/hrbf_batch.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+
+#include <immintrin.h>
+
+// Everything below is built for AVX-512 whatever the rest of the build targets, pow3_kernel only returns it when the CPU supports it.
+// Nothing may be included below, it would be built for AVX-512 as well.
+#if defined(__clang__)
+#pragma clang attribute push(__attribute__((target("avx512f"))), apply_to = function)
+#else
+#pragma GCC push_options
+#pragma GCC target("avx512f")
+// GCC 12 warns about the undefined source register of the intrinsics once they are inlined here
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+
+
+namespace
+{
+
+/// @brief The registers and operations of AVX-512 Pow3Lanes is written over, 16 lanes
+struct Avx512Lanes
+{
+    enum { Lanes = 16 };
+    typedef __m512 Reg;
+    static inline Reg set1(float a)                 { return _mm512_set1_ps(a); }
+    static inline Reg load(const float* a)          { return _mm512_loadu_ps(a); }
+    static inline void store(float* a, Reg r)       { _mm512_storeu_ps(a, r); }
+    static inline Reg sub(Reg a, Reg b)             { return _mm512_sub_ps(a, b); }
+    static inline Reg mul(Reg a, Reg b)             { return _mm512_mul_ps(a, b); }
+    static inline Reg fmadd(Reg a, Reg b, Reg c)    { return _mm512_fmadd_ps(a, b, c); }
+    static inline Reg sqrt(Reg a)                   { return _mm512_sqrt_ps(a); }
+    static inline Reg safe_inv(Reg l)
+    {
+        return _mm512_maskz_div_ps(_mm512_cmp_ps_mask(l, _mm512_setzero_ps(), _CMP_GT_OQ), _mm512_set1_ps(1.0f), l);
+    }
+};
+
+}
+
+
+#include "ScalarField/Hrbf/hrbf_batch_lanes.h"
+
+
+//-----------------------------------------------------------------------------------------------------
+
+void hrbf_batch::avx512::eval_grad_pow3(const Nodes<float, 3>& nodes, const float* points, int nb_points, float* values, float* grads)
+{
+    Pow3Lanes<Avx512Lanes>::eval_grad(nodes, points, nb_points, values, grads);
+}
+
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#else
+#pragma GCC pop_options
+#endif
+
+#endif
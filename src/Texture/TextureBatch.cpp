@@ -0,0 +1,92 @@
+#include "Texture/TextureBatch.h"
+
+
+//-----------------------------------------------------------------------------------------------------
+
+const TextureKernels &TextureKernels::Instance()
+{
+    return Current();
+}
+
+//-----------------------------------------------------------------------------------------------------
+
+bool TextureKernels::IsSupported(const Isa _isa)
+{
+    switch(_isa)
+    {
+    case Isa::Scalar: return true;
+#if defined(__x86_64__) || defined(__i386__)
+    case Isa::Avx2: return __builtin_cpu_supports("avx2");
+    case Isa::Avx512: return __builtin_cpu_supports("avx512f");
+#endif
+    default: return false;
+    }
+}
+
+//-----------------------------------------------------------------------------------------------------
+
+bool TextureKernels::Select(const Isa _isa)
+{
+    if(!IsSupported(_isa))
+    {
+        return false;
+    }
+
+    Current() = Make(_isa);
+    return true;
+}
+
+//-----------------------------------------------------------------------------------------------------
+
+const char *TextureKernels::GetName(const Isa _isa)
+{
+    switch(_isa)
+    {
+    case Isa::Scalar: return "scalar";
+    case Isa::Avx2: return "avx2";
+    case Isa::Avx512: return "avx512";
+    default: return "unknown";
+    }
+}
+
+//-----------------------------------------------------------------------------------------------------
+
+TextureKernels TextureKernels::Make(const Isa _isa)
+{
+    TextureKernels kernels;
+    kernels.isa = _isa;
+    kernels.dense = nullptr;
+    kernels.denseComponents = nullptr;
+    kernels.sparse = nullptr;
+
+    switch(_isa)
+    {
+#if defined(__x86_64__) || defined(__i386__)
+    case Isa::Avx2:
+        kernels.dense = &TextureBatchAvx2::EvalDense;
+        kernels.denseComponents = &TextureBatchAvx2::EvalDenseComponents;
+        kernels.sparse = &TextureBatchAvx2::EvalSparse;
+        break;
+    case Isa::Avx512:
+        kernels.dense = &TextureBatchAvx512::EvalDense;
+        kernels.denseComponents = &TextureBatchAvx512::EvalDenseComponents;
+        kernels.sparse = &TextureBatchAvx512::EvalSparse;
+        break;
+#endif
+    default:
+        break;
+    }
+
+    return kernels;
+}
+
+//-----------------------------------------------------------------------------------------------------
+
+TextureKernels &TextureKernels::Current()
+{
+    // Checked once, the first lookup of any texture pays for it
+    static TextureKernels kernels = Make(IsSupported(Isa::Avx512) ? Isa::Avx512 :
+                                         IsSupported(Isa::Avx2) ? Isa::Avx2 :
+                                         Isa::Scalar);
+    return kernels;
+}
@@ -0,0 +1,92 @@
+#include "Texture/TextureBatch.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+
+#include <immintrin.h>
+
+// Everything below is built for AVX2 whatever the rest of the build targets, TextureKernels only calls it when the CPU supports it.
+// Nothing may be included below, it would be built for AVX2 as well.
+#if defined(__clang__)
+#pragma clang attribute push(__attribute__((target("avx2"))), apply_to = function)
+#else
+#pragma GCC push_options
+#pragma GCC target("avx2")
+#endif
+
+
+namespace
+{
+
+/// @brief The registers and operations of AVX2 TextureLanes is written over, 8 lanes, masks are lanes of all bits set.
+struct Avx2Lanes
+{
+    enum { Lanes = 8 };
+    typedef __m256 Float;
+    typedef __m256i Int;
+    typedef __m256i Mask;
+
+    static inline Float Set(const float _v) { return _mm256_set1_ps(_v); }
+    static inline Float Load(const float *_p) { return _mm256_loadu_ps(_p); }
+    static inline void Store(float *_p, const Float _v) { _mm256_storeu_ps(_p, _v); }
+    static inline Float Add(const Float _a, const Float _b) { return _mm256_add_ps(_a, _b); }
+    static inline Float Sub(const Float _a, const Float _b) { return _mm256_sub_ps(_a, _b); }
+    static inline Float Mul(const Float _a, const Float _b) { return _mm256_mul_ps(_a, _b); }
+    static inline Float Min(const Float _a, const Float _b) { return _mm256_min_ps(_a, _b); }
+    static inline Float Max(const Float _a, const Float _b) { return _mm256_max_ps(_a, _b); }
+    static inline Int Truncate(const Float _v) { return _mm256_cvttps_epi32(_v); }
+    static inline Float ToFloat(const Int _v) { return _mm256_cvtepi32_ps(_v); }
+
+    static inline Int SetInt(const unsigned int _v) { return _mm256_set1_epi32((int)_v); }
+    static inline Int AddInt(const Int _a, const Int _b) { return _mm256_add_epi32(_a, _b); }
+    static inline Int MulInt(const Int _a, const Int _b) { return _mm256_mullo_epi32(_a, _b); }
+    static inline Int MinInt(const Int _a, const Int _b) { return _mm256_min_epi32(_a, _b); }
+    static inline Int AndInt(const Int _a, const Int _b) { return _mm256_and_si256(_a, _b); }
+    static inline Int ShiftLeft(const Int _v, const Int _bits) { return _mm256_sllv_epi32(_v, _bits); }
+    static inline Int ShiftRight(const Int _v, const Int _bits) { return _mm256_srlv_epi32(_v, _bits); }
+
+    static inline Float Gather(const float *_base, const Int _index) { return _mm256_i32gather_ps(_base, _index, 4); }
+    static inline Int GatherInt(const int *_base, const Int _index) { return _mm256_i32gather_epi32(_base, _index, 4); }
+    static inline Int GatherInt(const Int _src, const Mask _mask, const int *_base, const Int _index) { return _mm256_mask_i32gather_epi32(_src, _base, _index, _mask, 4); }
+
+    static inline Mask Test(const Int _a, const Int _b) { return _mm256_xor_si256(_mm256_cmpeq_epi32(_mm256_and_si256(_a, _b), _mm256_setzero_si256()), AllLanes()); }
+    static inline Mask MaskOr(const Mask _a, const Mask _b) { return _mm256_or_si256(_a, _b); }
+    static inline Mask MaskAndNot(const Mask _a, const Mask _b) { return _mm256_andnot_si256(_a, _b); }
+    static inline Mask NoLanes() { return _mm256_setzero_si256(); }
+    static inline Mask AllLanes() { return _mm256_set1_epi32(-1); }
+    static inline int Bits(const Mask _m) { return _mm256_movemask_ps(_mm256_castsi256_ps(_m)); }
+};
+
+}
+
+#include "Texture/TextureLanes.h"
+
+
+//-----------------------------------------------------------------------------------------------------
+
+void TextureBatchAvx2::EvalDense(const DenseTextureView &_texture, const glm::vec3 *_points, const unsigned int _numPoints, float *_out)
+{
+    TextureLanes<Avx2Lanes>::EvalDense(_texture, _points, _numPoints, _out);
+}
+
+//-----------------------------------------------------------------------------------------------------
+
+void TextureBatchAvx2::EvalDenseComponents(const DenseTextureView &_texture, const float *_x, const float *_y, const float *_z, const unsigned int _numPoints, float *_out)
+{
+    TextureLanes<Avx2Lanes>::EvalDenseComponents(_texture, _x, _y, _z, _numPoints, _out);
+}
+
+//-----------------------------------------------------------------------------------------------------
+
+unsigned int TextureBatchAvx2::EvalSparse(const SparseTextureView &_texture, const glm::vec3 *_points, const unsigned int _numPoints, float *_out, unsigned int *_coarse)
+{
+    return TextureLanes<Avx2Lanes>::EvalSparse(_texture, _points, _numPoints, _out, _coarse);
+}
+
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#else
+#pragma GCC pop_options
+#endif
+
+#endif
@@ -0,0 +1,95 @@
+#include "Texture/TextureBatch.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+
+#include <immintrin.h>
+
+// Everything below is built for AVX-512 whatever the rest of the build targets, TextureKernels only calls it when the CPU supports it.
+// Nothing may be included below, it would be built for AVX-512 as well.
+#if defined(__clang__)
+#pragma clang attribute push(__attribute__((target("avx512f"))), apply_to = function)
+#else
+#pragma GCC push_options
+#pragma GCC target("avx512f")
+// GCC 12 warns about the undefined source register of the intrinsics once they are inlined here
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+
+
+namespace
+{
+
+/// @brief The registers and operations of AVX-512 TextureLanes is written over, 16 lanes, masks are mask registers.
+struct Avx512Lanes
+{
+    enum { Lanes = 16 };
+    typedef __m512 Float;
+    typedef __m512i Int;
+    typedef __mmask16 Mask;
+
+    static inline Float Set(const float _v) { return _mm512_set1_ps(_v); }
+    static inline Float Load(const float *_p) { return _mm512_loadu_ps(_p); }
+    static inline void Store(float *_p, const Float _v) { _mm512_storeu_ps(_p, _v); }
+    static inline Float Add(const Float _a, const Float _b) { return _mm512_add_ps(_a, _b); }
+    static inline Float Sub(const Float _a, const Float _b) { return _mm512_sub_ps(_a, _b); }
+    static inline Float Mul(const Float _a, const Float _b) { return _mm512_mul_ps(_a, _b); }
+    static inline Float Min(const Float _a, const Float _b) { return _mm512_min_ps(_a, _b); }
+    static inline Float Max(const Float _a, const Float _b) { return _mm512_max_ps(_a, _b); }
+    static inline Int Truncate(const Float _v) { return _mm512_cvttps_epi32(_v); }
+    static inline Float ToFloat(const Int _v) { return _mm512_cvtepi32_ps(_v); }
+
+    static inline Int SetInt(const unsigned int _v) { return _mm512_set1_epi32((int)_v); }
+    static inline Int AddInt(const Int _a, const Int _b) { return _mm512_add_epi32(_a, _b); }
+    static inline Int MulInt(const Int _a, const Int _b) { return _mm512_mullo_epi32(_a, _b); }
+    static inline Int MinInt(const Int _a, const Int _b) { return _mm512_min_epi32(_a, _b); }
+    static inline Int AndInt(const Int _a, const Int _b) { return _mm512_and_epi32(_a, _b); }
+    static inline Int ShiftLeft(const Int _v, const Int _bits) { return _mm512_sllv_epi32(_v, _bits); }
+    static inline Int ShiftRight(const Int _v, const Int _bits) { return _mm512_srlv_epi32(_v, _bits); }
+
+    static inline Float Gather(const float *_base, const Int _index) { return _mm512_i32gather_ps(_index, _base, 4); }
+    static inline Int GatherInt(const int *_base, const Int _index) { return _mm512_i32gather_epi32(_index, _base, 4); }
+    static inline Int GatherInt(const Int _src, const Mask _mask, const int *_base, const Int _index) { return _mm512_mask_i32gather_epi32(_src, _mask, _index, _base, 4); }
+
+    static inline Mask Test(const Int _a, const Int _b) { return _mm512_test_epi32_mask(_a, _b); }
+    static inline Mask MaskOr(const Mask _a, const Mask _b) { return (Mask)(_a | _b); }
+    static inline Mask MaskAndNot(const Mask _a, const Mask _b) { return (Mask)(~_a & _b); }
+    static inline Mask NoLanes() { return 0; }
+    static inline Mask AllLanes() { return 0xffff; }
+    static inline int Bits(const Mask _m) { return _m; }
+};
+
+}
+
+#include "Texture/TextureLanes.h"
+
+
+//-----------------------------------------------------------------------------------------------------
+
+void TextureBatchAvx512::EvalDense(const DenseTextureView &_texture, const glm::vec3 *_points, const unsigned int _numPoints, float *_out)
+{
+    TextureLanes<Avx512Lanes>::EvalDense(_texture, _points, _numPoints, _out);
+}
+
+//-----------------------------------------------------------------------------------------------------
+
+void TextureBatchAvx512::EvalDenseComponents(const DenseTextureView &_texture, const float *_x, const float *_y, const float *_z, const unsigned int _numPoints, float *_out)
+{
+    TextureLanes<Avx512Lanes>::EvalDenseComponents(_texture, _x, _y, _z, _numPoints, _out);
+}
+
+//-----------------------------------------------------------------------------------------------------
+
+unsigned int TextureBatchAvx512::EvalSparse(const SparseTextureView &_texture, const glm::vec3 *_points, const unsigned int _numPoints, float *_out, unsigned int *_coarse)
+{
+    return TextureLanes<Avx512Lanes>::EvalSparse(_texture, _points, _numPoints, _out, _coarse);
+}
+
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#else
+#pragma GCC pop_options
+#endif
+
+#endif
@@ -0,0 +1,329 @@
+#include "Threading/threadpool.h"
+
+#include <algorithm>
+
+
+//------------------------------------------------------------------------
+
+namespace
+{
+    /// @brief The pool and worker id of the current thread, used to push nested tasks onto the workers own deque.
+    thread_local ThreadPool *t_pool = nullptr;
+    thread_local unsigned int t_workerId = 0;
+
+    /// @struct ParallelForState
+    /// @brief State shared between the chunks of a single ParallelFor call.
+    /// Held by shared pointer so runners that start after the call has returned find no work and exit safely.
+    struct ParallelForState
+    {
+        std::function<void(int, int)> func;
+        ThreadPool::Schedule schedule;
+        int dataSize;
+        int chunkSize;
+        int numThreads;
+        std::atomic<int> next;
+        std::atomic<int> done;
+        std::atomic<bool> failed;
+        std::exception_ptr error;
+        std::mutex mutex;
+        std::condition_variable cond;
+
+        /// @brief Claim the next chunk, returns false once the range is exhausted.
+        bool Claim(int &_start, int &_end)
+        {
+            if(schedule == ThreadPool::Schedule::Guided)
+            {
+                int start = next.load();
+                while(start < dataSize)
+                {
+                    int chunk = std::max(chunkSize, (dataSize - start) / (2 * numThreads));
+                    int end = std::min(start + chunk, dataSize);
+                    if(next.compare_exchange_weak(start, end))
+                    {
+                        _start = start;
+                        _end = end;
+                        return true;
+                    }
+                }
+                return false;
+            }
+
+            int start = next.fetch_add(chunkSize);
+            if(start >= dataSize)
+            {
+                return false;
+            }
+            _start = start;
+            _end = std::min(start + chunkSize, dataSize);
+            return true;
+        }
+
+        /// @brief Run chunks until none are left.
+        /// A chunk that throws keeps its exception for the caller, the chunks after it are still counted as done but skipped.
+        void Run()
+        {
+            int start, end;
+            while(Claim(start, end))
+            {
+                if(!failed.load())
+                {
+                    try
+                    {
+                        func(start, end);
+                    }
+                    catch(...)
+                    {
+                        std::lock_guard<std::mutex> lock(mutex);
+                        if(!error)
+                        {
+                            error = std::current_exception();
+                        }
+                        failed = true;
+                    }
+                }
+
+                if(done.fetch_add(end - start) + (end - start) == dataSize)
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    cond.notify_all();
+                }
+            }
+        }
+    };
+}
+
+//------------------------------------------------------------------------------------------------
+
+ThreadPool::ThreadPool(const unsigned int _numWorkers):
+    m_numPendingTasks(0),
+    m_nextQueue(0),
+    m_stop(false)
+{
+    StartWorkers(_numWorkers);
+}
+
+//------------------------------------------------------------------------------------------------
+
+ThreadPool::~ThreadPool()
+{
+    StopWorkers();
+}
+
+//------------------------------------------------------------------------------------------------
+
+ThreadPool &ThreadPool::Instance()
+{
+    static ThreadPool pool;
+    return pool;
+}
+
+//------------------------------------------------------------------------------------------------
+
+unsigned int ThreadPool::DefaultNumWorkers()
+{
+    unsigned int numThreads = std::thread::hardware_concurrency();
+    return numThreads > 1 ? numThreads - 1 : 0;
+}
+
+//------------------------------------------------------------------------------------------------
+
+void ThreadPool::SetNumWorkers(const unsigned int _numWorkers)
+{
+    if(_numWorkers == m_workers.size())
+    {
+        return;
+    }
+
+    StopWorkers();
+    StartWorkers(_numWorkers);
+}
+
+//------------------------------------------------------------------------------------------------
+
+unsigned int ThreadPool::GetNumWorkers() const
+{
+    return m_workers.size();
+}
+
+//------------------------------------------------------------------------------------------------
+
+void ThreadPool::ParallelFor(const std::function<void(int, int)> &_func,
+                             const int _dataSize,
+                             const Schedule _schedule,
+                             const int _grainSize)
+{
+    if(_dataSize <= 0)
+    {
+        return;
+    }
+
+    int numThreads = m_workers.size() + 1;
+    int grainSize = std::max(_grainSize, 1);
+    int chunkSize = (_schedule == Schedule::Static) ? std::max((_dataSize + numThreads - 1) / numThreads, grainSize) : grainSize;
+
+    // Not worth waking anyone up
+    if(numThreads == 1 || chunkSize >= _dataSize)
+    {
+        _func(0, _dataSize);
+        return;
+    }
+
+    auto state = std::make_shared<ParallelForState>();
+    state->func = _func;
+    state->schedule = _schedule;
+    state->dataSize = _dataSize;
+    state->chunkSize = chunkSize;
+    state->numThreads = numThreads;
+    state->next = 0;
+    state->done = 0;
+    state->failed = false;
+
+    int numChunks = (_dataSize + chunkSize - 1) / chunkSize;
+    int numRunners = std::min(numThreads, numChunks) - 1;
+    for(int i=0; i<numRunners; i++)
+    {
+        Push([state](){ state->Run(); });
+    }
+
+    // The calling thread works too, then waits for chunks still running elsewhere
+    state->Run();
+
+    std::unique_lock<std::mutex> lock(state->mutex);
+    state->cond.wait(lock, [&state](){ return state->done.load() == state->dataSize; });
+
+    // Only rethrow once nothing is running _func, it may refer to the callers locals
+    if(state->error)
+    {
+        std::rethrow_exception(state->error);
+    }
+}
+
+//------------------------------------------------------------------------------------------------
+
+void ThreadPool::StartWorkers(const unsigned int _numWorkers)
+{
+    m_stop = false;
+    m_numPendingTasks = 0;
+
+    m_queues.clear();
+    for(unsigned int i=0; i<_numWorkers; i++)
+    {
+        m_queues.push_back(std::unique_ptr<WorkQueue>(new WorkQueue()));
+    }
+
+    for(unsigned int i=0; i<_numWorkers; i++)
+    {
+        m_workers.push_back(std::thread(&ThreadPool::WorkerLoop, this, i));
+    }
+}
+
+//------------------------------------------------------------------------------------------------
+
+void ThreadPool::StopWorkers()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_sleepMutex);
+        m_stop = true;
+    }
+    m_sleepCond.notify_all();
+
+    for(auto &worker : m_workers)
+    {
+        if(worker.joinable())
+        {
+            worker.join();
+        }
+    }
+
+    m_workers.clear();
+    m_queues.clear();
+}
+
+//------------------------------------------------------------------------------------------------
+
+void ThreadPool::WorkerLoop(const unsigned int _workerId)
+{
+    t_pool = this;
+    t_workerId = _workerId;
+
+    std::function<void()> task;
+    while(true)
+    {
+        if(Pop(_workerId, task))
+        {
+            task();
+            task = nullptr;
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(m_sleepMutex);
+        m_sleepCond.wait(lock, [this](){ return m_stop || m_numPendingTasks.load() > 0; });
+        if(m_stop && m_numPendingTasks.load() <= 0)
+        {
+            break;
+        }
+    }
+
+    t_pool = nullptr;
+}
+
+//------------------------------------------------------------------------------------------------
+
+void ThreadPool::Push(std::function<void()> _task)
+{
+    if(m_queues.empty())
+    {
+        _task();
+        return;
+    }
+
+    unsigned int queueId = (t_pool == this) ? t_workerId : (m_nextQueue++ % m_queues.size());
+    {
+        std::lock_guard<std::mutex> lock(m_queues[queueId]->mutex);
+        m_queues[queueId]->tasks.push_back(std::move(_task));
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_sleepMutex);
+        m_numPendingTasks++;
+    }
+    m_sleepCond.notify_one();
+}
+
+//------------------------------------------------------------------------------------------------
+
+bool ThreadPool::Pop(const unsigned int _workerId, std::function<void()> &_task)
+{
+    unsigned int numQueues = m_queues.size();
+
+    // Newest task from our own deque first, it is most likely still in cache
+    {
+        WorkQueue &queue = *m_queues[_workerId];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if(!queue.tasks.empty())
+        {
+            _task = std::move(queue.tasks.back());
+            queue.tasks.pop_back();
+            m_numPendingTasks--;
+            return true;
+        }
+    }
+
+    // Otherwise steal the oldest task from someone else
+    for(unsigned int i=1; i<numQueues; i++)
+    {
+        WorkQueue &queue = *m_queues[(_workerId + i) % numQueues];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if(!queue.tasks.empty())
+        {
+            _task = std::move(queue.tasks.front());
+            queue.tasks.pop_front();
+            m_numPendingTasks--;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+//------------------------------------------------------------------------------------------------
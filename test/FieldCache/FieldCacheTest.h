@@ -0,0 +1,245 @@
+#ifndef _FIELDCACHETEST__H_
+#define _FIELDCACHETEST__H_
+
+//--------------------------------------------------------------------------
+
+#include "Shared.h"
+
+//--------------------------------------------------------------------------
+
+TEST_F(FieldCacheTest, SaveLoadRoundTrip)
+{
+    FieldFunction field;
+    MakeField(field);
+
+    FieldCache cache(m_directory + "/fields/nested");
+    ASSERT_TRUE(cache.Save(42, field));
+
+    FieldFunction loaded;
+    ASSERT_TRUE(cache.Load(42, loaded, false));
+    EXPECT_EQ(loaded.GetTextureResolution(), field.GetTextureResolution());
+    EXPECT_EQ(loaded.GetNumLevels(), field.GetNumLevels());
+
+    std::vector<glm::vec3> points;
+    MakeFieldPoints(points);
+    for(auto &&p : points)
+    {
+        EXPECT_EQ(loaded.Eval(p), field.Eval(p));
+        EXPECT_EQ(loaded.Eval(p, glm::mat4(1.0f), 1), field.Eval(p, glm::mat4(1.0f), 1));
+    }
+
+    // Saving again replaces the file
+    ASSERT_TRUE(cache.Save(42, field));
+    FieldFunction reloaded;
+    EXPECT_TRUE(cache.Load(42, reloaded, false));
+}
+
+//--------------------------------------------------------------------------
+
+TEST_F(FieldCacheTest, MissingFileMisses)
+{
+    FieldFunction field;
+    MakeField(field);
+
+    FieldCache cache(m_directory);
+    ASSERT_TRUE(cache.Save(42, field));
+
+    FieldFunction loaded;
+    EXPECT_FALSE(cache.Load(43, loaded, false));
+    EXPECT_EQ(loaded.Eval(glm::vec3(0.0f)), 0.0f);
+}
+
+//--------------------------------------------------------------------------
+
+TEST_F(FieldCacheTest, TruncatedFileMisses)
+{
+    FieldFunction field;
+    MakeField(field);
+
+    FieldCache cache(m_directory);
+    ASSERT_TRUE(cache.Save(42, field));
+    std::vector<char> bytes = ReadFile(FilePath(42));
+    ASSERT_GT(bytes.size(), 64u);
+
+    // Cut anywhere from the header to the last byte, the field is left as it was
+    FieldFunction other;
+    MakeField(other, glm::vec3(0.5f, 0.5f, 0.5f));
+    const float before = other.Eval(glm::vec3(0.8f, 0.0f, 0.0f));
+    for(std::size_t size : {bytes.size() - 1, bytes.size() / 2, (std::size_t)10, (std::size_t)0})
+    {
+        WriteFile(FilePath(42), std::vector<char>(bytes.begin(), bytes.begin() + size));
+        EXPECT_FALSE(cache.Load(42, other, false));
+        EXPECT_EQ(other.Eval(glm::vec3(0.8f, 0.0f, 0.0f)), before);
+    }
+}
+
+//--------------------------------------------------------------------------
+
+TEST_F(FieldCacheTest, StaleFileMisses)
+{
+    FieldFunction field;
+    MakeField(field);
+
+    FieldCache cache(m_directory);
+    ASSERT_TRUE(cache.Save(42, field));
+    std::vector<char> bytes = ReadFile(FilePath(42));
+
+    // Another version of the layout, the version follows the 4 byte magic
+    std::vector<char> stale = bytes;
+    stale[4] ^= 1;
+    WriteFile(FilePath(42), stale);
+    FieldFunction loaded;
+    EXPECT_FALSE(cache.Load(42, loaded, false));
+
+    // Another magic
+    stale = bytes;
+    stale[0] = 'X';
+    WriteFile(FilePath(42), stale);
+    EXPECT_FALSE(cache.Load(42, loaded, false));
+
+    // The file of another key under this key's name
+    WriteFile(FilePath(43), bytes);
+    EXPECT_FALSE(cache.Load(43, loaded, false));
+    EXPECT_EQ(loaded.Eval(glm::vec3(0.0f)), 0.0f);
+}
+
+//--------------------------------------------------------------------------
+
+TEST_F(FieldCacheTest, OnlyPrecomputedFieldsSaved)
+{
+    FieldCache cache(m_directory);
+    FieldFunction unfit;
+    EXPECT_FALSE(cache.Save(42, unfit));
+
+    std::vector<glm::vec3> points, normals;
+    EllipsoidSamples(40, glm::vec3(1.0f, 0.6f, 0.4f), points, normals);
+    FieldFunction notPrecomputed;
+    notPrecomputed.Fit(points, normals, 0.5f);
+    EXPECT_FALSE(cache.Save(42, notPrecomputed));
+
+    EXPECT_NE(access(FilePath(42).c_str(), F_OK), 0);
+}
+
+//--------------------------------------------------------------------------
+
+TEST_F(FieldCacheTest, LazyFieldSavedOnceFinished)
+{
+    FieldFunction eager;
+    MakeField(eager);
+
+    FieldFunction lazy;
+    lazy.SetLazyPrecompute(true);
+    MakeField(lazy);
+    ASSERT_TRUE(lazy.HasLazyBricks());
+
+    // Placeholders are never saved
+    FieldCache cache(m_directory);
+    EXPECT_FALSE(cache.Save(42, lazy));
+    EXPECT_NE(access(FilePath(42).c_str(), F_OK), 0);
+
+    // Some bricks filled by a lookup, the rest by finishing
+    std::vector<glm::vec3> points;
+    MakeFieldPoints(points);
+    lazy.Eval(points[points.size() / 2]);
+    EXPECT_TRUE(lazy.FinishLazyPrecompute(false));
+    EXPECT_FALSE(lazy.HasLazyBricks());
+    EXPECT_FALSE(lazy.FinishLazyPrecompute(false));
+    EXPECT_EQ(lazy.GetNumLevels(), eager.GetNumLevels());
+
+    ASSERT_TRUE(cache.Save(42, lazy));
+    FieldFunction loaded;
+    ASSERT_TRUE(cache.Load(42, loaded, false));
+    for(auto &&p : points)
+    {
+        EXPECT_NEAR(loaded.Eval(p), eager.Eval(p), 1e-4f);
+        EXPECT_NEAR(loaded.Eval(p, glm::mat4(1.0f), 1), eager.Eval(p, glm::mat4(1.0f), 1), 1e-4f);
+    }
+}
+
+//--------------------------------------------------------------------------
+
+TEST_F(FieldCacheTest, LazyLevelsBuiltByLookups)
+{
+    FieldFunction eager;
+    MakeField(eager);
+    ASSERT_GT(eager.GetNumLevels(), 1u);
+
+    FieldFunction lazy;
+    lazy.SetLazyPrecompute(true);
+    MakeField(lazy);
+    ASSERT_TRUE(lazy.HasLazyBricks());
+    EXPECT_EQ(lazy.GetNumLevels(), 1u);
+    EXPECT_EQ(lazy.GetLevel(1.0f), 0u);
+
+    // Lookups a voxel apart over the whole box reach every brick
+    glm::vec3 boundsMin, boundsMax;
+    lazy.GetTextureBounds(boundsMin, boundsMax);
+    const glm::uvec3 res = lazy.GetTextureResolution();
+    const glm::vec3 step = (boundsMax - boundsMin) / glm::vec3(res);
+    for(unsigned int z=0; z<res.z; ++z)
+    {
+        for(unsigned int y=0; y<res.y; ++y)
+        {
+            for(unsigned int x=0; x<res.x; ++x)
+            {
+                lazy.Eval(boundsMin + (glm::vec3(x + 0.5f, y + 0.5f, z + 0.5f) * step));
+            }
+        }
+    }
+
+    // The last brick filled built the coarser levels, as an eager precompute would have
+    EXPECT_FALSE(lazy.HasLazyBricks());
+    EXPECT_EQ(lazy.GetNumLevels(), eager.GetNumLevels());
+    EXPECT_EQ(lazy.GetLevel(1.0f), eager.GetLevel(1.0f));
+    std::vector<glm::vec3> points;
+    MakeFieldPoints(points);
+    for(auto &&p : points)
+    {
+        EXPECT_NEAR(lazy.Eval(p, glm::mat4(1.0f), 1), eager.Eval(p, glm::mat4(1.0f), 1), 1e-4f);
+    }
+
+    // Nothing left to fill, finishing only lets go of the brick states
+    EXPECT_TRUE(lazy.FinishLazyPrecompute(false));
+    EXPECT_FALSE(lazy.FinishLazyPrecompute(false));
+    EXPECT_EQ(lazy.GetNumLevels(), eager.GetNumLevels());
+
+    FieldCache cache(m_directory);
+    EXPECT_TRUE(cache.Save(42, lazy));
+}
+
+//--------------------------------------------------------------------------
+
+TEST_F(FieldCacheTest, EmptyDirectoryDisables)
+{
+    FieldFunction field;
+    MakeField(field);
+
+    FieldCache cache("");
+    EXPECT_FALSE(cache.Save(42, field));
+    EXPECT_FALSE(cache.Load(42, field, false));
+}
+
+//--------------------------------------------------------------------------
+
+TEST(FieldCache, KeyCoversSettings)
+{
+    Mesh mesh;
+    EllipsoidSamples(40, glm::vec3(1.0f, 0.6f, 0.4f), mesh.m_meshVerts, mesh.m_meshNorms);
+    std::pair<glm::vec3, glm::vec3> bone(glm::vec3(-1.0f, 0.0f, 0.0f), glm::vec3(1.0f, 0.0f, 0.0f));
+
+    FieldCache::Key key = FieldCache::MakeKey(mesh, bone, 50, 0.0f, 64);
+    EXPECT_EQ(FieldCache::MakeKey(mesh, bone, 50, 0.0f, 64), key);
+    EXPECT_NE(FieldCache::MakeKey(mesh, bone, 51, 0.0f, 64), key);
+    EXPECT_NE(FieldCache::MakeKey(mesh, bone, 50, 0.01f, 64), key);
+    EXPECT_NE(FieldCache::MakeKey(mesh, bone, 50, 0.0f, 32), key);
+
+    std::pair<glm::vec3, glm::vec3> otherBone(bone.first, glm::vec3(1.0f, 0.1f, 0.0f));
+    EXPECT_NE(FieldCache::MakeKey(mesh, otherBone, 50, 0.0f, 64), key);
+
+    mesh.m_meshVerts[7].x += 1e-3f;
+    EXPECT_NE(FieldCache::MakeKey(mesh, bone, 50, 0.0f, 64), key);
+}
+
+//--------------------------------------------------------------------------
+
+#endif // _FIELDCACHETEST__H_
@@ -0,0 +1,115 @@
+#ifndef _SHARED__H_
+#define _SHARED__H_
+
+//--------------------------------------------------------------------------
+
+#include <gtest/gtest.h>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+#include "ScalarField/fieldcache.h"
+
+
+//--------------------------------------------------------------------------
+// Points and normals on an ellipsoid, spread with a golden spiral
+//--------------------------------------------------------------------------
+void EllipsoidSamples(const int _numPoints, const glm::vec3 &_radii, std::vector<glm::vec3> &_points, std::vector<glm::vec3> &_normals)
+{
+    _points.resize(_numPoints);
+    _normals.resize(_numPoints);
+    const float goldenAngle = 3.14159265f * (3.0f - std::sqrt(5.0f));
+    for(int i=0; i<_numPoints; ++i)
+    {
+        float z = 1.0f - (2.0f * (i + 0.5f) / _numPoints);
+        float r = std::sqrt(1.0f - (z * z));
+        glm::vec3 unit(r * std::cos(goldenAngle * i), r * std::sin(goldenAngle * i), z);
+
+        _points[i] = unit * _radii;
+        _normals[i] = glm::normalize(unit / _radii);
+    }
+}
+
+//--------------------------------------------------------------------------
+// A small fit and precomputed field to cache
+//--------------------------------------------------------------------------
+void MakeField(FieldFunction &_field, const glm::vec3 &_radii = glm::vec3(1.0f, 0.6f, 0.4f))
+{
+    std::vector<glm::vec3> points, normals;
+    EllipsoidSamples(40, _radii, points, normals);
+    _field.Fit(points, normals, 0.5f);
+    _field.PrecomputeField(16, 2.0f, false);
+}
+
+//--------------------------------------------------------------------------
+// Sample points through and around the field
+//--------------------------------------------------------------------------
+void MakeFieldPoints(std::vector<glm::vec3> &_points)
+{
+    _points.clear();
+    for(float z=-1.3f; z<1.3f; z+=0.37f)
+    {
+        for(float y=-1.3f; y<1.3f; y+=0.29f)
+        {
+            for(float x=-2.1f; x<2.1f; x+=0.23f)
+            {
+                _points.push_back(glm::vec3(x, y, z));
+            }
+        }
+    }
+}
+
+//--------------------------------------------------------------------------
+// A directory of its own for each test, removed with everything in it afterwards
+//--------------------------------------------------------------------------
+class FieldCacheTest : public ::testing::Test
+{
+protected:
+    virtual void SetUp()
+    {
+        char directory[] = "/tmp/TestFieldCacheXXXXXX";
+        ASSERT_NE(mkdtemp(directory), nullptr);
+        m_directory = directory;
+    }
+
+    virtual void TearDown()
+    {
+        std::string command = "rm -rf '" + m_directory + "'";
+        EXPECT_EQ(std::system(command.c_str()), 0);
+    }
+
+    /// @brief Method to get the file FieldCache keeps a key in, under m_directory
+    std::string FilePath(const FieldCache::Key _key) const
+    {
+        std::ostringstream path;
+        path << m_directory << "/" << std::hex << _key << ".field";
+        return path.str();
+    }
+
+    /// @brief Method to read a whole file
+    std::vector<char> ReadFile(const std::string &_path) const
+    {
+        std::ifstream file(_path, std::ios::binary);
+        return std::vector<char>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    }
+
+    /// @brief Method to replace a file with _bytes
+    void WriteFile(const std::string &_path, const std::vector<char> &_bytes) const
+    {
+        std::ofstream file(_path, std::ios::binary | std::ios::trunc);
+        file.write(_bytes.data(), _bytes.size());
+    }
+
+    std::string m_directory;
+};
+
+//--------------------------------------------------------------------------
+
+
+#endif //_SHARED__H_
@@ -0,0 +1,10 @@
+#include <gtest/gtest.h>
+
+#include "FieldCacheTest.h"
+
+
+int main(int argc, char **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,40 @@
+QT       -= core gui
+
+
+TARGET = TestFieldCache
+
+DESTDIR = ../bin
+
+TEMPLATE = app
+
+CONFIG += console c++11
+
+QMAKE_CXXFLAGS += -std=c++11 -g
+
+# The cache is CPU only, keep CUDA out of the test
+DEFINES += NO_CUDA
+
+SOURCES +=  main.cpp                                    \
+            ../../src/ScalarField/fieldcache.cpp        \
+            ../../src/ScalarField/fieldfunction.cpp     \
+            ../../src/ScalarField/hrbf_batch.cpp        \
+            ../../src/ScalarField/hrbf_batch_avx2.cpp   \
+            ../../src/ScalarField/hrbf_batch_avx512.cpp \
+            ../../src/Threading/threadpool.cpp          \
+            ../../src/Texture/TextureBatch.cpp          \
+            ../../src/Texture/TextureBatchAvx2.cpp      \
+            ../../src/Texture/TextureBatchAvx512.cpp
+
+HEADERS +=  *.h                                         \
+            ../../include/ScalarField/fieldcache.h      \
+            ../../include/ScalarField/fieldfunction.h   \
+            ../../include/Texture/SparseTexture3DCpu.h  \
+            ../../include/Texture/BinaryBlob.h
+
+INCLUDEPATH +=  ../../include                       \
+                /usr/local/include                  \
+                /usr/include                        \
+                /usr/local/include/eigen3/          \
+                /usr/include/eigen3/
+
+LIBS += -L/usr/local/lib -L/usr/lib -lgtest
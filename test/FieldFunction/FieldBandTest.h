@@ -0,0 +1,91 @@
+#ifndef _FIELDBANDTEST__H_
+#define _FIELDBANDTEST__H_
+
+//--------------------------------------------------------------------------
+
+#include "Shared.h"
+
+//--------------------------------------------------------------------------
+// Largest difference between two fields over the voxels of the first one's texture
+//--------------------------------------------------------------------------
+float MaxVoxelDifference(FieldFunction &_a, FieldFunction &_b)
+{
+    glm::vec3 boundsMin, boundsMax;
+    _a.GetTextureBounds(boundsMin, boundsMax);
+    const glm::uvec3 res = _a.GetTextureResolution();
+    const glm::vec3 step = (boundsMax - boundsMin) / glm::vec3(res);
+    const glm::mat4 identity(1.0f);
+
+    float maxDiff = 0.0f;
+    for(unsigned int z=0; z<res.z; ++z)
+    {
+        for(unsigned int y=0; y<res.y; ++y)
+        {
+            for(unsigned int x=0; x<res.x; ++x)
+            {
+                glm::vec3 p = boundsMin + (glm::vec3(x, y, z) * step);
+                maxDiff = std::max(maxDiff, std::fabs(_a.Eval(p, identity) - _b.Eval(p, identity)));
+            }
+        }
+    }
+
+    return maxDiff;
+}
+
+//--------------------------------------------------------------------------
+
+TEST(FieldBand, BlockSkipMatchesFullEvaluation)
+{
+    // Blocks of one voxel are their own corners, so every voxel is evaluated
+    FieldFunction full;
+    full.SetPrecomputeBlockSize(1);
+    FitField(full);
+    full.PrecomputeField(40, 2.0f, false);
+
+    for(unsigned int blockSize : {2u, 4u, 7u})
+    {
+        FieldFunction banded;
+        banded.SetPrecomputeBlockSize(blockSize);
+        FitField(banded);
+        banded.PrecomputeField(40, 2.0f, false);
+        EXPECT_LT(MaxVoxelDifference(full, banded), 1e-4f) << "block size " << blockSize;
+    }
+}
+
+//--------------------------------------------------------------------------
+
+TEST(FieldBand, BlockSkipMatchesFullEvaluationTransformed)
+{
+    // A transformed, thinner field, blocks skewed against the surface
+    const glm::mat4 transform = glm::rotate(glm::mat4(1.0f), 0.7f, glm::vec3(1.0f, 2.0f, 0.5f));
+    const glm::vec3 radii(1.2f, 0.3f, 0.5f);
+
+    FieldFunction full;
+    full.SetPrecomputeBlockSize(1);
+    FitField(full, radii);
+    full.SetTransform(transform);
+    full.PrecomputeField(glm::uvec3(36, 28, 44), glm::vec3(-1.8f, -1.5f, -1.6f), glm::vec3(1.7f, 1.4f, 1.9f), false);
+
+    FieldFunction banded;
+    FitField(banded, radii);
+    banded.SetTransform(transform);
+    banded.PrecomputeField(glm::uvec3(36, 28, 44), glm::vec3(-1.8f, -1.5f, -1.6f), glm::vec3(1.7f, 1.4f, 1.9f), false);
+    EXPECT_LT(MaxVoxelDifference(full, banded), 1e-4f);
+}
+
+//--------------------------------------------------------------------------
+
+TEST(FieldBand, BlockSizeClampedAndKept)
+{
+    FieldFunction field;
+    EXPECT_EQ(field.GetPrecomputeBlockSize(), 4u);
+    field.SetPrecomputeBlockSize(0);
+    EXPECT_EQ(field.GetPrecomputeBlockSize(), 1u);
+    field.SetPrecomputeBlockSize(8);
+    EXPECT_EQ(field.GetPrecomputeBlockSize(), 8u);
+}
+
+//--------------------------------------------------------------------------
+
+
+#endif //_FIELDBANDTEST__H_
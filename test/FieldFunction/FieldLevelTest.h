@@ -0,0 +1,107 @@
+#ifndef _FIELDLEVELTEST__H_
+#define _FIELDLEVELTEST__H_
+
+//--------------------------------------------------------------------------
+
+#include "Shared.h"
+
+//--------------------------------------------------------------------------
+
+TEST(FieldLevel, CountAndResolution)
+{
+    FieldFunction field;
+    FitField(field);
+
+    // Halved while the level has at least twice the fewest voxels a level may have along every axis
+    field.PrecomputeField(32, 2.0f, false);
+    ASSERT_EQ(field.GetNumLevels(), 3u);
+    EXPECT_EQ(field.GetTextureResolution(0), glm::uvec3(32, 32, 32));
+    EXPECT_EQ(field.GetTextureResolution(1), glm::uvec3(16, 16, 16));
+    EXPECT_EQ(field.GetTextureResolution(2), glm::uvec3(8, 8, 8));
+    EXPECT_EQ(field.GetTextureResolution(7), glm::uvec3(8, 8, 8));
+
+    field.PrecomputeField(16, 2.0f, false);
+    ASSERT_EQ(field.GetNumLevels(), 2u);
+    EXPECT_EQ(field.GetTextureResolution(1), glm::uvec3(8, 8, 8));
+
+    field.PrecomputeField(15, 2.0f, false);
+    EXPECT_EQ(field.GetNumLevels(), 1u);
+    EXPECT_EQ(field.GetTextureResolution(1), glm::uvec3(15, 15, 15));
+
+    // Odd axes round up, the shortest axis decides when to stop
+    field.PrecomputeField(33, 2.0f, false);
+    ASSERT_EQ(field.GetNumLevels(), 3u);
+    EXPECT_EQ(field.GetTextureResolution(1), glm::uvec3(17, 17, 17));
+    EXPECT_EQ(field.GetTextureResolution(2), glm::uvec3(9, 9, 9));
+
+    field.PrecomputeField(glm::uvec3(32, 16, 48), glm::vec3(-2.0f), glm::vec3(2.0f), false);
+    ASSERT_EQ(field.GetNumLevels(), 2u);
+    EXPECT_EQ(field.GetTextureResolution(1), glm::uvec3(16, 8, 24));
+}
+
+//--------------------------------------------------------------------------
+
+TEST(FieldLevel, LevelForError)
+{
+    FieldFunction field;
+    FitField(field);
+
+    // Voxels of 0.125, 0.25 and 0.5 over a box of side 4
+    field.PrecomputeField(32, 2.0f, false);
+    EXPECT_EQ(field.GetLevel(0.0f), 0u);
+    EXPECT_EQ(field.GetLevel(0.125f), 0u);
+    EXPECT_EQ(field.GetLevel(0.2499f), 0u);
+    EXPECT_EQ(field.GetLevel(0.25f), 1u);
+    EXPECT_EQ(field.GetLevel(0.4999f), 1u);
+    EXPECT_EQ(field.GetLevel(0.5f), 2u);
+    EXPECT_EQ(field.GetLevel(100.0f), 2u);
+
+    // The largest side of a voxel counts, here 4/16 on level 0 and 4/8 on level 1
+    field.PrecomputeField(glm::uvec3(32, 16, 48), glm::vec3(-2.0f), glm::vec3(2.0f), false);
+    EXPECT_EQ(field.GetLevel(0.2499f), 0u);
+    EXPECT_EQ(field.GetLevel(0.25f), 0u);
+    EXPECT_EQ(field.GetLevel(0.4999f), 0u);
+    EXPECT_EQ(field.GetLevel(0.5f), 1u);
+
+    // A single level is all there is to pick
+    field.PrecomputeField(15, 2.0f, false);
+    EXPECT_EQ(field.GetLevel(100.0f), 0u);
+}
+
+//--------------------------------------------------------------------------
+
+TEST(FieldLevel, CoarseLevelMatchesDirectSampling)
+{
+    FieldFunction fine;
+    FitField(fine);
+    fine.PrecomputeField(32, 2.0f, false);
+
+    FieldFunction coarse;
+    FitField(coarse);
+    coarse.PrecomputeField(16, 2.0f, false);
+    ASSERT_EQ(fine.GetTextureResolution(1), coarse.GetTextureResolution());
+
+    // Level 1 of the fine field against the field sampled at its voxels, at the voxels and between them
+    const glm::mat4 identity(1.0f);
+    const float step = 4.0f / 16.0f;
+    for(float z=-2.0f; z<2.0f; z+=step / 3.0f)
+    {
+        for(float y=-2.0f; y<2.0f; y+=step / 3.0f)
+        {
+            for(float x=-2.0f; x<2.0f; x+=step / 3.0f)
+            {
+                glm::vec3 p(x, y, z);
+                EXPECT_NEAR(fine.Eval(p, identity, 1), coarse.Eval(p, identity, 0), 1e-3f);
+            }
+        }
+    }
+
+    // Past the coarsest level sampling stays on it
+    glm::vec3 p(0.3f, -0.2f, 0.1f);
+    EXPECT_EQ(fine.Eval(p, identity, 5), fine.Eval(p, identity, 2));
+}
+
+//--------------------------------------------------------------------------
+
+
+#endif //_FIELDLEVELTEST__H_
@@ -0,0 +1,48 @@
+#ifndef _SHARED__H_
+#define _SHARED__H_
+
+//--------------------------------------------------------------------------
+
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include <glm/gtx/transform.hpp>
+
+#include "ScalarField/fieldfunction.h"
+
+
+//--------------------------------------------------------------------------
+// Points and normals on an ellipsoid, spread with a golden spiral
+//--------------------------------------------------------------------------
+void EllipsoidSamples(const int _numPoints, const glm::vec3 &_radii, std::vector<glm::vec3> &_points, std::vector<glm::vec3> &_normals)
+{
+    _points.resize(_numPoints);
+    _normals.resize(_numPoints);
+    const float goldenAngle = 3.14159265f * (3.0f - std::sqrt(5.0f));
+    for(int i=0; i<_numPoints; ++i)
+    {
+        float z = 1.0f - (2.0f * (i + 0.5f) / _numPoints);
+        float r = std::sqrt(1.0f - (z * z));
+        glm::vec3 unit(r * std::cos(goldenAngle * i), r * std::sin(goldenAngle * i), z);
+
+        _points[i] = unit * _radii;
+        _normals[i] = glm::normalize(unit / _radii);
+    }
+}
+
+//--------------------------------------------------------------------------
+// A small field fit to an ellipsoid, left for each test to precompute
+//--------------------------------------------------------------------------
+void FitField(FieldFunction &_field, const glm::vec3 &_radii = glm::vec3(1.0f, 0.6f, 0.4f))
+{
+    std::vector<glm::vec3> points, normals;
+    EllipsoidSamples(40, _radii, points, normals);
+    _field.Fit(points, normals, 0.5f);
+}
+
+//--------------------------------------------------------------------------
+
+
+#endif //_SHARED__H_
@@ -0,0 +1,11 @@
+#include <gtest/gtest.h>
+
+#include "FieldLevelTest.h"
+#include "FieldBandTest.h"
+
+
+int main(int argc, char **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,142 @@
+#ifndef _BATCHEVALTEST__H_
+#define _BATCHEVALTEST__H_
+
+//--------------------------------------------------------------------------
+
+#include "Shared.h"
+
+//--------------------------------------------------------------------------
+// Check eval_grad matches eval and grad point by point
+//--------------------------------------------------------------------------
+template<typename Hrbf>
+void ExpectBatchMatches(const Hrbf &_hrbf,
+                        const std::vector<typename Hrbf::Vector> &_points,
+                        const double _tolerance)
+{
+    std::vector<typename Hrbf::Scalar> values(_points.size());
+    std::vector<typename Hrbf::Vector> grads(_points.size());
+    _hrbf.eval_grad(_points.data(), _points.size(), values.data(), grads.data());
+
+    for(unsigned int i=0; i<_points.size(); i++)
+    {
+        typename Hrbf::Scalar value = _hrbf.eval(_points[i]);
+        typename Hrbf::Vector g = _hrbf.grad(_points[i]);
+
+        double scale = 1.0 + std::abs(value);
+        EXPECT_NEAR(value, values[i], _tolerance * scale);
+        for(int d=0; d<3; d++)
+        {
+            EXPECT_NEAR(g(d), grads[i](d), _tolerance * (1.0 + g.norm()));
+        }
+    }
+}
+
+//--------------------------------------------------------------------------
+// Points on a grid around the samples, with a count that is not a multiple of the lane width
+//--------------------------------------------------------------------------
+template<typename Vector>
+std::vector<Vector> GridPoints(const int _res, const double _dim)
+{
+    std::vector<Vector> points;
+    for(int z=0; z<_res; z++)
+    {
+        for(int y=0; y<_res; y++)
+        {
+            for(int x=0; x<_res; x++)
+            {
+                points.push_back(Vector(_dim*((2.0*x/(_res-1))-1.0),
+                                        _dim*((2.0*y/(_res-1))-1.0),
+                                        _dim*((2.0*z/(_res-1))-1.0)) + Vector(0.013, 0.007, 0.011));
+            }
+        }
+    }
+    return points;
+}
+
+//--------------------------------------------------------------------------
+
+TEST(BatchEval, Pow3MatchesPointwise)
+{
+    std::vector<HrbfPow3::Vector> points, normals;
+    EllipsoidSamples(70, HrbfPow3::Vector(1.0f, 0.6f, 2.0f), points, normals);
+
+    HrbfPow3 hrbf;
+    hrbf.hermite_fit(points, normals);
+
+    ExpectBatchMatches(hrbf, GridPoints<HrbfPow3::Vector>(7, 2.5), 1e-4);
+}
+
+//--------------------------------------------------------------------------
+
+TEST(BatchEval, Pow3AtCentres)
+{
+    std::vector<HrbfPow3::Vector> points, normals;
+    EllipsoidSamples(37, HrbfPow3::Vector(1.0f, 0.6f, 2.0f), points, normals);
+
+    HrbfPow3 hrbf;
+    hrbf.hermite_fit(points, normals);
+
+    ExpectBatchMatches(hrbf, points, 1e-4);
+}
+
+//--------------------------------------------------------------------------
+
+TEST(BatchEval, Pow3KernelsMatchPointwise)
+{
+    std::vector<HrbfPow3::Vector> points, normals;
+    EllipsoidSamples(70, HrbfPow3::Vector(1.0f, 0.6f, 2.0f), points, normals);
+
+    HrbfPow3 hrbf;
+    hrbf.hermite_fit(points, normals);
+
+    // Every instruction set this CPU supports, not just the one picked
+    const hrbf_batch::Isa picked = hrbf_batch::selected();
+    for(auto isa : {hrbf_batch::Isa::Portable, hrbf_batch::Isa::Avx2, hrbf_batch::Isa::Avx512})
+    {
+        if(!hrbf_batch::select(isa))
+        {
+            continue;
+        }
+        SCOPED_TRACE(hrbf_batch::get_name(isa));
+        EXPECT_EQ(hrbf_batch::pow3_kernel() == nullptr, isa == hrbf_batch::Isa::Portable);
+
+        ExpectBatchMatches(hrbf, GridPoints<HrbfPow3::Vector>(7, 2.5), 1e-4);
+        ExpectBatchMatches(hrbf, points, 1e-4);
+    }
+    hrbf_batch::select(picked);
+}
+
+//--------------------------------------------------------------------------
+
+TEST(BatchEval, GaussMatchesPointwise)
+{
+    std::vector<HrbfGauss::Vector> points, normals;
+    EllipsoidSamples(50, HrbfGauss::Vector(1.0, 0.6, 2.0), points, normals);
+
+    HrbfGauss hrbf;
+    hrbf.hermite_fit(points, normals);
+
+    ExpectBatchMatches(hrbf, GridPoints<HrbfGauss::Vector>(5, 2.5), 1e-9);
+    ExpectBatchMatches(hrbf, points, 1e-9);
+}
+
+//--------------------------------------------------------------------------
+
+TEST(BatchEval, EmptyAndTinyBatches)
+{
+    std::vector<HrbfPow3::Vector> points, normals;
+    EllipsoidSamples(20, HrbfPow3::Vector(1.0f, 1.0f, 1.0f), points, normals);
+
+    HrbfPow3 hrbf;
+    hrbf.hermite_fit(points, normals);
+
+    hrbf.eval_grad(points.data(), 0, nullptr, nullptr);
+
+    std::vector<HrbfPow3::Vector> single(1, HrbfPow3::Vector(0.3f, -0.2f, 0.5f));
+    ExpectBatchMatches(hrbf, single, 1e-4);
+}
+
+//--------------------------------------------------------------------------
+
+
+#endif //_BATCHEVALTEST__H_
@@ -0,0 +1,239 @@
+#ifndef _COMPACTFITTEST__H_
+#define _COMPACTFITTEST__H_
+
+//--------------------------------------------------------------------------
+
+#include "Shared.h"
+#include "HermiteFitTest.h"
+
+//--------------------------------------------------------------------------
+// Wendland C4 with its radius baked in, not marked compact, so HRBF_fit
+// takes the dense path and visits every node
+//--------------------------------------------------------------------------
+template<int RadiusPercent>
+struct Rbf_wendland_dense
+{
+    static double r() { return RadiusPercent / 100.0; }
+    static inline double f  (const double& x) { return Rbf_wendland_c4<double>::f(x / r());                   }
+    static inline double df (const double& x) { return Rbf_wendland_c4<double>::df(x / r()) / r();            }
+    static inline double ddf(const double& x) { return Rbf_wendland_c4<double>::ddf(x / r()) / (r() * r());   }
+};
+
+//--------------------------------------------------------------------------
+// Fit the same samples sparse and dense and check both fields agree
+//--------------------------------------------------------------------------
+template<int RadiusPercent>
+void ExpectSparseMatchesDense(const int _numPoints)
+{
+    std::vector<HrbfWendland::Vector> points, normals;
+    EllipsoidSamples(_numPoints, HrbfWendland::Vector(1.0, 0.6, 2.0), points, normals);
+
+    HrbfWendland sparse;
+    sparse.set_support_radius(RadiusPercent / 100.0);
+    sparse.hermite_fit(points, normals);
+    EXPECT_LE(sparse.residual(), sparse.residual_tolerance());
+    ExpectInterpolates(sparse, points, normals, 1e-6);
+
+    HRBF_fit<double, 3, Rbf_wendland_dense<RadiusPercent> > dense;
+    dense.hermite_fit(points, normals);
+
+    for(int i=0; i<_numPoints; i++)
+    {
+        EXPECT_NEAR(dense._alphas(i), sparse._alphas(i), 1e-6 * (1.0 + std::abs(dense._alphas(i))));
+    }
+
+    // Evaluate through the grid, including points outside the bounds of the centres
+    for(double t=-3.0; t<=3.0; t+=0.1)
+    {
+        HrbfWendland::Vector x(0.4*t, 0.7 - 0.3*t, t);
+        EXPECT_NEAR(dense.eval(x), sparse.eval(x), 1e-6);
+
+        HrbfWendland::Vector g = sparse.grad(x);
+        HrbfWendland::Vector gd = dense.grad(x);
+        for(int d=0; d<3; d++)
+        {
+            EXPECT_NEAR(gd(d), g(d), 1e-4 * (1.0 + gd.norm()));
+        }
+    }
+}
+
+//--------------------------------------------------------------------------
+
+TEST(CompactFit, KernelDerivatives)
+{
+    // Compare against central differences, and check the support ends at 1
+    for(double x=0.05; x<1.0; x+=0.05)
+    {
+        const double h = 1e-6;
+        EXPECT_NEAR((Rbf_wendland_c4<double>::f(x+h) - Rbf_wendland_c4<double>::f(x-h)) / (2*h), Rbf_wendland_c4<double>::df(x), 1e-5);
+        EXPECT_NEAR((Rbf_wendland_c4<double>::df(x+h) - Rbf_wendland_c4<double>::df(x-h)) / (2*h), Rbf_wendland_c4<double>::ddf(x), 1e-5);
+        EXPECT_NEAR((Rbf_wendland_c2<double>::f(x+h) - Rbf_wendland_c2<double>::f(x-h)) / (2*h), Rbf_wendland_c2<double>::df(x), 1e-5);
+        EXPECT_NEAR((Rbf_wendland_c2<double>::df(x+h) - Rbf_wendland_c2<double>::df(x-h)) / (2*h), Rbf_wendland_c2<double>::ddf(x), 1e-5);
+    }
+
+    EXPECT_EQ(0.0, Rbf_wendland_c4<double>::f(1.0));
+    EXPECT_EQ(0.0, Rbf_wendland_c4<double>::df(1.5));
+    EXPECT_EQ(0.0, Rbf_wendland_c2<double>::ddf(2.0));
+}
+
+//--------------------------------------------------------------------------
+
+TEST(CompactFit, SparseMatchesDense)
+{
+    ExpectSparseMatchesDense<80>(200);
+}
+
+//--------------------------------------------------------------------------
+
+TEST(CompactFit, TinySupportWidensGrid)
+{
+    // So small that nodes do not overlap and the grid has to widen its cells
+    ExpectSparseMatchesDense<5>(40);
+}
+
+//--------------------------------------------------------------------------
+
+TEST(CompactFit, VanishesAwayFromCentres)
+{
+    std::vector<HrbfWendland::Vector> points, normals;
+    EllipsoidSamples(100, HrbfWendland::Vector(1.0, 1.0, 1.0), points, normals);
+
+    HrbfWendland hrbf;
+    hrbf.set_support_radius(0.5);
+    hrbf.hermite_fit(points, normals);
+
+    EXPECT_EQ(HrbfWendland::LDLT, hrbf.used_solver());
+    EXPECT_EQ(0.0, hrbf.eval(HrbfWendland::Vector(0.0, 0.0, 0.0)));
+    EXPECT_EQ(0.0, hrbf.eval(HrbfWendland::Vector(5.0, 0.0, 0.0)));
+    EXPECT_EQ(0.0, hrbf.grad(HrbfWendland::Vector(0.0, -7.0, 0.0)).norm());
+}
+
+//--------------------------------------------------------------------------
+
+TEST(CompactFit, BatchMatchesPointwise)
+{
+    std::vector<HrbfWendland::Vector> points, normals;
+    EllipsoidSamples(150, HrbfWendland::Vector(1.0, 0.6, 2.0), points, normals);
+
+    HrbfWendland hrbf;
+    hrbf.set_support_radius(0.7);
+    hrbf.hermite_fit(points, normals);
+
+    std::vector<HrbfWendland::Vector> samples = points;
+    samples.push_back(HrbfWendland::Vector(0.2, 0.1, -0.3));
+    samples.push_back(HrbfWendland::Vector(9.0, 9.0, 9.0));
+
+    std::vector<double> values(samples.size());
+    std::vector<HrbfWendland::Vector> grads(samples.size());
+    hrbf.eval_grad(samples.data(), samples.size(), values.data(), grads.data());
+
+    for(unsigned int i=0; i<samples.size(); i++)
+    {
+        EXPECT_DOUBLE_EQ(hrbf.eval(samples[i]), values[i]);
+        EXPECT_DOUBLE_EQ((hrbf.grad(samples[i]) - grads[i]).norm(), 0.0);
+    }
+}
+
+//--------------------------------------------------------------------------
+
+TEST(IterativeFit, CompactMatchesSparse)
+{
+    std::vector<HrbfWendland::Vector> points, normals;
+    EllipsoidSamples(400, HrbfWendland::Vector(1.0, 0.6, 2.0), points, normals);
+
+    HrbfWendland sparse;
+    sparse.set_support_radius(0.5);
+    sparse.hermite_fit(points, normals);
+
+    HrbfWendland iterative;
+    iterative.set_support_radius(0.5);
+    iterative.set_solver(HrbfWendland::ITERATIVE);
+    iterative.set_iterative_tolerance(1e-10);
+    iterative.hermite_fit(points, normals);
+
+    EXPECT_EQ(HrbfWendland::ITERATIVE, iterative.used_solver());
+    EXPECT_LE(iterative.residual(), 1e-10);
+    EXPECT_LT(iterative.iterations(), iterative.max_iterations());
+    ExpectInterpolates(iterative, points, normals, 1e-8);
+
+    for(int i=0; i<iterative._alphas.size(); i++)
+    {
+        EXPECT_NEAR(sparse._alphas(i), iterative._alphas(i), 1e-6 * (1.0 + std::abs(sparse._alphas(i))));
+    }
+}
+
+//--------------------------------------------------------------------------
+
+TEST(IterativeFit, WarmStart)
+{
+    std::vector<HrbfWendland::Vector> points, normals;
+    EllipsoidSamples(300, HrbfWendland::Vector(1.0, 0.6, 2.0), points, normals);
+
+    HrbfWendland hrbf;
+    hrbf.set_support_radius(0.5);
+    hrbf.set_solver(HrbfWendland::ITERATIVE);
+    hrbf.set_iterative_tolerance(1e-8);
+    hrbf.hermite_fit(points, normals);
+    int coldIterations = hrbf.iterations();
+    EXPECT_GT(coldIterations, 0);
+
+    // The previous weights already solve the same system
+    hrbf.hermite_fit(points, normals);
+    EXPECT_EQ(0, hrbf.iterations());
+
+    // A small edit converges faster than starting over
+    points[7] += HrbfWendland::Vector(0.01, 0.0, 0.0);
+    hrbf.hermite_fit(points, normals);
+    EXPECT_LT(hrbf.iterations(), coldIterations);
+    ExpectInterpolates(hrbf, points, normals, 1e-6);
+
+    hrbf.set_warm_start(false);
+    hrbf.hermite_fit(points, normals);
+    EXPECT_GT(hrbf.iterations(), 0);
+}
+
+//--------------------------------------------------------------------------
+
+TEST(IterativeFit, Pow3MatchesDense)
+{
+    std::vector<HrbfPow3::Vector> points, normals;
+    EllipsoidSamples(100, HrbfPow3::Vector(1.0f, 0.6f, 2.0f), points, normals);
+
+    HrbfPow3 dense;
+    dense.hermite_fit(points, normals);
+
+    // The r^3 diagonal blocks are zero, so this runs unpreconditioned
+    HrbfPow3 iterative;
+    iterative.set_solver(HrbfPow3::ITERATIVE);
+    iterative.hermite_fit(points, normals);
+
+    EXPECT_LE(iterative.residual(), iterative.iterative_tolerance());
+    ExpectInterpolates(iterative, points, normals, 1e-3);
+    for(float t=-2.0f; t<=2.0f; t+=0.25f)
+    {
+        HrbfPow3::Vector x(0.3f*t, 1.1f - 0.2f*t, t);
+        EXPECT_NEAR(dense.eval(x), iterative.eval(x), 1e-2f * (1.0f + std::fabs(dense.eval(x))));
+    }
+}
+
+//--------------------------------------------------------------------------
+
+TEST(IterativeFit, StopsAtMaxIterations)
+{
+    std::vector<HrbfPow3::Vector> points, normals;
+    EllipsoidSamples(60, HrbfPow3::Vector(1.0f, 0.6f, 2.0f), points, normals);
+
+    HrbfPow3 hrbf;
+    hrbf.set_solver(HrbfPow3::ITERATIVE);
+    hrbf.set_iterative_tolerance(0.0f);
+    hrbf.set_max_iterations(25, 10);
+    hrbf.hermite_fit(points, normals);
+
+    EXPECT_EQ(25, hrbf.iterations());
+    EXPECT_GT(hrbf.residual(), 0.0f);
+}
+
+//--------------------------------------------------------------------------
+
+
+#endif //_COMPACTFITTEST__H_
@@ -0,0 +1,306 @@
+#ifndef _HERMITEFITTEST__H_
+#define _HERMITEFITTEST__H_
+
+//--------------------------------------------------------------------------
+
+#include "Shared.h"
+
+//--------------------------------------------------------------------------
+// Check the fit is zero at the points with gradients along the normals
+//--------------------------------------------------------------------------
+template<typename Hrbf>
+void ExpectInterpolates(const Hrbf &_hrbf,
+                        const std::vector<typename Hrbf::Vector> &_points,
+                        const std::vector<typename Hrbf::Vector> &_normals,
+                        const double _tolerance)
+{
+    for(unsigned int i=0; i<_points.size(); i++)
+    {
+        EXPECT_NEAR(0.0, _hrbf.eval(_points[i]), _tolerance);
+
+        typename Hrbf::Vector g = _hrbf.grad(_points[i]);
+        for(int d=0; d<3; d++)
+        {
+            EXPECT_NEAR(_normals[i](d), g(d), _tolerance);
+        }
+    }
+}
+
+//--------------------------------------------------------------------------
+
+TEST(HermiteFit, Pow3SkipsLDLT)
+{
+    std::vector<HrbfPow3::Vector> points, normals;
+    EllipsoidSamples(60, HrbfPow3::Vector(1.0f, 0.6f, 2.0f), points, normals);
+
+    // The r^3 kernel has a zero diagonal, LDLT cannot pivot on it
+    HrbfPow3 hrbf;
+    EXPECT_EQ(HrbfPow3::LDLT, hrbf.solver());
+    hrbf.hermite_fit(points, normals);
+
+    EXPECT_EQ(HrbfPow3::PARTIAL_PIV_LU, hrbf.used_solver());
+    EXPECT_LE(hrbf.residual(), hrbf.residual_tolerance());
+    ExpectInterpolates(hrbf, points, normals, 1e-3);
+}
+
+//--------------------------------------------------------------------------
+
+TEST(HermiteFit, SolversAgree)
+{
+    std::vector<HrbfPow3::Vector> points, normals;
+    EllipsoidSamples(60, HrbfPow3::Vector(1.0f, 0.6f, 2.0f), points, normals);
+
+    HrbfPow3 partial;
+    partial.set_solver(HrbfPow3::PARTIAL_PIV_LU);
+    partial.hermite_fit(points, normals);
+
+    HrbfPow3 full;
+    full.set_solver(HrbfPow3::FULL_PIV_LU);
+    full.hermite_fit(points, normals);
+
+    EXPECT_EQ(HrbfPow3::FULL_PIV_LU, full.used_solver());
+
+    // Compare the fields away from the points too
+    for(float t=-2.0f; t<=2.0f; t+=0.25f)
+    {
+        HrbfPow3::Vector x(0.3f*t, 1.1f - 0.2f*t, t);
+        EXPECT_NEAR(full.eval(x), partial.eval(x), 1e-2f * (1.0f + std::fabs(full.eval(x))));
+    }
+}
+
+//--------------------------------------------------------------------------
+
+TEST(HermiteFit, ResidualEscalates)
+{
+    std::vector<HrbfPow3::Vector> points, normals;
+    EllipsoidSamples(30, HrbfPow3::Vector(1.0f, 1.0f, 1.0f), points, normals);
+
+    // No residual passes a negative tolerance, so every solver is tried
+    HrbfPow3 hrbf;
+    hrbf.set_residual_tolerance(-1.0f);
+    hrbf.hermite_fit(points, normals);
+
+    EXPECT_EQ(HrbfPow3::FULL_PIV_LU, hrbf.used_solver());
+    ExpectInterpolates(hrbf, points, normals, 1e-3);
+}
+
+//--------------------------------------------------------------------------
+
+TEST(HermiteFit, PositiveDefiniteKernelUsesLDLT)
+{
+    std::vector<HrbfGauss::Vector> points, normals;
+    EllipsoidSamples(20, HrbfGauss::Vector(1.5, 1.0, 2.0), points, normals);
+
+    HrbfGauss hrbf;
+    hrbf.set_residual_tolerance(1e-8);
+    hrbf.hermite_fit(points, normals);
+
+    EXPECT_EQ(HrbfGauss::LDLT, hrbf.used_solver());
+    ExpectInterpolates(hrbf, points, normals, 1e-6);
+}
+
+//--------------------------------------------------------------------------
+
+TEST(HermiteFit, WorkspaceReuse)
+{
+    std::vector<HrbfPow3::Vector> bigPoints, bigNormals, smallPoints, smallNormals;
+    EllipsoidSamples(60, HrbfPow3::Vector(1.0f, 0.6f, 2.0f), bigPoints, bigNormals);
+    EllipsoidSamples(25, HrbfPow3::Vector(0.8f, 1.2f, 1.0f), smallPoints, smallNormals);
+
+    HrbfPow3 fresh;
+    fresh.hermite_fit(smallPoints, smallNormals);
+
+    // A smaller fit after a bigger one reuses the left over buffers
+    HrbfPow3::Workspace workspace;
+    HrbfPow3 hrbf;
+    hrbf.hermite_fit(bigPoints, bigNormals, &workspace);
+    ExpectInterpolates(hrbf, bigPoints, bigNormals, 1e-3);
+    hrbf.hermite_fit(smallPoints, smallNormals, &workspace);
+    ExpectInterpolates(hrbf, smallPoints, smallNormals, 1e-3);
+
+    for(int i=0; i<hrbf._alphas.size(); i++)
+    {
+        EXPECT_FLOAT_EQ(fresh._alphas(i), hrbf._alphas(i));
+    }
+
+    workspace.release();
+    hrbf.hermite_fit(bigPoints, bigNormals, &workspace);
+    ExpectInterpolates(hrbf, bigPoints, bigNormals, 1e-3);
+}
+
+//--------------------------------------------------------------------------
+
+TEST(HermiteFit, ParallelAssembly)
+{
+    std::vector<HrbfPow3::Vector> points, normals;
+    EllipsoidSamples(61, HrbfPow3::Vector(1.0f, 0.6f, 2.0f), points, normals);
+
+    HrbfPow3 serial;
+    serial.hermite_fit(points, normals);
+
+    // Small chunks across a few threads, in no particular order
+    HrbfPow3 parallel;
+    parallel.set_parallel_for([](const std::function<void(int, int)> &func, int size){
+        std::atomic<int> next(0);
+        std::vector<std::thread> threads;
+        for(int t=0; t<4; t++)
+        {
+            threads.emplace_back([&](){
+                for(int start = next.fetch_add(3); start < size; start = next.fetch_add(3))
+                {
+                    func(start, std::min(start + 3, size));
+                }
+            });
+        }
+        for(auto &thread : threads)
+        {
+            thread.join();
+        }
+    });
+    parallel.hermite_fit(points, normals);
+
+    EXPECT_EQ(serial.used_solver(), parallel.used_solver());
+    for(int i=0; i<serial._alphas.size(); i++)
+    {
+        EXPECT_FLOAT_EQ(serial._alphas(i), parallel._alphas(i));
+        for(int d=0; d<3; d++)
+        {
+            EXPECT_FLOAT_EQ(serial._betas(d, i), parallel._betas(d, i));
+        }
+    }
+}
+
+//--------------------------------------------------------------------------
+
+TEST(HermiteFit, MixedPrecision)
+{
+    std::vector<HrbfPow3::Vector> points, normals;
+    EllipsoidSamples(300, HrbfPow3::Vector(1.0f, 0.6f, 2.0f), points, normals);
+
+    std::vector<HrbfPow3d::Vector> pointsd, normalsd;
+    for(unsigned int i=0; i<points.size(); i++)
+    {
+        pointsd.push_back(points[i].cast<double>());
+        normalsd.push_back(normals[i].cast<double>());
+    }
+
+    // Solved in double, evaluated in float through the batched kernels
+    HrbfPow3d fit;
+    fit.hermite_fit(pointsd, normalsd);
+    HrbfPow3 hrbf;
+    hrbf.assign_from(fit);
+
+    EXPECT_EQ(fit.used_solver(), hrbf.used_solver());
+    EXPECT_LE(fit.residual(), 1e-10);
+    ExpectInterpolates(hrbf, points, normals, 5e-4);
+
+    std::vector<float> values(points.size());
+    std::vector<HrbfPow3::Vector> grads(points.size());
+    hrbf.eval_grad(points.data(), points.size(), values.data(), grads.data());
+    for(unsigned int i=0; i<points.size(); i++)
+    {
+        EXPECT_NEAR(fit.eval(pointsd[i]), values[i], 5e-4);
+    }
+}
+
+//--------------------------------------------------------------------------
+// Check two fits have the same centres and weights
+//--------------------------------------------------------------------------
+template<typename Hrbf>
+void ExpectSameFit(const Hrbf &_expected, const Hrbf &_actual, const double _tolerance)
+{
+    ASSERT_EQ(_expected._node_centers.cols(), _actual._node_centers.cols());
+    EXPECT_EQ(_expected._node_centers, _actual._node_centers);
+
+    double scale = 1.0 + _expected._alphas.cwiseAbs().maxCoeff() + _expected._betas.cwiseAbs().maxCoeff();
+    EXPECT_LE((_expected._alphas - _actual._alphas).cwiseAbs().maxCoeff(), _tolerance * scale);
+    EXPECT_LE((_expected._betas - _actual._betas).cwiseAbs().maxCoeff(), _tolerance * scale);
+}
+
+//--------------------------------------------------------------------------
+
+TEST(IncrementalFit, AddAndRemoveMatchRefit)
+{
+    std::vector<HrbfPow3d::Vector> points, normals, extraPoints, extraNormals;
+    EllipsoidSamples(80, HrbfPow3d::Vector(1.0, 0.6, 2.0), points, normals);
+    EllipsoidSamples(7, HrbfPow3d::Vector(1.05, 0.65, 2.1), extraPoints, extraNormals);
+
+    HrbfPow3d hrbf;
+    hrbf.set_keep_factorisation(true);
+    hrbf.hermite_fit(points, normals);
+    ASSERT_TRUE(hrbf.has_factorisation());
+
+    // add some, remove some of the original and one of the added
+    ASSERT_TRUE(hrbf.add_nodes(extraPoints, extraNormals));
+    ASSERT_TRUE(hrbf.remove_nodes({3, 40, 79, 82}));
+    EXPECT_EQ(7 - 1 + 3, hrbf.nb_pending_updates());
+    EXPECT_LE(hrbf.residual(), 1e-8);
+
+    std::vector<HrbfPow3d::Vector> expectedPoints, expectedNormals;
+    for(int i=0; i<80; i++)
+    {
+        if(i != 3 && i != 40 && i != 79)
+        {
+            expectedPoints.push_back(points[i]);
+            expectedNormals.push_back(normals[i]);
+        }
+    }
+    for(int i=0; i<7; i++)
+    {
+        if(i != 2)
+        {
+            expectedPoints.push_back(extraPoints[i]);
+            expectedNormals.push_back(extraNormals[i]);
+        }
+    }
+
+    HrbfPow3d refit;
+    refit.hermite_fit(expectedPoints, expectedNormals);
+
+    ExpectSameFit(refit, hrbf, 1e-7);
+    ExpectInterpolates(hrbf, expectedPoints, expectedNormals, 1e-6);
+}
+
+//--------------------------------------------------------------------------
+
+TEST(IncrementalFit, RefitsPastMaxPending)
+{
+    std::vector<HrbfPow3d::Vector> points, normals, extraPoints, extraNormals;
+    EllipsoidSamples(40, HrbfPow3d::Vector(1.0, 0.6, 2.0), points, normals);
+    EllipsoidSamples(5, HrbfPow3d::Vector(0.9, 0.5, 1.8), extraPoints, extraNormals);
+
+    HrbfPow3d hrbf;
+    hrbf.set_keep_factorisation(true);
+    hrbf.set_max_pending_updates(4);
+    hrbf.hermite_fit(points, normals);
+
+    ASSERT_TRUE(hrbf.add_nodes(extraPoints, extraNormals));
+    EXPECT_EQ(0, hrbf.nb_pending_updates());
+    EXPECT_TRUE(hrbf.has_factorisation());
+    EXPECT_EQ(45, hrbf._node_centers.cols());
+
+    points.insert(points.end(), extraPoints.begin(), extraPoints.end());
+    normals.insert(normals.end(), extraNormals.begin(), extraNormals.end());
+    HrbfPow3d refit;
+    refit.hermite_fit(points, normals);
+    ExpectSameFit(refit, hrbf, 1e-7);
+}
+
+//--------------------------------------------------------------------------
+
+TEST(IncrementalFit, NeedsFactorisation)
+{
+    std::vector<HrbfPow3d::Vector> points, normals;
+    EllipsoidSamples(30, HrbfPow3d::Vector(1.0, 1.0, 1.0), points, normals);
+
+    HrbfPow3d hrbf;
+    hrbf.hermite_fit(points, normals);
+    EXPECT_FALSE(hrbf.has_factorisation());
+    EXPECT_FALSE(hrbf.remove_nodes({0}));
+    EXPECT_EQ(30, hrbf._node_centers.cols());
+}
+
+//--------------------------------------------------------------------------
+
+
+#endif //_HERMITEFITTEST__H_
@@ -0,0 +1,58 @@
+#ifndef _SHARED__H_
+#define _SHARED__H_
+
+//--------------------------------------------------------------------------
+
+#include <gtest/gtest.h>
+#include <vector>
+#include <cmath>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+#include "ScalarField/Hrbf/hrbf_core.h"
+#include "ScalarField/Hrbf/hrbf_phi_funcs.h"
+
+
+//--------------------------------------------------------------------------
+// Gaussian kernel, positive definite so its symmetric system suits LDLT
+//--------------------------------------------------------------------------
+template<typename Scalar>
+struct Rbf_gauss
+{
+    static inline Scalar f  (const Scalar& x) { return std::exp(-x*x);                            }
+    static inline Scalar df (const Scalar& x) { return Scalar(-2) * x * std::exp(-x*x);           }
+    static inline Scalar ddf(const Scalar& x) { return (Scalar(4)*x*x - Scalar(2)) * std::exp(-x*x); }
+};
+
+typedef HRBF_fit<float, 3, Rbf_pow3<float> > HrbfPow3;
+typedef HRBF_fit<double, 3, Rbf_pow3<double> > HrbfPow3d;
+typedef HRBF_fit<double, 3, Rbf_gauss<double> > HrbfGauss;
+typedef HRBF_fit<double, 3, Rbf_wendland_c4<double> > HrbfWendland;
+
+
+//--------------------------------------------------------------------------
+// Points and normals on an ellipsoid, spread with a golden spiral
+//--------------------------------------------------------------------------
+template<typename Vector>
+void EllipsoidSamples(const int _numPoints, const Vector &_radii, std::vector<Vector> &_points, std::vector<Vector> &_normals)
+{
+    _points.resize(_numPoints);
+    _normals.resize(_numPoints);
+
+    const double goldenAngle = M_PI * (3.0 - std::sqrt(5.0));
+    for(int i=0; i<_numPoints; i++)
+    {
+        double z = 1.0 - (2.0 * (i + 0.5) / _numPoints);
+        double r = std::sqrt(1.0 - z*z);
+        double theta = goldenAngle * i;
+        Vector unit(r * std::cos(theta), r * std::sin(theta), z);
+
+        _points[i] = unit.cwiseProduct(_radii);
+        _normals[i] = unit.cwiseQuotient(_radii).normalized();
+    }
+}
+
+//--------------------------------------------------------------------------
+
+
+#endif //_SHARED__H_
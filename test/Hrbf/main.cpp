@@ -0,0 +1,12 @@
+#include <gtest/gtest.h>
+
+#include "HermiteFitTest.h"
+#include "BatchEvalTest.h"
+#include "CompactFitTest.h"
+
+
+int main(int argc, char **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
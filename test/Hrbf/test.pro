@@ -0,0 +1,33 @@
+
+QT       -= core gui
+
+
+TARGET = TestHrbf
+
+DESTDIR = ../bin
+
+TEMPLATE = app
+
+CONFIG += console c++11
+
+QMAKE_CXXFLAGS += -std=c++11 -g
+
+SOURCES +=  main.cpp                                        \
+            ../../src/ScalarField/hrbf_batch.cpp            \
+            ../../src/ScalarField/hrbf_batch_avx2.cpp       \
+            ../../src/ScalarField/hrbf_batch_avx512.cpp
+
+HEADERS +=  *.h                                     \
+            ../../include/ScalarField/Hrbf/hrbf_core.h  \
+            ../../include/ScalarField/Hrbf/hrbf_batch.h \
+            ../../include/ScalarField/Hrbf/hrbf_batch_lanes.h \
+            ../../include/ScalarField/Hrbf/hrbf_grid.h  \
+            ../../include/ScalarField/Hrbf/hrbf_phi_funcs.h
+
+INCLUDEPATH +=  ../../include                       \
+                /usr/local/include                  \
+                /usr/include                        \
+                /usr/local/include/eigen3/          \
+                /usr/include/eigen3/
+
+LIBS += -L/usr/local/lib -L/usr/lib -lgtest
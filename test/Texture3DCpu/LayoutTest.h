@@ -0,0 +1,134 @@
+#ifndef _LAYOUTTEST__H_
+#define _LAYOUTTEST__H_
+
+//--------------------------------------------------------------------------
+
+#include "Shared.h"
+
+//--------------------------------------------------------------------------
+
+TEST(Texture3DCpu, BrickedMatchesLinear)
+{
+    // Several bricks along each axis, the last one only partly inside the texture
+    std::vector<float> data;
+    MakeLayoutData(layout_data_res, data);
+
+    Texture3DCpu<float> linear;
+    linear.SetData(layout_data_res, &data[0]);
+
+    Texture3DCpu<float> bricked(32, Texture3DCpu<float>::Layout::Bricked);
+    bricked.SetData(layout_data_res, &data[0]);
+
+    std::vector<glm::vec3> points;
+    MakeLayoutPoints(points);
+    for(auto &&p : points)
+    {
+        EXPECT_EQ(linear.Eval(p), bricked.Eval(p));
+    }
+}
+
+//--------------------------------------------------------------------------
+
+TEST(Texture3DCpu, SetLayoutKeepsValues)
+{
+    std::vector<float> data;
+    MakeLayoutData(layout_data_res, data);
+
+    Texture3DCpu<float> texture;
+    texture.SetData(layout_data_res, &data[0]);
+
+    std::vector<glm::vec3> points;
+    MakeLayoutPoints(points);
+    std::vector<float> expected;
+    for(auto &&p : points)
+    {
+        expected.push_back(texture.Eval(p));
+    }
+
+    texture.SetLayout(Texture3DCpu<float>::Layout::Bricked);
+    EXPECT_EQ(texture.GetLayout(), Texture3DCpu<float>::Layout::Bricked);
+    for(unsigned int i=0; i<points.size(); ++i)
+    {
+        EXPECT_EQ(texture.Eval(points[i]), expected[i]);
+    }
+
+    texture.SetLayout(Texture3DCpu<float>::Layout::Linear);
+    EXPECT_EQ(texture.GetLayout(), Texture3DCpu<float>::Layout::Linear);
+    for(unsigned int i=0; i<points.size(); ++i)
+    {
+        EXPECT_EQ(texture.Eval(points[i]), expected[i]);
+    }
+}
+
+//--------------------------------------------------------------------------
+
+TEST(Texture3DCpu, EvalBatchMatchesEval)
+{
+    std::vector<float> data;
+    MakeLayoutData(layout_data_res, data);
+
+    std::vector<glm::vec3> points;
+    MakeLayoutPoints(points);
+    std::vector<float> x, y, z;
+    for(auto &&p : points)
+    {
+        x.push_back(p.x);
+        y.push_back(p.y);
+        z.push_back(p.z);
+    }
+
+    // Every instruction set this CPU supports, not just the one picked
+    const TextureKernels::Isa picked = TextureKernels::Instance().isa;
+    for(auto isa : {TextureKernels::Isa::Scalar, TextureKernels::Isa::Avx2, TextureKernels::Isa::Avx512})
+    {
+        if(!TextureKernels::Select(isa))
+        {
+            continue;
+        }
+        SCOPED_TRACE(TextureKernels::GetName(isa));
+
+        for(auto layout : {Texture3DCpu<float>::Layout::Linear, Texture3DCpu<float>::Layout::Bricked})
+        {
+            Texture3DCpu<float> texture(32, layout);
+            texture.SetData(layout_data_res, &data[0]);
+
+            std::vector<float> batch(points.size());
+            std::vector<float> batchComponents(points.size());
+            texture.EvalBatch(&points[0], points.size(), &batch[0]);
+            texture.EvalBatch(&x[0], &y[0], &z[0], points.size(), &batchComponents[0]);
+
+            // Values are exact at voxels, in between allow for multiplies and adds being fused differently
+            for(unsigned int i=0; i<points.size(); ++i)
+            {
+                float expected = texture.Eval(points[i]);
+                EXPECT_NEAR(batch[i], expected, 1e-5f);
+                EXPECT_NEAR(batchComponents[i], expected, 1e-5f);
+            }
+        }
+    }
+    TextureKernels::Select(picked);
+}
+
+//--------------------------------------------------------------------------
+
+TEST(Texture3DCpu, KernelsPickedFromCpu)
+{
+    // Nothing better than what is picked is supported
+    const TextureKernels::Isa picked = TextureKernels::Instance().isa;
+    EXPECT_TRUE(TextureKernels::IsSupported(picked));
+    EXPECT_TRUE(TextureKernels::IsSupported(TextureKernels::Isa::Scalar));
+    if(picked != TextureKernels::Isa::Avx512)
+    {
+        EXPECT_FALSE(TextureKernels::IsSupported(TextureKernels::Isa::Avx512));
+    }
+    if(picked == TextureKernels::Isa::Scalar)
+    {
+        EXPECT_FALSE(TextureKernels::IsSupported(TextureKernels::Isa::Avx2));
+    }
+
+    EXPECT_EQ(TextureKernels::Instance().dense == nullptr, picked == TextureKernels::Isa::Scalar);
+}
+
+//--------------------------------------------------------------------------
+
+#endif // _LAYOUTTEST__H_
@@ -0,0 +1,117 @@
+#ifndef _LAZYTEST__H_
+#define _LAZYTEST__H_
+
+//--------------------------------------------------------------------------
+
+#include "Shared.h"
+
+//--------------------------------------------------------------------------
+
+/// @brief Method to copy a brick out of _res^3 voxels, those past the edge of the volume repeat the last one
+void GetBrickVoxels(const std::vector<float> &_data, const unsigned int _res, const glm::uvec3 &_brick, std::vector<float> &_voxels)
+{
+    const unsigned int brickSize = SparseTexture3DCpu<float>::BrickSize;
+    _voxels.resize(SparseTexture3DCpu<float>::BrickVoxels);
+    for(unsigned int z=0; z<brickSize; ++z)
+    {
+        for(unsigned int y=0; y<brickSize; ++y)
+        {
+            for(unsigned int x=0; x<brickSize; ++x)
+            {
+                unsigned int vx = std::min(_brick.x * brickSize + x, _res - 1);
+                unsigned int vy = std::min(_brick.y * brickSize + y, _res - 1);
+                unsigned int vz = std::min(_brick.z * brickSize + z, _res - 1);
+                _voxels[(z * brickSize * brickSize) + (y * brickSize) + x] = _data[(vz * _res * _res) + (vy * _res) + vx];
+            }
+        }
+    }
+}
+
+//--------------------------------------------------------------------------
+
+TEST(SparseTexture3DCpu, LazyBricksMatchSetData)
+{
+    std::vector<float> data;
+    MakeSparseData(sparse_data_res, data);
+
+    SparseTexture3DCpu<float, unsigned short> full;
+    full.SetData(sparse_data_res, &data[0]);
+
+    // Leave every other brick to fill later, some of them constant, with a placeholder in their voxels
+    const glm::uvec3 brickDim = full.GetBrickDim();
+    std::vector<unsigned char> lazyBricks(brickDim.x * brickDim.y * brickDim.z);
+    std::vector<float> placeholders = data;
+    for(unsigned int b=0; b<lazyBricks.size(); ++b)
+    {
+        lazyBricks[b] = (b % 2) == 0 ? 1 : 0;
+    }
+    for(unsigned int i=0; i<placeholders.size(); ++i)
+    {
+        unsigned int x = i % sparse_data_res, y = (i / sparse_data_res) % sparse_data_res, z = i / (sparse_data_res * sparse_data_res);
+        unsigned int b = ((z / 8) * brickDim.y * brickDim.x) + ((y / 8) * brickDim.x) + (x / 8);
+        placeholders[i] = lazyBricks[b] ? 0.5f : placeholders[i];
+    }
+
+    // The scale is that of the full data, the placeholders alone do not reach it
+    SparseTexture3DCpu<float, unsigned short> lazy;
+    lazy.SetLazyData(glm::uvec3(sparse_data_res), &placeholders[0], lazyBricks, 1.0f);
+
+    // Flagged bricks are stored in full however their voxels look, so filling them never moves the index
+    std::vector<unsigned char> constantBricks;
+    lazy.GetConstantBricks(constantBricks);
+    for(unsigned int b=0; b<lazyBricks.size(); ++b)
+    {
+        if(lazyBricks[b])
+        {
+            EXPECT_EQ(constantBricks[b], 0);
+        }
+    }
+
+    std::vector<float> voxels;
+    for(unsigned int b=0; b<lazyBricks.size(); ++b)
+    {
+        if(lazyBricks[b])
+        {
+            glm::uvec3 brick(b % brickDim.x, (b / brickDim.x) % brickDim.y, b / (brickDim.x * brickDim.y));
+            GetBrickVoxels(data, sparse_data_res, brick, voxels);
+            lazy.SetBrick(brick, &voxels[0]);
+        }
+    }
+
+    std::vector<glm::vec3> points;
+    MakeSparsePoints(sparse_data_res, points);
+    std::vector<float> batch(points.size());
+    lazy.EvalBatch(&points[0], points.size(), &batch[0]);
+    for(unsigned int i=0; i<points.size(); ++i)
+    {
+        float expected = full.Eval(points[i]);
+        EXPECT_NEAR(lazy.Eval(points[i]), expected, 1e-6f);
+        EXPECT_NEAR(batch[i], expected, 1e-5f);
+    }
+
+    std::vector<float> lazyData, fullData;
+    lazy.GetData(lazyData);
+    full.GetData(fullData);
+    EXPECT_EQ(lazyData, fullData);
+}
+
+//--------------------------------------------------------------------------
+
+TEST(SparseTexture3DCpu, SetBrickLeavesUnflaggedBricks)
+{
+    std::vector<float> data;
+    MakeSparseData(sparse_data_res, data);
+
+    SparseTexture3DCpu<float> texture;
+    std::vector<unsigned char> lazyBricks(64, 0);
+    texture.SetLazyData(glm::uvec3(sparse_data_res), &data[0], lazyBricks, 0.0f);
+
+    // A constant brick has no voxels of its own to fill
+    std::vector<float> voxels(SparseTexture3DCpu<float>::BrickVoxels, 0.25f);
+    texture.SetBrick(glm::uvec3(0, 0, 0), &voxels[0]);
+    EXPECT_EQ(texture.Eval(glm::vec3(3.5f) / (float)sparse_data_res), 0.0f);
+}
+
+//--------------------------------------------------------------------------
+
+#endif // _LAZYTEST__H_
@@ -0,0 +1,99 @@
+#ifndef _SERIALISETEST__H_
+#define _SERIALISETEST__H_
+
+//--------------------------------------------------------------------------
+
+#include "Shared.h"
+
+//--------------------------------------------------------------------------
+
+TEST(SparseTexture3DCpu, SerialiseRoundTrip)
+{
+    std::vector<float> data;
+    MakeSparseData(sparse_data_res, data);
+
+    SparseTexture3DCpu<float, unsigned short> texture;
+    std::vector<unsigned char> flatBricks;
+    MakeSparseRampBricks(texture.GetBrickDim(), flatBricks);
+    texture.SetData(glm::uvec3(sparse_data_res), &data[0], flatBricks);
+
+    std::vector<char> blob;
+    texture.Serialise(blob);
+
+    // A texture of another size is replaced, the whole buffer is read
+    SparseTexture3DCpu<float, unsigned short> restored(8);
+    const char *in = blob.data();
+    ASSERT_TRUE(restored.Deserialise(in, blob.data() + blob.size()));
+    EXPECT_EQ(in, blob.data() + blob.size());
+    EXPECT_EQ(restored.GetDim(), texture.GetDim());
+    EXPECT_EQ(restored.GetMemorySize(), texture.GetMemorySize());
+
+    std::vector<glm::vec3> points;
+    MakeSparsePoints(sparse_data_res, points);
+    for(auto &&p : points)
+    {
+        EXPECT_EQ(restored.Eval(p), texture.Eval(p));
+    }
+
+    std::vector<float> batch(points.size());
+    restored.EvalBatch(&points[0], points.size(), &batch[0]);
+    for(unsigned int i=0; i<points.size(); ++i)
+    {
+        EXPECT_NEAR(batch[i], texture.Eval(points[i]), 1e-5f);
+    }
+}
+
+//--------------------------------------------------------------------------
+
+TEST(SparseTexture3DCpu, DeserialiseRejectsTruncated)
+{
+    std::vector<float> data;
+    MakeSparseData(sparse_data_res, data);
+
+    SparseTexture3DCpu<float, unsigned short> texture;
+    texture.SetData(sparse_data_res, &data[0]);
+    std::vector<char> blob;
+    texture.Serialise(blob);
+
+    std::vector<float> linear;
+    MakeLinearData(layout_data_res, linear);
+    SparseTexture3DCpu<float, unsigned short> restored;
+    restored.SetData(layout_data_res, &linear[0]);
+    const float before = restored.Eval(glm::vec3(0.5f));
+
+    // Short by anything from a byte to all of it, the texture is left as it was
+    for(std::size_t size : {blob.size() - 1, blob.size() / 2, (std::size_t)12, (std::size_t)0})
+    {
+        const char *in = blob.data();
+        EXPECT_FALSE(restored.Deserialise(in, blob.data() + size));
+        EXPECT_EQ(restored.GetDim(), glm::uvec3(layout_data_res));
+        EXPECT_EQ(restored.Eval(glm::vec3(0.5f)), before);
+    }
+}
+
+//--------------------------------------------------------------------------
+
+TEST(SparseTexture3DCpu, DeserialiseRejectsBadIndex)
+{
+    std::vector<float> data;
+    MakeSparseData(sparse_data_res, data);
+
+    SparseTexture3DCpu<float> texture;
+    texture.SetData(sparse_data_res, &data[0]);
+    std::vector<char> blob;
+    texture.Serialise(blob);
+
+    // Point the last brick past the stored bricks, it follows the dim, scale and length of the index
+    std::size_t lastEntry = (3 * sizeof(unsigned int)) + sizeof(float) + sizeof(unsigned long long) + (63 * sizeof(unsigned int));
+    unsigned int entry = 1000;
+    std::memcpy(&blob[lastEntry], &entry, sizeof(entry));
+
+    SparseTexture3DCpu<float> restored;
+    const char *in = blob.data();
+    EXPECT_FALSE(restored.Deserialise(in, blob.data() + blob.size()));
+    EXPECT_EQ(restored.GetDim(), glm::uvec3(32));
+}
+
+//--------------------------------------------------------------------------
+
+#endif // _SERIALISETEST__H_
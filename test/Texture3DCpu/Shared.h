@@ -5,6 +5,7 @@
 
 #include <gtest/gtest.h>
 #include "Texture/Texture3DCpu.h"
+#include "Texture/SparseTexture3DCpu.h"
 
 
 //--------------------------------------------------------------------------
@@ -63,6 +64,94 @@ std::vector<float> float_data_2{1.0f, 1.0f, 1.0f, 1.0f,
 
 int float_data_res = 4;
 
+/// @brief Not a multiple of the brick size, so the last bricks are only partly inside the texture
+unsigned int layout_data_res = 19;
+
+/// @brief Method to fill a texture with a different value in each voxel
+void MakeLayoutData(const unsigned int _res, std::vector<float> &_data)
+{
+    _data.resize(_res * _res * _res);
+    for(unsigned int i=0; i<_data.size(); ++i)
+    {
+        _data[i] = (float)((i * 7919) % 1000) / 1000.0f;
+    }
+}
+
+/// @brief Method to make sample points across the texture, on voxels, between them and outside the texture,
+/// an odd number so batches end part way through a lane
+void MakeLayoutPoints(std::vector<glm::vec3> &_points)
+{
+    _points.clear();
+    for(int z=-2; z<24; z+=3)
+    {
+        for(int y=-2; y<24; y+=2)
+        {
+            for(int x=-2; x<24; ++x)
+            {
+                _points.push_back(glm::vec3(x / 19.0f, (y + 0.5f) / 19.0f, (z + 0.25f) / 19.0f));
+            }
+        }
+    }
+    _points.push_back(glm::vec3(0.5f, 0.5f, 0.5f));
+}
+
+/// @brief Not a multiple of the brick size, 4 bricks along each axis, the last only partly inside the texture
+unsigned int sparse_data_res = 27;
+
+/// @brief Method to fill a texture with every kind of brick along x, a brick of 0s, a ramp from 0 to 1 that is linear
+/// so its corners give back every voxel, a brick of 1s and one with a different value in each voxel
+void MakeSparseData(const unsigned int _res, std::vector<float> &_data)
+{
+    _data.resize(_res * _res * _res);
+    for(unsigned int i=0; i<_data.size(); ++i)
+    {
+        unsigned int x = i % _res;
+        _data[i] = x < 8 ? 0.0f :
+                   x < 16 ? (x - 8) / 8.0f :
+                   x < 24 ? 1.0f :
+                   (float)((i * 7919) % 1000) / 1000.0f;
+    }
+}
+
+/// @brief Method to flag the bricks of MakeSparseData that hold the ramp, the ones that can be coarse
+void MakeSparseRampBricks(const glm::uvec3 &_brickDim, std::vector<unsigned char> &_flatBricks)
+{
+    _flatBricks.resize(_brickDim.x * _brickDim.y * _brickDim.z);
+    for(unsigned int b=0; b<_flatBricks.size(); ++b)
+    {
+        _flatBricks[b] = (b % _brickDim.x) == 1 ? 1 : 0;
+    }
+}
+
+/// @brief Method to fill a texture with a linear function, which trilinear and Catmull-Rom interpolation both give back exactly
+void MakeLinearData(const unsigned int _res, std::vector<float> &_data)
+{
+    _data.resize(_res * _res * _res);
+    for(unsigned int i=0; i<_data.size(); ++i)
+    {
+        _data[i] = (0.01f * (i % _res)) + (0.02f * ((i / _res) % _res)) + (0.03f * (i / (_res * _res)));
+    }
+}
+
+/// @brief Method to make sample points across a texture of _res voxels along each axis, on voxels, between them,
+/// either side of brick edges and outside the texture, an odd number so batches end part way through a lane
+void MakeSparsePoints(const unsigned int _res, std::vector<glm::vec3> &_points)
+{
+    _points.clear();
+    for(int z=-2; z<(int)_res+3; z+=3)
+    {
+        for(int y=-2; y<(int)_res+3; y+=2)
+        {
+            for(int x=-2; x<(int)_res+3; ++x)
+            {
+                _points.push_back(glm::vec3(x, y + 0.5f, z + 0.25f) / (float)_res);
+                _points.push_back(glm::vec3(x + 0.75f, y, z + 0.5f) / (float)_res);
+            }
+        }
+    }
+    _points.push_back(glm::vec3(0.5f, 0.5f, 0.5f));
+}
+
 //--------------------------------------------------------------------------
 
 
@@ -0,0 +1,233 @@
+#ifndef _SPARSETEST__H_
+#define _SPARSETEST__H_
+
+//--------------------------------------------------------------------------
+
+#include "Shared.h"
+
+//--------------------------------------------------------------------------
+
+/// @brief Method to check a point in voxel coords is within [_min:_max] along every axis
+bool InsideVoxels(const glm::vec3 &_voxel, const float _min, const float _max)
+{
+    return _voxel.x >= _min && _voxel.y >= _min && _voxel.z >= _min &&
+           _voxel.x <= _max && _voxel.y <= _max && _voxel.z <= _max;
+}
+
+//--------------------------------------------------------------------------
+
+TEST(SparseTexture3DCpu, MatchesDense)
+{
+    std::vector<float> data;
+    MakeSparseData(sparse_data_res, data);
+
+    Texture3DCpu<float> dense;
+    dense.SetData(sparse_data_res, &data[0]);
+
+    SparseTexture3DCpu<float> sparse;
+    sparse.SetData(sparse_data_res, &data[0]);
+
+    std::vector<glm::vec3> points;
+    MakeSparsePoints(sparse_data_res, points);
+    for(auto &&p : points)
+    {
+        EXPECT_NEAR(sparse.Eval(p), dense.Eval(p), 1e-6f);
+    }
+
+    std::vector<float> decoded;
+    sparse.GetData(decoded);
+    EXPECT_EQ(decoded, data);
+}
+
+//--------------------------------------------------------------------------
+
+TEST(SparseTexture3DCpu, ConstantBricksShared)
+{
+    std::vector<float> data;
+    MakeSparseData(sparse_data_res, data);
+
+    SparseTexture3DCpu<float> sparse;
+    sparse.SetData(sparse_data_res, &data[0]);
+
+    // The bricks of 0s and 1s are constant, the ramp and the last bricks are not
+    glm::uvec3 brickDim = sparse.GetBrickDim();
+    EXPECT_EQ(brickDim, glm::uvec3(4, 4, 4));
+
+    std::vector<unsigned char> constantBricks;
+    sparse.GetConstantBricks(constantBricks);
+    ASSERT_EQ(constantBricks.size(), 64u);
+    for(unsigned int b=0; b<constantBricks.size(); ++b)
+    {
+        unsigned int bx = b % brickDim.x;
+        EXPECT_EQ(constantBricks[b], (bx == 0 || bx == 2) ? 1 : 0);
+    }
+
+    // Only the 32 other bricks are stored, plus a brick of each of the 2 constants and the index
+    EXPECT_LT(sparse.GetMemorySize(), 35 * SparseTexture3DCpu<float>::BrickVoxels * sizeof(float));
+}
+
+//--------------------------------------------------------------------------
+
+TEST(SparseTexture3DCpu, CoarseBricksInterpolateCorners)
+{
+    std::vector<float> data;
+    MakeSparseData(sparse_data_res, data);
+
+    SparseTexture3DCpu<float> stored;
+    stored.SetData(sparse_data_res, &data[0]);
+
+    std::vector<unsigned char> flatBricks;
+    MakeSparseRampBricks(stored.GetBrickDim(), flatBricks);
+    SparseTexture3DCpu<float> coarse;
+    coarse.SetData(glm::uvec3(sparse_data_res), &data[0], flatBricks);
+
+    // The ramp is linear so its corners give every voxel back
+    EXPECT_LT(coarse.GetMemorySize(), stored.GetMemorySize());
+
+    std::vector<glm::vec3> points;
+    MakeSparsePoints(sparse_data_res, points);
+    for(auto &&p : points)
+    {
+        EXPECT_NEAR(coarse.Eval(p), stored.Eval(p), 1e-6f);
+    }
+
+    std::vector<float> decoded;
+    coarse.GetData(decoded);
+    ASSERT_EQ(decoded.size(), data.size());
+    for(unsigned int i=0; i<data.size(); ++i)
+    {
+        EXPECT_NEAR(decoded[i], data[i], 1e-6f);
+    }
+}
+
+//--------------------------------------------------------------------------
+
+TEST(SparseTexture3DCpu, EvalBatchMatchesEval)
+{
+    std::vector<float> data;
+    MakeSparseData(sparse_data_res, data);
+
+    // Constant, coarse and stored bricks
+    SparseTexture3DCpu<float, unsigned short> texture;
+    std::vector<unsigned char> flatBricks;
+    MakeSparseRampBricks(texture.GetBrickDim(), flatBricks);
+    texture.SetData(glm::uvec3(sparse_data_res), &data[0], flatBricks);
+
+    std::vector<glm::vec3> points;
+    MakeSparsePoints(sparse_data_res, points);
+    std::vector<float> expected;
+    for(auto &&p : points)
+    {
+        expected.push_back(texture.Eval(p));
+    }
+
+    // Every instruction set this CPU supports, not just the one picked
+    const TextureKernels::Isa picked = TextureKernels::Instance().isa;
+    for(auto isa : {TextureKernels::Isa::Scalar, TextureKernels::Isa::Avx2, TextureKernels::Isa::Avx512})
+    {
+        if(!TextureKernels::Select(isa))
+        {
+            continue;
+        }
+        SCOPED_TRACE(TextureKernels::GetName(isa));
+
+        std::vector<float> batch(points.size());
+        texture.EvalBatch(&points[0], points.size(), &batch[0]);
+        for(unsigned int i=0; i<points.size(); ++i)
+        {
+            EXPECT_NEAR(batch[i], expected[i], 1e-5f);
+        }
+    }
+    TextureKernels::Select(picked);
+}
+
+//--------------------------------------------------------------------------
+
+TEST(SparseTexture3DCpu, EvalGradMatchesEval)
+{
+    std::vector<float> data;
+    MakeSparseData(sparse_data_res, data);
+
+    SparseTexture3DCpu<float> texture;
+    texture.SetData(sparse_data_res, &data[0]);
+
+    // Same value as Eval, and the gradient of the interpolation, away from voxel faces where it jumps.
+    // Within a voxel the interpolation is linear along each axis, so a central difference gives its gradient back
+    const float h = 0.05f / sparse_data_res;
+    std::vector<glm::vec3> points;
+    MakeSparsePoints(sparse_data_res, points);
+    for(auto &&p : points)
+    {
+        glm::vec3 grad;
+        EXPECT_EQ(texture.EvalGrad(p, grad), texture.Eval(p));
+
+        glm::vec3 voxel = p * (float)sparse_data_res;
+        if(!InsideVoxels(voxel, 0.0f, sparse_data_res - 1.0f) || voxel.x == std::floor(voxel.x))
+        {
+            continue;
+        }
+
+        float fx = (texture.Eval(p + glm::vec3(h, 0.0f, 0.0f)) - texture.Eval(p - glm::vec3(h, 0.0f, 0.0f))) / (2.0f * h);
+        EXPECT_NEAR(grad.x, fx, 1e-2f);
+    }
+
+    // Across a constant brick there is nothing to differentiate
+    glm::vec3 grad;
+    texture.EvalGrad(glm::vec3(3.5f, 10.5f, 10.5f) / (float)sparse_data_res, grad);
+    EXPECT_EQ(grad, glm::vec3(0.0f));
+}
+
+//--------------------------------------------------------------------------
+
+TEST(SparseTexture3DCpu, EvalCubic)
+{
+    std::vector<float> data;
+    MakeLinearData(layout_data_res, data);
+
+    SparseTexture3DCpu<float> texture;
+    texture.SetData(layout_data_res, &data[0]);
+
+    // Passes through the voxels
+    for(unsigned int v=2; v<layout_data_res-2; v+=3)
+    {
+        glm::vec3 p = glm::vec3(v, v + 1, v - 1) / (float)layout_data_res;
+        glm::vec3 grad;
+        EXPECT_NEAR(texture.EvalCubic(p, grad), texture.Eval(p), 1e-5f);
+    }
+
+    // Gives a linear function back, with its gradient in the space the texture is sampled in, here texture space
+    const glm::vec3 slope = glm::vec3(0.01f, 0.02f, 0.03f) * (float)layout_data_res;
+    std::vector<glm::vec3> points;
+    MakeLayoutPoints(points);
+    for(auto &&p : points)
+    {
+        if(!InsideVoxels(p * (float)layout_data_res, 1.0f, layout_data_res - 2.0f))
+        {
+            continue;
+        }
+
+        glm::vec3 grad, trilinearGrad;
+        EXPECT_NEAR(texture.EvalCubic(p, grad), texture.Eval(p), 1e-5f);
+        texture.EvalGrad(p, trilinearGrad);
+        for(int a=0; a<3; ++a)
+        {
+            EXPECT_NEAR(grad[a], slope[a], 1e-3f);
+            EXPECT_NEAR(trilinearGrad[a], slope[a], 1e-3f);
+        }
+    }
+
+    // Through the texture space transform, a texture spanning [-1:1] changes half as fast
+    glm::mat4 textureSpaceTransform(0.5f);
+    textureSpaceTransform[3] = glm::vec4(0.5f, 0.5f, 0.5f, 1.0f);
+    texture.SetTextureSpaceTransform(textureSpaceTransform);
+    glm::vec3 grad;
+    texture.EvalCubic(glm::vec3(0.05f, -0.1f, 0.1f), grad);
+    for(int a=0; a<3; ++a)
+    {
+        EXPECT_NEAR(grad[a], 0.5f * slope[a], 1e-3f);
+    }
+}
+
+//--------------------------------------------------------------------------
+
+#endif // _SPARSETEST__H_
@@ -0,0 +1,131 @@
+#ifndef _STORAGETEST__H_
+#define _STORAGETEST__H_
+
+//--------------------------------------------------------------------------
+
+#include "Shared.h"
+
+//--------------------------------------------------------------------------
+
+TEST(TextureStorage, HalfRoundTrip)
+{
+    // Exactly representable, including the largest half, the smallest normal and the smallest subnormal
+    for(float f : {0.0f, 1.0f, -2.0f, 0.5f, 0.099975586f, 1024.0f, 65504.0f, 6.1035156e-5f, 5.9604645e-8f})
+    {
+        EXPECT_EQ(HalfToFloat(FloatToHalf(f)), f);
+        EXPECT_EQ(HalfToFloat(FloatToHalf(-f)), -f);
+    }
+
+    EXPECT_EQ(FloatToHalf(1.0f).bits, 0x3c00);
+    EXPECT_EQ(FloatToHalf(-2.0f).bits, 0xc000);
+    EXPECT_EQ(FloatToHalf(65504.0f).bits, 0x7bff);
+    EXPECT_EQ(FloatToHalf(5.9604645e-8f).bits, 0x0001);
+}
+
+//--------------------------------------------------------------------------
+
+TEST(TextureStorage, HalfRounding)
+{
+    // Halfway between two halves rounds to the even mantissa
+    EXPECT_EQ(FloatToHalf(1.0f + (1.0f / 2048.0f)).bits, 0x3c00);
+    EXPECT_EQ(FloatToHalf(1.0f + (3.0f / 2048.0f)).bits, 0x3c02);
+
+    // Otherwise to nearest, relative error at most half a step of 10 mantissa bits
+    for(float f=-3.0f; f<3.0f; f+=0.0123f)
+    {
+        EXPECT_NEAR(HalfToFloat(FloatToHalf(f)), f, std::fabs(f) / 2048.0f + 1e-7f);
+    }
+
+    // Too big for a half
+    EXPECT_EQ(FloatToHalf(1e6f).bits, 0x7c00);
+    EXPECT_EQ(FloatToHalf(-1e6f).bits, 0xfc00);
+    EXPECT_TRUE(std::isinf(HalfToFloat(FloatToHalf(1e6f))));
+}
+
+//--------------------------------------------------------------------------
+
+TEST(TextureStorage, NormalisedCodecs)
+{
+    // In steps of the type, clamped to its range
+    EXPECT_EQ(ScalarCodec<unsigned char>::Encode(0.5f), 128);
+    EXPECT_EQ(ScalarCodec<unsigned char>::Encode(2.0f), 255);
+    EXPECT_EQ(ScalarCodec<unsigned char>::Encode(-1.0f), 0);
+    EXPECT_EQ(ScalarCodec<unsigned char>::Decode(255), 1.0f);
+
+    EXPECT_EQ(ScalarCodec<unsigned short>::Encode(1.0f), 65535);
+    EXPECT_EQ(ScalarCodec<unsigned short>::Encode(-0.5f), 0);
+    EXPECT_EQ(ScalarCodec<unsigned short>::Decode(0), 0.0f);
+
+    EXPECT_EQ(ScalarCodec<short>::Encode(-1.0f), -32767);
+    EXPECT_EQ(ScalarCodec<short>::Encode(-2.0f), -32767);
+    EXPECT_EQ(ScalarCodec<short>::Decode(-32768), -1.0f);
+
+    for(float f=0.0f; f<=1.0f; f+=0.01f)
+    {
+        EXPECT_NEAR(ScalarCodec<unsigned char>::Decode(ScalarCodec<unsigned char>::Encode(f)), f, 0.5f / 255.0f);
+        EXPECT_NEAR(ScalarCodec<unsigned short>::Decode(ScalarCodec<unsigned short>::Encode(f)), f, 0.5f / 65535.0f);
+        EXPECT_NEAR(ScalarCodec<short>::Decode(ScalarCodec<short>::Encode(-f)), -f, 0.5f / 32767.0f);
+    }
+}
+
+//--------------------------------------------------------------------------
+
+TEST(TextureStorage, ScaledByLargestMagnitude)
+{
+    typedef TextureStorage<float, short> Codec;
+    EXPECT_TRUE(Codec::Scaled());
+    EXPECT_EQ(Codec::Magnitude(-4.0f), 4.0f);
+    EXPECT_EQ(Codec::Decode(Codec::Encode(-4.0f, 4.0f), 4.0f), -4.0f);
+    EXPECT_NEAR(Codec::Decode(Codec::Encode(1.5f, 4.0f), 4.0f), 1.5f, 2.0f / 32767.0f);
+
+    typedef TextureStorage<glm::vec3, Vec3Storage<Half> > VecCodec;
+    EXPECT_FALSE(VecCodec::Scaled());
+    EXPECT_EQ(VecCodec::Magnitude(glm::vec3(1.0f, -3.0f, 2.0f)), 3.0f);
+    EXPECT_EQ(VecCodec::Decode(VecCodec::Encode(glm::vec3(1.0f, -3.0f, 0.25f), 1.0f), 1.0f), glm::vec3(1.0f, -3.0f, 0.25f));
+
+    // Unless specialised values are stored as they are
+    EXPECT_FALSE((TextureStorage<int, int>::Scaled()));
+    EXPECT_EQ((TextureStorage<int, int>::Encode(7, 2.0f)), 7);
+}
+
+//--------------------------------------------------------------------------
+
+TEST(TextureStorage, QuantisedTextureMatchesFloat)
+{
+    std::vector<float> data;
+    MakeLayoutData(layout_data_res, data);
+    std::vector<float> signedData(data.size());
+    for(unsigned int i=0; i<data.size(); ++i)
+    {
+        data[i] *= 3.0f;
+        signedData[i] = 1.5f - data[i];
+    }
+
+    SparseTexture3DCpu<float> full;
+    full.SetData(layout_data_res, &data[0]);
+    SparseTexture3DCpu<float, unsigned short> quantised;
+    quantised.SetData(layout_data_res, &data[0]);
+    SparseTexture3DCpu<float, Half> half;
+    half.SetData(layout_data_res, &data[0]);
+
+    SparseTexture3DCpu<float> signedFull;
+    signedFull.SetData(layout_data_res, &signedData[0]);
+    SparseTexture3DCpu<float, short> signedQuantised;
+    signedQuantised.SetData(layout_data_res, &signedData[0]);
+
+    // Normalised storage spans the largest magnitude, 3 or 1.5, in steps of the type, interpolation adds nothing to the error
+    EXPECT_LT(quantised.GetMemorySize(), full.GetMemorySize());
+    std::vector<glm::vec3> points;
+    MakeLayoutPoints(points);
+    for(auto &&p : points)
+    {
+        float expected = full.Eval(p);
+        EXPECT_NEAR(quantised.Eval(p), expected, 0.5f * 3.0f / 65535.0f + 1e-6f);
+        EXPECT_NEAR(half.Eval(p), expected, 3.0f / 2048.0f);
+        EXPECT_NEAR(signedQuantised.Eval(p), signedFull.Eval(p), 0.5f * 1.5f / 32767.0f + 1e-6f);
+    }
+}
+
+//--------------------------------------------------------------------------
+
+#endif // _STORAGETEST__H_
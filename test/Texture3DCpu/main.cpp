@@ -1,6 +1,11 @@
 #include <gtest/gtest.h>
 
 #include "TrilinearTest.h"
+#include "LayoutTest.h"
+#include "SparseTest.h"
+#include "StorageTest.h"
+#include "SerialiseTest.h"
+#include "LazyTest.h"
 
 
 int main(int argc, char **argv)
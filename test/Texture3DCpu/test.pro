@@ -12,10 +12,18 @@ CONFIG += console c++11
 
 QMAKE_CXXFLAGS += -std=c++11 -g
 
-SOURCES += main.cpp
+SOURCES +=  main.cpp                                \
+            ../../src/Texture/TextureBatch.cpp          \
+            ../../src/Texture/TextureBatchAvx2.cpp      \
+            ../../src/Texture/TextureBatchAvx512.cpp
 
 HEADERS +=  *.h                                     \
-            ../../include/Texture/Texture3DCpu.h
+            ../../include/Texture/Texture3DCpu.h        \
+            ../../include/Texture/SparseTexture3DCpu.h  \
+            ../../include/Texture/TextureStorage.h      \
+            ../../include/Texture/BinaryBlob.h          \
+            ../../include/Texture/TextureBatch.h        \
+            ../../include/Texture/TextureLanes.h
 
 INCLUDEPATH +=  ../../include                       \
                 /usr/local/include                  \
@@ -0,0 +1,137 @@
+#ifndef _FRAMEPIPELINETEST__H_
+#define _FRAMEPIPELINETEST__H_
+
+//--------------------------------------------------------------------------
+
+#include "Shared.h"
+#include "Threading/framepipeline.h"
+#include <stdexcept>
+
+//--------------------------------------------------------------------------
+// A frame recording which stages it has been through
+//--------------------------------------------------------------------------
+struct TestFrame
+{
+    TestFrame(const int _id = -1) : id(_id), stages(0) {}
+
+    int id;
+    int stages;
+    std::thread::id middleThread;
+};
+
+//--------------------------------------------------------------------------
+
+TEST(FramePipeline, FramesComeOutInOrder)
+{
+    ThreadPool pool(3);
+    FramePipeline<TestFrame> pipeline([](TestFrame &f){ EXPECT_EQ(0, f.stages); f.stages++; },
+                                      [](TestFrame &f){ EXPECT_EQ(1, f.stages); f.stages++; },
+                                      [](TestFrame &f){ EXPECT_EQ(2, f.stages); f.stages++; },
+                                      pool);
+
+    std::vector<int> finishedIds;
+    TestFrame finished;
+    for(int i=0; i<50; i++)
+    {
+        if(pipeline.Advance(TestFrame(i), finished))
+        {
+            EXPECT_EQ(3, finished.stages);
+            finishedIds.push_back(finished.id);
+        }
+    }
+
+    // The first frame takes three steps to come out
+    EXPECT_EQ(48u, finishedIds.size());
+
+    while(pipeline.Flush(finished))
+    {
+        EXPECT_EQ(3, finished.stages);
+        finishedIds.push_back(finished.id);
+    }
+
+    EXPECT_TRUE(pipeline.Empty());
+    ASSERT_EQ(50u, finishedIds.size());
+    for(int i=0; i<50; i++)
+    {
+        EXPECT_EQ(i, finishedIds[i]);
+    }
+}
+
+//--------------------------------------------------------------------------
+
+TEST(FramePipeline, MiddleStageRunsOnCaller)
+{
+    ThreadPool pool(2);
+    FramePipeline<TestFrame> pipeline([](TestFrame &){},
+                                      [](TestFrame &f){ f.middleThread = std::this_thread::get_id(); },
+                                      [](TestFrame &){},
+                                      pool);
+
+    TestFrame finished;
+    int numFinished = 0;
+    for(int i=0; i<10; i++)
+    {
+        if(pipeline.Advance(TestFrame(i), finished))
+        {
+            EXPECT_EQ(std::this_thread::get_id(), finished.middleThread);
+            numFinished++;
+        }
+    }
+
+    EXPECT_EQ(8, numFinished);
+}
+
+//--------------------------------------------------------------------------
+
+TEST(FramePipeline, StagesOverlap)
+{
+    ThreadPool pool(2);
+
+    // The first and last stages each wait for the middle stage of the same step to run,
+    // so this only finishes if all three run at once
+    std::atomic<int> middleStep(0);
+    std::atomic<int> step(0);
+    auto waitForMiddle = [&](TestFrame &){
+        while(middleStep.load() < step.load()) { std::this_thread::yield(); }
+    };
+
+    FramePipeline<TestFrame> pipeline(waitForMiddle,
+                                      [&](TestFrame &){ middleStep = step.load(); },
+                                      waitForMiddle,
+                                      pool);
+
+    TestFrame finished;
+    pipeline.Advance(TestFrame(0), finished);
+    for(int i=1; i<20; i++)
+    {
+        step = i;
+        pipeline.Advance(TestFrame(i), finished);
+    }
+
+    EXPECT_EQ(19, middleStep.load());
+}
+
+//--------------------------------------------------------------------------
+
+TEST(FramePipeline, StageExceptionIsRethrown)
+{
+    ThreadPool pool(2);
+    FramePipeline<TestFrame> pipeline([](TestFrame &f){ if(f.id == 3) { throw std::runtime_error("bad frame"); } },
+                                      [](TestFrame &){},
+                                      [](TestFrame &){},
+                                      pool);
+
+    TestFrame finished;
+    for(int i=0; i<3; i++)
+    {
+        pipeline.Advance(TestFrame(i), finished);
+    }
+
+    EXPECT_THROW(pipeline.Advance(TestFrame(3), finished), std::runtime_error);
+    EXPECT_TRUE(pipeline.Empty());
+}
+
+//--------------------------------------------------------------------------
+
+
+#endif //_FRAMEPIPELINETEST__H_
@@ -0,0 +1,152 @@
+#ifndef _PARALLELFORTEST__H_
+#define _PARALLELFORTEST__H_
+
+//--------------------------------------------------------------------------
+
+#include "Shared.h"
+
+//--------------------------------------------------------------------------
+
+TEST(ThreadPool, ParallelForVisitsEachIndexOnce)
+{
+    ThreadPool pool(4);
+
+    for(auto schedule : {ThreadPool::Schedule::Static, ThreadPool::Schedule::Guided, ThreadPool::Schedule::Dynamic})
+    {
+        for(int dataSize : {0, 1, 3, 5, 1000, 10007})
+        {
+            std::vector<int> visits = CountVisits(pool, dataSize, schedule);
+            EXPECT_EQ(std::vector<int>(dataSize, 1), visits);
+        }
+    }
+}
+
+//--------------------------------------------------------------------------
+
+TEST(ThreadPool, ParallelForGrainSize)
+{
+    ThreadPool pool(3);
+
+    // Every chunk handed out must be at least the grain size, apart from the tail of the range
+    for(auto schedule : {ThreadPool::Schedule::Guided, ThreadPool::Schedule::Dynamic})
+    {
+        std::atomic<int> smallChunks(0);
+        pool.ParallelFor([&smallChunks](int start, int end){
+            if(end - start < 16 && end != 1000)
+            {
+                smallChunks++;
+            }
+        }, 1000, schedule, 16);
+
+        EXPECT_EQ(0, smallChunks.load());
+        EXPECT_EQ(std::vector<int>(1000, 1), CountVisits(pool, 1000, schedule, 16));
+    }
+}
+
+//--------------------------------------------------------------------------
+
+TEST(ThreadPool, ParallelForWithoutWorkers)
+{
+    ThreadPool pool(0);
+    EXPECT_EQ(0u, pool.GetNumWorkers());
+
+    // Everything runs on the calling thread in a single chunk
+    int numChunks = 0;
+    pool.ParallelFor([&numChunks](int start, int end){
+        EXPECT_EQ(0, start);
+        EXPECT_EQ(100, end);
+        numChunks++;
+    }, 100, ThreadPool::Schedule::Dynamic);
+
+    EXPECT_EQ(1, numChunks);
+}
+
+//--------------------------------------------------------------------------
+
+TEST(ThreadPool, NestedParallelFor)
+{
+    ThreadPool pool(2);
+
+    std::vector<std::atomic<int>> visits(64 * 64);
+    for(auto &v : visits)
+    {
+        v = 0;
+    }
+
+    pool.ParallelFor([&](int startRow, int endRow){
+        for(int row=startRow; row<endRow; row++)
+        {
+            pool.ParallelFor([&, row](int start, int end){
+                for(int i=start; i<end; i++)
+                {
+                    visits[(row * 64) + i]++;
+                }
+            }, 64, ThreadPool::Schedule::Dynamic, 4);
+        }
+    }, 64, ThreadPool::Schedule::Dynamic);
+
+    for(auto &v : visits)
+    {
+        EXPECT_EQ(1, v.load());
+    }
+}
+
+//--------------------------------------------------------------------------
+
+TEST(ThreadPool, ParallelForRethrowsOnCaller)
+{
+    ThreadPool pool(3);
+
+    for(auto schedule : {ThreadPool::Schedule::Static, ThreadPool::Schedule::Guided, ThreadPool::Schedule::Dynamic})
+    {
+        // Whichever thread runs the throwing chunk, the caller gets the exception once every chunk is done
+        std::atomic<int> running(0);
+        std::atomic<int> overlapped(0);
+        try
+        {
+            pool.ParallelFor([&running](int start, int end){
+                running++;
+                for(int i=start; i<end; i++)
+                {
+                    if(i == 500)
+                    {
+                        running--;
+                        throw std::runtime_error("chunk failed");
+                    }
+                }
+                running--;
+            }, 1000, schedule, 8);
+            ADD_FAILURE() << "ParallelFor did not throw";
+        }
+        catch(const std::runtime_error &e)
+        {
+            EXPECT_STREQ("chunk failed", e.what());
+            overlapped += running.load();
+        }
+        EXPECT_EQ(0, overlapped.load());
+
+        // The pool is still usable afterwards
+        EXPECT_EQ(std::vector<int>(1000, 1), CountVisits(pool, 1000, schedule, 8));
+    }
+}
+
+//--------------------------------------------------------------------------
+
+TEST(ThreadPool, SetNumWorkers)
+{
+    ThreadPool pool(1);
+    EXPECT_EQ(1u, pool.GetNumWorkers());
+
+    pool.SetNumWorkers(5);
+    EXPECT_EQ(5u, pool.GetNumWorkers());
+    EXPECT_EQ(std::vector<int>(777, 1), CountVisits(pool, 777, ThreadPool::Schedule::Guided));
+
+    pool.SetNumWorkers(0);
+    EXPECT_EQ(0u, pool.GetNumWorkers());
+    EXPECT_EQ(std::vector<int>(777, 1), CountVisits(pool, 777, ThreadPool::Schedule::Static));
+}
+
+//--------------------------------------------------------------------------
+
+
+#endif //_PARALLELFORTEST__H_
@@ -0,0 +1,42 @@
+#ifndef _SHARED__H_
+#define _SHARED__H_
+
+//--------------------------------------------------------------------------
+
+#include <gtest/gtest.h>
+#include <atomic>
+#include <vector>
+#include <stdexcept>
+#include "Threading/threadpool.h"
+
+
+//--------------------------------------------------------------------------
+// Run a ParallelFor counting how many times each index is visited
+//--------------------------------------------------------------------------
+std::vector<int> CountVisits(ThreadPool &_pool, const int _dataSize, const ThreadPool::Schedule _schedule, const int _grainSize = 1)
+{
+    std::vector<std::atomic<int>> visits(_dataSize);
+    for(auto &v : visits)
+    {
+        v = 0;
+    }
+
+    _pool.ParallelFor([&visits](int start, int end){
+        for(int i=start; i<end; i++)
+        {
+            visits[i]++;
+        }
+    }, _dataSize, _schedule, _grainSize);
+
+    std::vector<int> result(_dataSize);
+    for(int i=0; i<_dataSize; i++)
+    {
+        result[i] = visits[i].load();
+    }
+    return result;
+}
+
+//--------------------------------------------------------------------------
+
+
+#endif //_SHARED__H_
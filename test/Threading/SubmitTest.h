@@ -0,0 +1,59 @@
+#ifndef _SUBMITTEST__H_
+#define _SUBMITTEST__H_
+
+//--------------------------------------------------------------------------
+
+#include "Shared.h"
+
+//--------------------------------------------------------------------------
+
+TEST(ThreadPool, SubmitReturnsResult)
+{
+    ThreadPool pool(4);
+
+    std::vector<std::future<int>> results;
+    for(int i=0; i<100; i++)
+    {
+        results.push_back(pool.Submit([i](){ return i * i; }));
+    }
+
+    for(int i=0; i<100; i++)
+    {
+        EXPECT_EQ(i * i, results[i].get());
+    }
+}
+
+//--------------------------------------------------------------------------
+
+TEST(ThreadPool, SubmitParallelFor)
+{
+    ThreadPool pool(3);
+
+    // A task can split its own work across the pool
+    auto result = pool.Submit([&pool](){
+        return CountVisits(pool, 5000, ThreadPool::Schedule::Guided);
+    });
+
+    EXPECT_EQ(std::vector<int>(5000, 1), result.get());
+}
+
+//--------------------------------------------------------------------------
+
+TEST(ThreadPool, DestructorFinishesQueuedTasks)
+{
+    std::atomic<int> count(0);
+    {
+        ThreadPool pool(2);
+        for(int i=0; i<200; i++)
+        {
+            pool.Submit([&count](){ count++; });
+        }
+    }
+
+    EXPECT_EQ(200, count.load());
+}
+
+//--------------------------------------------------------------------------
+
+
+#endif //_SUBMITTEST__H_
@@ -0,0 +1,99 @@
+#ifndef _TRIPLEBUFFERTEST__H_
+#define _TRIPLEBUFFERTEST__H_
+
+//--------------------------------------------------------------------------
+
+#include "Shared.h"
+#include "Threading/triplebuffer.h"
+#include <thread>
+#include <algorithm>
+
+//--------------------------------------------------------------------------
+
+TEST(TripleBuffer, ReadsNewestPublished)
+{
+    TripleBuffer<int> buffer;
+    buffer.Reset(0);
+
+    EXPECT_FALSE(buffer.Update());
+    EXPECT_EQ(0, buffer.GetReadBuffer());
+
+    for(int i=1; i<=3; i++)
+    {
+        buffer.GetWriteBuffer() = i;
+        buffer.Publish();
+    }
+
+    // Older values are dropped
+    EXPECT_TRUE(buffer.Update());
+    EXPECT_EQ(3, buffer.GetReadBuffer());
+
+    // Nothing new, the read slot keeps its value
+    EXPECT_FALSE(buffer.Update());
+    EXPECT_EQ(3, buffer.GetReadBuffer());
+}
+
+//--------------------------------------------------------------------------
+
+TEST(TripleBuffer, UnpublishedWritesAreNotRead)
+{
+    TripleBuffer<int> buffer;
+    buffer.Reset(0);
+
+    buffer.GetWriteBuffer() = 1;
+    buffer.Publish();
+    buffer.GetWriteBuffer() = 2;
+
+    EXPECT_TRUE(buffer.Update());
+    EXPECT_EQ(1, buffer.GetReadBuffer());
+    EXPECT_FALSE(buffer.Update());
+}
+
+//--------------------------------------------------------------------------
+
+TEST(TripleBuffer, ConcurrentReadsAreComplete)
+{
+    const int numValues = 20000;
+    const int size = 64;
+
+    TripleBuffer<std::vector<int>> buffer;
+    buffer.Reset(std::vector<int>(size, 0));
+
+    // Each published slot is filled with one value, a torn read would mix two
+    std::thread producer([&buffer, numValues](){
+        for(int i=1; i<=numValues; i++)
+        {
+            std::vector<int> &slot = buffer.GetWriteBuffer();
+            std::fill(slot.begin(), slot.end(), i);
+            buffer.Publish();
+        }
+    });
+
+    int last = 0;
+    bool torn = false;
+    bool backwards = false;
+    while(last < numValues)
+    {
+        if(!buffer.Update())
+        {
+            std::this_thread::yield();
+            continue;
+        }
+
+        const std::vector<int> &slot = buffer.GetReadBuffer();
+        torn |= (std::count(slot.begin(), slot.end(), slot[0]) != size);
+        backwards |= (slot[0] <= last);
+        last = slot[0];
+    }
+
+    producer.join();
+
+    EXPECT_FALSE(torn);
+    EXPECT_FALSE(backwards);
+    EXPECT_EQ(numValues, last);
+}
+
+//--------------------------------------------------------------------------
+
+
+#endif //_TRIPLEBUFFERTEST__H_
@@ -0,0 +1,13 @@
+#include <gtest/gtest.h>
+
+#include "ParallelForTest.h"
+#include "SubmitTest.h"
+#include "FramePipelineTest.h"
+#include "TripleBufferTest.h"
+
+
+int main(int argc, char **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
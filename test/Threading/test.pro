@@ -0,0 +1,29 @@
+QT       -= core gui
+
+
+TARGET = TestThreading
+
+DESTDIR = ../bin
+
+TEMPLATE = app
+
+CONFIG += console c++11
+
+QMAKE_CXXFLAGS += -std=c++11 -g
+
+SOURCES += main.cpp                                 \
+            ../../src/Threading/threadpool.cpp
+
+HEADERS +=  *.h                                     \
+            ../../include/Threading/threadpool.h     \
+            ../../include/Threading/framepipeline.h  \
+            ../../include/Threading/triplebuffer.h
+
+INCLUDEPATH +=  ../../include                       \
+                /usr/local/include                  \
+                /usr/include
+
+LIBS += -L/usr/local/lib -L/usr/lib -lgtest -lpthread
+
+
+OBJECTS_DIR = ./obj